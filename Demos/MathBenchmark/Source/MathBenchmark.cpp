@@ -0,0 +1,212 @@
+#include <Mako.h>
+#include <ctime>
+#include <cstdlib>
+#include <cmath>
+using namespace Mako;
+
+// Compares the scalar, SSE and AVX versions of the Matrix4<Float32> kernels.
+// Every benchmark is run once per SIMD_LEVEL the processor supports, and
+// the time per operation is printed. The results of every level are checked
+// against those of the scalar kernels, so a wrong kernel is reported instead
+// of just looking faster. The number parsing the OBJ loader uses is checked
+// against strtod() too.
+
+const UInt32 numMatrices = 4096;
+const UInt32 numVectors  = 65536;
+const UInt32 numRounds   = 200;
+
+//! How far a result may be from the scalar one, relative to it's size
+const Float32 epsilon = 1e-4f;
+
+static const wchar_t* simdLevelNames[] = { L"Scalar", L"SSE", L"AVX" };
+
+class MathBenchmark : public Mako::SimpleApplication
+{
+private:
+	ArrayList<Matrix4f> a, b, out;
+	ArrayList<Vec3df> vects;
+	ArrayList<Float32> vects4;
+	//! The results of the scalar kernels
+	ArrayList<Matrix4f> refProducts, refInverses;
+	ArrayList<Float32> refVects4;
+	UInt32 numMismatches;
+
+	//! A random transformation, so that it's invertible
+	static Matrix4f RandomMatrix()
+	{
+		Matrix4f m;
+		m.SetRotationDegrees(Vec3df(Float32(rand() % 360), Float32(rand() % 360), Float32(rand() % 360)));
+		m.SetTranslation(Vec3df(Float32(rand() % 100), Float32(rand() % 100), Float32(rand() % 100)));
+		return m;
+	}
+
+	static void Report(const wchar_t* name, clock_t start, UInt32 numOps)
+	{
+		Float64 ns = Float64(clock() - start) / CLOCKS_PER_SEC * 1000000000.0 / numOps;
+		wprintf(L"  %-28s %8.2f ns\n", name, ns);
+	}
+
+	//! Checks count floats against the scalar results, and reports the first
+	//! one that differs
+	void Check(const wchar_t* name, const Float32* results, const Float32* ref, UInt32 count)
+	{
+		for (UInt32 i = 0; i < count; ++i)
+		{
+			if (fabs(results[i] - ref[i]) > epsilon * Max(1.f, Float32(fabs(ref[i]))))
+			{
+				wprintf(L"  %-28s MISMATCH at %u: %f instead of %f\n", name, i, results[i], ref[i]);
+				++numMismatches;
+				return;
+			}
+		}
+	}
+
+	void Check(const wchar_t* name, const ArrayList<Matrix4f>& results, const ArrayList<Matrix4f>& ref)
+	{
+		for (UInt32 i = 0; i < results.size(); ++i)
+		{
+			for (UInt32 j = 0; j < 16; ++j)
+			{
+				if (fabs(results[i][j] - ref[i][j]) > epsilon * Max(1.f, Float32(fabs(ref[i][j]))))
+				{
+					wprintf(L"  %-28s MISMATCH at matrix %u: %f instead of %f\n", name, i,
+						results[i][j], ref[i][j]);
+					++numMismatches;
+					return;
+				}
+			}
+		}
+	}
+
+	//! Checks fast_atof_move() against strtod(), with numbers like the ones
+	//! exporters write, up to more fractional digits than it scales
+	void CheckParsing()
+	{
+		static const Int8* numbers[] =
+		{
+			"0", "1.5", "-42.125", "3.0e2", "-1.25E-3",
+			"0.123456789012345",
+			"0.12345678901234567",
+			"-7.99999999999999999999999999999999",
+			"1.000000000000000000000000000000000000000001e-2"
+		};
+
+		wprintf(L"Parsing\n");
+		for (UInt32 i = 0; i < sizeof(numbers) / sizeof(numbers[0]); ++i)
+		{
+			Float32 value;
+			const Int8* end = fast_atof_move(numbers[i], value);
+			const Float32 ref = Float32(strtod(numbers[i], 0));
+			if (*end || fabs(value - ref) > epsilon * Max(1.f, Float32(fabs(ref))))
+			{
+				wprintf(L"  %-28S MISMATCH: %f instead of %f\n", numbers[i], value, ref);
+				++numMismatches;
+			}
+		}
+		wprintf(L"\n");
+	}
+
+	//! Computes the results every level is checked against
+	void ComputeReferences()
+	{
+		UInt32 i;
+		SetSIMDLevel(SL_SCALAR);
+
+		refProducts.resize(numMatrices);
+		refInverses.resize(numMatrices);
+		for (i = 0; i < numMatrices; ++i)
+		{
+			refProducts[i].SetByproductNoCheck(a[i], b[i]);
+			a[i].GetInverse(refInverses[i]);
+		}
+
+		refVects4.resize(numVectors * 4);
+		for (i = 0; i < numVectors; ++i)
+			a[0].TransformVect(&refVects4[i*4], vects[i]);
+	}
+
+	void RunBenchmarks(SIMD_LEVEL level)
+	{
+		UInt32 r, i;
+		clock_t start;
+
+		wprintf(L"%s\n", simdLevelNames[level]);
+
+		start = clock();
+		for (r = 0; r < numRounds; ++r)
+			for (i = 0; i < numMatrices; ++i)
+				out[i].SetByproductNoCheck(a[i], b[i]);
+		Report(L"Matrix4f * Matrix4f", start, numRounds * numMatrices);
+		Check(L"Matrix4f * Matrix4f", out, refProducts);
+
+		start = clock();
+		for (r = 0; r < numRounds; ++r)
+			Matrix4f::MultiplyBatch(&out[0], &a[0], &b[0], numMatrices);
+		Report(L"Matrix4f::MultiplyBatch", start, numRounds * numMatrices);
+		Check(L"Matrix4f::MultiplyBatch", out, refProducts);
+
+		start = clock();
+		for (r = 0; r < numRounds; ++r)
+			for (i = 0; i < numMatrices; ++i)
+				a[i].GetInverse(out[i]);
+		Report(L"Matrix4f::GetInverse", start, numRounds * numMatrices);
+		Check(L"Matrix4f::GetInverse", out, refInverses);
+
+		start = clock();
+		for (r = 0; r < numRounds / 10; ++r)
+			for (i = 0; i < numVectors; ++i)
+				a[0].TransformVect(&vects4[i*4], vects[i]);
+		Report(L"Matrix4f::TransformVect", start, numRounds / 10 * numVectors);
+		Check(L"Matrix4f::TransformVect", &vects4[0], &refVects4[0], numVectors * 4);
+
+		start = clock();
+		for (r = 0; r < numRounds / 10; ++r)
+			a[0].TransformVects(&vects4[0], &vects[0], numVectors);
+		Report(L"Matrix4f::TransformVects", start, numRounds / 10 * numVectors);
+		Check(L"Matrix4f::TransformVects", &vects4[0], &refVects4[0], numVectors * 4);
+	}
+public:
+	void Initialize()
+	{
+		UInt32 i;
+		for (i = 0; i < numMatrices; ++i)
+		{
+			a.push_back(RandomMatrix());
+			b.push_back(RandomMatrix());
+		}
+		out.resize(numMatrices);
+
+		for (i = 0; i < numVectors; ++i)
+			vects.push_back(Vec3df(Float32(rand() % 100), Float32(rand() % 100), Float32(rand() % 100)));
+		vects4.resize(numVectors * 4);
+
+		const UInt32 features = GetCPUFeatures();
+		wprintf(L"CPU features:%s%s%s%s%s\n\n",
+			features & CPUF_SSE   ? L" SSE"    : L"",
+			features & CPUF_SSE2  ? L" SSE2"   : L"",
+			features & CPUF_SSE3  ? L" SSE3"   : L"",
+			features & CPUF_SSE41 ? L" SSE4.1" : L"",
+			features & CPUF_AVX   ? L" AVX"    : L"");
+
+		const SIMD_LEVEL best = SetSIMDLevel(SL_AVX);
+		ComputeReferences();
+
+		numMismatches = 0;
+		CheckParsing();
+		for (UInt32 level = SL_SCALAR; level <= UInt32(best); ++level)
+		{
+			SetSIMDLevel(SIMD_LEVEL(level));
+			RunBenchmarks(SIMD_LEVEL(level));
+		}
+		SetSIMDLevel(best);
+
+		if (numMismatches)
+			wprintf(L"\n%u checks didn't match the reference results\n", numMismatches);
+		else
+			wprintf(L"\nEvery check matched the reference results\n");
+
+		Quit();
+	}
+};
+
+RUN_MAKO_APPLICATION(MathBenchmark)
\ No newline at end of file
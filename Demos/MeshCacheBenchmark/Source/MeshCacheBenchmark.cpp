@@ -0,0 +1,63 @@
+#include <Mako.h>
+#include <ctime>
+using namespace Mako;
+
+// Compares how long it takes to load a mesh from it's source file and from
+// a mesh cache converted from it. Usage: MeshCacheBenchmark <mesh file>
+// The mesh cache is written next to the mesh, with .makomeshcache appended.
+
+const UInt32 numLoads = 20;
+
+class MeshCacheBenchmark : public Mako::SimpleApplication
+{
+private:
+	static void Report(const wchar_t* name, clock_t start)
+	{
+		Float64 ms = Float64(clock() - start) / CLOCKS_PER_SEC * 1000.0 / numLoads;
+		wprintf(L"  %-28s %8.2f ms\n", name, ms);
+	}
+
+	void LoadRepeatedly(const FilePath& filePath)
+	{
+		for (UInt32 i = 0; i < numLoads; ++i)
+		{
+			Mesh* m = GD()->LoadMeshFromFile(filePath);
+			m->Hold();
+			m->Drop();
+		}
+	}
+public:
+	void Initialize()
+	{
+		// Headless, only the loading is measured
+		InitGraphics(GraphicsCreationParams(Text("MeshCacheBenchmark"), Size2d(64, 64),
+		                                    false, false, GDT_SOFTWARE));
+
+		if (GetCmdLnArgs().size() < 2)
+		{
+			wprintf(L"Usage: MeshCacheBenchmark <mesh file>\n");
+			Quit();
+			return;
+		}
+
+		const FilePath source = GetCmdLnArgs()[1];
+		const FilePath cache  = source.GetAbs() + Text(".makomeshcache");
+
+		clock_t start = clock();
+		GD()->ConvertMeshToMeshCache(source, cache);
+		wprintf(L"Converted in %.2f ms\n\n",
+			Float64(clock() - start) / CLOCKS_PER_SEC * 1000.0);
+
+		start = clock();
+		LoadRepeatedly(source);
+		Report(L"Source mesh", start);
+
+		start = clock();
+		LoadRepeatedly(cache);
+		Report(L"Mesh cache", start);
+
+		Quit();
+	}
+};
+
+RUN_MAKO_APPLICATION(MeshCacheBenchmark)
@@ -20,12 +20,20 @@
 #include "MakoNetworkingDevice.h"
 #include "MakoVersion.h"
 #include "MakoRUN_MAKO_APPLICATION.h"
+#include "MakoAABBox3d.h"
+#include "MakoAsyncLoad.h"
+#include "MakoAsyncLoader.h"
+#include "MakoAtomic.h"
 #include "MakoAnimatedMesh.h"
 #include "MakoApplication.h"
 #include "MakoLightmappedDiffTexMtl.h"
+#include "MakoAllocator.h"
 #include "MakoArrayList.h"
 #include "MakoAudioDevice.h"
 #include "MakoBitManipulator.h"
+#include "MakoBlockCompression.h"
+#include "MakoBufferedStream.h"
+#include "MakoBVH3d.h"
 #include "MakoCamera.h"
 #include "MakoColor.h"
 #include "MakoConsole.h"
@@ -33,48 +41,66 @@
 #include <MakoCgDevice.h>
 #include <MakoCgMtl.h>
 #include <MakoCgShader.h>
+#include "MakoDDS.h"
+#include "MakoDDSLoader.h"
+#include "MakoDecodedMesh.h"
 #include "MakoDevice.h"
 #include "MakoDynamicBox.h"
 #include "MakoDynamicSphere.h"
 #include "MakoEntity3d.h"
 #include "Makoevents.h"
+#include "MakoEventQueue.h"
 #include "MakoException.h"
 #include "MakoT2Vertex.h"
 #include "MakoFileIO.h"
 #include "MakoFileStream.h"
 #include "MakoFPSCamera.h"
+#include "MakoFrustum.h"
 #include "MakoFont.h"
 #include "MakoGameStateApplication.h"
 #include "MakoMaterial.h"
 #include "MakoGraphicsDevice.h"
+#include "MakoImageResampler.h"
 #include "MakoIndexedMeshData.h"
+#include "MakoJobSystem.h"
 #include "MakoLinkedList.h"
 #include "MakoMakoMeshLoader.h"
 #include "MakoMap.h"
+#include "MakoMappedFile.h"
 #include "MakoMaterial.h"
 #include "MakoMath.h"
 #include "MakoMatrix4.h"
 #include "MakoMemoryStream.h"
 #include "MakoMesh.h"
+#include "MakoMeshCache.h"
+#include "MakoMeshCacheLoader.h"
 #include "MakoMeshData.h"
 #include "MakoMeshLoader.h"
 #include "MakoMeshManipulator.h"
 #include "MakoMeshSceneNode.h"
+#include "MakoNormalVertex.h"
 #include "MakoObjMeshLoader.h"
+#include "MakoObjectPool.h"
 #include "MakoOSDevice.h"
 #include "MakoPhysics3dDevice.h"
 #include "Makoplatform.h"
 #include "MakoReferenceCounted.h"
+#include "MakoRenderQueue.h"
+#include "MakoResourceCache.h"
 #include "MakoScene2d.h"
 #include "MakoScene2dNode.h"
 #include "MakoScene3d.h"
 #include "MakoScene3dNode.h"
+#include "MakoSIMD.h"
 #include "MakoSimpleApplication.h"
 #include "MakoSimpleKeyEventReceiver.h"
 #include "MakoSimpleMesh.h"
 #include "MakoDiffTexMtl.h"
 #include "MakoSkybox.h"
+#include "MakoSoftwareDevice.h"
+#include "MakoSphere3d.h"
 #include "MakoSprite.h"
+#include "MakoSpriteBatch.h"
 #include "MakoStandardVertex.h"
 #include "MakoStaticBox.h"
 #include "MakoStaticGeometry.h"
@@ -83,7 +109,10 @@
 #include "MakoStream.h"
 #include "MakoString.h"
 #include "MakoString.h"
+#include "MakoStringBuilder.h"
+#include "MakoStringId.h"
 #include "MakoTexture.h"
+#include "MakoThread.h"
 #include "MakoUtilities.h"
 #include "MakoVec2d.h"
 #include "MakoVec3d.h"
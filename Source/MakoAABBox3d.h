@@ -0,0 +1,182 @@
+#pragma once
+#include "MakoCommon.h"
+#include "MakoVec3d.h"
+#include "MakoMatrix4.h"
+#include <limits>
+
+MAKO_BEGIN_NAMESPACE
+
+//! An axis aligned bounding box. A box whose minimum edge is greater than
+//! it's maximum edge contains nothing, and is called empty. Default
+//! constructed boxes are empty.
+template <typename T>
+class AABBox3d
+{
+public:
+	/////////////////////////////////////////////////////
+	// Fields
+
+	//! The corner with the smallest coordinates
+	Vec3d<T> minEdge;
+	//! The corner with the largest coordinates
+	Vec3d<T> maxEdge;
+
+	/////////////////////////////////////////////////////
+	// Constructor(s)/Deconstructor
+
+	//! Constructs an empty box
+	MAKO_INLINE AABBox3d()
+	{ MakeEmpty(); }
+
+	//! Constructs a box from it's corners
+	MAKO_INLINE AABBox3d(const Vec3d<T>& minEdge, const Vec3d<T>& maxEdge)
+		: minEdge(minEdge), maxEdge(maxEdge) {}
+
+	/////////////////////////////////////////////////////
+	// Methods
+
+	//! Makes this box contain nothing
+	MAKO_INLINE void MakeEmpty()
+	{
+		minEdge = Vec3d<T>(std::numeric_limits<T>::max());
+		maxEdge = Vec3d<T>(-std::numeric_limits<T>::max());
+	}
+
+	//! Check if this box contains nothing
+	MAKO_INLINE bool IsEmpty() const
+	{ return minEdge.x > maxEdge.x || minEdge.y > maxEdge.y || minEdge.z > maxEdge.z; }
+
+	//! Grows the box so that it contains p
+	MAKO_INLINE void AddInternalPoint(const Vec3d<T>& p)
+	{
+		if (p.x < minEdge.x) minEdge.x = p.x;
+		if (p.y < minEdge.y) minEdge.y = p.y;
+		if (p.z < minEdge.z) minEdge.z = p.z;
+		if (p.x > maxEdge.x) maxEdge.x = p.x;
+		if (p.y > maxEdge.y) maxEdge.y = p.y;
+		if (p.z > maxEdge.z) maxEdge.z = p.z;
+	}
+
+	//! Grows the box so that it contains box. Empty boxes are ignored.
+	MAKO_INLINE void AddInternalBox(const AABBox3d<T>& box)
+	{
+		if (box.IsEmpty())
+			return;
+		AddInternalPoint(box.minEdge);
+		AddInternalPoint(box.maxEdge);
+	}
+
+	//! Check if p is inside of this box, or on it's surface
+	MAKO_INLINE bool IsPointInside(const Vec3d<T>& p) const
+	{
+		return p.x >= minEdge.x && p.x <= maxEdge.x &&
+			   p.y >= minEdge.y && p.y <= maxEdge.y &&
+			   p.z >= minEdge.z && p.z <= maxEdge.z;
+	}
+
+	//! Check if this box and box overlap
+	MAKO_INLINE bool Intersects(const AABBox3d<T>& box) const
+	{
+		return minEdge.x <= box.maxEdge.x && maxEdge.x >= box.minEdge.x &&
+			   minEdge.y <= box.maxEdge.y && maxEdge.y >= box.minEdge.y &&
+			   minEdge.z <= box.maxEdge.z && maxEdge.z >= box.minEdge.z;
+	}
+
+	//! Get the center of the box
+	MAKO_INLINE Vec3d<T> GetCenter() const
+	{ return (minEdge + maxEdge) / (T)2; }
+
+	//! Get half of the size of the box along every axis
+	MAKO_INLINE Vec3d<T> GetExtent() const
+	{ return (maxEdge - minEdge) / (T)2; }
+
+	//! Get the surface area of the box, 0 if it's empty
+	MAKO_INLINE T GetSurfaceArea() const
+	{
+		if (IsEmpty())
+			return (T)0;
+		const Vec3d<T> size = maxEdge - minEdge;
+		return (T)2 * (size.x*size.y + size.y*size.z + size.z*size.x);
+	}
+
+	//! Get the squared distance of p to the closest point of the box, 0 if p is inside
+	MAKO_INLINE T GetDistanceSq(const Vec3d<T>& p) const
+	{
+		T d = (T)0;
+		if (p.x < minEdge.x) d += (minEdge.x - p.x) * (minEdge.x - p.x);
+		else if (p.x > maxEdge.x) d += (p.x - maxEdge.x) * (p.x - maxEdge.x);
+		if (p.y < minEdge.y) d += (minEdge.y - p.y) * (minEdge.y - p.y);
+		else if (p.y > maxEdge.y) d += (p.y - maxEdge.y) * (p.y - maxEdge.y);
+		if (p.z < minEdge.z) d += (minEdge.z - p.z) * (minEdge.z - p.z);
+		else if (p.z > maxEdge.z) d += (p.z - maxEdge.z) * (p.z - maxEdge.z);
+		return d;
+	}
+
+	//! Check if the ray start + dir * t, minT <= t <= maxT, hits the box.
+	//! invDir is 1 / dir for every component, so it can be reused for many boxes.
+	//! \param[out] t The distance along the ray at which it enters the box, or
+	//! minT if it starts inside.
+	//! \return false if the ray misses the box, or the box is empty.
+	MAKO_INLINE bool IntersectsRay(const Vec3d<T>& start, const Vec3d<T>& invDir,
+								   T minT, T maxT, T& t) const
+	{
+		if (IsEmpty())
+			return false;
+
+		// Clip the ray against the three slabs of the box
+		T t0 = (minEdge.x - start.x) * invDir.x, t1 = (maxEdge.x - start.x) * invDir.x;
+		if (t0 > t1) { const T tmp = t0; t0 = t1; t1 = tmp; }
+		if (t0 > minT) minT = t0;
+		if (t1 < maxT) maxT = t1;
+
+		t0 = (minEdge.y - start.y) * invDir.y; t1 = (maxEdge.y - start.y) * invDir.y;
+		if (t0 > t1) { const T tmp = t0; t0 = t1; t1 = tmp; }
+		if (t0 > minT) minT = t0;
+		if (t1 < maxT) maxT = t1;
+
+		t0 = (minEdge.z - start.z) * invDir.z; t1 = (maxEdge.z - start.z) * invDir.z;
+		if (t0 > t1) { const T tmp = t0; t0 = t1; t1 = tmp; }
+		if (t0 > minT) minT = t0;
+		if (t1 < maxT) maxT = t1;
+
+		t = minT;
+		return minT <= maxT;
+	}
+
+	//! Get the axis aligned box that contains this box after it was transformed
+	//! by mat. Empty boxes stay empty.
+	AABBox3d<T> GetTransformed(const Matrix4<T>& mat) const;
+};
+
+template <typename T>
+MAKO_INLINE AABBox3d<T> AABBox3d<T>::GetTransformed(const Matrix4<T>& mat) const
+{
+	if (IsEmpty())
+		return *this;
+
+	// Transform the center, then add up the absolute projections of the
+	// extent onto every axis (Jim Arvo, Graphics Gems 1990).
+	const Vec3d<T> center = GetCenter();
+	const Vec3d<T> extent = GetExtent();
+	const T c[3] = { center.x, center.y, center.z };
+	const T e[3] = { extent.x, extent.y, extent.z };
+
+	Vec3d<T> newCenter(mat[12], mat[13], mat[14]);
+	Vec3d<T> newExtent(0);
+	for (UInt32 i = 0; i < 3; ++i)
+	{
+		newCenter.x += mat[i*4+0] * c[i];
+		newCenter.y += mat[i*4+1] * c[i];
+		newCenter.z += mat[i*4+2] * c[i];
+
+		newExtent.x += fabs(mat[i*4+0]) * e[i];
+		newExtent.y += fabs(mat[i*4+1]) * e[i];
+		newExtent.z += fabs(mat[i*4+2]) * e[i];
+	}
+	return AABBox3d<T>(newCenter - newExtent, newCenter + newExtent);
+}
+
+//! Typedef for a Float32 bounding box
+typedef AABBox3d<Float32> AABBox3df;
+
+MAKO_END_NAMESPACE
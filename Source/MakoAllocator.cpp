@@ -0,0 +1,249 @@
+#include "MakoAllocator.h"
+#include "MakoMath.h"
+#include <cstring>
+
+MAKO_BEGIN_NAMESPACE
+
+/////////////////////////////////////////////////////////////////
+// Statistics
+
+static volatile Int32 categoryAllocations[MC_ENUM_LENGTH];
+static volatile Int32 categoryFrees[MC_ENUM_LENGTH];
+static volatile Int32 categoryLiveBytes[MC_ENUM_LENGTH];
+
+MemoryStats GetMemoryStats(MEMORY_CATEGORY category)
+{
+	MemoryStats s;
+	s.numAllocations     = static_cast<UInt32>(AtomicLoad(&categoryAllocations[category]));
+	s.numLiveAllocations = s.numAllocations - static_cast<UInt32>(AtomicLoad(&categoryFrees[category]));
+	s.liveBytes          = static_cast<UInt32>(AtomicLoad(&categoryLiveBytes[category]));
+	return s;
+}
+
+const Int8* GetMemoryCategoryName(MEMORY_CATEGORY category)
+{
+	static const Int8* const names[MC_ENUM_LENGTH] =
+	{ "General", "Graphics", "Scene", "Mesh", "String", "Frame" };
+	return names[category];
+}
+
+/////////////////////////////////////////////////////////////////
+// Pools
+
+//! The difference in size between two block sizes
+static const UInt32 BLOCK_GRANULARITY = 16;
+static const UInt32 NUM_BLOCK_SIZES = MAX_POOLED_ALLOCATION / BLOCK_GRANULARITY;
+//! The number of blocks a thread takes from or gives back to the shared
+//! lists at a time. A thread gives blocks back once it holds twice as many.
+static const UInt32 BLOCK_BATCH = 32;
+//! The size of the chunks blocks are carved out of
+static const UInt32 CHUNK_SIZE = 64 * 1024;
+
+struct FreeBlock
+{
+	FreeBlock* next;
+};
+
+//! The free blocks of a thread
+struct ThreadBlockCache
+{
+	FreeBlock* blocks[NUM_BLOCK_SIZES];
+	UInt32 numBlocks[NUM_BLOCK_SIZES];
+};
+
+static MAKO_THREAD_LOCAL ThreadBlockCache* threadCache = nullptr;
+
+//! The blocks no thread holds, guarded by sharedLock. Chunks are never
+//! freed, only their blocks reused.
+static SpinLock sharedLock;
+static FreeBlock* sharedBlocks[NUM_BLOCK_SIZES];
+
+static MAKO_INLINE UInt32 GetBlockSizeIndex(size_t size)
+{ return size == 0 ? 0 : static_cast<UInt32>((size - 1) / BLOCK_GRANULARITY); }
+
+static ThreadBlockCache* GetThreadCache()
+{
+	if (!threadCache)
+	{
+		// It's never freed, since other threads may use the blocks it holds
+		// once the thread exited
+		threadCache = new ThreadBlockCache;
+		memset(threadCache, 0, sizeof(ThreadBlockCache));
+	}
+	return threadCache;
+}
+
+//! Moves up to BLOCK_BATCH shared blocks to a thread, carving a new chunk
+//! if there are none
+static void TakeSharedBlocks(ThreadBlockCache* cache, UInt32 index)
+{
+	const UInt32 blockSize = (index + 1) * BLOCK_GRANULARITY;
+	ScopedLock<SpinLock> l(sharedLock);
+
+	if (!sharedBlocks[index])
+	{
+		UInt8* chunk = static_cast<UInt8*>(::operator new(CHUNK_SIZE));
+		const UInt32 numBlocks = CHUNK_SIZE / blockSize;
+		for (UInt32 i = numBlocks; i-- > 0;)
+		{
+			FreeBlock* b = reinterpret_cast<FreeBlock*>(chunk + i * blockSize);
+			b->next = sharedBlocks[index];
+			sharedBlocks[index] = b;
+		}
+	}
+
+	for (UInt32 i = 0; i < BLOCK_BATCH && sharedBlocks[index]; ++i)
+	{
+		FreeBlock* b = sharedBlocks[index];
+		sharedBlocks[index] = b->next;
+		b->next = cache->blocks[index];
+		cache->blocks[index] = b;
+		++cache->numBlocks[index];
+	}
+}
+
+//! Moves BLOCK_BATCH blocks of a thread to the shared lists
+static void GiveSharedBlocks(ThreadBlockCache* cache, UInt32 index)
+{
+	ScopedLock<SpinLock> l(sharedLock);
+	for (UInt32 i = 0; i < BLOCK_BATCH; ++i)
+	{
+		FreeBlock* b = cache->blocks[index];
+		cache->blocks[index] = b->next;
+		b->next = sharedBlocks[index];
+		sharedBlocks[index] = b;
+	}
+	cache->numBlocks[index] -= BLOCK_BATCH;
+}
+
+void* AllocateMemory(size_t size, MEMORY_CATEGORY category)
+{
+	AtomicIncrement(&categoryAllocations[category]);
+	AtomicAdd(&categoryLiveBytes[category], static_cast<Int32>(size));
+
+	if (size > MAX_POOLED_ALLOCATION)
+		return ::operator new(size);
+
+	const UInt32 index = GetBlockSizeIndex(size);
+	ThreadBlockCache* cache = GetThreadCache();
+	if (!cache->blocks[index])
+		TakeSharedBlocks(cache, index);
+
+	FreeBlock* b = cache->blocks[index];
+	cache->blocks[index] = b->next;
+	--cache->numBlocks[index];
+	return b;
+}
+
+void FreeMemory(void* p, size_t size, MEMORY_CATEGORY category)
+{
+	if (!p)
+		return ;
+
+	AtomicIncrement(&categoryFrees[category]);
+	AtomicAdd(&categoryLiveBytes[category], -static_cast<Int32>(size));
+
+	if (size > MAX_POOLED_ALLOCATION)
+	{
+		::operator delete(p);
+		return ;
+	}
+
+	const UInt32 index = GetBlockSizeIndex(size);
+	ThreadBlockCache* cache = GetThreadCache();
+	FreeBlock* b = static_cast<FreeBlock*>(p);
+	b->next = cache->blocks[index];
+	cache->blocks[index] = b;
+	if (++cache->numBlocks[index] >= 2 * BLOCK_BATCH)
+		GiveSharedBlocks(cache, index);
+}
+
+/////////////////////////////////////////////////////////////////
+// FrameArena
+
+//! Get size rounded up to a multiple of the alignment
+static MAKO_INLINE UInt32 AlignFrameAllocation(size_t size)
+{ return (static_cast<UInt32>(size) + FrameArena::ALIGNMENT - 1) & ~(FrameArena::ALIGNMENT - 1); }
+
+FrameArena::FrameArena(UInt32 capacity)
+: block(nullptr), memory(nullptr), capacity(0), used(0), numAllocations(0), peak(0),
+  overflow(nullptr)
+{
+	AllocateBlock(capacity);
+}
+
+FrameArena::~FrameArena()
+{
+	Reset();
+	::operator delete(block);
+}
+
+void FrameArena::AllocateBlock(UInt32 capacity)
+{
+	::operator delete(block);
+	block = ::operator new(capacity + ALIGNMENT);
+	memory = reinterpret_cast<UInt8*>((reinterpret_cast<size_t>(block) + ALIGNMENT - 1) &
+		~static_cast<size_t>(ALIGNMENT - 1));
+	this->capacity = capacity;
+}
+
+void* FrameArena::Allocate(size_t size)
+{
+	const UInt32 alignedSize = AlignFrameAllocation(size);
+	const UInt32 offset = static_cast<UInt32>(AtomicAdd(&used, static_cast<Int32>(alignedSize)));
+	AtomicIncrement(&numAllocations);
+	AtomicIncrement(&categoryAllocations[MC_FRAME]);
+	AtomicAdd(&categoryLiveBytes[MC_FRAME], static_cast<Int32>(alignedSize));
+
+	if (offset + alignedSize <= capacity)
+		return memory + offset;
+
+	// The block is full
+	Overflow* o = static_cast<Overflow*>(::operator new(sizeof(Overflow) + ALIGNMENT + alignedSize));
+	overflowLock.Lock();
+	o->next = overflow;
+	overflow = o;
+	overflowLock.Unlock();
+	return reinterpret_cast<void*>((reinterpret_cast<size_t>(o + 1) + ALIGNMENT - 1) &
+		~static_cast<size_t>(ALIGNMENT - 1));
+}
+
+void FrameArena::Reset()
+{
+	const UInt32 bytesUsed = static_cast<UInt32>(AtomicExchange(&used, 0));
+	const Int32 allocations = AtomicExchange(&numAllocations, 0);
+	AtomicAdd(&categoryFrees[MC_FRAME], allocations);
+	AtomicAdd(&categoryLiveBytes[MC_FRAME], -static_cast<Int32>(bytesUsed));
+	peak = Max(peak, bytesUsed);
+
+	ScopedLock<SpinLock> l(overflowLock);
+	if (overflow)
+	{
+		while (overflow)
+		{
+			Overflow* next = overflow->next;
+			::operator delete(overflow);
+			overflow = next;
+		}
+
+		// Grow the block, so frames like this one fit
+		UInt32 newCapacity = capacity ? capacity : static_cast<UInt32>(DEFAULT_CAPACITY);
+		while (newCapacity < bytesUsed)
+			newCapacity *= 2;
+		AllocateBlock(newCapacity);
+	}
+}
+
+FrameArena& GetFrameArena()
+{
+	// Created when it's first used, so static objects of other files can
+	// use it. It's never deleted, since memory may be taken from it until
+	// the program exits.
+	static FrameArena* arena = new FrameArena;
+	return *arena;
+}
+
+//! Creates the arena before main(), so threads never create it at once
+static FrameArena& frameArenaInit = GetFrameArena();
+
+MAKO_END_NAMESPACE
@@ -0,0 +1,232 @@
+#pragma once
+#include "MakoCommon.h"
+#include "MakoAtomic.h"
+#include "MakoThread.h"
+#include <cstddef>
+#include <new>
+
+MAKO_BEGIN_NAMESPACE
+
+//! The subsystems allocations are counted for
+enum MEMORY_CATEGORY
+{
+	MC_GENERAL,
+	MC_GRAPHICS,
+	MC_SCENE,
+	MC_MESH,
+	MC_STRING,
+	//! Allocations from the FrameArena
+	MC_FRAME,
+	MC_ENUM_LENGTH
+};
+
+//! The allocations of a MEMORY_CATEGORY that went through AllocateMemory()
+//! or the FrameArena
+struct MemoryStats
+{
+	//! The number of allocations made since the program started
+	UInt32 numAllocations;
+	//! The number of them that weren't freed yet
+	UInt32 numLiveAllocations;
+	//! The bytes of them that weren't freed yet
+	UInt32 liveBytes;
+};
+
+//! Get the allocations of a subsystem
+MAKO_API MemoryStats GetMemoryStats(MEMORY_CATEGORY category);
+
+//! Get the name of a subsystem, like "Graphics"
+MAKO_API const Int8* GetMemoryCategoryName(MEMORY_CATEGORY category);
+
+//! The largest allocation AllocateMemory() takes from it's pools. Larger
+//! ones go to the global operator new.
+const UInt32 MAX_POOLED_ALLOCATION = 256;
+
+//! Allocates memory, counting it for a subsystem. Allocations of up to
+//! MAX_POOLED_ALLOCATION bytes are taken from pools of blocks of the same
+//! size, in steps of 16 bytes. Every thread has it's own lists of free
+//! blocks, so threads don't contend for a lock, and only go to the shared
+//! lists when theirs are empty, or hold too many blocks.
+//! It may be called by any thread.
+MAKO_API void* AllocateMemory(size_t size, MEMORY_CATEGORY category = MC_GENERAL);
+
+//! Frees memory AllocateMemory() returned. Any thread may free it.
+//! \param[in] size The size it was allocated with
+//! \param[in] category The category it was allocated with
+MAKO_API void FreeMemory(void* p, size_t size, MEMORY_CATEGORY category = MC_GENERAL);
+
+//! A linear allocator for memory that is only needed for the current frame.
+//! Allocating increments an offset into one block of memory, and freeing
+//! does nothing: Reset() frees everything at once. SimpleApplication resets
+//! the arena GetFrameArena() returns after EndScene().
+//!
+//! Allocations that don't fit are taken from the heap until the next reset,
+//! which then grows the block, so the following frames fit. Allocate() may
+//! be called by any thread; memory taken from the arena must not be used
+//! after the frame it was taken in.
+class FrameArena
+{
+public:
+	enum
+	{
+		DEFAULT_CAPACITY = 1 << 20,
+		//! Every allocation is aligned to it
+		ALIGNMENT = 16
+	};
+private:
+	//! A heap allocation made when the block was full
+	struct Overflow
+	{
+		Overflow* next;
+	};
+
+	void* block;
+	UInt8* memory;
+	UInt32 capacity;
+	//! The bytes of the block that were allocated, which may be more than
+	//! capacity once it's full
+	volatile Int32 used;
+	volatile Int32 numAllocations;
+	UInt32 peak;
+
+	SpinLock overflowLock;
+	Overflow* overflow;
+
+	void AllocateBlock(UInt32 capacity);
+
+	// Not copyable
+	FrameArena(const FrameArena&);
+	FrameArena& operator = (const FrameArena&);
+public:
+	MAKO_API FrameArena(UInt32 capacity = DEFAULT_CAPACITY);
+	MAKO_API ~FrameArena();
+
+	//! Allocate ALIGNMENT aligned memory that is freed by the next Reset()
+	MAKO_API void* Allocate(size_t size);
+
+	//! Frees every allocation
+	MAKO_API void Reset();
+
+	//! Get the number of bytes allocated since the last Reset()
+	MAKO_INLINE UInt32 GetBytesUsed() const
+	{ return static_cast<UInt32>(used); }
+
+	//! Get the most bytes that were allocated between two resets
+	MAKO_INLINE UInt32 GetPeakBytesUsed() const
+	{ return peak; }
+
+	MAKO_INLINE UInt32 GetCapacity() const
+	{ return capacity; }
+};
+
+//! Get the arena SimpleApplication resets every frame
+MAKO_API FrameArena& GetFrameArena();
+
+//! An STL allocator that allocates with AllocateMemory(), so ArrayLists and
+//! Maps can take their memory from the pools:
+//! <tt>ArrayList<UInt32, PoolAllocator<UInt32, MC_MESH> > indices;</tt>
+template <class T, MEMORY_CATEGORY C = MC_GENERAL>
+class PoolAllocator
+{
+public:
+	typedef T value_type;
+	typedef T* pointer;
+	typedef const T* const_pointer;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef size_t size_type;
+	typedef ptrdiff_t difference_type;
+
+	template <class U>
+	struct rebind
+	{ typedef PoolAllocator<U, C> other; };
+
+	MAKO_INLINE PoolAllocator() {}
+
+	template <class U>
+	MAKO_INLINE PoolAllocator(const PoolAllocator<U, C>&) {}
+
+	MAKO_INLINE pointer address(reference r) const
+	{ return &r; }
+
+	MAKO_INLINE const_pointer address(const_reference r) const
+	{ return &r; }
+
+	MAKO_INLINE pointer allocate(size_type n, const void* hint = 0)
+	{ return static_cast<pointer>(AllocateMemory(n * sizeof(T), C)); }
+
+	MAKO_INLINE void deallocate(pointer p, size_type n)
+	{ FreeMemory(p, n * sizeof(T), C); }
+
+	MAKO_INLINE size_type max_size() const
+	{ return static_cast<size_type>(-1) / sizeof(T); }
+
+	MAKO_INLINE void construct(pointer p, const T& value)
+	{ new (static_cast<void*>(p)) T(value); }
+
+	MAKO_INLINE void destroy(pointer p)
+	{ p->~T(); }
+};
+
+template <class T, class U, MEMORY_CATEGORY C>
+MAKO_INLINE bool operator==(const PoolAllocator<T, C>&, const PoolAllocator<U, C>&)
+{ return true; }
+
+template <class T, class U, MEMORY_CATEGORY C>
+MAKO_INLINE bool operator!=(const PoolAllocator<T, C>&, const PoolAllocator<U, C>&)
+{ return false; }
+
+//! An STL allocator that allocates from the FrameArena, for containers that
+//! don't outlive the frame. Memory is only freed by FrameArena::Reset(), so
+//! reserve() them instead of letting them grow.
+template <class T>
+class FrameAllocator
+{
+public:
+	typedef T value_type;
+	typedef T* pointer;
+	typedef const T* const_pointer;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef size_t size_type;
+	typedef ptrdiff_t difference_type;
+
+	template <class U>
+	struct rebind
+	{ typedef FrameAllocator<U> other; };
+
+	MAKO_INLINE FrameAllocator() {}
+
+	template <class U>
+	MAKO_INLINE FrameAllocator(const FrameAllocator<U>&) {}
+
+	MAKO_INLINE pointer address(reference r) const
+	{ return &r; }
+
+	MAKO_INLINE const_pointer address(const_reference r) const
+	{ return &r; }
+
+	MAKO_INLINE pointer allocate(size_type n, const void* hint = 0)
+	{ return static_cast<pointer>(GetFrameArena().Allocate(n * sizeof(T))); }
+
+	MAKO_INLINE void deallocate(pointer p, size_type n) {}
+
+	MAKO_INLINE size_type max_size() const
+	{ return static_cast<size_type>(-1) / sizeof(T); }
+
+	MAKO_INLINE void construct(pointer p, const T& value)
+	{ new (static_cast<void*>(p)) T(value); }
+
+	MAKO_INLINE void destroy(pointer p)
+	{ p->~T(); }
+};
+
+template <class T, class U>
+MAKO_INLINE bool operator==(const FrameAllocator<T>&, const FrameAllocator<U>&)
+{ return true; }
+
+template <class T, class U>
+MAKO_INLINE bool operator!=(const FrameAllocator<T>&, const FrameAllocator<U>&)
+{ return false; }
+
+MAKO_END_NAMESPACE
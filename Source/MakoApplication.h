@@ -22,6 +22,7 @@ class Console;
 class Physics3dDevice;
 class NetworkingDevice;
 class FileSystem;
+class JobSystem;
 
 //! This is the most important class in the Mako Game Engine,
 //! it ties together all the devices and other functionalities.
@@ -107,6 +108,14 @@ public:
 	//! GetFileSystem().
 	MAKO_REALINLINE FileSystem* FS() const
 	{ return GetFileSystem(); }
+
+	//! Get the job system, which runs jobs on worker threads
+	virtual JobSystem* GetJobSystem() const = 0;
+
+	//! Shorter way of writing in code to get the job system. Identical to
+	//! GetJobSystem().
+	MAKO_REALINLINE JobSystem* JS() const
+	{ return GetJobSystem(); }
 	
 	//! Gets the mesh manipulator
 	//! \return The mesh manipulator
@@ -121,10 +130,19 @@ public:
 	//! \return The console
 	virtual Console* GetConsole() const = 0;
 
-	//! Post an event. All applicable event receivers will receive this event
-	//! in OnEvent().
+	//! Post an event. It's copied into a queue, so it doesn't have to outlive
+	//! the call, and it can be posted from any thread. All applicable event
+	//! receivers will receive this event in OnEvent(), at the next
+	//! DispatchEvents().
 	//! \param[in] e The event to be sent
 	virtual void PostEvent(Event* e) = 0;
+
+	//! Sends the events that were posted to their receivers: first every
+	//! KeyEvent, then every MouseButtonEvent, and so on in the order of
+	//! EVENT_TYPE, each type in the order they were posted. Events posted by
+	//! receivers are sent at the next call. It's called once every frame by
+	//! Run(), after the devices were updated and before Frame().
+	virtual void DispatchEvents() = 0;
 	
 	//! Add a new event receiver. Returns the index of it.
 	//! \param[in] er The receiver to be added
@@ -57,8 +57,12 @@ MAKO_BEGIN_NAMESPACE
 //! To find documentation on methods and more, look up these stl classes.
 //! When C++0x is released, this will be a typedef instead
 //!
-template <typename T>
-class ArrayList : public std::vector<T>
+//! The allocator is std::allocator by default. PoolAllocator and
+//! FrameAllocator (see MakoAllocator.h) take the memory from Mako's pools
+//! and the frame arena instead.
+//!
+template <typename T, typename A = std::allocator<T> >
+class ArrayList : public std::vector<T, A>
 {
 public:
 	//! Empty deconstructor
@@ -66,7 +70,12 @@ public:
 
 	//! Constructor constructs with a size
 	//! \param[in] size The initial size of the array
-	MAKO_INLINE ArrayList(UInt32 size) : std::vector<T>(size) {}
+	MAKO_INLINE ArrayList(UInt32 size) : std::vector<T, A>(size) {}
+
+	//! Constructor constructs with a size, and copies of value
+	//! \param[in] size The initial size of the array
+	//! \param[in] value The value of every element
+	MAKO_INLINE ArrayList(UInt32 size, const T& value) : std::vector<T, A>(size, value) {}
 
 	//! Empy deconstructor
 	MAKO_INLINE ~ArrayList() {}
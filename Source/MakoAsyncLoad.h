@@ -0,0 +1,72 @@
+#pragma once
+#include "MakoCommon.h"
+#include "MakoReferenceCounted.h"
+#include "MakoString.h"
+#include "MakoTexture.h"
+#include "MakoMesh.h"
+#include "MakoFont.h"
+
+MAKO_BEGIN_NAMESPACE
+
+// Forward declaration
+class AsyncLoader;
+
+//! The state of an AsyncLoad
+enum ASYNC_LOAD_STATE
+{
+	//! The resource is being read, decoded or waiting to be created
+	ALS_LOADING,
+	//! The resource was created, AsyncLoad::Get() returns it
+	ALS_LOADED,
+	//! The resource couldn't be loaded, AsyncLoad::GetError() tells why
+	ALS_FAILED,
+	ALS_ENUM_LENGTH
+};
+
+//! A handle to a resource that is loaded in the background, returned by the
+//! GraphicsDevice's Load*Async() methods. The state only changes in
+//! GraphicsDevice::UpdateAsyncLoads(), so it can be polled every frame
+//! without locking.
+template <typename T>
+class AsyncLoad : public ReferenceCounted
+{
+	friend class AsyncLoader;
+private:
+	T* resource;
+	ASYNC_LOAD_STATE state;
+	String error;
+
+	MAKO_INLINE void SetLoaded(T* r)
+	{ resource = r; resource->Hold(); state = ALS_LOADED; }
+
+	MAKO_INLINE void SetFailed(const String& e)
+	{ error = e; state = ALS_FAILED; }
+public:
+	MAKO_INLINE AsyncLoad()
+	: resource(nullptr), state(ALS_LOADING) {}
+
+	MAKO_INLINE ~AsyncLoad()
+	{ if (resource) resource->Drop(); }
+
+	MAKO_INLINE ASYNC_LOAD_STATE GetState() const
+	{ return state; }
+
+	//! Check if the resource was either loaded, or failed to load
+	MAKO_INLINE bool IsDone() const
+	{ return state != ALS_LOADING; }
+
+	//! Get the resource, or nullptr if it's still loading or failed to load.
+	//! The handle holds the resource, so Hold() it to keep it longer.
+	MAKO_INLINE T* Get() const
+	{ return resource; }
+
+	//! Get why the resource failed to load
+	MAKO_INLINE const String& GetError() const
+	{ return error; }
+};
+
+typedef AsyncLoad<Texture> AsyncTexture;
+typedef AsyncLoad<Mesh>    AsyncMesh;
+typedef AsyncLoad<Font>    AsyncFont;
+
+MAKO_END_NAMESPACE
@@ -0,0 +1,556 @@
+#include "MakoAsyncLoader.h"
+#include "MakoApplication.h"
+#include "MakoGraphicsDevice.h"
+#include "MakoJobSystem.h"
+#include "MakoFileSystem.h"
+#include "MakoFileStream.h"
+#include "MakoMemoryStream.h"
+#include "MakoTextureLoader.h"
+#include "MakoMeshLoader.h"
+#include "MakoDecodedMesh.h"
+#include "MakoResourceCache.h"
+#include "MakoConsole.h"
+#include "MakoStringBuilder.h"
+#include "MakoException.h"
+
+MAKO_BEGIN_NAMESPACE
+
+struct AsyncLoader::Request
+{
+	MAKO_INLINE Request()
+	: loader(nullptr), cacheKey(NULL_STRING_ID), meshLoader(nullptr), texLoader(nullptr), index(0),
+	  texture(nullptr), mesh(nullptr), font(nullptr), meshDecoded(false), fileData(nullptr),
+	  fileSize(0), failed(false) {}
+
+	MAKO_INLINE ~Request()
+	{
+		delete [] static_cast<Byte*>(texParams.data);
+		for (UInt32 i = 0; i < meshTextures.size(); ++i)
+			delete [] static_cast<Byte*>(meshTextures[i].data);
+		delete [] fileData;
+	}
+
+	AsyncLoader* loader;
+	REQUEST_TYPE type;
+	FilePath path;
+	//! The key of the resource in the ResourceCache
+	StringId cacheKey;
+	MeshLoader* meshLoader;
+	TextureLoader* texLoader;
+	//! Index in AsyncLoader::requests
+	UInt32 index;
+
+	//! The handle of the request, depending on it's type
+	AsyncTexture* texture;
+	AsyncMesh* mesh;
+	AsyncFont* font;
+
+	TextureCreationParams texParams;
+
+	DecodedMesh decodedMesh;
+	bool meshDecoded;
+	//! The decoded textures of decodedMesh, data is nullptr for those that failed
+	ArrayList<TextureCreationParams> meshTextures;
+	ArrayList<MeshTexture> meshTextureJobs;
+	//! The ResourceCache keys of the textures of decodedMesh, NULL_STRING_ID
+	//! for those that weren't found
+	ArrayList<StringId> meshTextureKeys;
+	//! Whether each texture of decodedMesh was cached, so it wasn't decoded
+	ArrayList<UInt8> meshTexturesCached;
+
+	//! The whole file, for fonts and meshes that couldn't be decoded
+	UInt8* fileData;
+	UInt32 fileSize;
+
+	bool failed;
+	String error;
+};
+
+//! Get the number of bytes a decoded texture has, 0 if it wasn't decoded
+static MAKO_INLINE UInt32 GetTextureSize(const TextureCreationParams& params)
+{
+	const UInt32 size = params.data ? GetImageDataSize(params.format, params.size) : 0;
+	// A mip chain adds about a third
+	return params.generateMipMaps || params.numMipLevels > 1 ? size + size / 3 : size;
+}
+
+AsyncLoader::AsyncLoader(GraphicsDevice* gd, TextureLoader* const* texLoaders,
+						 UInt32 numTexLoaders)
+: gd(gd), texLoaders(texLoaders), numTexLoaders(numTexLoaders), numReadyDone(0),
+  numDecoding(0), uploadBudget(DEFAULT_UPLOAD_BUDGET) {}
+
+AsyncLoader::~AsyncLoader()
+{
+	// Jobs that are still decoding use the requests. If the JobSystem is gone
+	// already, it's workers are too, and the jobs it had queued never run.
+	JobSystem* js = APP()->JS();
+	if (js)
+	{
+		while (AtomicLoad(&numDecoding))
+		{
+			if (!js->RunJob())
+				Thread::YieldCPU();
+		}
+	}
+
+	while (!requests.empty())
+		DeleteRequest(requests.back());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////
+// Jobs
+
+UInt32 AsyncLoader::FindTextureLoader(const FilePath& path) const
+{
+	String ext = path.GetExt();
+	ext.LowerCase();
+
+	for (UInt32 i = 0; i < numTexLoaders; ++i)
+	{
+		if (texLoaders[i]->IsLoadableFileExt(ext))
+			return i;
+	}
+	return numTexLoaders;
+}
+
+void AsyncLoader::DecodeTexture(void* request)
+{
+	Request* r = static_cast<Request*>(request);
+	try
+	{
+		FileInputStream* file = new FileInputStream(r->path);
+		file->Hold();
+		try
+		{
+			if (!r->texLoader->Decode(file, r->texParams))
+			{
+				r->failed = true;
+				r->error  = Text("The file isn't of the texture's type");
+			}
+		}
+		catch (Exception&)
+		{
+			file->Drop();
+			throw;
+		}
+		file->Drop();
+	}
+	catch (Exception& e)
+	{
+		r->failed = true;
+		r->error  = e.description;
+	}
+	FinishDecoding(r);
+}
+
+void AsyncLoader::DecodeMesh(void* request)
+{
+	Request* r = static_cast<Request*>(request);
+	try
+	{
+		FileInputStream* file = new FileInputStream(r->path);
+		file->Hold();
+		try
+		{
+			r->meshDecoded = r->meshLoader->Decode(file, r->decodedMesh);
+		}
+		catch (Exception&)
+		{
+			file->Drop();
+			throw;
+		}
+		file->Drop();
+	}
+	catch (Exception& e)
+	{
+		r->failed = true;
+		r->error  = e.description;
+	}
+
+	// The loader can only load the mesh on the thread that renders
+	if (!r->failed && !r->meshDecoded)
+	{
+		ReadFile(r);
+		return;
+	}
+
+	const UInt32 numTextures = r->decodedMesh.texturePaths.size();
+	if (r->failed || !numTextures)
+	{
+		FinishDecoding(r);
+		return;
+	}
+
+	// Decode the textures in parallel, the mesh is done when all of them are
+	JobSystem* js = APP()->JS();
+	r->meshTextures.resize(numTextures);
+	r->meshTextureJobs.resize(numTextures);
+	r->meshTextureKeys.resize(numTextures, NULL_STRING_ID);
+	r->meshTexturesCached.resize(numTextures, 0);
+
+	Job* finish = js->CreateJob(&FinishDecoding, r);
+	for (UInt32 i = 0; i < numTextures; ++i)
+	{
+		r->meshTextureJobs[i].request = r;
+		r->meshTextureJobs[i].index   = i;
+
+		Job* job = js->CreateJob(&DecodeMeshTexture, &r->meshTextureJobs[i]);
+		js->AddContinuation(job, finish);
+		js->Submit(job);
+	}
+	js->Submit(finish);
+}
+
+void AsyncLoader::DecodeMeshTexture(void* meshTexture)
+{
+	MeshTexture* mt = static_cast<MeshTexture*>(meshTexture);
+	Request* r = mt->request;
+	TextureCreationParams& params = r->meshTextures[mt->index];
+
+	// Textures that fail are left without data, and are logged when the mesh
+	// is created
+	try
+	{
+		FilePath found = APP()->FS()->FindFile(r->decodedMesh.texturePaths[mt->index]);
+		if (found.GetAbs().IsEmpty())
+			return;
+
+		const AsyncLoader* loader = r->loader;
+		const UInt32 tt = loader->FindTextureLoader(found);
+		if (tt == loader->numTexLoaders)
+			return;
+
+		// Textures the meshes share are only decoded once
+		StringId& key = r->meshTextureKeys[mt->index];
+		key = ResourceCache::MakeKey(found, tt);
+		if (loader->gd->GetResourceCache()->Contains(RCT_TEXTURE, key))
+		{
+			r->meshTexturesCached[mt->index] = 1;
+			return;
+		}
+
+		FileInputStream* file = new FileInputStream(found);
+		file->Hold();
+		try
+		{
+			loader->texLoaders[tt]->Decode(file, params);
+		}
+		catch (Exception&)
+		{
+			file->Drop();
+			throw;
+		}
+		file->Drop();
+	}
+	catch (Exception&)
+	{
+		delete [] static_cast<Byte*>(params.data);
+		params.data = nullptr;
+	}
+}
+
+void AsyncLoader::ReadFile(void* request)
+{
+	Request* r = static_cast<Request*>(request);
+	try
+	{
+		FileInputStream* file = new FileInputStream(r->path);
+		file->Hold();
+		r->fileSize = file->GetSize();
+		r->fileData = new UInt8[r->fileSize];
+		try
+		{
+			file->ReadTo(r->fileData, r->fileSize);
+		}
+		catch (Exception&)
+		{
+			file->Drop();
+			throw;
+		}
+		file->Drop();
+	}
+	catch (Exception& e)
+	{
+		r->failed = true;
+		r->error  = e.description;
+	}
+	FinishDecoding(r);
+}
+
+void AsyncLoader::FinishDecoding(void* request)
+{
+	Request* r = static_cast<Request*>(request);
+
+	// r may be created and deleted as soon as the lock is released
+	AsyncLoader* loader = r->loader;
+	loader->lock.Lock();
+	loader->decoded.push_back(r);
+	loader->lock.Unlock();
+	AtomicDecrement(&loader->numDecoding);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////
+// Requests
+
+AsyncLoader::Request* AsyncLoader::AddRequest(REQUEST_TYPE type, const FilePath& path)
+{
+	Request* r = new Request;
+	r->loader = this;
+	r->type   = type;
+	r->path   = path;
+	r->index  = requests.size();
+	requests.push_back(r);
+	AtomicIncrement(&numDecoding);
+	return r;
+}
+
+void AsyncLoader::DeleteRequest(Request* r)
+{
+	// Move the last request into r's place
+	requests[r->index] = requests.back();
+	requests[r->index]->index = r->index;
+	requests.pop_back();
+
+	if (r->texture) r->texture->Drop();
+	if (r->mesh)    r->mesh->Drop();
+	if (r->font)    r->font->Drop();
+	delete r;
+}
+
+AsyncTexture* AsyncLoader::LoadTexture(const FilePath& path, TextureLoader* loader,
+									   StringId cacheKey)
+{
+	Texture* cached = gd->GetResourceCache()->FindTexture(cacheKey);
+	if (cached)
+	{
+		AsyncTexture* t = new AsyncTexture;
+		t->SetLoaded(cached);
+		return t;
+	}
+
+	Request* r = AddRequest(RT_TEXTURE, path);
+	r->cacheKey  = cacheKey;
+	r->texLoader = loader;
+	r->texture   = new AsyncTexture;
+	r->texture->Hold();
+
+	APP()->JS()->Submit(APP()->JS()->CreateJob(&DecodeTexture, r));
+	return r->texture;
+}
+
+AsyncMesh* AsyncLoader::LoadMesh(const FilePath& path, MeshLoader* loader,
+								 StringId cacheKey)
+{
+	Mesh* cached = gd->GetResourceCache()->FindMesh(cacheKey);
+	if (cached)
+	{
+		AsyncMesh* m = new AsyncMesh;
+		m->SetLoaded(cached);
+		return m;
+	}
+
+	Request* r = AddRequest(RT_MESH, path);
+	r->cacheKey   = cacheKey;
+	r->meshLoader = loader;
+	r->mesh       = new AsyncMesh;
+	r->mesh->Hold();
+
+	APP()->JS()->Submit(APP()->JS()->CreateJob(&DecodeMesh, r));
+	return r->mesh;
+}
+
+AsyncFont* AsyncLoader::LoadFont(const FilePath& path)
+{
+	Request* r = AddRequest(RT_FONT, path);
+	r->font = new AsyncFont;
+	r->font->Hold();
+
+	APP()->JS()->Submit(APP()->JS()->CreateJob(&ReadFile, r));
+	return r->font;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////
+// Creating
+
+void AsyncLoader::Create(Request* r)
+{
+	Console* console = APP()->GetConsole();
+	ResourceCache* cache = gd->GetResourceCache();
+
+	if (!r->failed)
+	{
+		try
+		{
+			switch (r->type)
+			{
+			case RT_TEXTURE:
+				{
+					// The texture may have been loaded since the request was made
+					Texture* t = cache->FindTexture(r->cacheKey);
+					if (!t)
+					{
+						// The texture owns the pixels now
+						t = gd->CreateTexture(r->texParams);
+						r->texParams.data = nullptr;
+						cache->AddTexture(r->cacheKey, t);
+					}
+					r->texture->SetLoaded(t);
+					break;
+				}
+			case RT_MESH:
+				{
+					// The mesh may have been loaded since the request was made
+					Mesh* m = cache->FindMesh(r->cacheKey);
+					if (m)
+					{
+						r->mesh->SetLoaded(m);
+						break;
+					}
+
+					if (r->meshDecoded)
+					{
+						// The textures are held while the mesh is created, so those no
+						// material uses are deleted afterwards
+						ArrayList<Texture*> textures(r->meshTextures.size(), nullptr);
+						for (UInt32 i = 0; i < textures.size(); ++i)
+						{
+							const StringId key = r->meshTextureKeys[i];
+							Texture* t = key == NULL_STRING_ID ? nullptr : cache->FindTexture(key);
+							if (!t && r->meshTextures[i].data)
+							{
+								t = gd->CreateTexture(r->meshTextures[i]);
+								r->meshTextures[i].data = nullptr;
+								cache->AddTexture(key, t);
+							}
+							else if (!t && r->meshTexturesCached[i])
+							{
+								// The texture was purged from the cache since it was decoded
+								try
+								{
+									t = gd->LoadTextureFromFile(r->decodedMesh.texturePaths[i]);
+								}
+								catch (Exception&) {}
+							}
+
+							if (!t)
+							{
+								MAKO_LOG(console, LL_MEDIUM, Text("Failed to load texture (") +
+									r->decodedMesh.texturePaths[i] + StringChar(')'));
+								continue;
+							}
+							textures[i] = t;
+							textures[i]->Hold();
+						}
+
+						m = CreateDecodedMesh(gd, r->decodedMesh, textures);
+
+						for (UInt32 i = 0; i < textures.size(); ++i)
+							if (textures[i])
+								textures[i]->Drop();
+					}
+					else
+					{
+						// The stream deletes the file's data
+						MemoryInputStream* stream = new MemoryInputStream(r->fileData, r->fileSize);
+						r->fileData = nullptr;
+						stream->Hold();
+						try
+						{
+							m = r->meshLoader->Load(stream);
+						}
+						catch (Exception&)
+						{
+							stream->Drop();
+							throw;
+						}
+						stream->Drop();
+					}
+
+					cache->AddMesh(r->cacheKey, m);
+					r->mesh->SetLoaded(m);
+					break;
+				}
+			case RT_FONT:
+				{
+					// The font reads from the stream for as long as it exists
+					MemoryInputStream* stream = new MemoryInputStream(r->fileData, r->fileSize);
+					r->fileData = nullptr;
+					stream->Hold();
+					Font* f;
+					try
+					{
+						f = gd->LoadFont(stream);
+					}
+					catch (Exception&)
+					{
+						stream->Drop();
+						throw;
+					}
+					stream->Drop();
+					r->font->SetLoaded(f);
+					break;
+				}
+			}
+		}
+		catch (Exception& e)
+		{
+			r->failed = true;
+			r->error  = e.description;
+		}
+	}
+
+	if (r->failed)
+	{
+		if (r->texture) r->texture->SetFailed(r->error);
+		if (r->mesh)    r->mesh->SetFailed(r->error);
+		if (r->font)    r->font->SetFailed(r->error);
+
+		if (MAKO_IS_LOG_LEVEL_ENABLED(console, LL_MEDIUM))
+		{
+			StringBuilder message(r->path.GetAbs().GetLength() + r->error.GetLength() + 20);
+			message.Append(Text("Failed to load [")).Append(r->path.GetAbs()).Append(Text("]: ")).Append(r->error);
+			console->Log(LL_MEDIUM, message);
+		}
+	}
+	else if (MAKO_IS_LOG_LEVEL_ENABLED(console, LL_LOW))
+	{
+		StringBuilder message(r->path.GetAbs().GetLength() + 10);
+		message.Append(Text("Loaded [")).Append(r->path.GetAbs()).Append(StringChar(']'));
+		console->Log(LL_LOW, message);
+	}
+
+	DeleteRequest(r);
+}
+
+void AsyncLoader::Update()
+{
+	lock.Lock();
+	ready.insert(ready.end(), decoded.begin(), decoded.end());
+	decoded.clear();
+	lock.Unlock();
+
+	UInt32 uploaded = 0;
+	while (numReadyDone < ready.size())
+	{
+		Request* r = ready[numReadyDone];
+
+		UInt32 size = GetTextureSize(r->texParams) + r->decodedMesh.GetSize() + r->fileSize;
+		for (UInt32 i = 0; i < r->meshTextures.size(); ++i)
+			size += GetTextureSize(r->meshTextures[i]);
+
+		if (uploaded && uploaded + size > uploadBudget)
+			break;
+
+		++numReadyDone;
+		Create(r);
+		uploaded += size;
+	}
+
+	if (numReadyDone == ready.size())
+	{
+		ready.clear();
+		numReadyDone = 0;
+	}
+}
+
+MAKO_END_NAMESPACE
@@ -0,0 +1,134 @@
+#pragma once
+#include "MakoCommon.h"
+#include "MakoArrayList.h"
+#include "MakoFilePath.h"
+#include "MakoStringId.h"
+#include "MakoThread.h"
+#include "MakoAsyncLoad.h"
+
+MAKO_BEGIN_NAMESPACE
+
+// Forward declarations
+class GraphicsDevice;
+class TextureLoader;
+class MeshLoader;
+
+//! Loads textures, meshes and fonts in the background for a GraphicsDevice.
+//! Files are read and decoded by jobs of the application's JobSystem. The
+//! textures a mesh uses are decoded by jobs of their own, and the mesh is
+//! done when all of them are. Only creating the resources on the
+//! GraphicsDevice is left to Update(), which the thread that renders calls
+//! once per frame. It creates as many of them as fit into the upload budget,
+//! in the order their decoding finished.
+//!
+//! Resources that are in the GraphicsDevice's ResourceCache aren't loaded
+//! again, and the ones that are loaded are added to it.
+class AsyncLoader
+{
+private:
+	enum REQUEST_TYPE
+	{
+		RT_TEXTURE,
+		RT_MESH,
+		RT_FONT
+	};
+
+	struct Request;
+
+	//! A texture of a mesh request, decoded by a job of it's own
+	struct MeshTexture
+	{
+		Request* request;
+		UInt32 index;
+	};
+
+	GraphicsDevice* gd;
+	TextureLoader* const* texLoaders;
+	UInt32 numTexLoaders;
+
+	//! Guards decoded
+	Mutex lock;
+	//! Requests whose decoding finished, in the order it did
+	ArrayList<Request*> decoded;
+	//! Requests taken from decoded that didn't fit into the budget yet.
+	//! Only the thread that renders uses it.
+	ArrayList<Request*> ready;
+	UInt32 numReadyDone;
+
+	//! Every request that wasn't created yet
+	ArrayList<Request*> requests;
+	//! Requests that are still being decoded
+	volatile Int32 numDecoding;
+
+	UInt32 uploadBudget;
+
+	static void DecodeTexture(void* request);
+	static void DecodeMesh(void* request);
+	static void DecodeMeshTexture(void* meshTexture);
+	static void ReadFile(void* request);
+	static void FinishDecoding(void* request);
+
+	//! Get the index of the loader for a texture file's extension, or
+	//! numTexLoaders if there's no such loader
+	UInt32 FindTextureLoader(const FilePath& path) const;
+
+	Request* AddRequest(REQUEST_TYPE type, const FilePath& path);
+	void Create(Request* r);
+	void DeleteRequest(Request* r);
+public:
+	enum
+	{
+		//! The default upload budget: 8 MB per frame
+		DEFAULT_UPLOAD_BUDGET = 8 * 1024 * 1024
+	};
+
+	//! \param[in] gd The GraphicsDevice to create the resources on
+	//! \param[in] texLoaders The texture loaders to decode textures with. They
+	//! must be able to decode several textures at once.
+	MAKO_API AsyncLoader(GraphicsDevice* gd, TextureLoader* const* texLoaders,
+						 UInt32 numTexLoaders);
+
+	//! Waits for the requests that are being decoded, and deletes every
+	//! request that wasn't created yet
+	MAKO_API ~AsyncLoader();
+
+	//! Starts loading a texture.
+	//! \param[in] path The path of the texture, which must exist
+	//! \param[in] loader The loader to decode the texture with
+	//! \param[in] cacheKey The key of the texture in the ResourceCache. If
+	//! it's cached, the returned handle is loaded already.
+	MAKO_API AsyncTexture* LoadTexture(const FilePath& path, TextureLoader* loader,
+									   StringId cacheKey);
+
+	//! Starts loading a mesh and it's textures. Meshes whose loader can't
+	//! decode them are only read in the background, and loaded in Update().
+	//! \param[in] path The path of the mesh, which must exist
+	//! \param[in] loader The loader to decode the mesh with
+	//! \param[in] cacheKey The key of the mesh in the ResourceCache, like
+	//! LoadTexture()'s
+	MAKO_API AsyncMesh* LoadMesh(const FilePath& path, MeshLoader* loader,
+								 StringId cacheKey);
+
+	//! Starts loading a font. The file is read in the background.
+	//! \param[in] path The path of the font, which must exist
+	MAKO_API AsyncFont* LoadFont(const FilePath& path);
+
+	//! Creates the resources that finished decoding, until the upload budget
+	//! of this frame is used up. At least one is created every call, so
+	//! resources bigger than the budget are still created.
+	MAKO_API void Update();
+
+	//! Set how many bytes of pixels, vertices and indices Update() creates
+	//! at most per call
+	MAKO_INLINE void SetUploadBudget(UInt32 bytesPerFrame)
+	{ uploadBudget = bytesPerFrame; }
+
+	MAKO_INLINE UInt32 GetUploadBudget() const
+	{ return uploadBudget; }
+
+	//! Get the number of requests that weren't created yet
+	MAKO_INLINE UInt32 GetNumPending() const
+	{ return requests.size(); }
+};
+
+MAKO_END_NAMESPACE
@@ -0,0 +1,98 @@
+#pragma once
+#include "MakoCommon.h"
+#if MAKO_COMPILER == MAKO_COMPILER_MSVC
+#include <intrin.h>
+#endif
+
+MAKO_BEGIN_NAMESPACE
+
+//! Atomic operations on 32 bit integers and pointers. Each of them is a
+//! full memory barrier, so writes made before one are visible to a thread
+//! that sees it's result.
+
+#if MAKO_COMPILER == MAKO_COMPILER_MSVC
+
+//! Adds one to *p
+//! \return The new value
+MAKO_INLINE Int32 AtomicIncrement(volatile Int32* p)
+{ return _InterlockedIncrement((volatile long*)p); }
+
+//! Subtracts one from *p
+//! \return The new value
+MAKO_INLINE Int32 AtomicDecrement(volatile Int32* p)
+{ return _InterlockedDecrement((volatile long*)p); }
+
+//! Adds n to *p
+//! \return The previous value
+MAKO_INLINE Int32 AtomicAdd(volatile Int32* p, Int32 n)
+{ return _InterlockedExchangeAdd((volatile long*)p, n); }
+
+//! Sets *p to n
+//! \return The previous value
+MAKO_INLINE Int32 AtomicExchange(volatile Int32* p, Int32 n)
+{ return _InterlockedExchange((volatile long*)p, n); }
+
+//! Sets *p to exchange if it's equal to comparand
+//! \return The previous value, which is comparand if *p was set
+MAKO_INLINE Int32 AtomicCompareExchange(volatile Int32* p, Int32 exchange, Int32 comparand)
+{ return _InterlockedCompareExchange((volatile long*)p, exchange, comparand); }
+
+//! Sets *p to exchange if it's equal to comparand
+//! \return The previous value, which is comparand if *p was set
+MAKO_INLINE void* AtomicCompareExchangePointer(void* volatile* p, void* exchange, void* comparand)
+{ return _InterlockedCompareExchangePointer(p, exchange, comparand); }
+
+//! Stops the compiler and the processor from moving reads and writes across it
+MAKO_INLINE void AtomicFence()
+{ _ReadWriteBarrier(); _mm_mfence(); }
+
+//! Tells the processor that the thread is spinning, so it can give it's
+//! resources to the other hardware thread of the core
+MAKO_INLINE void CPUPause()
+{ _mm_pause(); }
+
+#else
+
+MAKO_INLINE Int32 AtomicIncrement(volatile Int32* p)
+{ return __sync_add_and_fetch(p, 1); }
+
+MAKO_INLINE Int32 AtomicDecrement(volatile Int32* p)
+{ return __sync_sub_and_fetch(p, 1); }
+
+MAKO_INLINE Int32 AtomicAdd(volatile Int32* p, Int32 n)
+{ return __sync_fetch_and_add(p, n); }
+
+MAKO_INLINE Int32 AtomicExchange(volatile Int32* p, Int32 n)
+{
+	// __sync_lock_test_and_set is only an acquire barrier
+	__sync_synchronize();
+	return __sync_lock_test_and_set(p, n);
+}
+
+MAKO_INLINE Int32 AtomicCompareExchange(volatile Int32* p, Int32 exchange, Int32 comparand)
+{ return __sync_val_compare_and_swap(p, comparand, exchange); }
+
+MAKO_INLINE void* AtomicCompareExchangePointer(void* volatile* p, void* exchange, void* comparand)
+{ return __sync_val_compare_and_swap(p, comparand, exchange); }
+
+MAKO_INLINE void AtomicFence()
+{ __sync_synchronize(); }
+
+MAKO_INLINE void CPUPause()
+{
+#if defined (__i386__) || defined (__x86_64__)
+	__builtin_ia32_pause();
+#endif
+}
+
+#endif
+
+//! Reads *p, and makes sure reads after it aren't done before it
+MAKO_INLINE Int32 AtomicLoad(const volatile Int32* p)
+{ Int32 n = *p; AtomicFence(); return n; }
+
+//! Writes *p, after every read and write before it
+MAKO_INLINE void AtomicStore(volatile Int32* p, Int32 n)
+{ AtomicFence(); *p = n; }
+
+MAKO_END_NAMESPACE
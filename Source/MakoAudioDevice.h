@@ -68,7 +68,9 @@ enum AUDIO_DEVICE_TYPE
 	//! Microsoft Windows and Xbox 360.
 	ADT_XAUDIO2,
 #endif
-	ADT_ENUM_LENGTH
+	ADT_ENUM_LENGTH,
+	//! Picks the best device that is available
+	ADT_AUTO
 };
 
 //! This abstract class handles playing regular and 3d sounds.
@@ -0,0 +1,408 @@
+#include "MakoBVH3d.h"
+#include "MakoMath.h"
+#include <algorithm>
+
+MAKO_BEGIN_NAMESPACE
+
+// Every query walks the tree with a stack this big. Nodes are split in the
+// middle below MAX_SAH_DEPTH, so the tree is never deeper than this.
+static const UInt32 STACK_SIZE = 64;
+
+static MAKO_INLINE Float32 GetAxis(const Vec3df& v, UInt32 axis)
+{ return axis == 0 ? v.x : (axis == 1 ? v.y : v.z); }
+
+//! Sorts items into buckets along an axis, by the centroids of their boxes.
+struct BVHBinner
+{
+	const ArrayList<Vec3df>& centroids;
+	UInt32 axis;
+	Float32 lo, scale;
+	UInt32 split;
+
+	BVHBinner(const ArrayList<Vec3df>& centroids, UInt32 axis, Float32 lo, Float32 scale, UInt32 split)
+		: centroids(centroids), axis(axis), lo(lo), scale(scale), split(split) {}
+
+	MAKO_INLINE UInt32 GetBin(UInt32 item) const
+	{
+		const UInt32 bin = (UInt32)((GetAxis(centroids[item], axis) - lo) * scale);
+		return bin < BVH3d::NUM_BINS ? bin : BVH3d::NUM_BINS - 1;
+	}
+
+	//! For std::partition(), true if the item goes to the first child
+	MAKO_INLINE bool operator () (UInt32 item) const
+	{ return GetBin(item) < split; }
+};
+
+//! For std::nth_element(), orders items by their centroids along an axis
+struct BVHCentroidLess
+{
+	const ArrayList<Vec3df>& centroids;
+	UInt32 axis;
+
+	BVHCentroidLess(const ArrayList<Vec3df>& centroids, UInt32 axis)
+		: centroids(centroids), axis(axis) {}
+
+	MAKO_INLINE bool operator () (UInt32 a, UInt32 b) const
+	{ return GetAxis(centroids[a], axis) < GetAxis(centroids[b], axis); }
+};
+
+BVH3d::BVH3d()
+	: totalArea(0.f), builtArea(0.f), dirty(false) {}
+
+void BVH3d::Clear()
+{
+	nodes.clear();
+	parents.clear();
+	dirtyNodes.clear();
+	items.clear();
+	itemBoxes.clear();
+	itemLeaves.clear();
+	totalArea = builtArea = 0.f;
+	dirty = false;
+}
+
+/////////////////////////////////////////////////////////////////
+// Building
+
+void BVH3d::Build(const AABBox3df* boxes, UInt32 count)
+{
+	Clear();
+	if (!count)
+		return;
+
+	itemBoxes.assign(boxes, boxes + count);
+	items.resize(count);
+	itemLeaves.resize(count);
+
+	ArrayList<Vec3df> centroids(count);
+	for (UInt32 i = 0; i < count; ++i)
+	{
+		items[i]     = i;
+		centroids[i] = boxes[i].GetCenter();
+	}
+
+	// A binary tree with count leaves at most has this many nodes, so nodes
+	// is never reallocated while it's built.
+	nodes.reserve(2 * count);
+	parents.reserve(2 * count);
+
+	Node root;
+	root.children  = 0;
+	root.firstItem = 0;
+	root.numItems  = count;
+	nodes.push_back(root);
+	parents.push_back(0);
+
+	ArrayList<UInt32> depths;
+	depths.reserve(2 * count);
+	depths.push_back(0);
+
+	// Children are appended after their parents, so this visits them all
+	for (UInt32 n = 0; n < nodes.size(); ++n)
+		Split(n, centroids, depths);
+
+	dirtyNodes.assign(nodes.size(), 0);
+	builtArea = totalArea;
+}
+
+void BVH3d::Split(UInt32 n, const ArrayList<Vec3df>& centroids, ArrayList<UInt32>& depths)
+{
+	const UInt32 first = nodes[n].firstItem;
+	const UInt32 num   = nodes[n].numItems;
+	UInt32* begin = &items[first];
+	UInt32* end   = begin + num;
+	UInt32* it;
+
+	AABBox3df box, centroidBox;
+	for (it = begin; it != end; ++it)
+	{
+		box.AddInternalBox(itemBoxes[*it]);
+		centroidBox.AddInternalPoint(centroids[*it]);
+	}
+	nodes[n].box = box;
+	totalArea += box.GetSurfaceArea();
+
+	if (num <= MAX_LEAF_ITEMS)
+	{
+		for (it = begin; it != end; ++it)
+			itemLeaves[*it] = n;
+		return;
+	}
+
+	// Split along the axis the centroids are spread out the most
+	const Vec3df size = centroidBox.maxEdge - centroidBox.minEdge;
+	UInt32 axis = size.y > size.x ? 1 : 0;
+	if (size.z > GetAxis(size, axis))
+		axis = 2;
+	const Float32 extent = GetAxis(size, axis);
+
+	UInt32* mid = begin;
+	if (depths[n] < MAX_SAH_DEPTH && extent > 0.f)
+	{
+		// Sort the items into buckets by their centroids. The cost of splitting
+		// between two buckets is the area of each side times it's number of items.
+		AABBox3df binBoxes[NUM_BINS];
+		UInt32 binCounts[NUM_BINS] = { 0 };
+		BVHBinner binner(centroids, axis, GetAxis(centroidBox.minEdge, axis), NUM_BINS / extent, 0);
+		for (it = begin; it != end; ++it)
+		{
+			const UInt32 bin = binner.GetBin(*it);
+			++binCounts[bin];
+			binBoxes[bin].AddInternalBox(itemBoxes[*it]);
+		}
+
+		// Sweep from the right to get the cost of every right side...
+		Float32 rightCosts[NUM_BINS];
+		AABBox3df sweepBox;
+		UInt32 sweepCount = 0, bin;
+		for (bin = NUM_BINS - 1; bin > 0; --bin)
+		{
+			sweepBox.AddInternalBox(binBoxes[bin]);
+			sweepCount += binCounts[bin];
+			rightCosts[bin] = sweepBox.GetSurfaceArea() * sweepCount;
+		}
+
+		// ...then from the left to add the left sides and find the cheapest
+		sweepBox.MakeEmpty();
+		sweepCount = 0;
+		Float32 bestCost = FLT_MAX;
+		for (bin = 0; bin < NUM_BINS - 1; ++bin)
+		{
+			sweepBox.AddInternalBox(binBoxes[bin]);
+			sweepCount += binCounts[bin];
+			const Float32 cost = sweepBox.GetSurfaceArea() * sweepCount + rightCosts[bin + 1];
+			if (cost < bestCost)
+			{
+				bestCost     = cost;
+				binner.split = bin + 1;
+			}
+		}
+
+		mid = std::partition(begin, end, binner);
+	}
+
+	// Split in the middle if the buckets didn't separate the items
+	if (mid == begin || mid == end)
+	{
+		mid = begin + num / 2;
+		std::nth_element(begin, mid, end, BVHCentroidLess(centroids, axis));
+	}
+
+	Node child;
+	child.children  = 0;
+	child.firstItem = first;
+	child.numItems  = (UInt32)(mid - begin);
+
+	nodes[n].children = nodes.size();
+	nodes.push_back(child);
+
+	child.firstItem = first + child.numItems;
+	child.numItems  = num - child.numItems;
+	nodes.push_back(child);
+
+	parents.push_back(n);
+	parents.push_back(n);
+	depths.push_back(depths[n] + 1);
+	depths.push_back(depths[n] + 1);
+}
+
+/////////////////////////////////////////////////////////////////
+// Refitting
+
+void BVH3d::SetItemBox(UInt32 item, const AABBox3df& box)
+{
+	itemBoxes[item] = box;
+
+	// Flag the leaf and it's ancestors, up to the first one that already is
+	UInt32 n = itemLeaves[item];
+	while (!dirtyNodes[n])
+	{
+		dirtyNodes[n] = 1;
+		if (n == 0)
+			break;
+		n = parents[n];
+	}
+	dirty = true;
+}
+
+void BVH3d::Refit()
+{
+	if (!dirty)
+		return;
+
+	// Children come after their parents, so walking backwards refits every
+	// child before it's parent.
+	for (UInt32 i = nodes.size(); i-- > 0;)
+	{
+		if (!dirtyNodes[i])
+			continue;
+
+		Node& n = nodes[i];
+		totalArea -= n.box.GetSurfaceArea();
+		n.box.MakeEmpty();
+		if (n.children)
+		{
+			n.box.AddInternalBox(nodes[n.children].box);
+			n.box.AddInternalBox(nodes[n.children + 1].box);
+		}
+		else
+		{
+			for (UInt32 j = n.firstItem; j < n.firstItem + n.numItems; ++j)
+				n.box.AddInternalBox(itemBoxes[items[j]]);
+		}
+		totalArea += n.box.GetSurfaceArea();
+		dirtyNodes[i] = 0;
+	}
+	dirty = false;
+}
+
+/////////////////////////////////////////////////////////////////
+// Queries
+
+UInt32 BVH3d::RayCast(const Vec3df& start, const Vec3df& dir, Float32 maxT, Float32* t) const
+{
+	Float32 best = maxT, nodeT;
+	UInt32 bestItem = INVALID_ITEM;
+
+	const Vec3df invDir(1.f / dir.x, 1.f / dir.y, 1.f / dir.z);
+	if (nodes.empty() || !nodes[0].box.IntersectsRay(start, invDir, 0.f, best, nodeT))
+		return INVALID_ITEM;
+
+	UInt32 stack[STACK_SIZE];
+	UInt32 top = 0;
+	stack[top++] = 0;
+	while (top)
+	{
+		const Node& n = nodes[stack[--top]];
+		if (!n.children)
+		{
+			for (UInt32 j = n.firstItem; j < n.firstItem + n.numItems; ++j)
+			{
+				if (itemBoxes[items[j]].IntersectsRay(start, invDir, 0.f, best, nodeT))
+				{
+					best     = nodeT;
+					bestItem = items[j];
+				}
+			}
+			continue;
+		}
+
+		// Visit the nearer child first, so the farther one is more likely to
+		// be skipped because something nearer was hit already.
+		Float32 t0, t1;
+		const bool hit0 = nodes[n.children].box.IntersectsRay(start, invDir, 0.f, best, t0);
+		const bool hit1 = nodes[n.children + 1].box.IntersectsRay(start, invDir, 0.f, best, t1);
+		if (hit0 && hit1)
+		{
+			const UInt32 nearer = t0 <= t1 ? n.children : n.children + 1;
+			stack[top++] = nearer == n.children ? n.children + 1 : n.children;
+			stack[top++] = nearer;
+		}
+		else if (hit0)
+			stack[top++] = n.children;
+		else if (hit1)
+			stack[top++] = n.children + 1;
+	}
+
+	if (t && bestItem != INVALID_ITEM)
+		*t = best;
+	return bestItem;
+}
+
+void BVH3d::QueryBox(const AABBox3df& box, ArrayList<UInt32>& out) const
+{
+	if (nodes.empty())
+		return;
+
+	UInt32 stack[STACK_SIZE];
+	UInt32 top = 0;
+	stack[top++] = 0;
+	while (top)
+	{
+		const Node& n = nodes[stack[--top]];
+		if (!n.box.Intersects(box))
+			continue;
+
+		if (n.children)
+		{
+			stack[top++] = n.children;
+			stack[top++] = n.children + 1;
+		}
+		else
+		{
+			for (UInt32 j = n.firstItem; j < n.firstItem + n.numItems; ++j)
+				if (itemBoxes[items[j]].Intersects(box))
+					out.push_back(items[j]);
+		}
+	}
+}
+
+void BVH3d::QuerySphere(const Sphere3df& sphere, ArrayList<UInt32>& out) const
+{
+	if (nodes.empty() || sphere.IsEmpty())
+		return;
+
+	const Float32 radiusSq = sphere.radius * sphere.radius;
+
+	UInt32 stack[STACK_SIZE];
+	UInt32 top = 0;
+	stack[top++] = 0;
+	while (top)
+	{
+		const Node& n = nodes[stack[--top]];
+		if (n.box.IsEmpty() || n.box.GetDistanceSq(sphere.center) > radiusSq)
+			continue;
+
+		if (n.children)
+		{
+			stack[top++] = n.children;
+			stack[top++] = n.children + 1;
+		}
+		else
+		{
+			for (UInt32 j = n.firstItem; j < n.firstItem + n.numItems; ++j)
+			{
+				const AABBox3df& itemBox = itemBoxes[items[j]];
+				if (!itemBox.IsEmpty() && itemBox.GetDistanceSq(sphere.center) <= radiusSq)
+					out.push_back(items[j]);
+			}
+		}
+	}
+}
+
+void BVH3d::QueryFrustum(const Frustum& frustum, ArrayList<UInt32>& out) const
+{
+	if (nodes.empty())
+		return;
+
+	UInt32 stack[STACK_SIZE];
+	UInt32 top = 0;
+	stack[top++] = 0;
+	while (top)
+	{
+		const Node& n = nodes[stack[--top]];
+		const FRUSTUM_TEST_RESULT r = frustum.Test(n.box);
+		if (r == FTR_OUTSIDE)
+			continue;
+
+		if (r == FTR_INSIDE)
+		{
+			// Every item of the subtree is inside, too
+			out.insert(out.end(), items.begin() + n.firstItem,
+					   items.begin() + n.firstItem + n.numItems);
+		}
+		else if (n.children)
+		{
+			stack[top++] = n.children;
+			stack[top++] = n.children + 1;
+		}
+		else
+		{
+			for (UInt32 j = n.firstItem; j < n.firstItem + n.numItems; ++j)
+				if (frustum.Test(itemBoxes[items[j]]) != FTR_OUTSIDE)
+					out.push_back(items[j]);
+		}
+	}
+}
+
+MAKO_END_NAMESPACE
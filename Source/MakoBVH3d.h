@@ -0,0 +1,121 @@
+#pragma once
+#include "MakoCommon.h"
+#include "MakoArrayList.h"
+#include "MakoAABBox3d.h"
+#include "MakoSphere3d.h"
+#include "MakoFrustum.h"
+
+MAKO_BEGIN_NAMESPACE
+
+//! A bounding volume hierarchy over a set of axis aligned boxes, called items.
+//! Items are identified by their index in the array passed to Build().
+//! The tree is built top down with the surface area heuristic. When items
+//! move, the boxes of the tree are refitted bottom up, which is much cheaper
+//! than building it again, but the tree gets slower to query the further the
+//! items moved away from where they were built. IsDegraded() tells when it's
+//! worth building the tree again.
+class BVH3d
+{
+public:
+	enum
+	{
+		INVALID_ITEM = 0xFFFFFFFF,
+		//! Nodes with this many items or less aren't split
+		MAX_LEAF_ITEMS = 4,
+		//! Nodes deeper than this are split in the middle instead of with the
+		//! surface area heuristic, so the tree can't be deeper than the query stack.
+		MAX_SAH_DEPTH = 32,
+		//! Number of buckets the surface area heuristic sorts the items into
+		NUM_BINS = 16
+	};
+
+	//! A node of the tree
+	struct Node
+	{
+		//! Box containing the items of the node
+		AABBox3df box;
+		//! Index of the first child node, the second one follows it. 0 for leaves.
+		UInt32 children;
+		//! The node and all of it's descendants contain the items in
+		//! GetItems()[firstItem, firstItem + numItems)
+		UInt32 firstItem;
+		UInt32 numItems;
+	};
+private:
+	//! Parents always come before their children, the root is at index 0.
+	ArrayList<Node> nodes;
+	//! Index of the parent of each node, 0 for the root.
+	ArrayList<UInt32> parents;
+	//! Whether the box of each node has to be refitted
+	ArrayList<UInt8> dirtyNodes;
+	//! Item indices, ordered so that every node covers a contiguous range
+	ArrayList<UInt32> items;
+	//! Box of each item
+	ArrayList<AABBox3df> itemBoxes;
+	//! Index of the leaf node of each item
+	ArrayList<UInt32> itemLeaves;
+	//! Sum of the surface areas of all nodes, now and when the tree was built.
+	Float32 totalArea, builtArea;
+	bool dirty;
+
+	//! Calculates the box of a node, and splits it into two children if it
+	//! has too many items. Children are appended to nodes.
+	void Split(UInt32 node, const ArrayList<Vec3df>& centroids, ArrayList<UInt32>& depths);
+public:
+	//! Constructs an empty tree
+	MAKO_API BVH3d();
+
+	//! Builds the tree over count boxes. Any previous items are removed.
+	MAKO_API void Build(const AABBox3df* boxes, UInt32 count);
+
+	//! Removes all items
+	MAKO_API void Clear();
+
+	//! Moves an item. The tree isn't updated until Refit() is called, so many
+	//! items can be moved at once.
+	MAKO_API void SetItemBox(UInt32 item, const AABBox3df& box);
+
+	//! Refits the boxes of the nodes whose items moved since the last call.
+	MAKO_API void Refit();
+
+	//! Check if the items moved so much since the tree was built, that building
+	//! it again would make queries noticeably faster.
+	MAKO_INLINE bool IsDegraded() const
+	{ return totalArea > builtArea * 2.f; }
+
+	//! Finds the item whose box the ray start + dir * t, 0 <= t <= maxT, hits first.
+	//! \param[out] t If not nullptr, receives the distance along the ray at
+	//! which the box was hit. Distances are multiples of the length of dir.
+	//! \return The item, or INVALID_ITEM if no box was hit.
+	MAKO_API UInt32 RayCast(const Vec3df& start, const Vec3df& dir, Float32 maxT,
+							Float32* t = nullptr) const;
+
+	//! Appends the items whose boxes overlap box to out
+	MAKO_API void QueryBox(const AABBox3df& box, ArrayList<UInt32>& out) const;
+
+	//! Appends the items whose boxes overlap sphere to out
+	MAKO_API void QuerySphere(const Sphere3df& sphere, ArrayList<UInt32>& out) const;
+
+	//! Appends the items whose boxes aren't completely outside of frustum to
+	//! out. Subtrees completely inside of the frustum are appended without
+	//! testing their items.
+	MAKO_API void QueryFrustum(const Frustum& frustum, ArrayList<UInt32>& out) const;
+
+	//! Get the nodes of the tree. The root is the first one, if there are items.
+	MAKO_INLINE const ArrayList<Node>& GetNodes() const
+	{ return nodes; }
+
+	//! Get the item indices in the order the nodes refer to them
+	MAKO_INLINE const ArrayList<UInt32>& GetItems() const
+	{ return items; }
+
+	//! Get the box of an item
+	MAKO_INLINE const AABBox3df& GetItemBox(UInt32 item) const
+	{ return itemBoxes[item]; }
+
+	//! Get the number of items
+	MAKO_INLINE UInt32 GetNumItems() const
+	{ return itemBoxes.size(); }
+};
+
+MAKO_END_NAMESPACE
@@ -0,0 +1,503 @@
+#include "MakoBlockCompression.h"
+#include "MakoJobSystem.h"
+#include "MakoApplication.h"
+#include "MakoException.h"
+#include "MakoMath.h"
+#include <string.h>
+
+MAKO_BEGIN_NAMESPACE
+
+//! Rows of blocks are given to jobs in batches of at least this many blocks
+static const UInt32 BLOCKS_PER_JOB = 1024;
+
+//! Indices of the BC1 3 color mode that mean a transparent pixel
+static const UInt32 BC1_TRANSPARENT_INDEX = 3;
+
+static MAKO_INLINE Int32 Expand5(UInt32 c)
+{ return static_cast<Int32>((c << 3) | (c >> 2)); }
+
+static MAKO_INLINE Int32 Expand6(UInt32 c)
+{ return static_cast<Int32>((c << 2) | (c >> 4)); }
+
+static MAKO_INLINE UInt16 PackRGB565(const Float32* c)
+{
+	const UInt32 r = static_cast<UInt32>(Clamp(c[0], 0.f, 255.f) * (31.f / 255.f) + .5f);
+	const UInt32 g = static_cast<UInt32>(Clamp(c[1], 0.f, 255.f) * (63.f / 255.f) + .5f);
+	const UInt32 b = static_cast<UInt32>(Clamp(c[2], 0.f, 255.f) * (31.f / 255.f) + .5f);
+	return static_cast<UInt16>((r << 11) | (g << 5) | b);
+}
+
+static MAKO_INLINE UInt16 ReadUInt16LE(const UInt8* in)
+{ return static_cast<UInt16>(in[0] | (in[1] << 8)); }
+
+static MAKO_INLINE void WriteUInt16LE(UInt8* out, UInt16 n)
+{
+	out[0] = static_cast<UInt8>(n);
+	out[1] = static_cast<UInt8>(n >> 8);
+}
+
+/////////////////////////////////////////////////////////////////
+// Colors (BC1, and the color half of BC3)
+
+//! Builds the RGBA palette of a color block. Blocks with c0 <= c1 have 3
+//! colors and a transparent black, unless threeColorMode is false, which
+//! is how BC3 interprets it's color blocks.
+static void BuildColorPalette(UInt16 c0, UInt16 c1, bool threeColorMode, Int32 palette[4][4])
+{
+	palette[0][0] = Expand5(c0 >> 11); palette[0][1] = Expand6((c0 >> 5) & 63); palette[0][2] = Expand5(c0 & 31);
+	palette[1][0] = Expand5(c1 >> 11); palette[1][1] = Expand6((c1 >> 5) & 63); palette[1][2] = Expand5(c1 & 31);
+	palette[0][3] = palette[1][3] = 255;
+
+	if (c0 > c1 || !threeColorMode)
+	{
+		for (UInt32 i = 0; i < 3; ++i)
+		{
+			palette[2][i] = (2 * palette[0][i] + palette[1][i] + 1) / 3;
+			palette[3][i] = (palette[0][i] + 2 * palette[1][i] + 1) / 3;
+		}
+		palette[2][3] = palette[3][3] = 255;
+	}
+	else
+	{
+		for (UInt32 i = 0; i < 3; ++i)
+			palette[2][i] = (palette[0][i] + palette[1][i]) / 2;
+		palette[2][3] = 255;
+		palette[3][0] = palette[3][1] = palette[3][2] = palette[3][3] = 0;
+	}
+}
+
+//! The endpoints and indices of a color block, and the squared error of it's pixels
+struct ColorBlockFit
+{
+	UInt16 c0, c1;
+	UInt32 indices;
+	Int32 error;
+};
+
+//! Quantizes the endpoints e0 and e1 and finds the nearest palette color of
+//! every pixel. The endpoints are ordered for the 3 color mode if some pixels
+//! are transparent, and for the 4 color mode otherwise.
+static void FitColorBlock(const UInt8* pixels, const bool* transparent, bool anyTransparent,
+						  bool threeColorMode, const Float32* e0, const Float32* e1, ColorBlockFit& fit)
+{
+	UInt16 c0 = PackRGB565(e0), c1 = PackRGB565(e1);
+	if (anyTransparent ? c0 > c1 : c0 < c1)
+	{
+		const UInt16 t = c0;
+		c0 = c1;
+		c1 = t;
+	}
+
+	Int32 palette[4][4];
+	BuildColorPalette(c0, c1, threeColorMode, palette);
+	const UInt32 numColors = threeColorMode && c0 <= c1 ? 3 : 4;
+
+	fit.c0 = c0;
+	fit.c1 = c1;
+	fit.indices = 0;
+	fit.error = 0;
+	for (UInt32 i = 0; i < 16; ++i)
+	{
+		UInt32 best = BC1_TRANSPARENT_INDEX;
+		if (!transparent[i])
+		{
+			const UInt8* p = pixels + i * 4;
+			Int32 bestError = 0x7FFFFFFF;
+			for (UInt32 j = 0; j < numColors; ++j)
+			{
+				const Int32 dr = p[0] - palette[j][0], dg = p[1] - palette[j][1], db = p[2] - palette[j][2];
+				const Int32 error = dr * dr + dg * dg + db * db;
+				if (error < bestError)
+				{
+					bestError = error;
+					best = j;
+				}
+			}
+			fit.error += bestError;
+		}
+		fit.indices |= best << (i * 2);
+	}
+}
+
+//! Finds the endpoints that minimize the squared error of the pixels for
+//! the indices of fit, with least squares.
+//! \return false if the indices don't determine the endpoints.
+static bool RefineColorEndpoints(const UInt8* pixels, const bool* transparent, bool threeColors,
+								 const ColorBlockFit& fit, Float32* e0, Float32* e1)
+{
+	// How much of e0 each index is made of
+	static const Float32 fourColorWeights[4]  = { 1.f, 0.f, 2.f / 3.f, 1.f / 3.f };
+	static const Float32 threeColorWeights[4] = { 1.f, 0.f, .5f, 0.f };
+	const Float32* weights = threeColors ? threeColorWeights : fourColorWeights;
+
+	Float32 aa = 0.f, bb = 0.f, ab = 0.f;
+	Float32 ax[3] = { 0.f, 0.f, 0.f }, bx[3] = { 0.f, 0.f, 0.f };
+	for (UInt32 i = 0; i < 16; ++i)
+	{
+		if (transparent[i])
+			continue;
+
+		const Float32 a = weights[(fit.indices >> (i * 2)) & 3], b = 1.f - a;
+		aa += a * a;
+		bb += b * b;
+		ab += a * b;
+		for (UInt32 c = 0; c < 3; ++c)
+		{
+			ax[c] += a * pixels[i * 4 + c];
+			bx[c] += b * pixels[i * 4 + c];
+		}
+	}
+
+	const Float32 det = aa * bb - ab * ab;
+	if (Abs(det) < 1e-6f)
+		return false;
+
+	const Float32 invDet = 1.f / det;
+	for (UInt32 c = 0; c < 3; ++c)
+	{
+		e0[c] = (ax[c] * bb - bx[c] * ab) * invDet;
+		e1[c] = (bx[c] * aa - ax[c] * ab) * invDet;
+	}
+	return true;
+}
+
+//! Encodes the colors of a block of 4x4 RGBA pixels. With threeColorMode,
+//! pixels whose alpha is less than 128 become transparent.
+static void EncodeColorBlock(const UInt8* pixels, bool threeColorMode, UInt8* out)
+{
+	bool transparent[16];
+	bool anyTransparent = false;
+	Float32 mean[3] = { 0.f, 0.f, 0.f };
+	UInt32 numOpaque = 0;
+	for (UInt32 i = 0; i < 16; ++i)
+	{
+		transparent[i] = threeColorMode && pixels[i * 4 + 3] < 128;
+		anyTransparent = anyTransparent || transparent[i];
+		if (transparent[i])
+			continue;
+
+		for (UInt32 c = 0; c < 3; ++c)
+			mean[c] += pixels[i * 4 + c];
+		++numOpaque;
+	}
+
+	if (!numOpaque)
+	{
+		// Every pixel is transparent
+		WriteUInt16LE(out, 0);
+		WriteUInt16LE(out + 2, 0);
+		memset(out + 4, 0xFF, 4);
+		return;
+	}
+
+	for (UInt32 c = 0; c < 3; ++c)
+		mean[c] /= numOpaque;
+
+	// The covariance of the colors: rr, rg, rb, gg, gb, bb
+	Float32 cov[6] = { 0.f, 0.f, 0.f, 0.f, 0.f, 0.f };
+	for (UInt32 i = 0; i < 16; ++i)
+	{
+		if (transparent[i])
+			continue;
+
+		const Float32 r = pixels[i * 4] - mean[0], g = pixels[i * 4 + 1] - mean[1], b = pixels[i * 4 + 2] - mean[2];
+		cov[0] += r * r; cov[1] += r * g; cov[2] += r * b;
+		cov[3] += g * g; cov[4] += g * b; cov[5] += b * b;
+	}
+
+	// The principal axis, by power iteration
+	Float32 axis[3] = { 1.f, 1.f, 1.f };
+	for (UInt32 iteration = 0; iteration < 8; ++iteration)
+	{
+		const Float32 x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+		const Float32 y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+		const Float32 z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+		const Float32 m = Max(Abs(x), Abs(y), Abs(z));
+		if (m < 1e-6f)
+			break;
+		axis[0] = x / m;
+		axis[1] = y / m;
+		axis[2] = z / m;
+	}
+	const Float32 length = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+	for (UInt32 c = 0; c < 3; ++c)
+		axis[c] /= length;
+
+	// The endpoints are the extremes of the colors along the axis, moved
+	// inwards a little, because the colors between them are more accurate.
+	Float32 lo = 0.f, hi = 0.f;
+	for (UInt32 i = 0; i < 16; ++i)
+	{
+		if (transparent[i])
+			continue;
+
+		const Float32 t = (pixels[i * 4] - mean[0]) * axis[0] + (pixels[i * 4 + 1] - mean[1]) * axis[1] +
+			(pixels[i * 4 + 2] - mean[2]) * axis[2];
+		lo = Min(lo, t);
+		hi = Max(hi, t);
+	}
+	const Float32 inset = (hi - lo) / 16.f;
+	lo += inset;
+	hi -= inset;
+
+	Float32 e0[3], e1[3];
+	for (UInt32 c = 0; c < 3; ++c)
+	{
+		e0[c] = mean[c] + axis[c] * hi;
+		e1[c] = mean[c] + axis[c] * lo;
+	}
+
+	ColorBlockFit fit;
+	FitColorBlock(pixels, transparent, anyTransparent, threeColorMode, e0, e1, fit);
+
+	if (fit.error > 0)
+	{
+		const bool threeColors = threeColorMode && fit.c0 <= fit.c1;
+		ColorBlockFit refined;
+		if (RefineColorEndpoints(pixels, transparent, threeColors, fit, e0, e1))
+		{
+			FitColorBlock(pixels, transparent, anyTransparent, threeColorMode, e0, e1, refined);
+			if (refined.error < fit.error)
+				fit = refined;
+		}
+	}
+
+	WriteUInt16LE(out, fit.c0);
+	WriteUInt16LE(out + 2, fit.c1);
+	WriteUInt16LE(out + 4, static_cast<UInt16>(fit.indices));
+	WriteUInt16LE(out + 6, static_cast<UInt16>(fit.indices >> 16));
+}
+
+//! Decodes a color block into 16 RGBA pixels
+static void DecodeColorBlock(const UInt8* in, bool threeColorMode, UInt8* pixels)
+{
+	Int32 palette[4][4];
+	BuildColorPalette(ReadUInt16LE(in), ReadUInt16LE(in + 2), threeColorMode, palette);
+
+	const UInt32 indices = ReadUInt16LE(in + 4) | (ReadUInt16LE(in + 6) << 16);
+	for (UInt32 i = 0; i < 16; ++i)
+	{
+		const Int32* color = palette[(indices >> (i * 2)) & 3];
+		for (UInt32 c = 0; c < 4; ++c)
+			pixels[i * 4 + c] = static_cast<UInt8>(color[c]);
+	}
+}
+
+/////////////////////////////////////////////////////////////////
+// Single channels (BC4, and the alpha of BC3 and both halves of BC5)
+
+//! Builds the palette of a single channel block. Blocks with r0 > r1 have 8
+//! values, others 6, 0 and 255.
+static void BuildChannelPalette(UInt8 r0, UInt8 r1, Int32 palette[8])
+{
+	palette[0] = r0;
+	palette[1] = r1;
+	if (r0 > r1)
+	{
+		for (Int32 i = 1; i < 7; ++i)
+			palette[i + 1] = ((7 - i) * r0 + i * r1 + 3) / 7;
+	}
+	else
+	{
+		for (Int32 i = 1; i < 5; ++i)
+			palette[i + 1] = ((5 - i) * r0 + i * r1 + 2) / 5;
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+}
+
+//! Encodes one channel of 16 pixels, which are stride bytes apart
+static void EncodeChannelBlock(const UInt8* values, UInt32 stride, UInt8* out)
+{
+	UInt8 lo = 255, hi = 0;
+	for (UInt32 i = 0; i < 16; ++i)
+	{
+		lo = Min(lo, values[i * stride]);
+		hi = Max(hi, values[i * stride]);
+	}
+
+	// The 8 value mode spans the range of the block
+	out[0] = hi;
+	out[1] = lo;
+	Int32 palette[8];
+	BuildChannelPalette(hi, lo, palette);
+
+	UInt64 indices = 0;
+	for (UInt32 i = 0; i < 16; ++i)
+	{
+		const Int32 v = values[i * stride];
+		UInt32 best = 0;
+		Int32 bestError = 256;
+		for (UInt32 j = 0; j < 8; ++j)
+		{
+			const Int32 error = Abs(v - palette[j]);
+			if (error < bestError)
+			{
+				bestError = error;
+				best = j;
+			}
+		}
+		indices |= static_cast<UInt64>(best) << (i * 3);
+	}
+
+	for (UInt32 b = 0; b < 6; ++b)
+		out[2 + b] = static_cast<UInt8>(indices >> (b * 8));
+}
+
+//! Decodes one channel of 16 pixels, which are stride bytes apart
+static void DecodeChannelBlock(const UInt8* in, UInt8* values, UInt32 stride)
+{
+	Int32 palette[8];
+	BuildChannelPalette(in[0], in[1], palette);
+
+	UInt64 indices = 0;
+	for (UInt32 b = 0; b < 6; ++b)
+		indices |= static_cast<UInt64>(in[2 + b]) << (b * 8);
+
+	for (UInt32 i = 0; i < 16; ++i)
+		values[i * stride] = static_cast<UInt8>(palette[(indices >> (i * 3)) & 7]);
+}
+
+/////////////////////////////////////////////////////////////////
+// Images
+
+//! Compresses rows of blocks
+struct CompressBlockRows
+{
+	const UInt8* pixels;
+	Size2d size;
+	COLOR_FORMAT format;
+	UInt8* out;
+
+	void operator () (UInt32 begin, UInt32 end)
+	{
+		const UInt32 blocksX = (size.x + 3) / 4, blockSize = GetBlockSize(format);
+		UInt8 block[16 * 4];
+		for (UInt32 by = begin; by < end; ++by)
+		{
+			for (UInt32 bx = 0; bx < blocksX; ++bx)
+			{
+				// Pixels past the edge of the image repeat the last row or column
+				for (UInt32 y = 0; y < 4; ++y)
+				{
+					const UInt32 sy = Min(by * 4 + y, size.y - 1);
+					for (UInt32 x = 0; x < 4; ++x)
+						memcpy(&block[(y * 4 + x) * 4], pixels + (sy * size.x + Min(bx * 4 + x, size.x - 1)) * 4, 4);
+				}
+
+				UInt8* o = out + (by * blocksX + bx) * blockSize;
+				switch (format)
+				{
+				case CF_BC1:
+					EncodeColorBlock(block, true, o);
+					break;
+				case CF_BC3:
+					EncodeChannelBlock(block + 3, 4, o);
+					EncodeColorBlock(block, false, o + 8);
+					break;
+				case CF_BC4:
+					EncodeChannelBlock(block, 4, o);
+					break;
+				case CF_BC5:
+					EncodeChannelBlock(block, 4, o);
+					EncodeChannelBlock(block + 1, 4, o + 8);
+					break;
+				}
+			}
+		}
+	}
+};
+
+//! Decompresses rows of blocks
+struct DecompressBlockRows
+{
+	const UInt8* blocks;
+	Size2d size;
+	COLOR_FORMAT format;
+	UInt8* out;
+
+	void operator () (UInt32 begin, UInt32 end)
+	{
+		const UInt32 blocksX = (size.x + 3) / 4, blockSize = GetBlockSize(format);
+		UInt8 block[16 * 4];
+		for (UInt32 by = begin; by < end; ++by)
+		{
+			for (UInt32 bx = 0; bx < blocksX; ++bx)
+			{
+				const UInt8* in = blocks + (by * blocksX + bx) * blockSize;
+				switch (format)
+				{
+				case CF_BC1:
+					DecodeColorBlock(in, true, block);
+					break;
+				case CF_BC3:
+					DecodeColorBlock(in + 8, false, block);
+					DecodeChannelBlock(in, block + 3, 4);
+					break;
+				case CF_BC4:
+				case CF_BC5:
+					for (UInt32 i = 0; i < 16; ++i)
+					{
+						block[i * 4 + 1] = block[i * 4 + 2] = 0;
+						block[i * 4 + 3] = 255;
+					}
+					DecodeChannelBlock(in, block, 4);
+					if (format == CF_BC5)
+						DecodeChannelBlock(in + 8, block + 1, 4);
+					break;
+				}
+
+				// Only the pixels inside of the image are copied
+				const UInt32 w = Min(size.x - bx * 4, 4u), h = Min(size.y - by * 4, 4u);
+				for (UInt32 y = 0; y < h; ++y)
+					memcpy(out + ((by * 4 + y) * size.x + bx * 4) * 4, &block[y * 16], w * 4);
+			}
+		}
+	}
+};
+
+//! Calls f for ranges of the rows of blocks, with the JobSystem if there is one
+template <typename F>
+static void RunBlockRows(const Size2d& size, F& f)
+{
+	const UInt32 blocksX = (size.x + 3) / 4, blocksY = (size.y + 3) / 4;
+	const UInt32 rowsPerJob = Max(BLOCKS_PER_JOB / blocksX, 1u);
+
+	JobSystem* js = APP()->JS();
+	if (js && blocksY > rowsPerJob)
+		js->ParallelFor(blocksY, f, rowsPerJob);
+	else
+		f(0, blocksY);
+}
+
+void CompressImage(const UInt8* pixels, const Size2d& size, COLOR_FORMAT format, UInt8* out)
+{
+	if (!IsBlockCompressed(format))
+		throw Exception(Text("CompressImage() can only compress to block compressed formats"));
+	if (!size.x || !size.y)
+		return;
+
+	CompressBlockRows f;
+	f.pixels = pixels;
+	f.size   = size;
+	f.format = format;
+	f.out    = out;
+	RunBlockRows(size, f);
+}
+
+void DecompressImage(const UInt8* blocks, const Size2d& size, COLOR_FORMAT format, UInt8* out)
+{
+	if (!IsBlockCompressed(format))
+		throw Exception(Text("DecompressImage() can only decompress block compressed formats"));
+	if (!size.x || !size.y)
+		return;
+
+	DecompressBlockRows f;
+	f.blocks = blocks;
+	f.size   = size;
+	f.format = format;
+	f.out    = out;
+	RunBlockRows(size, f);
+}
+
+MAKO_END_NAMESPACE
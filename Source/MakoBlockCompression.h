@@ -0,0 +1,31 @@
+#pragma once
+#include "MakoCommon.h"
+#include "MakoTexture.h"
+
+MAKO_BEGIN_NAMESPACE
+
+//! Compresses an image of 8 bit RGBA pixels (CF_R8G8B8A8) to a block
+//! compressed format. It's meant for converting textures before they're
+//! shipped (see GraphicsDevice::ConvertTextureToDDS()), but it's fast enough
+//! to be used while loading, too: the endpoints of each block are found along
+//! the principal axis of it's colors and refined once with least squares.
+//! The rows of blocks are compressed in parallel if the Application has a
+//! JobSystem.
+//!
+//! - CF_BC1 uses it's 3 color mode for blocks with pixels whose alpha is
+//!   less than 128, so they're transparent.
+//! - CF_BC3 encodes alpha with 8 bit precision.
+//! - CF_BC4 encodes red only, CF_BC5 red and green.
+//! \param[in] pixels size.x * size.y pixels, row by row.
+//! \param[in] format The format to compress to, one of the block compressed ones.
+//! \param[out] out Receives GetImageDataSize(format, size) bytes.
+MAKO_API void CompressImage(const UInt8* pixels, const Size2d& size, COLOR_FORMAT format, UInt8* out);
+
+//! Decompresses an image of a block compressed format to 8 bit RGBA pixels,
+//! for when the hardware can't sample it. Channels a format doesn't have are
+//! 0, except for alpha, which is 255.
+//! \param[in] blocks GetImageDataSize(format, size) bytes.
+//! \param[out] out Receives size.x * size.y pixels, row by row.
+MAKO_API void DecompressImage(const UInt8* blocks, const Size2d& size, COLOR_FORMAT format, UInt8* out);
+
+MAKO_END_NAMESPACE
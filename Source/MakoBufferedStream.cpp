@@ -0,0 +1,164 @@
+#include "MakoBufferedStream.h"
+#include "MakoException.h"
+
+MAKO_BEGIN_NAMESPACE
+
+BufferedInputStream::BufferedInputStream(InputStream* source, UInt32 bufferSize)
+: source(source), buffer(nullptr), capacity(bufferSize), pos(0), end(0), bufferStart(0),
+  sourceSize(0)
+{
+	source->Hold();
+	buffer      = new UInt8[capacity];
+	bufferStart = source->Tell();
+	sourceSize  = source->GetSize();
+}
+
+BufferedInputStream::~BufferedInputStream()
+{
+	delete [] buffer;
+	source->Drop();
+}
+
+bool BufferedInputStream::Fill(UInt32 cBytes)
+{
+	if (cBytes > capacity)
+		return false;
+
+	// Move the unread bytes to the front, to make room behind them
+	const UInt32 unread = end - pos;
+	if (pos)
+	{
+		memmove(buffer, buffer + pos, unread);
+		bufferStart += pos;
+		pos = 0;
+		end = unread;
+	}
+
+	UInt32 toRead;
+	if (sourceSize)
+	{
+		// Read as much as fits, but not past the end of the source
+		const UInt32 sourcePos = bufferStart + end;
+		toRead = sourcePos < sourceSize ? sourceSize - sourcePos : 0;
+		if (toRead > capacity - end)
+			toRead = capacity - end;
+	}
+	else
+		toRead = cBytes - unread;
+
+	if (toRead)
+	{
+		source->ReadTo(buffer + end, toRead);
+		end += toRead;
+	}
+
+	return end >= cBytes;
+}
+
+void BufferedInputStream::ReadToSlow(void* out, UInt32 cBytes)
+{
+	UInt8* dest = static_cast<UInt8*>(out);
+
+	// Use up what's buffered first
+	const UInt32 unread = end - pos;
+	memcpy(dest, buffer + pos, unread);
+	dest   += unread;
+	cBytes -= unread;
+	pos     = end;
+
+	// Large reads go straight to their destination instead of through the buffer
+	if (cBytes >= capacity / 2)
+	{
+		bufferStart += end;
+		pos = end = 0;
+
+		if (sourceSize)
+		{
+			const UInt32 left = bufferStart < sourceSize ? sourceSize - bufferStart : 0;
+			if (cBytes > left)
+			{
+				memset(dest + left, 0, cBytes - left);
+				cBytes = left;
+			}
+		}
+
+		source->ReadTo(dest, cBytes);
+		bufferStart += cBytes;
+		return;
+	}
+
+	// Reads past the end of the stream get zeros
+	if (!Fill(cBytes))
+	{
+		memcpy(dest, buffer + pos, end - pos);
+		memset(dest + (end - pos), 0, cBytes - (end - pos));
+		pos = end;
+		return;
+	}
+
+	memcpy(dest, buffer + pos, cBytes);
+	pos += cBytes;
+}
+
+void BufferedInputStream::Read(String& str)
+{
+	str.Clear();
+	for (;;)
+	{
+		if (end - pos < sizeof(StringChar) && !Fill(sizeof(StringChar)))
+		{
+			// The stream ended before the '\0'
+			pos = end;
+			return;
+		}
+
+		const StringChar* chars = reinterpret_cast<const StringChar*>(buffer + pos);
+		const UInt32 numChars = (end - pos) / sizeof(StringChar);
+
+		UInt32 length = 0;
+		while (length < numChars && chars[length] != StringChar('\0'))
+			++length;
+
+		if (length)
+			str.Append(chars, length);
+		pos += length * sizeof(StringChar);
+
+		if (length < numChars)
+		{
+			// Skip the '\0'
+			pos += sizeof(StringChar);
+			return;
+		}
+	}
+}
+
+void BufferedInputStream::Skip(UInt32 cBytes)
+{
+	if (cBytes <= end - pos)
+		pos += cBytes;
+	else
+		Seek(Tell() + cBytes);
+}
+
+void BufferedInputStream::Seek(UInt32 byte)
+{
+	// Anywhere in the buffer, including it's end
+	if (byte >= bufferStart && byte - bufferStart <= end)
+	{
+		pos = byte - bufferStart;
+		return;
+	}
+
+	const UInt32 sourcePos = bufferStart + end;
+	if (source->IsSeekable())
+		source->Seek(byte);
+	else if (byte > sourcePos)
+		source->Skip(byte - sourcePos);
+	else
+		throw Exception(Text("BufferedInputStream::Seek() can't seek back in a stream that isn't seekable"));
+
+	bufferStart = byte;
+	pos = end = 0;
+}
+
+MAKO_END_NAMESPACE
@@ -0,0 +1,146 @@
+#pragma once
+#include "MakoStream.h"
+#include <string.h>
+
+MAKO_BEGIN_NAMESPACE
+
+//! Reads another InputStream through a buffer, so that reading many small
+//! values doesn't cost a virtual call and a trip to the source for each one.
+//! The Read methods are redefined here so they copy straight out of the
+//! buffer; call them through a BufferedInputStream (not an InputStream) to
+//! get the inline versions.
+//!
+//! Sources with a fixed size (GetSize() isn't 0) are read ahead a whole buffer
+//! at a time. Other sources, like sockets, are only asked for the bytes the
+//! caller reads, since reading ahead could block.
+class BufferedInputStream : public InputStream
+{
+public:
+	enum { DEFAULT_BUFFER_SIZE = 64 * 1024 };
+private:
+	InputStream* source;
+	UInt8* buffer;
+	UInt32 capacity;
+	//! The unread bytes are buffer[pos, end)
+	UInt32 pos, end;
+	//! The position in source of buffer[0]
+	UInt32 bufferStart;
+	//! The size of source, 0 if it doesn't have a fixed size
+	UInt32 sourceSize;
+
+	//! Buffers at least cBytes unread bytes, if the source has them.
+	//! \return If there are cBytes unread bytes in the buffer.
+	MAKO_API bool Fill(UInt32 cBytes);
+
+	//! ReadTo() for reads that aren't already buffered
+	MAKO_API void ReadToSlow(void* out, UInt32 cBytes);
+
+	// Not copyable
+	BufferedInputStream(const BufferedInputStream&);
+	BufferedInputStream& operator = (const BufferedInputStream&);
+public:
+	//! \param[in] source The stream to read. It's held until this is destroyed,
+	//! and shouldn't be read from any other way until then.
+	//! \param[in] bufferSize The size of the buffer in bytes
+	MAKO_API BufferedInputStream(InputStream* source, UInt32 bufferSize = DEFAULT_BUFFER_SIZE);
+	MAKO_API ~BufferedInputStream();
+
+	MAKO_INLINE void ReadTo(void* out, UInt32 cBytes)
+	{
+		if (cBytes <= end - pos)
+		{
+			memcpy(out, buffer + pos, cBytes);
+			pos += cBytes;
+		}
+		else
+			ReadToSlow(out, cBytes);
+	}
+
+	//! Read count values of type T into out
+	template <typename T>
+	MAKO_INLINE void ReadSpan(T* out, UInt32 count)
+	{ BufferedInputStream::ReadTo(out, sizeof(T) * count); }
+
+	//! Shorter way of reading data
+	//! \param[out] thing The thing to be read
+	template <typename T>
+	MAKO_INLINE void Read(T& thing)
+	{ BufferedInputStream::ReadTo(&thing, sizeof(T)); }
+
+	//! Read a '\0' terminated String, a buffer at a time
+	MAKO_API void Read(String& str);
+
+	//! Read a Int8
+	MAKO_INLINE Int8 Read8BitInt()
+	{ Int8 n; Read(n); return n; }
+
+	//! Read a UInt8
+	MAKO_INLINE UInt8 Read8BitUInt()
+	{ UInt8 n; Read(n); return n; }
+
+	//! Read a Int16
+	MAKO_INLINE Int16 Read16BitInt()
+	{ Int16 n; Read(n); return n; }
+
+	//! Read a UInt16
+	MAKO_INLINE UInt16 Read16BitUInt()
+	{ UInt16 n; Read(n); return n; }
+
+	//! Read a Int32
+	MAKO_INLINE Int32 Read32BitInt()
+	{ Int32 n; Read(n); return n; }
+
+	//! Read a UInt32
+	MAKO_INLINE UInt32 Read32BitUInt()
+	{ UInt32 n; Read(n); return n; }
+
+	//! Read a Float32
+	MAKO_INLINE Float32 Read32BitFloat()
+	{ Float32 n; Read(n); return n; }
+
+	//! Read a Float64
+	MAKO_INLINE Float64 Read64BitFloat()
+	{ Float64 n; Read(n); return n; }
+
+	//! Look at the next cBytes bytes without reading them.
+	//! \return A pointer to the bytes, valid until the next call that reads,
+	//! skips or seeks. nullptr if the stream ends before cBytes bytes, or if
+	//! cBytes is larger than the buffer.
+	MAKO_INLINE const void* Peek(UInt32 cBytes)
+	{ return cBytes <= end - pos || Fill(cBytes) ? buffer + pos : nullptr; }
+
+	//! Look at all of the bytes that are buffered, without reading them. The
+	//! buffer is refilled first if it's empty. Skip() the bytes to read them.
+	//! \param[out] cBytes Receives the number of bytes, 0 at the end of the stream.
+	//! \return A pointer to the bytes, valid until the next call that reads,
+	//! skips or seeks.
+	MAKO_INLINE const void* PeekBuffered(UInt32& cBytes)
+	{
+		if (pos == end)
+			Fill(1);
+		cBytes = end - pos;
+		return buffer + pos;
+	}
+
+	MAKO_API void Skip(UInt32 cBytes);
+
+	//! Seeking backwards is possible within the buffer even if the source
+	//! isn't seekable.
+	MAKO_INLINE bool IsSeekable() const
+	{ return source->IsSeekable(); }
+
+	MAKO_INLINE UInt32 Tell() const
+	{ return bufferStart + pos; }
+
+	//! Seeks within the buffer if it can, otherwise seeks the source and
+	//! empties the buffer. Seeking forward skips if the source isn't seekable.
+	MAKO_API void Seek(UInt32 byte);
+
+	MAKO_INLINE UInt32 GetSize() const
+	{ return sourceSize; }
+
+	MAKO_INLINE String GetFilePath() const
+	{ return source->GetFilePath(); }
+};
+
+MAKO_END_NAMESPACE
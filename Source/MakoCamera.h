@@ -23,6 +23,10 @@ public:
 		  nearViewPlane(nearViewPlane), farViewPlane(farViewPlane) {}
 	
 	MAKO_INLINE virtual ~Camera() {}
+
+	//! Cameras draw nothing
+	MAKO_INLINE virtual NODE_BOUNDS GetBoundingBox(AABBox3df& box) const
+	{ return NB_NONE; }
 	
 	MAKO_INLINE Float32 GetFOV() const
 	{ return fov; }
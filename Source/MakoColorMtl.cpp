@@ -1,7 +1,6 @@
 #include "MakoColorMtl.h"
-#include "MakoD3D9Device.h"
+#include "MakoGraphicsDevice.h"
 #include "MakoCgDevice.h"
-#include <cg/cgd3d9.h>
 
 MAKO_BEGIN_NAMESPACE
 
@@ -42,4 +41,15 @@ void ColorMtl::Bind(GraphicsDevice* gd) const
 	GetCgShader()->EndEditingParameters();
 }
 
+void ColorMtl::BindTransform(GraphicsDevice* gd) const
+{
+	GetCgShader()->BeginEditingParameters();
+
+	modelViewProjCgParam->SetValue((gd->GetTransform(TS_PROJECTION) *
+		                            gd->GetTransform(TS_VIEW) *
+									gd->GetTransform(TS_WORLD)).GetTransposed());
+
+	GetCgShader()->EndEditingParameters();
+}
+
 MAKO_END_NAMESPACE
\ No newline at end of file
@@ -23,8 +23,13 @@ public:
 	{ this->c = c; }
 	
 	MAKO_API Int32 GetType() const;
+
+	//! It's translucent unless it's color is opaque
+	MAKO_INLINE bool IsTranslucent() const
+	{ return c.GetA() != 255; }
 	
 	MAKO_API void Bind(GraphicsDevice* gd) const;
+	MAKO_API void BindTransform(GraphicsDevice* gd) const;
 };
 
 MAKO_END_NAMESPACE
\ No newline at end of file
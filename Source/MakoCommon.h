@@ -50,6 +50,13 @@
 	#define MAKO_REALINLINE inline
 #endif
 
+//! Gives every thread it's own copy of a static variable of a POD type
+#ifdef _MSC_VER
+	#define MAKO_THREAD_LOCAL __declspec(thread)
+#else
+	#define MAKO_THREAD_LOCAL __thread
+#endif
+
 #if MAKO_PLATFORM == MAKO_PLATFORM_WIN32
 	#ifdef MAKO_COMPILING
 		#define MAKO_API __declspec(dllexport)
@@ -93,6 +100,12 @@ MAKO_BEGIN_NAMESPACE
 	
 	//! Guaranteed to be 32 bit unsigned int
 	typedef unsigned __int32 UInt32;
+
+	//! Guaranteed to be 64 bit signed int
+	typedef __int64 Int64;
+
+	//! Guaranteed to be 64 bit unsigned int
+	typedef unsigned __int64 UInt64;
 #else
 	//! Guaranteed to be 8 bit signed int
 	typedef char   Int8;
@@ -111,6 +124,12 @@ MAKO_BEGIN_NAMESPACE
 	
 	//! Guaranteed to be 32 bit unsigned int
 	typedef unsigned int UInt32;
+
+	//! Guaranteed to be 64 bit signed int
+	typedef long long Int64;
+
+	//! Guaranteed to be 64 bit unsigned int
+	typedef unsigned long long UInt64;
 #endif
 
 typedef Int8 Byte;
@@ -6,4 +6,7 @@
 #define MAKO_COMPILING
 
 // Faster math operations
-// #define MAKO_FAST_MATH
\ No newline at end of file
+// #define MAKO_FAST_MATH
+
+// Compile out MAKO_LOG() calls below a LOG_LEVEL (1 = LL_MEDIUM, 2 = LL_HIGH)
+// #define MAKO_MIN_LOG_LEVEL 1
\ No newline at end of file
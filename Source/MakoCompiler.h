@@ -13,4 +13,10 @@
 	#define MAKO_COMPILER MAKO_COMPILER_BORL
 #else
 	#pragma error "Unknown compiler."
+#endif
+
+// Whether the compiler supports rvalue references, so objects can be moved
+// instead of copied
+#if (defined(_MSC_VER) && _MSC_VER >= 1600) || __cplusplus >= 201103L || defined(__GXX_EXPERIMENTAL_CXX0X__)
+	#define MAKO_HAS_RVALUE_REFERENCES
 #endif
\ No newline at end of file
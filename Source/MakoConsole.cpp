@@ -0,0 +1,305 @@
+#include "MakoConsole.h"
+#include "MakoMath.h"
+
+MAKO_BEGIN_NAMESPACE
+
+//! Positions wrap around, which signed integers can't do portably
+static MAKO_INLINE Int32 AddToPosition(Int32 pos, UInt32 n)
+{ return static_cast<Int32>(static_cast<UInt32>(pos) + n); }
+
+//! Get how far position a is ahead of b
+static MAKO_INLINE Int32 PositionDistance(Int32 a, Int32 b)
+{ return static_cast<Int32>(static_cast<UInt32>(a) - static_cast<UInt32>(b)); }
+
+Console::Console(bool logToFile, bool logToStdOut, const char* logFileName)
+: tail(0), head(0), written(0), logLevel(LL_LOW), numDropped(0), sinkWaiting(0), stopping(0),
+  sink(nullptr), logToFile(logToFile ? 1 : 0), logToStdOut(logToStdOut ? 1 : 0),
+  logFileName(logFileName), logFile(nullptr), logFileSize(0), logFileOpened(false)
+{
+	slots = new Slot[CAPACITY];
+	for (UInt32 i = 0; i < CAPACITY; ++i)
+		slots[i].sequence = static_cast<Int32>(i);
+
+	contents.Reserve(MAX_CONTENTS_LENGTH);
+	sink = new Thread(&RunSink, this);
+}
+
+Console::~Console()
+{
+	AtomicStore(&stopping, 1);
+	wake.Post();
+	delete sink;
+
+	if (logFile)
+		fclose(logFile);
+	delete [] slots;
+}
+
+void Console::Post(LOG_LEVEL ll, const StringView& s, bool newLine)
+{
+	const UInt32 numRecords = Clamp<UInt32>((s.GetLength() + RECORD_LENGTH - 1) / RECORD_LENGTH,
+		1, MAX_RECORDS_PER_MESSAGE);
+
+	// The records of a message are claimed together, so the messages of
+	// different threads don't interleave. The sink frees slots in order, so
+	// they're all free if the last one is.
+	UInt32 numRetries = 0;
+	Int32 pos = AtomicLoad(&tail);
+	for (;;)
+	{
+		const Slot& last = slots[static_cast<UInt32>(AddToPosition(pos, numRecords - 1)) & (CAPACITY - 1)];
+		const Int32 diff = PositionDistance(AtomicLoad(&last.sequence), AddToPosition(pos, numRecords - 1));
+		if (diff == 0)
+		{
+			const Int32 prev = AtomicCompareExchange(&tail, AddToPosition(pos, numRecords), pos);
+			if (prev == pos)
+				break;
+			pos = prev;
+		}
+		else if (diff < 0)
+		{
+			// The sink didn't take the records a lap ago out yet. Give it a
+			// chance to, but don't wait for it for long.
+			if (++numRetries > MAX_POST_RETRIES)
+			{
+				AtomicIncrement(&numDropped);
+				return ;
+			}
+			WakeSink();
+			Thread::YieldCPU();
+			pos = AtomicLoad(&tail);
+		}
+		else
+			pos = AtomicLoad(&tail);
+	}
+
+	for (UInt32 i = 0; i < numRecords; ++i)
+	{
+		Slot& slot = slots[static_cast<UInt32>(AddToPosition(pos, i)) & (CAPACITY - 1)];
+		Record& r = slot.record;
+		const UInt32 offset = i * RECORD_LENGTH;
+		r.level   = ll;
+		r.length  = static_cast<UInt16>(offset < s.GetLength() ? Min<UInt32>(s.GetLength() - offset, RECORD_LENGTH) : 0);
+		r.last    = i == numRecords - 1;
+		r.newLine = newLine && r.last;
+		if (r.length)
+			memcpy(r.text, s.GetData() + offset, sizeof(StringChar) * r.length);
+		AtomicStore(&slot.sequence, AddToPosition(pos, i + 1));
+	}
+
+	WakeSink();
+}
+
+void Console::WakeSink()
+{
+	if (AtomicExchange(&sinkWaiting, 0))
+		wake.Post();
+}
+
+void Console::RunSink(void* console)
+{
+	Console* c = static_cast<Console*>(console);
+	for (;;)
+	{
+		if (c->TakeRecords())
+			continue;
+
+		// Records are only taken out once the sink is told to stop, so
+		// nothing that was printed before is lost
+		if (AtomicLoad(&c->stopping))
+			return ;
+
+		// Check the ring again after saying the sink waits, so a record
+		// posted in between either is seen here or wakes the sink
+		AtomicExchange(&c->sinkWaiting, 1);
+		const Slot& next = c->slots[static_cast<UInt32>(c->head) & (CAPACITY - 1)];
+		if (AtomicLoad(&next.sequence) == AddToPosition(c->head, 1))
+		{
+			AtomicExchange(&c->sinkWaiting, 0);
+			continue;
+		}
+		c->wake.Wait();
+	}
+}
+
+bool Console::TakeRecords()
+{
+	bool took = false;
+	for (UInt32 i = 0; i < CAPACITY; ++i)
+	{
+		Slot& slot = slots[static_cast<UInt32>(head) & (CAPACITY - 1)];
+		if (AtomicLoad(&slot.sequence) != AddToPosition(head, 1))
+			break; // Not posted yet
+
+		const Record& r = slot.record;
+		message.Append(r.text, r.length);
+		if (r.last)
+		{
+			if (r.newLine)
+				message.Append(StringChar('\n'));
+			Write(message);
+			message.Clear();
+		}
+
+		// Free the slot for the poster a lap ahead
+		AtomicStore(&slot.sequence, AddToPosition(head, CAPACITY));
+		head = AddToPosition(head, 1);
+		took = true;
+	}
+
+	const Int32 dropped = AtomicExchange(&numDropped, 0);
+	if (dropped)
+	{
+		String s = Text("[") + String::From32BitUInt(static_cast<UInt32>(dropped)) +
+			Text(" messages were dropped, since the console's ring was full]\n");
+		Write(s);
+	}
+
+	if (took)
+	{
+		if (logFile)
+			fflush(logFile);
+		if (AtomicLoad(&logToStdOut))
+			fflush(stdout);
+		AtomicStore(&written, head);
+	}
+	return took;
+}
+
+void Console::Write(const String& s)
+{
+	{
+		ScopedLock<Mutex> l(contentsLock);
+		contents.Append(s);
+		// Keep the newest half, so the contents aren't moved every message
+		if (contents.GetLength() > MAX_CONTENTS_LENGTH)
+			contents.Erase(0, contents.GetLength() - MAX_CONTENTS_LENGTH / 2);
+	}
+
+	const bool toStdOut = AtomicLoad(&logToStdOut) != 0;
+	const bool toFile   = AtomicLoad(&logToFile) != 0;
+	if (!toFile && logFile)
+	{
+		fclose(logFile);
+		logFile = nullptr;
+	}
+	if (!toStdOut && !toFile)
+		return ;
+
+	// Encode it as UTF-8. Characters outside the BMP are surrogate pairs in
+	// the string, and one 4 byte sequence in UTF-8; a surrogate that isn't
+	// part of a pair is written as U+FFFD.
+	utf8.clear();
+	for (UInt32 i = 0; i < s.GetLength(); ++i)
+	{
+		UInt32 c = s[i];
+		if (c >= 0xD800 && c <= 0xDFFF)
+		{
+			const UInt32 low = i + 1 < s.GetLength() ? s[i + 1] : 0;
+			if (c <= 0xDBFF && low >= 0xDC00 && low <= 0xDFFF)
+			{
+				c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+				++i;
+			}
+			else
+				c = 0xFFFD;
+		}
+
+		if (c < 0x80)
+			utf8.push_back(static_cast<char>(c));
+		else if (c < 0x800)
+		{
+			utf8.push_back(static_cast<char>(0xC0 | (c >> 6)));
+			utf8.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+		}
+		else if (c < 0x10000)
+		{
+			utf8.push_back(static_cast<char>(0xE0 | (c >> 12)));
+			utf8.push_back(static_cast<char>(0x80 | ((c >> 6) & 0x3F)));
+			utf8.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+		}
+		else
+		{
+			utf8.push_back(static_cast<char>(0xF0 | (c >> 18)));
+			utf8.push_back(static_cast<char>(0x80 | ((c >> 12) & 0x3F)));
+			utf8.push_back(static_cast<char>(0x80 | ((c >> 6) & 0x3F)));
+			utf8.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+		}
+	}
+	if (utf8.empty())
+		return ;
+
+	if (toStdOut)
+		fwrite(&utf8[0], 1, utf8.size(), stdout);
+
+	if (toFile)
+	{
+		if (!logFile)
+			OpenLogFile(logFileOpened);
+		if (logFile)
+		{
+			fwrite(&utf8[0], 1, utf8.size(), logFile);
+			logFileSize += utf8.size();
+			if (logFileSize > MAX_LOG_FILE_SIZE)
+				RotateLogFiles();
+		}
+	}
+}
+
+void Console::OpenLogFile(bool append)
+{
+	logFile = fopen(logFileName.GetData(), append ? "ab" : "wb");
+	logFileSize = 0;
+	if (!logFile)
+	{
+		// Printing goes on without the file if it can't be opened
+		AtomicStore(&logToFile, 0);
+		return ;
+	}
+
+	logFileOpened = true;
+	if (append)
+	{
+		fseek(logFile, 0, SEEK_END);
+		logFileSize = static_cast<UInt32>(ftell(logFile));
+	}
+}
+
+void Console::RotateLogFiles()
+{
+	fclose(logFile);
+	logFile = nullptr;
+
+	// <log file>.1 becomes <log file>.2, and so on, and the oldest is removed
+	ASCIIString older = logFileName + '.';
+	older.Append32BitUInt(NUM_OLD_LOG_FILES);
+	remove(older.GetData());
+	for (UInt32 i = NUM_OLD_LOG_FILES; i > 1; --i)
+	{
+		ASCIIString newer = logFileName + '.';
+		newer.Append32BitUInt(i - 1);
+		rename(newer.GetData(), older.GetData());
+		older = newer;
+	}
+	rename(logFileName.GetData(), older.GetData());
+
+	OpenLogFile(false);
+}
+
+String Console::GetContents() const
+{
+	ScopedLock<Mutex> l(contentsLock);
+	return contents;
+}
+
+void Console::Flush()
+{
+	const Int32 target = AtomicLoad(&tail);
+	while (PositionDistance(target, AtomicLoad(&written)) > 0)
+	{
+		WakeSink();
+		Thread::YieldCPU();
+	}
+}
+
+MAKO_END_NAMESPACE
@@ -1,56 +1,229 @@
 #pragma once
 #include "MakoCommon.h"
 #include "MakoString.h"
+#include "MakoArrayList.h"
+#include "MakoAtomic.h"
+#include "MakoThread.h"
+#include <cstdio>
 
 MAKO_BEGIN_NAMESPACE
 
-// Forward declaration
-class Application;
-
 //! Specifies the importance of the log for something that
 //! happened.
 enum LOG_LEVEL
-{ LL_LOW, LL_MEDIUM, LL_HIGH};
+{ LL_LOW, LL_MEDIUM, LL_HIGH, LL_ENUM_LENGTH };
+
+//! Logs below this level are compiled out of MAKO_LOG(): 0 keeps every
+//! level, 1 drops LL_LOW, 2 drops LL_LOW and LL_MEDIUM.
+#ifndef MAKO_MIN_LOG_LEVEL
+	#define MAKO_MIN_LOG_LEVEL 0
+#endif
+
+//! Whether logs of a level reach the console, checking the compile time
+//! level before the console's
+#define MAKO_IS_LOG_LEVEL_ENABLED(CONSOLE, LEVEL) \
+	((LEVEL) >= MAKO_MIN_LOG_LEVEL && (CONSOLE)->IsLogLevelEnabled(LEVEL))
+
+//! Log a message, only building it if it's level is enabled, so a disabled
+//! log costs a comparison and doesn't allocate:
+//! <tt>MAKO_LOG(console, LL_LOW, Text("Loaded [") + path + StringChar(']'));</tt>
+#define MAKO_LOG(CONSOLE, LEVEL, MESSAGE) \
+	do { if (MAKO_IS_LOG_LEVEL_ENABLED(CONSOLE, LEVEL)) (CONSOLE)->Log(LEVEL, MESSAGE); } while (0)
 
 //! This class represents the console of a Mako application.
 //! It can be opened during the running of a game usually by
 //! the "~" key. It acts as displaying warning/error messages,
 //! and also to execute actions that affect the Mako application's
 //! state.
+//!
+//! Printing doesn't write anything itself: the text is copied into records
+//! in a ring of CAPACITY slots, which any number of threads can post to
+//! without locking or allocating, and a sink thread takes them out and
+//! appends them to the contents, stdout and the log file. The contents only
+//! keep the newest MAX_CONTENTS_LENGTH characters. Messages posted while
+//! the ring stays full are dropped, and the number of them is logged.
 class Console
 {
+public:
+	enum
+	{
+		//! The number of records of the ring, a power of two
+		CAPACITY = 1024,
+		//! The number of characters a record holds. Longer messages take up
+		//! several records.
+		RECORD_LENGTH = 120,
+		//! Messages are cut off after this many records
+		MAX_RECORDS_PER_MESSAGE = 32,
+		//! The number of times a message is posted again while the ring is
+		//! full before it's dropped
+		MAX_POST_RETRIES = 64,
+		//! The number of the newest characters the contents keep
+		MAX_CONTENTS_LENGTH = 64 * 1024,
+		//! The log file is rotated when it's larger than this many bytes
+		MAX_LOG_FILE_SIZE = 4 * 1024 * 1024,
+		//! The number of rotated log files that are kept, as
+		//! <log file>.1 (the newest) to <log file>.NUM_OLD_LOG_FILES
+		NUM_OLD_LOG_FILES = 3
+	};
 private:
+	//! A part of a message
+	struct Record
+	{
+		LOG_LEVEL level;
+		UInt16 length;
+		//! Whether it's the last record of it's message
+		bool last;
+		//! Whether a new line follows the message
+		bool newLine;
+		StringChar text[RECORD_LENGTH];
+	};
+
+	struct Slot
+	{
+		//! The position of the slot when it's free to be written, or that
+		//! position plus one when the record in it is ready to be read
+		volatile Int32 sequence;
+		Record record;
+	};
+
+	Slot* slots;
+
+	// The producers and the sink each keep to their own cache line
+	Int8 pad0[64];
+	//! The position the next record is posted to
+	volatile Int32 tail;
+	Int8 pad1[64];
+	//! The position the next record is taken from, only used by the sink
+	Int32 head;
+	//! The position up to which records were written out, for Flush()
+	volatile Int32 written;
+	Int8 pad2[64];
+
+	//! The lowest LOG_LEVEL that is logged
+	volatile Int32 logLevel;
+	//! The number of messages that were dropped since the sink last logged it
+	volatile Int32 numDropped;
+
+	//! Set while the sink waits for records, so posters know to wake it
+	volatile Int32 sinkWaiting;
+	volatile Int32 stopping;
+	Semaphore wake;
+	Thread* sink;
+
+	mutable Mutex contentsLock;
 	String contents;
-	Application* app;
-	bool logToFile;
+
+	volatile Int32 logToFile;
+	volatile Int32 logToStdOut;
+	ASCIIString logFileName;
+	//! Only used by the sink, which opens the log file when it's first
+	//! written to, and closes it when logging to it is turned off
+	FILE* logFile;
+	UInt32 logFileSize;
+	bool logFileOpened;
+
+	// Only used by the sink
+	String message;
+	ArrayList<char> utf8;
+
+	// Not copyable
+	Console(const Console&);
+	Console& operator = (const Console&);
+
+	//! Copy a message into records, and post them
+	void Post(LOG_LEVEL ll, const StringView& s, bool newLine);
+
+	//! Wakes the sink if it waits for records
+	void WakeSink();
+
+	static void RunSink(void* console);
+
+	//! Takes the records that were posted out of the ring, and writes out the
+	//! messages that are complete
+	//! \return Whether any record was taken
+	bool TakeRecords();
+
+	//! Appends a message to the contents, and writes it to stdout and the
+	//! log file
+	void Write(const String& s);
+
+	//! \param[in] append Whether to append to the log file instead of
+	//! starting a new one
+	void OpenLogFile(bool append);
+	void RotateLogFiles();
 public:
-	MAKO_INLINE Console(bool logToFile = false)
-		: logToFile(logToFile) {}
-	MAKO_INLINE ~Console() {}
-	
+	//! Starts the sink thread.
+	//! \param[in] logToFile Whether to write everything that's printed to a
+	//! log file, too
+	//! \param[in] logToStdOut Whether to write everything that's printed to
+	//! stdout, too
+	//! \param[in] logFileName The path of the log file
+	MAKO_API Console(bool logToFile = false, bool logToStdOut = false,
+	                 const char* logFileName = "Mako.log");
+
+	//! Writes out what was posted, and stops the sink thread
+	MAKO_API ~Console();
+
 	//! Print text onto the contents of the Console
 	//! \param[in] s The text
-	MAKO_INLINE void Print(const String& s)
-	{ contents += s; }
+	MAKO_INLINE void Print(const StringView& s)
+	{ Post(LL_HIGH, s, false); }
 
 	//! Print a line of text onto the contents of the console.
 	//! This simply appends a new line character to String s
 	//! and then prints it to the console's contents.
 	//! \param[in] s The text
-	MAKO_INLINE void PrintLn(const String& s)
-	{ contents += (s + StringChar('\n')); }
-	
-	//! Get the contents of the console.
+	MAKO_INLINE void PrintLn(const StringView& s)
+	{ Post(LL_HIGH, s, true); }
+
+	//! Get the contents of the console: the newest MAX_CONTENTS_LENGTH
+	//! characters that were written out. Call Flush() first to include
+	//! everything that was printed.
 	//! \return The contents of the console
-	MAKO_INLINE const String& GetContents() const
-	{ return contents; }
+	MAKO_API String GetContents() const;
+
+	//! Waits until everything that was printed before was written out
+	MAKO_API void Flush();
+
+	//! Set whether everything that's printed from now on is written to the
+	//! log file, too. The log file is started anew the first time it's
+	//! written to, and appended to when logging to it is turned on again.
+	MAKO_INLINE void SetLogToFile(bool logToFile)
+	{ AtomicStore(&this->logToFile, logToFile ? 1 : 0); }
+
+	MAKO_INLINE bool GetLogToFile() const
+	{ return AtomicLoad(&logToFile) != 0; }
+
+	//! Set whether everything that's printed from now on is written to
+	//! stdout, too
+	MAKO_INLINE void SetLogToStdOut(bool logToStdOut)
+	{ AtomicStore(&this->logToStdOut, logToStdOut ? 1 : 0); }
+
+	MAKO_INLINE bool GetLogToStdOut() const
+	{ return AtomicLoad(&logToStdOut) != 0; }
+
+	//! Set the lowest level that is logged. Messages of lower levels are
+	//! ignored by Log(), and not even built by MAKO_LOG().
+	MAKO_INLINE void SetLogLevel(LOG_LEVEL ll)
+	{ AtomicStore(&logLevel, static_cast<Int32>(ll)); }
+
+	MAKO_INLINE LOG_LEVEL GetLogLevel() const
+	{ return static_cast<LOG_LEVEL>(AtomicLoad(&logLevel)); }
+
+	//! Check if messages of a level are logged
+	MAKO_INLINE bool IsLogLevelEnabled(LOG_LEVEL ll) const
+	{ return static_cast<Int32>(ll) >= AtomicLoad(&logLevel); }
 
 	//! Log that SOMETHING happened. This differs from Print()
 	//! and PrintLn() because it is specialized for recording
-	//! something specific that occured.
+	//! something specific that occured. Use MAKO_LOG() to not
+	//! build the message when it's level isn't logged.
 	//! \param[in] ll The log level; the importance
 	//! \param[in] message The message describing what occured.
-	MAKO_INLINE void Log(LOG_LEVEL ll, const String& message)
-	{ PrintLn(message); }
+	MAKO_INLINE void Log(LOG_LEVEL ll, const StringView& message)
+	{
+		if (IsLogLevelEnabled(ll))
+			Post(ll, message, true);
+	}
 };
 MAKO_END_NAMESPACE
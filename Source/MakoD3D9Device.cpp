@@ -44,9 +44,23 @@ MAKO_BEGIN_NAMESPACE
 #define EXC_IF_HR_FAILEDMSG(thing, msg)\
 	if (FAILED(thing)) throw Exception(msg);
 
+//! The vertex of the quads of Draw2dQuads(), already in screen space
+struct Quad2dVertex
+{
+	Float32 x, y, z, rhw;
+	D3DCOLOR color;
+	Float32 u, v;
+};
+
+#define QUAD2D_FVF (D3DFVF_XYZRHW | D3DFVF_DIFFUSE | D3DFVF_TEX1)
+
+//! The number of quads that fit in D3D9Device::quadVB
+static const UInt32 QUAD_BATCH_SIZE = 4096;
+
 D3D9Device::D3D9Device(bool vsync)
 : deviceOptions(GDO_ENUM_LENGTH), oldTex2dQuadGeometryPos(0, 0), oldTex2dQuadGeometryRot(0.f),
-  oldTex2dQuadGeometrySize(0, 0), GenericGraphicsDevice(vsync), defaultmtl(nullptr)
+  oldTex2dQuadGeometrySize(0, 0), GenericGraphicsDevice(vsync), defaultmtl(nullptr),
+  quadVB(nullptr), quadIB(nullptr), quadVBPos(0), quadStates(nullptr)
 {
 	d3d = Direct3DCreate9(D3D_SDK_VERSION);
 	InitIDirect3dDevice9();
@@ -118,6 +132,81 @@ void D3D9Device::InitOptions()
 void D3D9Device::Init2dDrawingCapability()
 {
 	EXC_IF_D3D9GLOFUNC_FAILED(D3DXCreateSprite(d3ddev, &sprite), L"D3DXCreateSprite");
+
+	// Every quad is two triangles, whose indices never change
+	EXC_IF_D3D9FUNC_FAILED(d3ddev->CreateIndexBuffer
+		(
+			QUAD_BATCH_SIZE * 6 * sizeof(UInt16),
+			D3DUSAGE_WRITEONLY,
+			D3DFMT_INDEX16,
+			D3DPOOL_MANAGED,
+			&quadIB,
+			nullptr
+		), L"CreateIndexBuffer");
+
+	UInt16* indices;
+	EXC_IF_D3D9FUNC_FAILED(quadIB->Lock(0, 0, reinterpret_cast<void**>(&indices), 0), L"IndexBuffer::Lock");
+	for (UInt32 i = 0; i < QUAD_BATCH_SIZE; ++i, indices += 6)
+	{
+		const UInt16 first = static_cast<UInt16>(i * 4);
+		indices[0] = first;     indices[1] = first + 1; indices[2] = first + 2;
+		indices[3] = first;     indices[4] = first + 2; indices[5] = first + 3;
+	}
+	quadIB->Unlock();
+
+	CreateDefaultPoolResources();
+}
+
+void D3D9Device::CreateDefaultPoolResources()
+{
+	EXC_IF_D3D9FUNC_FAILED(d3ddev->CreateVertexBuffer
+		(
+			QUAD_BATCH_SIZE * 4 * sizeof(Quad2dVertex),
+			D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY,
+			QUAD2D_FVF,
+			D3DPOOL_DEFAULT,
+			&quadVB,
+			nullptr
+		), L"CreateVertexBuffer");
+
+	// Record which states Draw2dQuads() changes; the values don't matter
+	d3ddev->BeginStateBlock();
+	d3ddev->SetFVF(QUAD2D_FVF);
+	d3ddev->SetStreamSource(0, quadVB, 0, sizeof(Quad2dVertex));
+	d3ddev->SetIndices(quadIB);
+	d3ddev->SetVertexShader(nullptr);
+	d3ddev->SetPixelShader(nullptr);
+	d3ddev->SetTexture(0, nullptr);
+	d3ddev->SetRenderState(D3DRS_ZENABLE, D3DZB_FALSE);
+	d3ddev->SetRenderState(D3DRS_LIGHTING, FALSE);
+	d3ddev->SetRenderState(D3DRS_CULLMODE, D3DCULL_NONE);
+	d3ddev->SetRenderState(D3DRS_ALPHABLENDENABLE, TRUE);
+	d3ddev->SetRenderState(D3DRS_SRCBLEND, D3DBLEND_SRCALPHA);
+	d3ddev->SetRenderState(D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA);
+	d3ddev->SetTextureStageState(0, D3DTSS_COLOROP, D3DTOP_MODULATE);
+	d3ddev->SetTextureStageState(0, D3DTSS_COLORARG1, D3DTA_TEXTURE);
+	d3ddev->SetTextureStageState(0, D3DTSS_COLORARG2, D3DTA_DIFFUSE);
+	d3ddev->SetTextureStageState(0, D3DTSS_ALPHAOP, D3DTOP_MODULATE);
+	d3ddev->SetTextureStageState(0, D3DTSS_ALPHAARG1, D3DTA_TEXTURE);
+	d3ddev->SetTextureStageState(0, D3DTSS_ALPHAARG2, D3DTA_DIFFUSE);
+	d3ddev->SetTextureStageState(1, D3DTSS_COLOROP, D3DTOP_DISABLE);
+	EXC_IF_D3D9FUNC_FAILED(d3ddev->EndStateBlock(&quadStates), L"EndStateBlock");
+	quadVBPos = 0;
+}
+
+void D3D9Device::ReleaseDefaultPoolResources()
+{
+	if (quadStates)
+	{
+		quadStates->Release();
+		quadStates = nullptr;
+	}
+	if (quadVB)
+	{
+		quadVB->Release();
+		quadVB = nullptr;
+	}
+	quadVBPos = 0;
 }
 
 void D3D9Device::GetVendorInfo()
@@ -155,6 +244,7 @@ void D3D9Device::GetVendorInfo()
 
 D3D9Device::~D3D9Device()
 {
+	DropResources();
 	if (defaultmtl)
 		defaultmtl->Drop();
 	if (d3ddev)
@@ -171,6 +261,9 @@ D3D9Device::~D3D9Device()
 		sprite->Release();
 		sprite = nullptr;
 	}
+	ReleaseDefaultPoolResources();
+	if (quadIB)
+		quadIB->Release();
 	if (d3ddev)
 	{
 		d3ddev->Release();
@@ -280,7 +373,20 @@ void D3D9Device::EndScene()
 
 void D3D9Device::Reset()
 {
-	HRESULT hr = d3ddev->Reset(&d3dpp);
+	// Everything in D3DPOOL_DEFAULT has to be released before the device
+	// can be reset, and is created again afterwards
+	sprite->OnLostDevice();
+	ReleaseDefaultPoolResources();
+
+	if (FAILED(d3ddev->Reset(&d3dpp)))
+	{
+		// The device is still lost; it's reset again later
+		APP()->GetConsole()->Log(LL_LOW, Text("IDirect3d9::Reset() failed."));
+		return ;
+	}
+
+	sprite->OnResetDevice();
+	CreateDefaultPoolResources();
 	deviceLost = false;
 }
 void D3D9Device::SetBackgroundColor(const Color& color)
@@ -521,6 +627,51 @@ void D3D9Device::DrawIndexedMeshData(IndexedMeshData* mb)
 	}
 }
 
+void D3D9Device::DrawMeshDataPrimitives(MeshData* mb, UInt32 firstPrim, UInt32 numPrims)
+{
+	// Select which vertex format we are using
+	LOG_IF_D3D9FUNC_FAILED(d3ddev->SetFVF
+		(
+		static_cast<D3D9VertexBuffer*>(mb->GetVertexHardwareBuffer())->GetFVF()
+		), L"SetFVF");
+
+	// Tell D3D9 where the vertices are
+	LOG_IF_D3D9FUNC_FAILED(d3ddev->SetStreamSource
+		(
+			0,
+			static_cast<D3D9VertexBuffer*>(mb->GetVertexHardwareBuffer())->GetD3D9VertexBuffer(),
+			0,
+			mb->GetVertexType()
+		), L"SetStreamSource");
+
+	if (!mb->IsIndexed())
+	{
+		LOG_IF_D3D9FUNC_FAILED(d3ddev->DrawPrimitive
+		(
+			static_cast<D3DPRIMITIVETYPE>(mb->GetPrimitiveType()),
+			CalcVertPosFromPrimCount(firstPrim, mb->GetPrimitiveType()),
+			numPrims
+		), L"DrawPrimitive");
+		return ;
+	}
+
+	// Tell D3D9 where the indices are
+	LOG_IF_D3D9FUNC_FAILED(d3ddev->SetIndices
+		(
+			static_cast<D3D9IndexBuffer*>(static_cast<IndexedMeshData*>(mb)->GetIndexHardwareBuffer())->GetD3D9IndexBuffer()
+		), L"SetIndices");
+
+	LOG_IF_D3D9FUNC_FAILED(d3ddev->DrawIndexedPrimitive
+	(
+		static_cast<D3DPRIMITIVETYPE>(mb->GetPrimitiveType()),
+		0, // This value is ADDED to the vbindices' values
+		0,
+		mb->GetNumVertices(),
+		CalcVBIndexPosFromPrimCount(firstPrim, mb->GetPrimitiveType()),
+		numPrims
+	), L"DrawIndexedPrimitive");
+}
+
 void D3D9Device::Draw2dTexture(const Position2d& pos, Texture* tex, const Rotation2d& rot)
 {
 	EXC_IF_D3D9GLOFUNC_FAILED(sprite->Begin(D3DXSPRITE_ALPHABLEND), L"D3DXSprite::Begin");
@@ -545,6 +696,92 @@ void D3D9Device::Draw2dTexture(const Position2d& pos, Texture* tex, const Rotati
 	EXC_IF_D3D9GLOFUNC_FAILED(sprite->End(), L"D3DXSprite::End");;
 }
 
+void D3D9Device::Draw2dQuads(Texture* tex, const Quad2d* quads, UInt32 numQuads)
+{
+	// Nothing is drawn while the device is lost and couldn't be reset yet
+	if (!numQuads || !quadVB)
+		return;
+
+	quadStates->Capture();
+
+	d3ddev->SetFVF(QUAD2D_FVF);
+	d3ddev->SetStreamSource(0, quadVB, 0, sizeof(Quad2dVertex));
+	d3ddev->SetIndices(quadIB);
+	d3ddev->SetVertexShader(nullptr);
+	d3ddev->SetPixelShader(nullptr);
+	d3ddev->SetTexture(0, static_cast<D3D9Texture*>(tex->GetTextureHardwareBuffer())->GetIDirect3DTexture9());
+	d3ddev->SetRenderState(D3DRS_ZENABLE, D3DZB_FALSE);
+	d3ddev->SetRenderState(D3DRS_LIGHTING, FALSE);
+	d3ddev->SetRenderState(D3DRS_CULLMODE, D3DCULL_NONE);
+	d3ddev->SetRenderState(D3DRS_ALPHABLENDENABLE, TRUE);
+	d3ddev->SetRenderState(D3DRS_SRCBLEND, D3DBLEND_SRCALPHA);
+	d3ddev->SetRenderState(D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA);
+	// CF_A8 textures have no colors of their own; they're white
+	d3ddev->SetTextureStageState(0, D3DTSS_COLOROP,
+		tex->GetColorFormat() == CF_A8 ? D3DTOP_SELECTARG2 : D3DTOP_MODULATE);
+	d3ddev->SetTextureStageState(0, D3DTSS_COLORARG1, D3DTA_TEXTURE);
+	d3ddev->SetTextureStageState(0, D3DTSS_COLORARG2, D3DTA_DIFFUSE);
+	d3ddev->SetTextureStageState(0, D3DTSS_ALPHAOP, D3DTOP_MODULATE);
+	d3ddev->SetTextureStageState(0, D3DTSS_ALPHAARG1, D3DTA_TEXTURE);
+	d3ddev->SetTextureStageState(0, D3DTSS_ALPHAARG2, D3DTA_DIFFUSE);
+	d3ddev->SetTextureStageState(1, D3DTSS_COLOROP, D3DTOP_DISABLE);
+
+	while (numQuads)
+	{
+		// Append after the quads already in the buffer, so the driver doesn't
+		// wait for the GPU to be done with them; discard it once it's full
+		DWORD lockFlags = D3DLOCK_NOOVERWRITE;
+		if (quadVBPos == QUAD_BATCH_SIZE)
+		{
+			quadVBPos = 0;
+			lockFlags = D3DLOCK_DISCARD;
+		}
+		const UInt32 count = Min(numQuads, QUAD_BATCH_SIZE - quadVBPos);
+
+		Quad2dVertex* v;
+		if (FAILED(quadVB->Lock(quadVBPos * 4 * sizeof(Quad2dVertex), count * 4 * sizeof(Quad2dVertex),
+			reinterpret_cast<void**>(&v), lockFlags)))
+			break;
+
+		for (UInt32 i = 0; i < count; ++i, v += 4)
+		{
+			const Quad2d& q = quads[i];
+			const D3DCOLOR color = q.color.GetB8G8R8A8Format();
+			for (UInt32 j = 0; j < 4; ++j)
+			{
+				// Pixel centres are at integers in Direct3D 9, texel centres at
+				// halves, so the positions are moved by half a pixel to match
+				v[j].x     = q.pos[j].x - .5f;
+				v[j].y     = q.pos[j].y - .5f;
+				v[j].z     = 0.f;
+				v[j].rhw   = 1.f;
+				v[j].color = color;
+			}
+			v[0].u = q.uv0.x; v[0].v = q.uv0.y;
+			v[1].u = q.uv1.x; v[1].v = q.uv0.y;
+			v[2].u = q.uv1.x; v[2].v = q.uv1.y;
+			v[3].u = q.uv0.x; v[3].v = q.uv1.y;
+		}
+		quadVB->Unlock();
+
+		LOG_IF_D3D9FUNC_FAILED(d3ddev->DrawIndexedPrimitive
+		(
+			D3DPT_TRIANGLELIST,
+			quadVBPos * 4, // Added to the indices
+			0,
+			count * 4,
+			0,
+			count * 2
+		), L"DrawIndexedPrimitive");
+
+		quadVBPos += count;
+		quads     += count;
+		numQuads  -= count;
+	}
+
+	quadStates->Apply();
+}
+
 void D3D9Device::Draw2dText(const Position2d& pos, const String& text, const Color& c, const UInt32 fontSize,
 							const String& font)
 {}
@@ -28,6 +28,15 @@ private:
 
 	LPD3DXSPRITE sprite;
 
+	//! Draw2dQuads() appends it's quads to quadVB, until it's full; then
+	//! it's discarded and filled again from the start.
+	LPDIRECT3DVERTEXBUFFER9 quadVB;
+	LPDIRECT3DINDEXBUFFER9 quadIB;
+	UInt32 quadVBPos;
+	//! Every state Draw2dQuads() sets, captured before and applied after,
+	//! so the 3d drawing is left as it was
+	LPDIRECT3DSTATEBLOCK9 quadStates;
+
 	bool deviceLost;
 	String vendornfo;
 
@@ -83,6 +92,7 @@ public:
 
 	void DrawMeshData(MeshData* mb);
 	void DrawIndexedMeshData(IndexedMeshData* mb);
+	void DrawMeshDataPrimitives(MeshData* mb, UInt32 firstPrim, UInt32 numPrims);
 
 	MeshData* CreateMeshData(const MeshDataCreationParams& params);
 	MeshData* CreateIndexedMeshData(const IndexedMeshDataCreationParams& params);
@@ -93,6 +103,8 @@ public:
 	void Draw2dTexture(const Position2d& pos,
 		Texture* tex, const Rotation2d& rot = Rot2d(0.f));
 
+	void Draw2dQuads(Texture* tex, const Quad2d* quads, UInt32 numQuads);
+
 	void TakeScreenshot(const String& filePath, IMAGE_TYPE imageType = IMGT_PNG);
 private:
 	void SetTex2dQuadGeometry(const Position2d& pos, const Size2d& size, 
@@ -101,6 +113,11 @@ private:
 	void InitOptions();
 	void InitIDirect3dDevice9();
 	void Init2dDrawingCapability();
+
+	//! Creates the resources in D3DPOOL_DEFAULT, which don't survive a
+	//! Reset(): quadVB and quadStates
+	void CreateDefaultPoolResources();
+	void ReleaseDefaultPoolResources();
 	void GetVendorInfo();
 };
 
@@ -18,15 +18,37 @@ D3D9Texture::D3D9Texture(D3D9Device* gd, Texture* texture)
 	case CF_R8G8B8A8:
 		format = D3DFMT_A8R8G8B8;
 		break;
+	case CF_A8:
+		format = D3DFMT_A8;
+		break;
+	case CF_BC1:
+		format = D3DFMT_DXT1;
+		break;
+	case CF_BC3:
+		format = D3DFMT_DXT5;
+		break;
+	case CF_BC4:
+		format = static_cast<D3DFORMAT>(MAKEFOURCC('A', 'T', 'I', '1'));
+		break;
+	case CF_BC5:
+		format = static_cast<D3DFORMAT>(MAKEFOURCC('A', 'T', 'I', '2'));
+		break;
+	default:
+		throw Exception(Text("Failed to identify color format in D3D9Texture::D3D9Texture()."));
 	}
 
+	// Textures without their own mip levels still get them from the driver,
+	// unless they're block compressed, which the driver can't filter
+	const UInt32 levels = texture->GetNumMipLevels();
+	const DWORD usage = levels > 1 || IsBlockCompressed(texture->GetColorFormat()) ? 0 : D3DUSAGE_AUTOGENMIPMAP;
+
 	HRESULT hr;
 	if (FAILED(hr = gd->GetIDirect3DDevice9()->CreateTexture
 		(
 			texture->GetSize().x,
 			texture->GetSize().y,
-			1,
-			D3DUSAGE_AUTOGENMIPMAP,
+			levels,
+			usage,
 			format,
 			D3DPOOL_MANAGED,
 			&d3d9tex,
@@ -45,27 +67,62 @@ D3D9Texture::~D3D9Texture()
 
 void D3D9Texture::Update()
 {
-	D3DLOCKED_RECT rect;
-	if (FAILED(d3d9tex->LockRect(0, &rect, nullptr, 0)))
-		throw Exception(Text("IDirect3DTexture9::LockRect() failed"));
+	// The parent may have removed or generated it's mip levels since the
+	// texture was created, so only the levels both have are updated
+	const UInt32 levels = parent->GetNumMipLevels() < d3d9tex->GetLevelCount() ?
+		parent->GetNumMipLevels() : d3d9tex->GetLevelCount();
 
-	switch (parent->GetColorFormat())
+	for (UInt32 level = 0; level < levels; ++level)
 	{
-	case CF_R8G8B8A8:
-		{
-			for (UInt32* out = (UInt32*)rect.pBits, * in = (UInt32*)parent->GetImageData(); in != parent->GetImageDataEnd(); ++in, ++out)
-				*out = (((UByte*)in)[3] << 24) | (((UByte*)in)[0] << 16) | (((UByte*)in)[1] << 8) | (((UByte*)in)[2]);
-			break;
-		}
-	default:
+		D3DLOCKED_RECT rect;
+		if (FAILED(d3d9tex->LockRect(level, &rect, nullptr, 0)))
+			throw Exception(Text("IDirect3DTexture9::LockRect() failed"));
+
+		const Size2d& size = parent->GetMipLevelSize(level);
+		switch (parent->GetColorFormat())
 		{
-			throw Exception(Text("Failed to identify color format in D3D9Texture::Update()."));
+		case CF_R8G8B8A8:
+			{
+				const UByte* in = static_cast<const UByte*>(parent->GetMipLevelData(level));
+				for (UInt32 y = 0; y < size.y; ++y)
+				{
+					UInt32* out = reinterpret_cast<UInt32*>(static_cast<UByte*>(rect.pBits) + y * rect.Pitch);
+					for (UInt32 x = 0; x < size.x; ++x, in += 4)
+						out[x] = (in[3] << 24) | (in[0] << 16) | (in[1] << 8) | in[2];
+				}
+				break;
+			}
+		case CF_A8:
+			{
+				const UByte* in = static_cast<const UByte*>(parent->GetMipLevelData(level));
+				for (UInt32 y = 0; y < size.y; ++y, in += size.x)
+					memcpy(static_cast<UByte*>(rect.pBits) + y * rect.Pitch, in, size.x);
+				break;
+			}
+		case CF_BC1:
+		case CF_BC3:
+		case CF_BC4:
+		case CF_BC5:
+			{
+				// Blocks are uploaded as they are, a row of blocks at a time
+				const UByte* in = static_cast<const UByte*>(parent->GetMipLevelData(level));
+				const UInt32 rowSize = ((size.x + 3) / 4) * GetBlockSize(parent->GetColorFormat());
+				for (UInt32 y = 0; y < (size.y + 3) / 4; ++y, in += rowSize)
+					memcpy(static_cast<UByte*>(rect.pBits) + y * rect.Pitch, in, rowSize);
+				break;
+			}
+		default:
+			{
+				d3d9tex->UnlockRect(level);
+				throw Exception(Text("Failed to identify color format in D3D9Texture::Update()."));
+			}
 		}
-	}
 
-	if (FAILED(d3d9tex->UnlockRect(0)))
-		throw Exception(Text("IDirect3DTexture9::UnlockRect() failed"));
+		if (FAILED(d3d9tex->UnlockRect(level)))
+			throw Exception(Text("IDirect3DTexture9::UnlockRect() failed"));
+	}
 
+	// Does nothing unless the texture was created with D3DUSAGE_AUTOGENMIPMAP
 	d3d9tex->GenerateMipSubLevels();
 }
 
@@ -114,6 +114,8 @@ DWORD D3D9VertexBuffer::GetFVF()
 		fvf |= D3DFVF_TEX1;
 	else if (mb->GetVertexType() == VT_T2)
 		fvf |= D3DFVF_TEX2;
+	else if (mb->GetVertexType() == VT_NORMAL)
+		fvf |= D3DFVF_NORMAL | D3DFVF_TEX1;
 	return fvf;
 }
 
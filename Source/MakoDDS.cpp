@@ -0,0 +1,68 @@
+#include "MakoDDS.h"
+#include "MakoStream.h"
+#include "MakoImageResampler.h"
+#include "MakoException.h"
+#include <string.h>
+
+MAKO_BEGIN_NAMESPACE
+
+void WriteDDS(OutputStream* out, COLOR_FORMAT format, const Size2d& size,
+			  UInt32 numMipLevels, const void* data)
+{
+	DDSHeader header;
+	memset(&header, 0, sizeof(header));
+	header.size        = sizeof(DDSHeader);
+	header.flags       = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT;
+	header.height      = size.y;
+	header.width       = size.x;
+	header.mipMapCount = numMipLevels;
+	header.caps        = DDSCAPS_TEXTURE;
+	header.pixelFormat.size = sizeof(DDSPixelFormat);
+
+	if (numMipLevels > 1)
+	{
+		header.flags |= DDSD_MIPMAPCOUNT;
+		header.caps  |= DDSCAPS_COMPLEX | DDSCAPS_MIPMAP;
+	}
+
+	switch (format)
+	{
+	case CF_R8G8B8A8:
+		header.flags |= DDSD_PITCH;
+		header.pitchOrLinearSize = size.x * 4;
+		header.pixelFormat.flags       = DDPF_RGB | DDPF_ALPHAPIXELS;
+		header.pixelFormat.rgbBitCount = 32;
+		header.pixelFormat.rBitMask    = 0x000000FF;
+		header.pixelFormat.gBitMask    = 0x0000FF00;
+		header.pixelFormat.bBitMask    = 0x00FF0000;
+		header.pixelFormat.aBitMask    = 0xFF000000;
+		break;
+	case CF_BC1:
+	case CF_BC3:
+	case CF_BC4:
+	case CF_BC5:
+		header.flags |= DDSD_LINEARSIZE;
+		header.pitchOrLinearSize = GetImageDataSize(format, size);
+		header.pixelFormat.flags  = DDPF_FOURCC;
+		header.pixelFormat.fourCC = format == CF_BC1 ? DDS_FOURCC_DXT1 :
+									format == CF_BC3 ? DDS_FOURCC_DXT5 :
+									format == CF_BC4 ? DDS_FOURCC_ATI1 : DDS_FOURCC_ATI2;
+		break;
+	default:
+		throw Exception(Text("Failed to identify color format in WriteDDS()."));
+	}
+
+	UInt32 dataSize = 0;
+	Size2d levelSize = size;
+	for (UInt32 i = 0; i < numMipLevels; ++i)
+	{
+		dataSize += GetImageDataSize(format, levelSize);
+		levelSize = GetNextMipLevelSize(levelSize);
+	}
+
+	out->Write32BitUInt(DDS_MAGIC);
+	out->WriteData(&header, sizeof(header));
+	out->WriteData(data, dataSize);
+}
+
+MAKO_END_NAMESPACE
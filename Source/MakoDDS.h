@@ -0,0 +1,111 @@
+#pragma once
+#include "MakoCommon.h"
+#include "MakoTexture.h"
+
+MAKO_BEGIN_NAMESPACE
+
+// Forward declaration
+class OutputStream;
+
+//! A DDS file is the DDS_MAGIC, followed by a DDSHeader, an optional
+//! DDSHeaderDX10 if the pixel format's fourCC is DDS_FOURCC_DX10, and the
+//! pixels of every mip level, one after another. Block compressed levels are
+//! stored as they are uploaded, so loading them is one read. All values are
+//! little endian.
+
+//! The first four bytes of every DDS file, "DDS "
+const UInt32 DDS_MAGIC = 0x20534444;
+
+//! DDSHeader::flags
+const UInt32 DDSD_CAPS        = 0x1;
+const UInt32 DDSD_HEIGHT      = 0x2;
+const UInt32 DDSD_WIDTH       = 0x4;
+const UInt32 DDSD_PITCH       = 0x8;
+const UInt32 DDSD_PIXELFORMAT = 0x1000;
+const UInt32 DDSD_MIPMAPCOUNT = 0x20000;
+const UInt32 DDSD_LINEARSIZE  = 0x80000;
+
+//! DDSPixelFormat::flags
+const UInt32 DDPF_ALPHAPIXELS = 0x1;
+const UInt32 DDPF_FOURCC      = 0x4;
+const UInt32 DDPF_RGB         = 0x40;
+const UInt32 DDPF_LUMINANCE   = 0x20000;
+
+//! DDSHeader::caps and caps2
+const UInt32 DDSCAPS_COMPLEX  = 0x8;
+const UInt32 DDSCAPS_TEXTURE  = 0x1000;
+const UInt32 DDSCAPS_MIPMAP   = 0x400000;
+const UInt32 DDSCAPS2_CUBEMAP = 0x200;
+const UInt32 DDSCAPS2_VOLUME  = 0x200000;
+
+//! Four character codes of DDSPixelFormat::fourCC
+const UInt32 DDS_FOURCC_DXT1 = 0x31545844;
+const UInt32 DDS_FOURCC_DXT5 = 0x35545844;
+const UInt32 DDS_FOURCC_ATI1 = 0x31495441;
+const UInt32 DDS_FOURCC_BC4U = 0x55344342;
+const UInt32 DDS_FOURCC_ATI2 = 0x32495441;
+const UInt32 DDS_FOURCC_BC5U = 0x55354342;
+const UInt32 DDS_FOURCC_DX10 = 0x30315844;
+
+//! DXGI_FORMATs of DDSHeaderDX10::dxgiFormat that are supported
+enum DDS_DXGI_FORMAT
+{
+	DDS_DXGI_R8G8B8A8_UNORM      = 28,
+	DDS_DXGI_R8G8B8A8_UNORM_SRGB = 29,
+	DDS_DXGI_BC1_UNORM           = 71,
+	DDS_DXGI_BC1_UNORM_SRGB      = 72,
+	DDS_DXGI_BC3_UNORM           = 77,
+	DDS_DXGI_BC3_UNORM_SRGB      = 78,
+	DDS_DXGI_BC4_UNORM           = 80,
+	DDS_DXGI_BC5_UNORM           = 83
+};
+
+struct DDSPixelFormat
+{
+	//! sizeof(DDSPixelFormat)
+	UInt32 size;
+	UInt32 flags;
+	UInt32 fourCC;
+	UInt32 rgbBitCount;
+	UInt32 rBitMask, gBitMask, bBitMask, aBitMask;
+};
+
+struct DDSHeader
+{
+	//! sizeof(DDSHeader)
+	UInt32 size;
+	UInt32 flags;
+	UInt32 height;
+	UInt32 width;
+	//! The bytes of a row of an uncompressed image, or of the whole top
+	//! level of a compressed one
+	UInt32 pitchOrLinearSize;
+	UInt32 depth;
+	UInt32 mipMapCount;
+	UInt32 reserved1[11];
+	DDSPixelFormat pixelFormat;
+	UInt32 caps;
+	UInt32 caps2;
+	UInt32 caps3;
+	UInt32 caps4;
+	UInt32 reserved2;
+};
+
+struct DDSHeaderDX10
+{
+	UInt32 dxgiFormat;
+	UInt32 resourceDimension;
+	UInt32 miscFlag;
+	UInt32 arraySize;
+	UInt32 miscFlags2;
+};
+
+//! Writes a texture to a DDS file, so DDSLoader can load it. Block
+//! compressed formats are written with the four character codes Direct3D 9
+//! understands, CF_R8G8B8A8 with bit masks.
+//! \param[in] data The pixels of numMipLevels levels, one after another, like
+//! TextureCreationParams::data.
+MAKO_API void WriteDDS(OutputStream* out, COLOR_FORMAT format, const Size2d& size,
+					   UInt32 numMipLevels, const void* data);
+
+MAKO_END_NAMESPACE
@@ -0,0 +1,186 @@
+#include "MakoDDSLoader.h"
+#include "MakoDDS.h"
+#include "MakoStream.h"
+#include "MakoTexture.h"
+#include "MakoImageResampler.h"
+#include "MakoException.h"
+#include "MakoMath.h"
+
+MAKO_BEGIN_NAMESPACE
+
+//! A channel of an uncompressed pixel format, given by a bit mask
+struct DDSChannel
+{
+	UInt32 mask, shift, bits;
+
+	DDSChannel(UInt32 mask)
+		: mask(mask), shift(0), bits(0)
+	{
+		if (!mask)
+			return;
+		while (!((mask >> shift) & 1))
+			++shift;
+		while (shift + bits < 32 && ((mask >> (shift + bits)) & 1))
+			++bits;
+	}
+
+	//! Extracts the channel from pixel, scaled to 8 bits
+	MAKO_INLINE UInt8 Extract(UInt32 pixel) const
+	{
+		if (!bits)
+			return 0;
+		const UInt32 value = (pixel & mask) >> shift;
+		return static_cast<UInt8>(bits >= 8 ? value >> (bits - 8) : value * 255 / ((1 << bits) - 1));
+	}
+};
+
+//! The largest width or height of a DDS file that is loaded, that of D3D11
+static const UInt32 MAX_DDS_SIZE = 16384;
+
+//! Throws if a stream with a fixed size has less than cBytes bytes left, so
+//! a truncated file isn't read past it's end
+static void CheckBytesLeft(InputStream* stream, UInt64 cBytes)
+{
+	const UInt32 size = stream->GetSize();
+	if (size && static_cast<UInt64>(stream->Tell()) + cBytes > size)
+		throw Exception(Text("The DDS file is corrupt"));
+}
+
+//! Get the COLOR_FORMAT of a DXGI_FORMAT
+static COLOR_FORMAT GetDXGIColorFormat(UInt32 dxgiFormat)
+{
+	switch (dxgiFormat)
+	{
+	case DDS_DXGI_R8G8B8A8_UNORM:
+	case DDS_DXGI_R8G8B8A8_UNORM_SRGB:
+		return CF_R8G8B8A8;
+	case DDS_DXGI_BC1_UNORM:
+	case DDS_DXGI_BC1_UNORM_SRGB:
+		return CF_BC1;
+	case DDS_DXGI_BC3_UNORM:
+	case DDS_DXGI_BC3_UNORM_SRGB:
+		return CF_BC3;
+	case DDS_DXGI_BC4_UNORM:
+		return CF_BC4;
+	case DDS_DXGI_BC5_UNORM:
+		return CF_BC5;
+	}
+	throw Exception(Text("The DXGI format of the DDS file is not supported"));
+}
+
+bool DDSLoader::Decode(InputStream* stream, TextureCreationParams& params)
+{
+	if (stream->Read32BitUInt() != DDS_MAGIC)
+		return false;
+
+	DDSHeader header;
+	CheckBytesLeft(stream, sizeof(header));
+	stream->ReadTo(&header, sizeof(header));
+	if (header.size != sizeof(DDSHeader) || header.pixelFormat.size != sizeof(DDSPixelFormat))
+		throw Exception(Text("The DDS file is corrupt"));
+	if (header.caps2 & (DDSCAPS2_CUBEMAP | DDSCAPS2_VOLUME))
+		throw Exception(Text("DDS cube maps and volume textures are not supported"));
+
+	const DDSPixelFormat& pf = header.pixelFormat;
+	COLOR_FORMAT format;
+	bool masked = false;
+	if (pf.flags & DDPF_FOURCC)
+	{
+		switch (pf.fourCC)
+		{
+		case DDS_FOURCC_DXT1:
+			format = CF_BC1;
+			break;
+		case DDS_FOURCC_DXT5:
+			format = CF_BC3;
+			break;
+		case DDS_FOURCC_ATI1:
+		case DDS_FOURCC_BC4U:
+			format = CF_BC4;
+			break;
+		case DDS_FOURCC_ATI2:
+		case DDS_FOURCC_BC5U:
+			format = CF_BC5;
+			break;
+		case DDS_FOURCC_DX10:
+			{
+				DDSHeaderDX10 dx10;
+				CheckBytesLeft(stream, sizeof(dx10));
+				stream->ReadTo(&dx10, sizeof(dx10));
+				if (dx10.arraySize > 1)
+					throw Exception(Text("DDS texture arrays are not supported"));
+				format = GetDXGIColorFormat(dx10.dxgiFormat);
+				break;
+			}
+		default:
+			throw Exception(Text("The pixel format of the DDS file is not supported"));
+		}
+	}
+	else if ((pf.flags & DDPF_RGB) && pf.rgbBitCount == 32)
+	{
+		format = CF_R8G8B8A8;
+		masked = true;
+	}
+	else
+	{
+		throw Exception(Text("The pixel format of the DDS file is not supported"));
+	}
+
+	if (!header.width || !header.height || header.width > MAX_DDS_SIZE || header.height > MAX_DDS_SIZE)
+		throw Exception(Text("The DDS file is corrupt"));
+
+	params.size.x = header.width;
+	params.size.y = header.height;
+	params.format = format;
+
+	params.numMipLevels = (header.flags & DDSD_MIPMAPCOUNT) && header.mipMapCount ? header.mipMapCount : 1;
+	if (params.numMipLevels > GetMipChainLength(params.size))
+		throw Exception(Text("The DDS file is corrupt"));
+
+	// Added up in 64 bits, so the size can't wrap around
+	UInt64 levelsSize = 0;
+	Size2d levelSize = params.size;
+	for (UInt32 i = 0; i < params.numMipLevels; ++i)
+	{
+		const UInt64 w = levelSize.x, h = levelSize.y;
+		levelsSize += IsBlockCompressed(format) ? ((w + 3) / 4) * ((h + 3) / 4) * GetBlockSize(format) :
+			w * h * (GetColorStride(format) / 8);
+		levelSize = GetNextMipLevelSize(levelSize);
+	}
+	if (levelsSize > 0xFFFFFFFF)
+		throw Exception(Text("The DDS file is corrupt"));
+	CheckBytesLeft(stream, levelsSize);
+	const UInt32 dataSize = static_cast<UInt32>(levelsSize);
+
+	UInt8* data = new UInt8[dataSize];
+	try
+	{
+		stream->ReadTo(data, dataSize);
+	}
+	catch (Exception&)
+	{
+		delete [] data;
+		throw;
+	}
+
+	if (masked)
+	{
+		// Reorder the channels of every pixel to R, G, B, A
+		const DDSChannel r(pf.rBitMask), g(pf.gBitMask), b(pf.bBitMask);
+		const DDSChannel a(pf.flags & DDPF_ALPHAPIXELS ? pf.aBitMask : 0);
+		for (UInt8* p = data; p != data + dataSize; p += 4)
+		{
+			const UInt32 pixel = p[0] | (p[1] << 8) | (p[2] << 16) | (p[3] << 24);
+			p[0] = r.Extract(pixel);
+			p[1] = g.Extract(pixel);
+			p[2] = b.Extract(pixel);
+			p[3] = a.bits ? a.Extract(pixel) : 255;
+		}
+	}
+
+	params.data = data;
+	params.generateMipMaps = true;
+	return true;
+}
+
+MAKO_END_NAMESPACE
@@ -0,0 +1,24 @@
+#pragma once
+#include "MakoCommon.h"
+#include "MakoTextureLoader.h"
+
+MAKO_BEGIN_NAMESPACE
+
+//! Loads DDS files (see MakoDDS.h). Block compressed images (DXT1, DXT5,
+//! ATI1/BC4 and ATI2/BC5, or their DX10 DXGI formats) and their mip levels
+//! are read as they are, and uploaded without being decoded. Uncompressed
+//! 32 bit images are converted to CF_R8G8B8A8. Cube maps, volumes and
+//! arrays aren't supported.
+class DDSLoader : public TextureLoader
+{
+public:
+	MAKO_INLINE DDSLoader() {}
+	MAKO_INLINE ~DDSLoader() {}
+
+	bool IsLoadableFileExt(const StringView& ext) const
+	{ return ext == Text("dds"); }
+
+	bool Decode(InputStream* stream, TextureCreationParams& params);
+};
+
+MAKO_END_NAMESPACE
@@ -0,0 +1,94 @@
+#include "MakoDecodedMesh.h"
+#include "MakoSimpleMesh.h"
+#include "MakoGraphicsDevice.h"
+#include "MakoApplication.h"
+#include "MakoFileSystem.h"
+#include "MakoConsole.h"
+#include "MakoDiffTexMtl.h"
+#include "MakoMeshCache.h"
+#include "MakoMesh.h"
+
+MAKO_BEGIN_NAMESPACE
+
+UInt32 DecodedMesh::GetSize() const
+{
+	UInt32 size = 0;
+	for (UInt32 i = 0; i < subMeshes.size(); ++i)
+	{
+		const IndexedMeshDataCreationParams& p = subMeshes[i].params;
+		size += p.numVertices * p.vertexType + p.numVertBufferIndices * p.vertBufferIndexType;
+	}
+	return size;
+}
+
+void LoadDecodedMeshTextures(const DecodedMesh& mesh, ArrayList<Texture*>& textures)
+{
+	textures.assign(mesh.texturePaths.size(), nullptr);
+	for (UInt32 i = 0; i < mesh.texturePaths.size(); ++i)
+	{
+		FilePath fp = APP()->FS()->FindFile(mesh.texturePaths[i]);
+		if (!fp.GetAbs().IsEmpty())
+			textures[i] = APP()->GD()->LoadTextureFromFile(fp);
+		else
+			MAKO_LOG(APP()->GetConsole(), LL_MEDIUM, Text("Failed to load texture (") + mesh.texturePaths[i] + StringChar(')'));
+	}
+}
+
+Mesh* CreateDecodedMesh(GraphicsDevice* gd, const DecodedMesh& mesh,
+						const ArrayList<Texture*>& textures)
+{
+	SimpleMesh* m = new SimpleMesh;
+	for (UInt32 iSubMesh = 0; iSubMesh < mesh.subMeshes.size(); ++iSubMesh)
+	{
+		const DecodedSubMesh& sm = mesh.subMeshes[iSubMesh];
+
+		IndexedMeshDataCreationParams p = sm.params;
+		if (!sm.vertices.empty())
+			p.vertices = const_cast<UInt8*>(&sm.vertices[0]);
+		if (!sm.indices.empty())
+			p.vertBufferIndices = const_cast<UInt8*>(&sm.indices[0]);
+
+		typedef Map<UInt32, UInt32>::const_iterator TexturesIt;
+		for (TexturesIt it = sm.textures.begin(); it != sm.textures.end(); ++it)
+		{
+			if ((*it).second == DecodedSubMesh::DEFAULT_MATERIAL)
+				p.materials[(*it).first] = gd->GetDefaultMaterial();
+			else if (textures[(*it).second])
+				p.materials[(*it).first] = new DiffTexMtl(textures[(*it).second]);
+		}
+
+		MeshData* mb = p.numVertBufferIndices ? gd->CreateIndexedMeshData(p) :
+		                                        gd->CreateMeshData(p);
+		m->AddSubMesh(mb);
+	}
+	return m;
+}
+
+Mesh* LoadDecodedMesh(const DecodedMesh& mesh, ArrayList<MeshCacheSubMesh>* cacheSubMeshes)
+{
+	ArrayList<Texture*> textures;
+	LoadDecodedMeshTextures(mesh, textures);
+	Mesh* m = CreateDecodedMesh(APP()->GD(), mesh, textures);
+
+	if (cacheSubMeshes)
+	{
+		for (UInt32 i = 0; i < mesh.subMeshes.size(); ++i)
+		{
+			cacheSubMeshes->push_back(MeshCacheSubMesh());
+			cacheSubMeshes->back().mb = m->GetSubMesh(i);
+
+			// Only the textures that were found made it into the materials
+			const Map<UInt32, UInt32>& subTextures = mesh.subMeshes[i].textures;
+			typedef Map<UInt32, UInt32>::const_iterator TexturesIt;
+			for (TexturesIt it = subTextures.begin(); it != subTextures.end(); ++it)
+			{
+				if ((*it).second != DecodedSubMesh::DEFAULT_MATERIAL && textures[(*it).second])
+					cacheSubMeshes->back().textures[(*it).first] = mesh.texturePaths[(*it).second];
+			}
+		}
+	}
+
+	return m;
+}
+
+MAKO_END_NAMESPACE
@@ -0,0 +1,81 @@
+#pragma once
+#include "MakoCommon.h"
+#include "MakoArrayList.h"
+#include "MakoMap.h"
+#include "MakoString.h"
+#include "MakoIndexedMeshData.h"
+
+MAKO_BEGIN_NAMESPACE
+
+// Forward declarations
+class GraphicsDevice;
+class Texture;
+class Mesh;
+struct MeshCacheSubMesh;
+
+//! A sub mesh that was decoded, but not created yet
+struct DecodedSubMesh
+{
+	enum
+	{
+		//! The texture of sub materials that are the default material
+		DEFAULT_MATERIAL = 0xFFFFFFFF
+	};
+
+	//! Describes the vertices and indices of the sub mesh. It's materials are
+	//! ignored, they are made from textures instead. numVertBufferIndices is 0
+	//! if the sub mesh isn't indexed.
+	IndexedMeshDataCreationParams params;
+
+	//! If not empty, these hold the vertices and indices, and params'
+	//! pointers to them are ignored. Otherwise params points to memory that
+	//! outlives the DecodedMesh.
+	ArrayList<UInt8> vertices, indices;
+
+	//! The texture of the DiffTexMtl used from each primitive on, as an index
+	//! into DecodedMesh::texturePaths, or DEFAULT_MATERIAL.
+	Map<UInt32, UInt32> textures;
+};
+
+//! A mesh decoded by MeshLoader::Decode(). Decoding doesn't use the
+//! GraphicsDevice, so it can be done on any thread; the mesh is then created
+//! with CreateDecodedMesh() on the thread that renders.
+struct DecodedMesh
+{
+	ArrayList<DecodedSubMesh> subMeshes;
+
+	//! The paths of the textures the sub meshes use, each only once
+	ArrayList<String> texturePaths;
+
+	//! Bytes the sub meshes can point into, like the file they were decoded from
+	ArrayList<UInt8> data;
+
+	MAKO_INLINE DecodedMesh() {}
+
+	//! Get the number of bytes of vertices and indices the sub meshes have
+	MAKO_API UInt32 GetSize() const;
+private:
+	// Not copyable, sub meshes may point into data
+	DecodedMesh(const DecodedMesh&);
+	DecodedMesh& operator = (const DecodedMesh&);
+};
+
+//! Loads the textures of a decoded mesh with GraphicsDevice::LoadTextureFromFile().
+//! Textures that can't be found are logged and left nullptr.
+//! \param[out] textures Receives a texture for every path in mesh.texturePaths
+MAKO_API void LoadDecodedMeshTextures(const DecodedMesh& mesh, ArrayList<Texture*>& textures);
+
+//! Creates a decoded mesh. Sub materials whose texture is nullptr aren't
+//! created, so the previous one goes on instead.
+//! \param[in] textures A texture for every path in mesh.texturePaths
+MAKO_API Mesh* CreateDecodedMesh(GraphicsDevice* gd, const DecodedMesh& mesh,
+								 const ArrayList<Texture*>& textures);
+
+//! Loads the textures of a decoded mesh and creates it on the application's
+//! GraphicsDevice, which is what MeshLoader::Load() does after decoding.
+//! \param[out] cacheSubMeshes If not nullptr, receives a MeshCacheSubMesh
+//! for every sub mesh.
+MAKO_API Mesh* LoadDecodedMesh(const DecodedMesh& mesh,
+							   ArrayList<MeshCacheSubMesh>* cacheSubMeshes = nullptr);
+
+MAKO_END_NAMESPACE
@@ -28,7 +28,11 @@ public:
 	MAKO_INLINE Texture* GetDiffuseTexture() const
 	{ return tex; }
 
+	MAKO_INLINE Texture* GetTexture() const
+	{ return tex; }
+
 	void Bind(GraphicsDevice* gd) const;
+	void BindTransform(GraphicsDevice* gd) const;
 };
 
 MAKO_END_NAMESPACE
\ No newline at end of file
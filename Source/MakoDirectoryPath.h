@@ -13,7 +13,7 @@ public:
 
 	MAKO_INLINE DirectoryPath(const StringChar* text) : dir(text)
 	{
-		if (dir[dir.GetLength()-1] == '/' || dir[dir.GetLength()-1] == '\\')
+		if (!dir.IsEmpty() && (dir[dir.GetLength()-1] == '/' || dir[dir.GetLength()-1] == '\\'))
 		{
 			this->dir[dir.GetLength()-1] = '\0';
 			--this->dir.length;
@@ -22,7 +22,7 @@ public:
 
 	MAKO_INLINE DirectoryPath(const String& dir) : dir(dir)
 	{
-		if (dir[dir.GetLength()-1] == '/' || dir[dir.GetLength()-1] == '\\')
+		if (!dir.IsEmpty() && (dir[dir.GetLength()-1] == '/' || dir[dir.GetLength()-1] == '\\'))
 		{
 			this->dir[dir.GetLength()-1] = '\0';
 			--this->dir.length;
@@ -0,0 +1,130 @@
+#include "MakoEventQueue.h"
+
+MAKO_BEGIN_NAMESPACE
+
+void EventRecord::Set(const Event* e)
+{
+	type = e->GetEventType();
+	switch (type)
+	{
+	case ET_KEY:
+		{
+			const KeyEvent* ke = static_cast<const KeyEvent*>(e);
+			key.key = ke->GetKey();
+			key.down = ke->IsDown();
+			return ;
+		}
+	case ET_MOUSE_BTN:
+		{
+			const MouseButtonEvent* mbe = static_cast<const MouseButtonEvent*>(e);
+			mouseButton.btn = mbe->GetButton();
+			mouseButton.down = mbe->IsDown();
+			return ;
+		}
+	case ET_MOUSE_MOVE:
+		{
+			const Vec2di& movement = static_cast<const MouseMoveEvent*>(e)->GetMovement();
+			mouseMove.x = movement.x;
+			mouseMove.y = movement.y;
+			return ;
+		}
+	case ET_MOUSE_WHEEL:
+		{
+			mouseWheel.movement = static_cast<const MouseWheelEvent*>(e)->GetMovement();
+			return ;
+		}
+	case ET_PHYSICS_3D_ACTOR_PAIR_EVENT:
+		{
+			const Physics3dActorPairEvent* ape = static_cast<const Physics3dActorPairEvent*>(e);
+			const ActorPair pair = ape->GetActorPair();
+			actorPair.actor1 = pair.actor1;
+			actorPair.actor2 = pair.actor2;
+			actorPair.ct = ape->GetCollisionType();
+			return ;
+		}
+	}
+}
+
+//! Positions wrap around, which signed integers can't do portably
+static MAKO_INLINE Int32 AddToPosition(Int32 pos, UInt32 n)
+{ return static_cast<Int32>(static_cast<UInt32>(pos) + n); }
+
+//! Get how far position a is ahead of b
+static MAKO_INLINE Int32 PositionDistance(Int32 a, Int32 b)
+{ return static_cast<Int32>(static_cast<UInt32>(a) - static_cast<UInt32>(b)); }
+
+EventQueue::EventQueue()
+: tail(0), head(0), overflowing(0)
+{
+	slots = new Slot[CAPACITY];
+	for (UInt32 i = 0; i < CAPACITY; ++i)
+		slots[i].sequence = static_cast<Int32>(i);
+}
+
+EventQueue::~EventQueue()
+{ delete [] slots; }
+
+void EventQueue::Post(const EventRecord& record)
+{
+	if (!AtomicLoad(&overflowing))
+	{
+		Int32 pos = AtomicLoad(&tail);
+		for (;;)
+		{
+			Slot& s = slots[static_cast<UInt32>(pos) & (CAPACITY - 1)];
+			const Int32 diff = PositionDistance(AtomicLoad(&s.sequence), pos);
+			if (diff == 0)
+			{
+				// The slot is free; claim it, unless another poster did first
+				const Int32 prev = AtomicCompareExchange(&tail, AddToPosition(pos, 1), pos);
+				if (prev == pos)
+				{
+					s.record = record;
+					AtomicStore(&s.sequence, AddToPosition(pos, 1));
+					return ;
+				}
+				pos = prev;
+			}
+			else if (diff < 0)
+			{
+				// The consumer didn't take the record a lap ago out yet, so
+				// the ring is full
+				break;
+			}
+			else
+			{
+				// Another poster claimed the slot
+				pos = AtomicLoad(&tail);
+			}
+		}
+	}
+
+	ScopedLock<SpinLock> lock(overflowLock);
+	overflow.push_back(record);
+	AtomicStore(&overflowing, 1);
+}
+
+void EventQueue::TakeAll(ArrayList<EventRecord>& records)
+{
+	for (UInt32 i = 0; i < CAPACITY; ++i)
+	{
+		Slot& s = slots[static_cast<UInt32>(head) & (CAPACITY - 1)];
+		if (AtomicLoad(&s.sequence) != AddToPosition(head, 1))
+			break; // Not posted yet
+		records.push_back(s.record);
+
+		// Free the slot for the poster a lap ahead
+		AtomicStore(&s.sequence, AddToPosition(head, CAPACITY));
+		head = AddToPosition(head, 1);
+	}
+
+	if (AtomicLoad(&overflowing))
+	{
+		ScopedLock<SpinLock> lock(overflowLock);
+		records.insert(records.end(), overflow.begin(), overflow.end());
+		overflow.clear();
+		AtomicStore(&overflowing, 0);
+	}
+}
+
+MAKO_END_NAMESPACE
@@ -0,0 +1,120 @@
+#pragma once
+#include "MakoCommon.h"
+#include "MakoEvents.h"
+#include "MakoArrayList.h"
+#include "MakoAtomic.h"
+#include "MakoThread.h"
+
+MAKO_BEGIN_NAMESPACE
+
+//! The data of a KeyEvent
+struct KeyEventData
+{
+	KEY key;
+	bool down;
+};
+
+//! The data of a MouseButtonEvent
+struct MouseButtonEventData
+{
+	MOUSE_BUTTON btn;
+	bool down;
+};
+
+//! The data of a MouseMoveEvent
+struct MouseMoveEventData
+{
+	Int32 x, y;
+};
+
+//! The data of a MouseWheelEvent
+struct MouseWheelEventData
+{
+	Int32 movement;
+};
+
+//! The data of a Physics3dActorPairEvent
+struct Physics3dActorPairEventData
+{
+	Physics3dActor* actor1, *actor2;
+	CONTACT_PAIR_EVENT_TYPE ct;
+};
+
+//! An Event copied into a fixed size record, so it can be queued without
+//! allocating it. The member of the union that's used depends on type.
+struct EventRecord
+{
+	EVENT_TYPE type;
+	union
+	{
+		KeyEventData key;
+		MouseButtonEventData mouseButton;
+		MouseMoveEventData mouseMove;
+		MouseWheelEventData mouseWheel;
+		Physics3dActorPairEventData actorPair;
+	};
+
+	//! Copy an event into the record
+	MAKO_API void Set(const Event* e);
+};
+
+//! A queue of EventRecords that any number of threads can post to, and one
+//! thread takes them out of. Records are stored in place in a ring of
+//! CAPACITY slots, so posting doesn't allocate and doesn't lock: a poster
+//! claims a slot by incrementing the tail, writes the record into it, and
+//! then publishes it by setting the slot's sequence number.
+//! Records posted while the ring is full go to an overflow list guarded by a
+//! SpinLock instead, so none are lost; they may be taken out after records
+//! posted later.
+class EventQueue
+{
+public:
+	enum
+	{
+		//! The number of slots of the ring, a power of two
+		CAPACITY = 4096
+	};
+private:
+	struct Slot
+	{
+		//! The position of the slot when it's free to be written, or that
+		//! position plus one when the record in it is ready to be read
+		volatile Int32 sequence;
+		EventRecord record;
+	};
+
+	Slot* slots;
+
+	// The producers and the consumer each keep to their own cache line
+	Int8 pad0[64];
+	//! The position the next record is posted to
+	volatile Int32 tail;
+	Int8 pad1[64];
+	//! The position the next record is taken from, only used by the consumer
+	Int32 head;
+	Int8 pad2[64];
+
+	SpinLock overflowLock;
+	ArrayList<EventRecord> overflow;
+	//! Set while overflow isn't empty, so records are posted to it until it
+	//! was taken out, and their order is kept
+	volatile Int32 overflowing;
+
+	// Not copyable
+	EventQueue(const EventQueue&);
+	EventQueue& operator = (const EventQueue&);
+public:
+	MAKO_API EventQueue();
+	MAKO_API ~EventQueue();
+
+	//! Post a record. It can be called from any thread.
+	MAKO_API void Post(const EventRecord& record);
+
+	//! Takes the records that were posted out of the queue, and appends them
+	//! to records in the order they were posted. At most CAPACITY records of
+	//! the ring are taken, so posters can't keep it from returning. Only one
+	//! thread can call it at a time.
+	MAKO_API void TakeAll(ArrayList<EventRecord>& records);
+};
+
+MAKO_END_NAMESPACE
@@ -39,10 +39,16 @@ public:
 		return ext;
 	}
 
+	//! Get the directory of the file
+	//! \return The directory, or an empty path if the path has none
 	MAKO_INLINE DirectoryPath GetDir() const
 	{
-		UInt dotPos = fp.FindFromEnd(StringChar('/'));
-		return fp.GetSubString(0, dotPos);
+		for (UInt i = fp.GetLength(); i > 0; --i)
+		{
+			if (fp[i - 1] == StringChar('/') || fp[i - 1] == StringChar('\\'))
+				return fp.GetSubString(0, i - 1);
+		}
+		return DirectoryPath();
 	}
 
 	MAKO_INLINE operator const String& () const
@@ -10,10 +10,15 @@ class FileInputStream : public InputStream
 private:
 	FILE* file;
 	UInt32 fileSize;
+	FilePath filePath;
 public:
-	MAKO_INLINE FileInputStream(const FilePath& fp) : file(nullptr)
+	MAKO_INLINE FileInputStream(const FilePath& fp) : file(nullptr), filePath(fp)
 	{
+#if MAKO_PLATFORM == MAKO_PLATFORM_WIN32
 		file = _wfopen(fp.GetAbs().ToWStringData(), L"rb");
+#else
+		file = fopen(fp.GetAbs().ToASCII(), "rb");
+#endif
 		fseek(file, 0, SEEK_END);
 		fileSize = ftell(file);
 		rewind(file);
@@ -25,6 +30,9 @@ public:
 	MAKO_INLINE void ReadTo(void* buffer, UInt32 cBytes)
 	{ fread(buffer, cBytes, 1, file); }
 
+	MAKO_INLINE bool IsSeekable() const
+	{ return true; }
+
 	MAKO_INLINE UInt32 Tell() const
 	{ return ftell(file); }
 
@@ -36,6 +44,9 @@ public:
 
 	MAKO_INLINE UInt32 GetSize() const
 	{ return fileSize; }
+
+	MAKO_INLINE String GetFilePath() const
+	{ return filePath.GetAbs(); }
 };
 
 class FileOutputStream : public OutputStream
@@ -46,7 +57,11 @@ private:
 public:
 	MAKO_INLINE FileOutputStream(const FilePath& filePath) : file(NULL)
 	{
+#if MAKO_PLATFORM == MAKO_PLATFORM_WIN32
 		file = _wfopen(filePath.GetAbs().ToWStringData(), L"wb");
+#else
+		file = fopen(filePath.GetAbs().ToASCII(), "wb");
+#endif
 		fseek(file , 0 , SEEK_END);
 		fileSize = ftell(file);
 		rewind(file);
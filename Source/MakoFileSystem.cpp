@@ -8,30 +8,57 @@
 
 MAKO_BEGIN_NAMESPACE
 
-FilePath FileSystem::FindFile(const String& fileName)
+FilePath FileSystem::FindFile(const StringView& fileName)
 {
-	// Check if fileName already exists
-	if (os->DoesFileExist(fileName))
-		return fileName;
+	const StringId id = HashString(fileName);
+	LinkedList<DirectoryPath> searchDirs;
+	DirectoryPath exe;
+	{
+		ScopedLock<Mutex> l(lock);
+		Map<StringId, FoundFile>::const_iterator it = found.find(id);
+		if (it != found.end() && StringView((*it).second.name) == fileName)
+			return (*it).second.path;
 
-	// Check if it is relative to the exe directory
-	if (exeDir.GetFull().IsEmpty())
-		exeDir = FilePath(APP()->GetCmdLnArgs()[0]).GetDir();
+		if (exeDir.GetFull().IsEmpty())
+			exeDir = FilePath(APP()->GetCmdLnArgs()[0]).GetDir();
+		searchDirs = dirs;
+		exe = exeDir;
+	}
 
+	String probe;
+	probe.AssignTo(fileName);
+	bool exists = os->DoesFileExist(probe);
 
-	String str;
+	// Check if it is relative to the directories or the exe directory
 	typedef LinkedList<DirectoryPath>::iterator DirsIt;
-	for (DirsIt it = dirs.begin(); it != dirs.end(); ++it)
+	for (DirsIt dirIt = searchDirs.begin(); !exists && dirIt != searchDirs.end(); ++dirIt)
 	{
-		str = (*it).GetFull() + '/' + fileName;
-		if (os->DoesFileExist(str))
-			return str;
+		const String& dir = (*dirIt).GetFull();
 
-		str = exeDir.GetFull() + '/' + (*it).GetFull() + '/' + fileName;
-		if (os->DoesFileExist(str))
-			return str;
+		probe.Reserve(exe.GetFull().GetLength() + dir.GetLength() + fileName.GetLength() + 2);
+		probe.AssignTo(dir);
+		probe.Append(StringChar('/'));
+		probe.Append(fileName);
+		exists = os->DoesFileExist(probe);
+		if (exists)
+			break;
+
+		probe.AssignTo(exe.GetFull());
+		probe.Append(StringChar('/'));
+		probe.Append(dir);
+		probe.Append(StringChar('/'));
+		probe.Append(fileName);
+		exists = os->DoesFileExist(probe);
 	}
-	return Text("");
+	if (!exists)
+		return Text("");
+
+	// A name that hashes like another one replaces it
+	ScopedLock<Mutex> l(lock);
+	FoundFile& f = found[id];
+	f.name.AssignTo(fileName);
+	f.path = probe;
+	return probe;
 }
 
 MAKO_END_NAMESPACE
\ No newline at end of file
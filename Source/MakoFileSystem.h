@@ -1,10 +1,13 @@
 #pragma once
 #include "MakoCommon.h"
 #include "MakoString.h"
+#include "MakoStringId.h"
 #include "MakoFilePath.h"
 #include "MakoDirectoryPath.h"
 #include "MakoLinkedList.h"
+#include "MakoMap.h"
 #include "MakoApplication.h"
+#include "MakoThread.h"
 
 MAKO_BEGIN_NAMESPACE
 
@@ -17,15 +20,52 @@ class FileSystem
 	OSDevice* os;
 
 	DirectoryPath exeDir;
+
+	//! A file that was found, and the name it was looked for by
+	struct FoundFile
+	{
+		String name;
+		FilePath path;
+	};
+	//! The files that were found, by the hash of the name they were looked
+	//! for by, so a file is only searched for once. The names are hashed
+	//! rather than interned, so looking for files doesn't grow the string
+	//! table.
+	Map<StringId, FoundFile> found;
+
+	//! Files are found by the threads that load assets too. It isn't held
+	//! while the disk is checked.
+	Mutex lock;
 public:
 	MAKO_INLINE FileSystem() : os(APP()->OS()) {}
 	
 	MAKO_INLINE ~FileSystem() {}
 
 	void AddDirectory(const DirectoryPath& dir)
-	{ dirs.push_back(dir); }
+	{
+		{
+			ScopedLock<Mutex> l(lock);
+			dirs.push_back(dir);
+		}
+		ForgetFoundFiles();
+	}
+
+	//! Find a file in the current directory or the directories that were
+	//! added, either as they are or relative to the executable's directory.
+	//! Where a file was found is remembered, so looking for it again doesn't
+	//! touch the disk; files that weren't found are looked for every time.
+	//! A remembered path goes stale if the file is moved or deleted, or if
+	//! it's relative and the current directory changes; call
+	//! ForgetFoundFiles() when that may have happened.
+	//! \return The path of the file, or an empty path if it wasn't found
+	FilePath FindFile(const StringView& fileName);
+
+	//! Forget where files were found, so FindFile() looks for them again
+	void ForgetFoundFiles()
+	{ ScopedLock<Mutex> l(lock); found.clear(); }
 
-	FilePath FindFile(const String& fileName);
+	MAKO_INLINE FilePath FindFile(const String& fileName)
+	{ return FindFile(StringView(fileName)); }
 };
 
 MAKO_END_NAMESPACE
\ No newline at end of file
@@ -12,8 +12,23 @@ class Texture;
 
 typedef UInt FontSize;
 
+//! Where a glyph is in it's Font's atlas, and how it's placed on a line
 struct GlyphMetrics
 {
+	MAKO_INLINE GlyphMetrics()
+		: advance(0), page(0) {}
+
+	//! The size of the glyph's bitmap, which is 0 for spaces
+	Size2d size;
+	//! The offset of the bitmap's up-left corner from the pen, which is on
+	//! the baseline. y is negative above it.
+	Vec2di offset;
+	//! How far the pen moves to the right after the glyph
+	Int advance;
+	//! The atlas page the bitmap is in, see Font::GetAtlasPage()
+	UInt32 page;
+	//! The position of the bitmap in it's page, in texels
+	Pos2d atlasPos;
 };
 
 class Font : public ReferenceCounted
@@ -26,6 +41,30 @@ public:
 	//! \return The texture of the text
 	virtual Texture* Rasterize(const String& text) = 0;
 
+	//! Get the metrics of a glyph at the current size. The first time a
+	//! glyph is asked for at a size, it's rasterized into the atlas of that
+	//! size; after that, this is a lookup.
+	virtual const GlyphMetrics& GetGlyphMetrics(StringChar c) = 0;
+
+	//! Get the kerning between two glyphs at the current size, which is
+	//! added to the advance of the left one.
+	virtual Int GetKerning(StringChar left, StringChar right) = 0;
+
+	//! Get the distance between the baselines of two lines at the current size
+	virtual Int GetLineHeight() const = 0;
+
+	//! Get the distance from the top of a line to it's baseline at the
+	//! current size
+	virtual Int GetAscender() const = 0;
+
+	//! Get the number of pages of the atlas of the current size
+	virtual UInt32 GetNumAtlasPages() const = 0;
+
+	//! Get a page of the atlas of the current size, a CF_A8 texture. Glyphs
+	//! that were rasterized into it since it was last gotten are uploaded
+	//! first.
+	virtual Texture* GetAtlasPage(UInt32 page) = 0;
+
 	virtual void SetSize(FontSize size) = 0;
 	virtual FontSize GetSize() const = 0;
 	
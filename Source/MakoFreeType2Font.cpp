@@ -1,12 +1,13 @@
 #include "MakoFreeType2Font.h"
 #include "MakoGenericGraphicsDevice.h"
 #include "MakoTexture.h"
+#include "MakoBufferedStream.h"
 #include <cstdio>
 
 MAKO_BEGIN_NAMESPACE
 
 FreeType2Font::FreeType2Font(Mako::GenericGraphicsDevice *gd, const FilePath& filepath)
-: gd(gd), fontSize(12)
+: s(nullptr), gd(gd), cache(nullptr), fontSize(12)
 {
 	FILE* file;
 	UInt32 filesize;
@@ -22,294 +23,305 @@ FreeType2Font::FreeType2Font(Mako::GenericGraphicsDevice *gd, const FilePath& fi
 	// Get the data
 	fontFileData = new Byte[filesize];
 	fread(fontFileData, filesize, 1, file);
+	fclose(file);
 	
 	FT_Error err;
 	if (err = FT_New_Memory_Face(gd->GetFT_Library(), (FT_Byte*)fontFileData,
 		filesize, 0, &face))
 		throw Exception(Text("FT_New_Memory_Face() failed"), err);
 
-	if (err = FT_Set_Pixel_Sizes(face, 0, fontSize))
-		throw Exception(Text("FT_Set_Char_Size() failed"), err);
+	SetSize(fontSize);
 }
 
 FreeType2Font::FreeType2Font(Mako::GenericGraphicsDevice *gd, InputStream* istream)
-: gd(gd), fontFileData(nullptr), fontSize(12)
+: s(nullptr), gd(gd), fontFileData(nullptr), cache(nullptr), fontSize(12)
 {
-	istream->Hold();
-	/*
-   *   base ::
-   *     For memory-based streams, this is the address of the first stream
-   *     byte in memory.  This field should always be set to NULL for
-   *     disk-based streams.
-   *
-   *   size ::
-   *     The stream size in bytes.
-   *
-   *   pos ::
-   *     The current position within the stream.
-   *
-   *   descriptor ::
-   *     This field is a union that can hold an integer or a pointer.  It is
-   *     used by stream implementations to store file descriptors or `FILE*'
-   *     pointers.
-   *
-   *   pathname ::
-   *     This field is completely ignored by FreeType.  However, it is often
-   *     useful during debugging to use it to store the stream's fileName
-   *     (where available).
-   *
-   *   read ::
-   *     The stream's input function.
-   *
-   *   close ::
-   *     The stream;s close function.
-   *
-   *   memory ::
-   *     The memory manager to use to preload frames.  This is set
-   *     internally by FreeType and shouldn't be touched by stream
-   *     implementations.
-   *
-   *   cursor ::
-   *     This field is set and used internally by FreeType when parsing
-   *     frames.
-   *
-   *   limit ::
-   *     This field is set and used internally by FreeType when parsing
-   *     frames.
-   */
-	UInt8* dat = new UInt8[istream->GetSize()];
-
-	FT_StreamRec stream;
-	stream.base               = dat;
-	stream.close              = FTStreamCloseFunc;
-	stream.descriptor.pointer = istream;
-	stream.pos                = 0;
-	stream.read               = FTStreamIoFunc;
-	stream.size               = istream->GetSize();
+	// FreeType reads from the stream for as long as the face exists, seeking
+	// to the tables it needs. FTStreamCloseFunc() drops the stream when the
+	// face is done with it.
+	BufferedInputStream* bis = new BufferedInputStream(istream);
+	bis->Hold();
+
+	s = new FT_StreamRec;
+	memset(s, 0, sizeof(FT_StreamRec));
+	s->base               = nullptr;
+	s->close              = FTStreamCloseFunc;
+	s->descriptor.pointer = bis;
+	s->pos                = 0;
+	s->read               = FTStreamIoFunc;
+	s->size               = bis->GetSize();
 
 	FT_Open_Args openArgs;
 	openArgs.memory_base = nullptr;
 	openArgs.memory_size = 0;
-	openArgs.stream      = &stream;
+	openArgs.stream      = s;
 	openArgs.flags       = FT_OPEN_STREAM;
 	openArgs.pathname    = nullptr;
 	
+	// FT_Open_Face() closes the stream if it fails
 	FT_Error err;
  	if (err = FT_Open_Face(gd->GetFT_Library(), &openArgs, 0, &face))
+	{
+		delete s;
 		throw Exception(Text("FT_Open_Face() failed"), err);
+	}
 
-	istream->Drop();
-
-	if (err = FT_Set_Pixel_Sizes(face, 0, fontSize))
-		throw Exception(Text("FT_Set_Char_Size() failed"), err);
+	SetSize(fontSize);
 }
 
 FreeType2Font::~FreeType2Font()
 {
-	typedef Map<StringChar, Map<UInt, Texture*> >::iterator GlyphsIt;
-	for (GlyphsIt it = cachedGlyphs.begin(); it != cachedGlyphs.end(); ++it)
+	typedef Map<FontSize, SizeCache*>::iterator CachesIt;
+	for (CachesIt it = sizeCaches.begin(); it != sizeCaches.end(); ++it)
 	{
-		typedef Map<UInt, Texture*>::iterator TexsIt;
-		for (TexsIt it2 = (*it).second.begin(); it2 != (*it).second.end(); ++it2)
-		{
-			(*it2).second->Drop();
-		}
+		for (UInt32 i = 0; i < (*it).second->pages.size(); ++i)
+			(*it).second->pages[i].tex->Drop();
+		delete (*it).second;
 	}
 	FT_Done_Face(face);
 	delete [] fontFileData;
+	delete s;
 }
 
-Texture* FreeType2Font::Rasterize(const String& text)
+FreeType2Font::SizeCache::SizeCache()
+: pageSize(0), lineHeight(0), ascender(0)
+{ memset(asciiLoaded, 0, sizeof(asciiLoaded)); }
+
+void FreeType2Font::SetSize(FontSize size)
 {
-	TextureCreationParams texparams;
-	texparams.size.x = 0;
-	texparams.size.y = 0;
-	texparams.format = CF_R8G8B8A8;
+	FT_Error err;
+	if (err = FT_Set_Pixel_Sizes(face, 0, size))
+		throw Exception(Text("FT_Set_Char_Size() failed"), err);
+	fontSize = size;
 
-	for (UInt i = 0; i < text.GetLength(); ++i)
+	Map<FontSize, SizeCache*>::iterator it = sizeCaches.find(size);
+	if (it != sizeCaches.end())
 	{
-		FT_Error err;
-
-		FT_GlyphSlot slot = face->glyph;
-
-		// load glyph image into the slot (erase previous one)
-		if (err = FT_Load_Char(face, text[i], FT_LOAD_DEFAULT))
-			throw Exception(Text("FT_Load_Char() failed"), err);
-
-		texparams.size.x += slot->advance.x/64;
-		texparams.size.y = Max(texparams.size.y, (UInt)slot->metrics.height/64);
+		cache = (*it).second;
+		return;
 	}
 
-	// Allocate image data
-	UInt32* data = new UInt32[texparams.size.x * texparams.size.y];
-	texparams.data = static_cast<void*>(data);
-	memset(data, 0, sizeof(UInt32*) * texparams.size.x * texparams.size.y);
+	cache = sizeCaches[size] = new SizeCache;
+	cache->lineHeight = face->size->metrics.height >> 6;
+	cache->ascender   = face->size->metrics.ascender >> 6;
 
-	// Position of pen
-	Int penX = 0, penY = 0;
-	for (UInt i = 0; i < text.GetLength(); ++i)
-	{
-		FT_Error err;
-
-		FT_GlyphSlot slot = face->glyph;
-
-		// load glyph image into the slot (erase previous one)
-		if (err = FT_Load_Char(face, text[i], FT_LOAD_RENDER))
-			throw Exception(Text("FT_Load_Char() failed"), err);
-
-		penX += slot->bitmap_left;
-		//penY -= (face->bbox.yMax/64 - slot->bitmap_top)/2;
+	// A page holds about 8 lines of glyphs, so most texts of a size need
+	// only one
+	cache->pageSize = 256;
+	while (cache->pageSize < static_cast<UInt>(cache->lineHeight) * 8 && cache->pageSize < 2048)
+		cache->pageSize *= 2;
+}
 
-		UInt colorStride = GetColorStride(CF_R8G8B8A8)/8;
-		for (UInt x = 0; x < static_cast<UInt>(slot->bitmap.width); ++x)
+const GlyphMetrics& FreeType2Font::GetGlyphMetrics(StringChar c)
+{
+	if (c < 128)
+	{
+		if (!cache->asciiLoaded[c])
 		{
-			for (UInt y = 0; y < static_cast<UInt>(slot->bitmap.rows); ++y)
-			{
-				UInt datax = x + penX;
-				UInt datay = y + penY;
-				if (datax >= texparams.size.x || datay >= texparams.size.y)
-					continue;
-				UInt dataOffset = datay*texparams.size.x + datax;
-				UInt bmpOffset  = y*(slot->bitmap.width) + x;
-
-				unsigned char val = slot->bitmap.buffer[bmpOffset];
-
-				data[dataOffset] = (val << 24) | (val << 16) | (val << 8) | (val);
-			}
+			LoadGlyph(c, cache->ascii[c]);
+			cache->asciiLoaded[c] = true;
 		}
-		penX -= slot->bitmap_left;
-		//penY += (face->bbox.yMax/64 - slot->bitmap_top)/2;
-
-		penX += slot->advance.x/64;
-		penY += slot->advance.y/64;
-
+		return cache->ascii[c];
 	}
 
+	Map<StringChar, GlyphMetrics>::iterator it = cache->glyphs.find(c);
+	if (it != cache->glyphs.end())
+		return (*it).second;
 
-	return gd->CreateTexture(texparams);
+	GlyphMetrics gm;
+	LoadGlyph(c, gm);
+	return cache->glyphs[c] = gm;
 }
 
-GraphicsDevice* FreeType2Font::GetGraphicsDevice()
-{ return gd; }
-
-unsigned long FreeType2Font::FTStreamIoFunc(FT_Stream      stream,
-											unsigned long  offset,
-											unsigned char* buffer,
-											unsigned long  count)
+Int FreeType2Font::GetKerning(StringChar left, StringChar right)
 {
-	if (count == 0)
+	if (!FT_HAS_KERNING(face))
 		return 0;
-	InputStream* istream = (InputStream*)stream->descriptor.pointer;
-	istream->ReadTo(buffer, count);
-	return count;
-}
 
-void FreeType2Font::FTStreamCloseFunc(FT_Stream stream)
-{}
-
-#if 0
-const Size2d& FreeType2Font::GetGlyphSize(const StringChar& glyph,
-										  const UInt fontSize) const
-{
-	if (cachedGlyphsInfo[glyph][fontSize].size != 0)
-		return cachedGlyphsInfo[glyph][fontSize].size;
+	const UInt32 key = (static_cast<UInt32>(left) << 16) | right;
+	Map<UInt32, Int>::iterator it = cache->kerning.find(key);
+	if (it != cache->kerning.end())
+		return (*it).second;
 
+	FT_Vector delta;
 	FT_Error err;
-	
-	if (err = FT_Set_Char_Size(face, 50 * fontSize, 50 * fontSize, 100, 0))
-		throw Exception(Text("FT_Set_Char_Size() failed"), err);
+	if (err = FT_Get_Kerning(face, FT_Get_Char_Index(face, left), FT_Get_Char_Index(face, right),
+		FT_KERNING_DEFAULT, &delta))
+		throw Exception(Text("FT_Get_Kerning() failed"), err);
 
-	FT_GlyphSlot slot = face->glyph;
-
-	// load glyph image into the slot (erase previous one)
-	if (err = FT_Load_Char(face, glyph, FT_LOAD_DEFAULT))
-		throw Exception(Text("FT_Load_Char() failed"), err);
-
-	GlyphInfo& gi = cachedGlyphsInfo[glyph][fontSize];
-	gi.offset =	Vec2di(0, -slot->bitmap_top);
-	gi.size = Size2d(slot->bitmap.width, slot->bitmap.rows);
-	return gi.size;
+	return cache->kerning[key] = delta.x >> 6;
 }
 
+Texture* FreeType2Font::GetAtlasPage(UInt32 page)
+{
+	AtlasPage& p = cache->pages[page];
+	if (p.dirty)
+	{
+		p.tex->GetTextureHardwareBuffer()->Update();
+		p.dirty = false;
+	}
+	return p.tex;
+}
 
-Texture* FreeType2Font::GetGlyphTexture(const StringChar& glyph,
-										const UInt fontSize) const
+void FreeType2Font::LoadGlyph(StringChar c, GlyphMetrics& gm)
 {
-	if (cachedGlyphs[glyph][fontSize])
-		return cachedGlyphs[glyph][fontSize];
-	
 	FT_Error err;
-	
-	if (err = FT_Set_Char_Size(face, 50 * fontSize, 0, 100, 0))
-		throw Exception(Text("FT_Set_Char_Size() failed"), err);
+	if (err = FT_Load_Char(face, c, FT_LOAD_RENDER))
+		throw Exception(Text("FT_Load_Char() failed"), err);
 
 	FT_GlyphSlot slot = face->glyph;
+	gm.size    = Size2d(slot->bitmap.width, slot->bitmap.rows);
+	gm.offset  = Vec2di(slot->bitmap_left, -slot->bitmap_top);
+	gm.advance = slot->advance.x >> 6;
+
+	if (gm.size.x == 0 || gm.size.y == 0)
+		return;
+
+	AtlasPage& page = AllocateAtlasRect(gm.size, gm);
+	UInt8* out = static_cast<UInt8*>(page.tex->GetImageData()) +
+		gm.atlasPos.y * cache->pageSize + gm.atlasPos.x;
+	for (UInt y = 0; y < gm.size.y; ++y)
+		memcpy(out + y * cache->pageSize, slot->bitmap.buffer + y * slot->bitmap.pitch, gm.size.x);
+	page.dirty = true;
+}
 
-	// load glyph image into the slot (erase previous one)
-	if (err = FT_Load_Char(face, glyph, FT_LOAD_RENDER))
-		throw Exception(Text("FT_Load_Char() failed"), err);
+FreeType2Font::AtlasPage& FreeType2Font::AllocateAtlasRect(const Size2d& size, GlyphMetrics& gm)
+{
+	// A texel of padding to the right and below keeps filtering from
+	// bleeding the neighbours into a glyph
+	const UInt w = size.x + 1, h = size.y + 1;
+	if (w > cache->pageSize || h > cache->pageSize)
+		throw Exception(Text("A glyph is larger than a page of the font atlas"));
 
-	GlyphInfo& gi = cachedGlyphsInfo[glyph][fontSize];
-	if (gi.size == 0)
+	if (!cache->pages.empty())
 	{
-		gi.size = Size2d(slot->bitmap.width, slot->bitmap.rows);
-		gi.offset = Vec2di(0, -slot->bitmap_top);
-	}
+		AtlasPage& page = cache->pages.back();
 
-	UInt colorStride = GetColorStride(CF_R8G8B8A8)/8;
-	UInt8* data = new UInt8[colorStride *
-		                    slot->bitmap.width *
-							slot->bitmap.rows];
-	for (UInt x = 0; x < static_cast<UInt>(slot->bitmap.width); ++x)
-	{
-		for (UInt y = 0; y < static_cast<UInt>(slot->bitmap.rows); ++y)
+		// Start a new shelf if the glyph doesn't fit on the current one
+		if (page.penX + w > cache->pageSize)
+		{
+			page.shelfY     += page.shelfHeight;
+			page.shelfHeight = 0;
+			page.penX        = 0;
+		}
+
+		if (page.shelfY + h <= cache->pageSize)
 		{
-			UInt dataOffset = ((y * colorStride) * slot->bitmap.width) + (x * colorStride);
-			UInt bmpOffset  = (y * slot->bitmap.width + x);
-			//memcpy(data + dataOffset, slot->bitmap.buffer + bmpOffset, 4);
-			data[dataOffset + 0] = slot->bitmap.buffer[bmpOffset];
-			data[dataOffset + 1] = slot->bitmap.buffer[bmpOffset];
-			data[dataOffset + 2] = slot->bitmap.buffer[bmpOffset];
-			data[dataOffset + 3] = slot->bitmap.buffer[bmpOffset];
+			gm.page     = cache->pages.size() - 1;
+			gm.atlasPos = Pos2d(page.penX, page.shelfY);
+			page.penX       += w;
+			page.shelfHeight = Max(page.shelfHeight, h);
+			return page;
 		}
 	}
 
-	//slot->bitmap
 	TextureCreationParams texparams;
-	texparams.data   = data;
-	texparams.size.x = slot->bitmap.width;
-	texparams.size.y = slot->bitmap.rows;
-	texparams.format = CF_R8G8B8A8;
-	Texture* t = cachedGlyphs[glyph][fontSize] = gd->CreateTexture(texparams);
-	t->Hold();
-	return t;
+	texparams.size   = Size2d(cache->pageSize, cache->pageSize);
+	texparams.format = CF_A8;
+	texparams.data   = new UInt8[cache->pageSize * cache->pageSize];
+	memset(texparams.data, 0, cache->pageSize * cache->pageSize);
+
+	AtlasPage page;
+	page.tex = gd->CreateTexture(texparams);
+	page.tex->Hold();
+	page.shelfY      = 0;
+	page.shelfHeight = h;
+	page.penX        = w;
+	page.dirty       = true;
+	cache->pages.push_back(page);
+
+	gm.page     = cache->pages.size() - 1;
+	gm.atlasPos = Pos2d(0, 0);
+	return cache->pages.back();
 }
 
-const Vec2di& FreeType2Font::GetGlyphOffset(const StringChar& glyph,
-											 UInt fontSize) const
+Texture* FreeType2Font::Rasterize(const String& text)
 {
-	GlyphInfo& gi = cachedGlyphsInfo[glyph][fontSize];
-	if (gi.size == 0)
+	// The glyphs are copied from the atlas, so they're rasterized only once
+	Int width = 0;
+	for (UInt i = 0; i < text.GetLength(); ++i)
+	{
+		StringChar c = text[i] == '\n' ? ' ' : text[i];
+		width += GetGlyphMetrics(c).advance;
+		if (i > 0)
+			width += GetKerning(text[i - 1] == '\n' ? ' ' : text[i - 1], c);
+	}
+
+	TextureCreationParams texparams;
+	texparams.size.x = Max(width, 0);
+	texparams.size.y = cache->lineHeight;
+	texparams.format = CF_R8G8B8A8;
+
+	// Allocate image data
+	UInt32* data = new UInt32[texparams.size.x * texparams.size.y];
+	texparams.data = static_cast<void*>(data);
+	memset(data, 0, sizeof(UInt32) * texparams.size.x * texparams.size.y);
+
+	// Position of the pen, on the baseline
+	Int penX = 0, penY = cache->ascender;
+	for (UInt i = 0; i < text.GetLength(); ++i)
 	{
-		FT_Error err;
+		StringChar c = text[i] == '\n' ? ' ' : text[i];
+		if (i > 0)
+			penX += GetKerning(text[i - 1] == '\n' ? ' ' : text[i - 1], c);
 
+		const GlyphMetrics& gm = GetGlyphMetrics(c);
+		if (gm.size.x && gm.size.y)
+		{
+			const UInt8* page = static_cast<const UInt8*>(cache->pages[gm.page].tex->GetImageData());
+			for (UInt y = 0; y < gm.size.y; ++y)
+			{
+				for (UInt x = 0; x < gm.size.x; ++x)
+				{
+					UInt datax = x + penX + gm.offset.x;
+					UInt datay = y + penY + gm.offset.y;
+					if (datax >= texparams.size.x || datay >= texparams.size.y)
+						continue;
+
+					UInt8 val = page[(gm.atlasPos.y + y) * cache->pageSize + gm.atlasPos.x + x];
+					data[datay * texparams.size.x + datax] = (val << 24) | (val << 16) | (val << 8) | (val);
+				}
+			}
+		}
+
+		penX += gm.advance;
+	}
 
-		if (err = FT_Set_Char_Size(face, 50 * fontSize, 0, 100, 0))
-			throw Exception(Text("FT_Set_Char_Size() failed"), err);
+	return gd->CreateTexture(texparams);
+}
 
-		FT_GlyphSlot slot = face->glyph;
+GraphicsDevice* FreeType2Font::GetGraphicsDevice()
+{ return gd; }
 
-		// load glyph image into the slot (erase previous one)
-		if (err = FT_Load_Char(face, glyph, FT_LOAD_DEFAULT))
-			throw Exception(Text("FT_Load_Char() failed"), err);
+unsigned long FreeType2Font::FTStreamIoFunc(FT_Stream      stream,
+											unsigned long  offset,
+											unsigned char* buffer,
+											unsigned long  count)
+{
+	BufferedInputStream* istream = (BufferedInputStream*)stream->descriptor.pointer;
 
-		gi.size = Size2d(slot->bitmap.width, slot->bitmap.rows);
-		gi.offset = Vec2di(0, -slot->bitmap_top);
+	// A count of 0 is only a seek, which fails by returning non zero
+	if (offset > stream->size)
+		return count ? 0 : 1;
+	if (offset != istream->Tell())
+	{
+		if (offset < istream->Tell() && !istream->IsSeekable())
+			return count ? 0 : 1;
+		istream->Seek(offset);
 	}
 
-	return gi.offset;
+	if (count > stream->size - offset)
+		count = stream->size - offset;
+	istream->ReadTo(buffer, count);
+	return count;
 }
 
-#endif
+void FreeType2Font::FTStreamCloseFunc(FT_Stream stream)
+{
+	BufferedInputStream* istream = (BufferedInputStream*)stream->descriptor.pointer;
+	if (istream)
+		istream->Drop();
+	stream->descriptor.pointer = nullptr;
+}
 
 MAKO_END_NAMESPACE
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 #include "MakoCommon.h"
 #include "MakoMap.h"
+#include "MakoArrayList.h"
 #include "MakoFont.h"
 #include "MakoException.h"
 #include "MakoFilePath.h"
@@ -13,23 +14,55 @@ MAKO_BEGIN_NAMESPACE
 class GenericGraphicsDevice;
 class InputStream;
 
+//! A Font loaded with FreeType 2. Glyphs are rasterized once per size, into
+//! an atlas of CF_A8 pages, and their metrics and kerning are cached with
+//! them.
 class FreeType2Font : public Font
 {
 private:
-	struct GlyphInfo
+	//! A page of an atlas. Glyphs are packed into it on shelves: rows as high
+	//! as their highest glyph, filled from left to right.
+	struct AtlasPage
 	{
-		Size2d size;
-		Vec2di offset;
+		Texture* tex;
+		UInt shelfY, shelfHeight, penX;
+		//! Set when glyphs were rasterized into it since it was uploaded
+		bool dirty;
+	};
+
+	//! The glyphs and atlas of one font size
+	struct SizeCache
+	{
+		SizeCache();
+
+		//! Glyphs below 128 are looked up directly, the others in glyphs
+		GlyphMetrics ascii[128];
+		bool asciiLoaded[128];
+		Map<StringChar, GlyphMetrics> glyphs;
+		//! Kerning of pairs of glyphs, by left << 16 | right
+		Map<UInt32, Int> kerning;
+		ArrayList<AtlasPage> pages;
+		//! The width and height of every page
+		UInt pageSize;
+		Int lineHeight, ascender;
 	};
 private:
 	FT_Stream s;
 	GenericGraphicsDevice* gd;
 	FT_Face face;
 	void* fontFileData;
-	mutable Map<StringChar, Map<UInt, Texture*> > cachedGlyphs;
-	mutable Map<StringChar, Map<UInt, GlyphInfo> > cachedGlyphsInfo;
+	Map<FontSize, SizeCache*> sizeCaches;
+	//! The SizeCache of fontSize
+	SizeCache* cache;
 
 	FontSize fontSize;
+
+	//! Rasterizes a glyph into the atlas of the current size
+	void LoadGlyph(StringChar c, GlyphMetrics& gm);
+
+	//! Finds room for a bitmap of size size in the atlas of the current
+	//! size, adding a page if the last one is full, and stores where in gm.
+	AtlasPage& AllocateAtlasRect(const Size2d& size, GlyphMetrics& gm);
 public:
 	FreeType2Font(GenericGraphicsDevice* gd, const FilePath& filepath);
 	FreeType2Font(GenericGraphicsDevice* gd, InputStream* istream);
@@ -37,18 +70,27 @@ public:
 
 	Texture* Rasterize(const String& text);
 
+	const GlyphMetrics& GetGlyphMetrics(StringChar c);
+
+	Int GetKerning(StringChar left, StringChar right);
+
+	MAKO_INLINE Int GetLineHeight() const
+	{ return cache->lineHeight; }
+
+	MAKO_INLINE Int GetAscender() const
+	{ return cache->ascender; }
+
+	MAKO_INLINE UInt32 GetNumAtlasPages() const
+	{ return cache->pages.size(); }
+
+	Texture* GetAtlasPage(UInt32 page);
+
 	GraphicsDevice* GetGraphicsDevice();
 
 	MAKO_INLINE FontSize GetSize() const
 	{ return fontSize; }
 
-	MAKO_INLINE void SetSize(FontSize size)
-	{
-		fontSize = size;
-		FT_Error err;
-		if (err = FT_Set_Pixel_Sizes(face, 0, fontSize))
-			throw Exception(Text("FT_Set_Char_Size() failed"), err);
-	}
+	void SetSize(FontSize size);
 
 	static unsigned long FTStreamIoFunc(FT_Stream      stream,
 		                                unsigned long  offset,
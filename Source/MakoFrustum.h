@@ -0,0 +1,140 @@
+#pragma once
+#include "MakoCommon.h"
+#include "MakoVec3d.h"
+#include "MakoMatrix4.h"
+#include "MakoAABBox3d.h"
+#include "MakoSphere3d.h"
+
+MAKO_BEGIN_NAMESPACE
+
+//! The planes of a Frustum
+enum FRUSTUM_PLANE
+{
+	FP_LEFT,
+	FP_RIGHT,
+	FP_BOTTOM,
+	FP_TOP,
+	FP_NEAR,
+	FP_FAR,
+	FP_ENUM_LENGTH
+};
+
+//! The results of a Frustum test
+enum FRUSTUM_TEST_RESULT
+{
+	//! The volume is completely outside of the frustum
+	FTR_OUTSIDE,
+	//! The volume is partly inside of the frustum
+	FTR_INTERSECTS,
+	//! The volume is completely inside of the frustum
+	FTR_INSIDE
+};
+
+//! A view frustum: the volume that is visible to a camera. It is made of six
+//! planes whose normals point into the frustum.
+class Frustum
+{
+public:
+	//! A plane, the points p for which normal.p + d == 0.
+	struct Plane
+	{
+		Vec3df normal;
+		Float32 d;
+
+		//! Get the signed distance of p to the plane. It's positive in front of the plane.
+		MAKO_INLINE Float32 GetDistance(const Vec3df& p) const
+		{ return normal.x*p.x + normal.y*p.y + normal.z*p.z + d; }
+	};
+private:
+	Plane planes[FP_ENUM_LENGTH];
+public:
+	//! Constructs a frustum that contains everything
+	MAKO_INLINE Frustum()
+	{
+		for (UInt32 i = 0; i < FP_ENUM_LENGTH; ++i)
+		{
+			planes[i].normal = Vec3df(0.f);
+			planes[i].d = 1.f;
+		}
+	}
+
+	//! Constructs the frustum from a view-projection matrix.
+	MAKO_INLINE Frustum(const Matrix4f& viewProj)
+	{ Build(viewProj); }
+
+	//! Builds the planes of the frustum from a view-projection matrix
+	//! (PROJECTION * VIEW), as the GraphicsDevice builds it from the Camera.
+	//! The clip space depth is expected to range from 0 to w, like in D3D.
+	MAKO_INLINE void Build(const Matrix4f& viewProj)
+	{
+		// Clip space component j of a point is column j of the matrix dotted
+		// with the point. A point is inside when -w <= x <= w, -w <= y <= w
+		// and 0 <= z <= w (Gribb & Hartmann).
+		const Matrix4f& m = viewProj;
+		SetPlane(FP_LEFT,   m[3] + m[0], m[7] + m[4], m[11] + m[8],  m[15] + m[12]);
+		SetPlane(FP_RIGHT,  m[3] - m[0], m[7] - m[4], m[11] - m[8],  m[15] - m[12]);
+		SetPlane(FP_BOTTOM, m[3] + m[1], m[7] + m[5], m[11] + m[9],  m[15] + m[13]);
+		SetPlane(FP_TOP,    m[3] - m[1], m[7] - m[5], m[11] - m[9],  m[15] - m[13]);
+		SetPlane(FP_NEAR,   m[2],        m[6],        m[10],         m[14]);
+		SetPlane(FP_FAR,    m[3] - m[2], m[7] - m[6], m[11] - m[10], m[15] - m[14]);
+	}
+
+	//! Get one of the planes of the frustum
+	MAKO_INLINE const Plane& GetPlane(FRUSTUM_PLANE which) const
+	{ return planes[which]; }
+
+	//! Tests a box against the frustum. Empty boxes are outside.
+	MAKO_INLINE FRUSTUM_TEST_RESULT Test(const AABBox3df& box) const
+	{
+		if (box.IsEmpty())
+			return FTR_OUTSIDE;
+
+		const Vec3df center = box.GetCenter();
+		const Vec3df extent = box.GetExtent();
+
+		FRUSTUM_TEST_RESULT result = FTR_INSIDE;
+		for (UInt32 i = 0; i < FP_ENUM_LENGTH; ++i)
+		{
+			const Plane& p = planes[i];
+			const Float32 dist = p.GetDistance(center);
+			const Float32 radius = fabs(p.normal.x) * extent.x +
+				fabs(p.normal.y) * extent.y + fabs(p.normal.z) * extent.z;
+
+			if (dist < -radius)
+				return FTR_OUTSIDE;
+			if (dist < radius)
+				result = FTR_INTERSECTS;
+		}
+		return result;
+	}
+
+	//! Tests a sphere against the frustum. Empty spheres are outside.
+	MAKO_INLINE FRUSTUM_TEST_RESULT Test(const Sphere3df& sphere) const
+	{
+		if (sphere.IsEmpty())
+			return FTR_OUTSIDE;
+
+		FRUSTUM_TEST_RESULT result = FTR_INSIDE;
+		for (UInt32 i = 0; i < FP_ENUM_LENGTH; ++i)
+		{
+			const Float32 dist = planes[i].GetDistance(sphere.center);
+			if (dist < -sphere.radius)
+				return FTR_OUTSIDE;
+			if (dist < sphere.radius)
+				result = FTR_INTERSECTS;
+		}
+		return result;
+	}
+private:
+	MAKO_INLINE void SetPlane(FRUSTUM_PLANE which, Float32 a, Float32 b, Float32 c, Float32 d)
+	{
+		// Normalize, so that GetDistance() returns real distances
+		Float32 len = sqrt(a*a + b*b + c*c);
+		if (len == 0.f)
+			len = 1.f;
+		planes[which].normal = Vec3df(a / len, b / len, c / len);
+		planes[which].d = d / len;
+	}
+};
+
+MAKO_END_NAMESPACE
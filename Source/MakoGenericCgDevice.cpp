@@ -3,6 +3,7 @@
 #include "MakoException.h"
 #include "MakoApplication.h"
 #include "MakoFileSystem.h"
+#include "MakoResourceCache.h"
 
 MAKO_BEGIN_NAMESPACE
 
@@ -154,11 +155,24 @@ CgShader* GenericCgDevice::LoadShaderFromFile(const FilePath& fileName,
 	if (found.GetAbs().IsEmpty())
 		throw Exception(Text("The Cg shader [") + fileName.GetAbs() + Text("] does not exist"));
 
+	ResourceCache* cache = gdevice->GetResourceCache();
+	String options;
+	options.Reserve(vertexProgName.GetLength() + fragProgName.GetLength() + 1);
+	options.AppendConverted(vertexProgName.GetData(), vertexProgName.GetLength());
+	options.Append(StringChar('|'));
+	options.AppendConverted(fragProgName.GetData(), fragProgName.GetLength());
+	StringId key = ResourceCache::MakeKey(found, options);
+	CgShader* shader = cache->FindShader(key);
+	if (shader)
+		return shader;
+
 	FileInputStream file(found);
 	char* contents = new char[file.GetSize() + 1];
 	file.ReadTo(contents, file.GetSize());
 	contents[file.GetSize()] = '\0';
-	return CreateShader(ASCIIString::FromAllocData(contents), vertexProgName, fragProgName);
+	shader = CreateShader(ASCIIString::FromAllocData(contents), vertexProgName, fragProgName);
+	cache->AddShader(key, shader, file.GetSize());
+	return shader;
 }
 
 void GenericCgDevice::CgErrorHandler(CGcontext context, CGerror error, void *data)
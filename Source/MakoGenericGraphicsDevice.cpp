@@ -2,6 +2,9 @@
 #include "MakoFileIO.h"
 #include "MakoObjMeshLoader.h"
 #include "MakoMakoMeshLoader.h"
+#include "MakoMeshCacheLoader.h"
+#include "MakoMeshCache.h"
+#include "MakoMesh.h"
 #include "MakoTextureLoader.h"
 #include "MakoColorMtl.h"
 #include "MakoException.h"
@@ -9,6 +12,10 @@
 #include "MakoFileStream.h"
 #include "MakoJPEGLoader.h"
 #include "MakoPNGLoader.h"
+#include "MakoDDSLoader.h"
+#include "MakoDDS.h"
+#include "MakoBlockCompression.h"
+#include "MakoImageResampler.h"
 #include "MakoException.h"
 #include "MakoFreeType2Font.h"
 #include "MakoFileStream.h"
@@ -19,23 +26,28 @@ MAKO_BEGIN_NAMESPACE
 GenericGraphicsDevice::GenericGraphicsDevice(bool vsync)
 : vsync(vsync)
 {
-#if 0
-	meshLoaders[MT_OBJ] = new ObjMeshLoader(APP());
-#endif
+	meshLoaders[MT_OBJ] = new ObjMeshLoader();
 	meshLoaders[MT_MAKOMESH] = new MakoMeshLoader();
+	meshLoaders[MT_MAKOMESHCACHE] = new MeshCacheLoader();
 
 	texLoaders[TT_JPEG] = new JPEGLoader;
 	texLoaders[TT_PNG] = new PNGLoader;
+	texLoaders[TT_DDS] = new DDSLoader;
 
 	if (FT_Init_FreeType(&library))
 	{
 		throw Exception(Text("FT_Init_FreeType() failed in \
 							 GenericGraphicsDevice::GenericGraphicsDevice()"));
 	}
+
+	asyncLoader = new AsyncLoader(this, texLoaders, TT_ENUM_LENGTH);
 }
 
 GenericGraphicsDevice::~GenericGraphicsDevice()
 {
+	// Jobs that are still decoding use the loaders
+	DropResources();
+
 	for (UInt i = 0; i < MT_ENUM_LENGTH; ++i)
 		delete meshLoaders[i];
 
@@ -46,18 +58,59 @@ GenericGraphicsDevice::~GenericGraphicsDevice()
 		throw Exception(Text("FT_Done_FreeType() failed"));
 }
 
+void GenericGraphicsDevice::DropResources()
+{
+	if (asyncLoader)
+	{
+		delete asyncLoader;
+		asyncLoader = nullptr;
+	}
+	resourceCache.Clear();
+}
+
+MESH_TYPE GenericGraphicsDevice::GetMeshType(const FilePath& fileName) const
+{
+	String ext = fileName.GetExt();
+	ext.LowerCase();
+
+	for (UInt i = 0; i < MT_ENUM_LENGTH; ++i)
+	{
+		if (meshLoaders[i]->IsLoadableFileExt(ext))
+			return static_cast<MESH_TYPE>(i);
+	}
+
+	throw Exception(Text("The file type [") + ext + Text("] is not supported"));
+}
+
+TEXTURE_TYPE GenericGraphicsDevice::GetTextureType(const FilePath& fileName) const
+{
+	String ext = fileName.GetExt();
+	ext.LowerCase();
+
+	for (UInt i = 0; i < TT_ENUM_LENGTH; ++i)
+	{
+		if (texLoaders[i]->IsLoadableFileExt(ext))
+			return static_cast<TEXTURE_TYPE>(i);
+	}
+
+	throw Exception(Text("The file type [") + ext + Text("] is not supported"));
+}
+
 Mesh* GenericGraphicsDevice::LoadMeshFromFile(const FilePath& fileName, MESH_TYPE mt)
 {
 	FilePath found = APP()->FS()->FindFile(fileName);
 	if (found.GetAbs().IsEmpty())
 		throw Exception(Text("The mesh file [") + fileName.GetAbs() + Text("] does not exist"));
 
-	FileInputStream* file = new FileInputStream(found);
-	file->Hold();
-	Mesh* m = meshLoaders[mt]->Load(file);
-	file->Drop();
+	StringId key = ResourceCache::MakeKey(found, mt);
+	Mesh* m = resourceCache.FindMesh(key);
+	if (m)
+		return m;
+
+	m = meshLoaders[mt]->LoadFromFile(found);
+	resourceCache.AddMesh(key, m);
 
-	APP()->GetConsole()->Log(LL_LOW, Text("Loaded mesh [") + found.GetAbs() + StringChar(']'));
+	MAKO_LOG(APP()->GetConsole(), LL_LOW, Text("Loaded mesh [") + found.GetAbs() + StringChar(']'));
 	return m;
 }
 
@@ -67,84 +120,133 @@ Texture* GenericGraphicsDevice::LoadTextureFromFile(const FilePath& fileName, TE
 	if (found.GetAbs().IsEmpty())
 		throw Exception(Text("The texture file [") + fileName.GetAbs() + Text("] does not exist"));
 
+	StringId key = ResourceCache::MakeKey(found, texType);
+	Texture* t = resourceCache.FindTexture(key);
+	if (t)
+		return t;
+
 	FileInputStream* file = new FileInputStream(found);
 	file->Hold();
-	Texture* t = texLoaders[texType]->Load(file);
+	t = texLoaders[texType]->Load(file);
 	file->Drop();
+	resourceCache.AddTexture(key, t);
 
-	APP()->GetConsole()->Log(LL_LOW, Text("Loaded texture [") + found.GetAbs() + StringChar(']'));
+	MAKO_LOG(APP()->GetConsole(), LL_LOW, Text("Loaded texture [") + found.GetAbs() + StringChar(']'));
 	return t;
 }
 
 Mesh* GenericGraphicsDevice::LoadMeshFromFile(const FilePath& fileName)
+{ return LoadMeshFromFile(fileName, GetMeshType(fileName)); }
+
+void GenericGraphicsDevice::ConvertMeshToMeshCache(const FilePath& source, const FilePath& dest)
 {
-	FilePath found = APP()->FS()->FindFile(fileName);
+	FilePath found = APP()->FS()->FindFile(source);
 	if (found.GetAbs().IsEmpty())
-		throw Exception(Text("The mesh file [") + found.GetAbs() + Text("] does not exist"));
+		throw Exception(Text("The mesh file [") + source.GetAbs() + Text("] does not exist"));
 
-	MESH_TYPE mt = (MESH_TYPE)0xFFFFFFFF;
-	String ext = fileName.GetExt();
-	ext.LowerCase();
-
-	for (UInt i = 0; i < TT_ENUM_LENGTH; ++i)
-	{
-		if (meshLoaders[i]->IsLoadableFileExt(ext))
-		{
-			mt = static_cast<MESH_TYPE>(i);
-			break;
-		}
-	}
-
-	if (mt == 0xFFFFFFFF)
-		throw Exception(Text("The file type [") + ext + Text("] is not supported"));
+	MESH_TYPE mt = GetMeshType(source);
 
+	ArrayList<MeshCacheSubMesh> subMeshes;
 	FileInputStream* file = new FileInputStream(found);
 	file->Hold();
-	Mesh* m = meshLoaders[mt]->Load(file);
+	Mesh* m = meshLoaders[mt]->LoadForMeshCache(file, subMeshes);
 	file->Drop();
 
-	APP()->GetConsole()->Log(LL_LOW, Text("Loaded mesh [") + found.GetAbs() + StringChar(']'));
-	return m;
+	if (!m)
+		throw Exception(Text("The file type [") + source.GetExt() + Text("] can't be converted to a mesh cache"));
+	m->Hold();
+
+	FileOutputStream* out = new FileOutputStream(dest);
+	out->Hold();
+	WriteMeshCache(subMeshes, out);
+	out->Drop();
+	m->Drop();
+
+	MAKO_LOG(APP()->GetConsole(), LL_LOW, Text("Converted mesh [") + found.GetAbs() + Text("] to [") + dest.GetAbs() + StringChar(']'));
 }
 
-Texture* GenericGraphicsDevice::LoadTextureFromFile(const FilePath& fileName)
+void GenericGraphicsDevice::ConvertTextureToDDS(const FilePath& source, const FilePath& dest,
+												COLOR_FORMAT format)
 {
-	FilePath found = APP()->FS()->FindFile(fileName);
+	FilePath found = APP()->FS()->FindFile(source);
 	if (found.GetAbs().IsEmpty())
-		throw Exception(Text("The texture file [") + fileName.GetAbs() + Text("] does not exist"));
+		throw Exception(Text("The texture file [") + source.GetAbs() + Text("] does not exist"));
 
-	TEXTURE_TYPE tt = (TEXTURE_TYPE)0xFFFFFFFF;
-	String ext = fileName.GetExt();
-	ext.LowerCase();
+	TextureCreationParams params;
+	FileInputStream* file = new FileInputStream(found);
+	file->Hold();
+	bool decoded = texLoaders[GetTextureType(source)]->Decode(file, params);
+	file->Drop();
 
-	for (UInt i = 0; i < TT_ENUM_LENGTH; ++i)
+	if (!decoded)
+		throw Exception(Text("The texture file [") + found.GetAbs() + Text("] could not be decoded"));
+	if (!params.size.x || !params.size.y)
 	{
-		if (texLoaders[i]->IsLoadableFileExt(ext))
+		delete [] static_cast<UInt8*>(params.data);
+		throw Exception(Text("The texture file [") + found.GetAbs() + Text("] is empty"));
+	}
+
+	// Block compressed sources are decompressed, and their mip levels
+	// generated again
+	ArrayList<UInt8> pixels(params.size.x * params.size.y * 4);
+	if (IsBlockCompressed(params.format))
+		DecompressImage(static_cast<const UInt8*>(params.data), params.size, params.format, &pixels[0]);
+	else
+		memcpy(&pixels[0], params.data, pixels.size());
+	delete [] static_cast<UInt8*>(params.data);
+
+	// The uncompressed levels, one after another
+	const UInt32 numLevels = GetMipChainLength(params.size);
+	ArrayList<UInt32> offsets(numLevels, 0);
+	ArrayList<Size2d> sizes(numLevels, params.size);
+	for (UInt32 i = 1; i < numLevels; ++i)
+	{
+		sizes[i]   = GetNextMipLevelSize(sizes[i - 1]);
+		offsets[i] = offsets[i - 1] + sizes[i - 1].x * sizes[i - 1].y * 4;
+	}
+	pixels.resize(offsets.back() + sizes.back().x * sizes.back().y * 4);
+
+	for (UInt32 i = 1; i < numLevels; ++i)
+		ResampleImageRGBA8(&pixels[offsets[i - 1]], sizes[i - 1], &pixels[offsets[i]], sizes[i], RF_KAISER);
+
+	ArrayList<UInt8> levels;
+	if (format == CF_R8G8B8A8)
+	{
+		levels.swap(pixels);
+	}
+	else
+	{
+		UInt32 size = 0;
+		for (UInt32 i = 0; i < numLevels; ++i)
+			size += GetImageDataSize(format, sizes[i]);
+		levels.resize(size);
+
+		UInt8* out = &levels[0];
+		for (UInt32 i = 0; i < numLevels; ++i)
 		{
-			tt = static_cast<TEXTURE_TYPE>(i);
-			break;
+			CompressImage(&pixels[offsets[i]], sizes[i], format, out);
+			out += GetImageDataSize(format, sizes[i]);
 		}
 	}
 
-	if (tt == 0xFFFFFFFF)
-		throw Exception(Text("The file type [") + ext + Text("] is not supported"));
+	FileOutputStream* out = new FileOutputStream(dest);
+	out->Hold();
+	WriteDDS(out, format, params.size, numLevels, &levels[0]);
+	out->Drop();
 
-	FileInputStream* file = new FileInputStream(found);
-	file->Hold();
-	Texture* t = texLoaders[tt]->Load(file);
-	file->Drop();
-
-	APP()->GetConsole()->Log(LL_LOW, Text("Loaded texture [") + found.GetAbs() + StringChar(']'));
-	return t;
+	MAKO_LOG(APP()->GetConsole(), LL_LOW, Text("Converted texture [") + found.GetAbs() + Text("] to [") + dest.GetAbs() + StringChar(']'));
 }
 
+Texture* GenericGraphicsDevice::LoadTextureFromFile(const FilePath& fileName)
+{ return LoadTextureFromFile(fileName, GetTextureType(fileName)); }
+
 Font* GenericGraphicsDevice::LoadFontFromFile(const FilePath& fileName)
 {
 	FilePath found = APP()->FS()->FindFile(fileName);
 	if (found.GetAbs().IsEmpty())
 		throw Exception(Text("The font file [") + fileName.GetAbs() + Text("] does not exist"));
 
-	APP()->GetConsole()->Log(LL_LOW, Text("Loaded font [") + found.GetAbs() + StringChar(']'));
+	MAKO_LOG(APP()->GetConsole(), LL_LOW, Text("Loaded font [") + found.GetAbs() + StringChar(']'));
 
 	return new FreeType2Font(this, found); //new FileInputStream(filepath));
 }
@@ -154,35 +256,102 @@ Font* GenericGraphicsDevice::LoadFont(InputStream* istream)
 	return new FreeType2Font(this, istream);
 }
 
+AsyncTexture* GenericGraphicsDevice::LoadTextureAsync(const FilePath& fileName)
+{
+	FilePath found = APP()->FS()->FindFile(fileName);
+	if (found.GetAbs().IsEmpty())
+		throw Exception(Text("The texture file [") + fileName.GetAbs() + Text("] does not exist"));
+
+	TEXTURE_TYPE tt = GetTextureType(fileName);
+	return asyncLoader->LoadTexture(found, texLoaders[tt], ResourceCache::MakeKey(found, tt));
+}
+
+AsyncMesh* GenericGraphicsDevice::LoadMeshAsync(const FilePath& fileName)
+{
+	FilePath found = APP()->FS()->FindFile(fileName);
+	if (found.GetAbs().IsEmpty())
+		throw Exception(Text("The mesh file [") + fileName.GetAbs() + Text("] does not exist"));
+
+	MESH_TYPE mt = GetMeshType(fileName);
+	return asyncLoader->LoadMesh(found, meshLoaders[mt], ResourceCache::MakeKey(found, mt));
+}
+
+AsyncFont* GenericGraphicsDevice::LoadFontAsync(const FilePath& fileName)
+{
+	FilePath found = APP()->FS()->FindFile(fileName);
+	if (found.GetAbs().IsEmpty())
+		throw Exception(Text("The font file [") + fileName.GetAbs() + Text("] does not exist"));
+
+	return asyncLoader->LoadFont(found);
+}
+
 void GenericGraphicsDevice::Draw2dText(const String& text,
 									   Font* font,
 									   const Pos2d& pos)
 {
-	Pos2d currpos(pos);
-	UInt32 cc = 0; // char count
-	for (const StringChar* p = text.GetData(); p != (text.GetData() + text.GetLength() + 1); ++p)
+	for (UInt32 i = 0; i < textBatches.size(); ++i)
+		textBatches[i].clear();
+
+	// The glyphs are gathered by the atlas page they're in, and every page
+	// is drawn with one call
+	Vec2df pen(static_cast<Float32>(pos.x), static_cast<Float32>(pos.y + font->GetAscender()));
+	StringChar prev = 0;
+	for (UInt i = 0; i < text.GetLength(); ++i)
 	{
-		switch (*p)
+		const StringChar c = text[i];
+		if (c == '\n')
 		{
-		case '\0':
-		case '\n':
-			{
-				if (cc == 0)
-					break;
-
-				Texture* t = font->Rasterize(String::FromData(p - cc, cc));
-				t->Hold();
-
-				Draw2dTexture(currpos, t, 0.f);
-
-				currpos.y += 15;
-				cc = 0;
-				t->Drop();
-				break;
-			}
-		default:
-			++cc;
+			pen.x = static_cast<Float32>(pos.x);
+			pen.y += font->GetLineHeight();
+			prev = 0;
+			continue;
 		}
+
+		if (prev)
+			pen.x += font->GetKerning(prev, c);
+		prev = c;
+
+		const GlyphMetrics& gm = font->GetGlyphMetrics(c);
+		if (gm.size.x && gm.size.y)
+		{
+			if (gm.page >= textBatches.size())
+				textBatches.resize(gm.page + 1);
+
+			const Float32 x0 = pen.x + gm.offset.x, y0 = pen.y + gm.offset.y;
+			const Float32 x1 = x0 + gm.size.x, y1 = y0 + gm.size.y;
+
+			Quad2d q;
+			q.pos[0] = Vec2df(x0, y0);
+			q.pos[1] = Vec2df(x1, y0);
+			q.pos[2] = Vec2df(x1, y1);
+			q.pos[3] = Vec2df(x0, y1);
+			// The texture coordinates are divided by the page size below
+			q.uv0 = TCoord(static_cast<Float32>(gm.atlasPos.x), static_cast<Float32>(gm.atlasPos.y));
+			q.uv1 = TCoord(static_cast<Float32>(gm.atlasPos.x + gm.size.x),
+			               static_cast<Float32>(gm.atlasPos.y + gm.size.y));
+			q.color = Color(255, 255, 255, 255);
+			textBatches[gm.page].push_back(q);
+		}
+
+		pen.x += gm.advance;
+	}
+
+	for (UInt32 i = 0; i < textBatches.size(); ++i)
+	{
+		ArrayList<Quad2d>& batch = textBatches[i];
+		if (batch.empty())
+			continue;
+
+		// Gotten after every glyph is rasterized, so the page is uploaded once
+		Texture* page = font->GetAtlasPage(i);
+		const Float32 invW = 1.f / page->GetSize().x, invH = 1.f / page->GetSize().y;
+		for (UInt32 j = 0; j < batch.size(); ++j)
+		{
+			batch[j].uv0.x *= invW; batch[j].uv0.y *= invH;
+			batch[j].uv1.x *= invW; batch[j].uv1.y *= invH;
+		}
+
+		Draw2dQuads(page, &batch[0], batch.size());
 	}
 }
 
@@ -9,6 +9,8 @@
 #include "MakoOSDevice.h"
 #include "MakoMemoryStream.h"
 #include "MakoTextureLoader.h"
+#include "MakoAsyncLoader.h"
+#include "MakoResourceCache.h"
 #include <ft2build.h>
 #include FT_FREETYPE_H
 
@@ -26,7 +28,24 @@ private:
 	Matrix4f transformations[TS_ENUM_LENGTH];
 	bool vsync;
 	FT_Library library;
+	AsyncLoader* asyncLoader;
+	ResourceCache resourceCache;
+	//! The quads of Draw2dText(), by atlas page. Kept so their memory is reused.
+	ArrayList<ArrayList<Quad2d> > textBatches;
+
+	//! Get the format of a mesh file by it's extension. Throws if there's no
+	//! loader for it.
+	MESH_TYPE GetMeshType(const FilePath& fileName) const;
+
+	//! Get the format of a texture file by it's extension. Throws if there's no
+	//! loader for it.
+	TEXTURE_TYPE GetTextureType(const FilePath& fileName) const;
 protected:
+	//! Classes who inherit GenericGraphicsDevice: Call this
+	//! method at the start of your deconstructor, so the cached
+	//! and loading resources are deleted while the device still exists.
+	void DropResources();
+
 	MAKO_INLINE Matrix4f& GetTransform(TRANSFORMATION_STATE ts)
 	{ return transformations[ts]; }
 public:
@@ -48,8 +67,24 @@ public:
 	Texture* LoadTextureFromFile(const FilePath& fileName);
 
 	Mesh* LoadMeshFromFile(const FilePath& fileName, MESH_TYPE mt);
+
+	void ConvertMeshToMeshCache(const FilePath& source, const FilePath& dest);
+	void ConvertTextureToDDS(const FilePath& source, const FilePath& dest, COLOR_FORMAT format);
 	Texture* LoadTextureFromFile(const FilePath& fileName, TEXTURE_TYPE texType);
 
+	AsyncTexture* LoadTextureAsync(const FilePath& fileName);
+	AsyncMesh* LoadMeshAsync(const FilePath& fileName);
+	AsyncFont* LoadFontAsync(const FilePath& fileName);
+
+	MAKO_INLINE ResourceCache* GetResourceCache()
+	{ return &resourceCache; }
+
+	MAKO_INLINE void UpdateAsyncLoads()
+	{ asyncLoader->Update(); }
+
+	MAKO_INLINE void SetAsyncUploadBudget(UInt32 bytesPerFrame)
+	{ asyncLoader->SetUploadBudget(bytesPerFrame); }
+
 	MAKO_INLINE const Matrix4f& GetTransform(TRANSFORMATION_STATE ts) const
 	{ return transformations[ts]; }
 	
@@ -13,6 +13,7 @@
 #include "MakoColor.h"
 #include "MakoTexture.h"
 #include "MakoFilePath.h"
+#include "MakoAsyncLoad.h"
 
 MAKO_BEGIN_NAMESPACE
 
@@ -27,6 +28,7 @@ class Application;
 class Material;
 class CgDevice;
 class Font;
+class ResourceCache;
 
 //! Graphics device option
 enum GRAPHICS_DEVICE_OPTION
@@ -42,7 +44,11 @@ enum GRAPHICS_DEVICE_TYPE
 #ifdef MAKO_D3D_AVAILABLE
 	GDT_D3D9,
 #endif
-	GDT_ENUM_LENGTH
+	//! Rasterizes in system memory; needs no window or GPU
+	GDT_SOFTWARE,
+	GDT_ENUM_LENGTH,
+	//! Picks the best device that is available
+	GDT_AUTO
 };
 
 //! Texture filtering is the method used to determine the texture color 
@@ -106,17 +112,32 @@ enum TEXTURE_ADDRESS_MODE
 
 enum MESH_TYPE
 {
-#if 0
 	MT_OBJ,
-#endif
 	MT_MAKOMESH,
+	//! A mesh converted with GraphicsDevice::ConvertMeshToMeshCache()
+	MT_MAKOMESHCACHE,
 	MT_ENUM_LENGTH
 };
 
+//! A textured quad, drawn in screen space by GraphicsDevice::Draw2dQuads()
+struct Quad2d
+{
+	//! The screen positions of the corners: up-left, up-right, down-right
+	//! and down-left. They may form any parallelogram.
+	Vec2df pos[4];
+	//! The texture coordinates of the up-left and down-right corners
+	TCoord uv0, uv1;
+	//! The texels are multiplied with it
+	Color color;
+};
+
 enum TEXTURE_TYPE
 {
 	TT_JPEG,
 	TT_PNG,
+	//! Can hold block compressed textures and their mip levels, see
+	//! GraphicsDevice::ConvertTextureToDDS()
+	TT_DDS,
 	TT_ENUM_LENGTH
 };
 
@@ -239,6 +260,59 @@ public:
 	//! \return The loaded mesh.
 	virtual Mesh* LoadMeshFromFile(const FilePath& fileName) = 0;
 
+	//! Starts loading a texture in the background. The file is read and
+	//! decoded by the JobSystem, and the texture is created by
+	//! UpdateAsyncLoads(). The format is detected by the file's extension.
+	//! \param[in] fileName The file path of the texture
+	//! \return The handle to poll. Hold() it for as long as it's used.
+	virtual AsyncTexture* LoadTextureAsync(const FilePath& fileName) = 0;
+
+	//! Starts loading a mesh and it's textures in the background, like
+	//! LoadTextureAsync().
+	//! \param[in] fileName The file path of the mesh
+	//! \return The handle to poll. Hold() it for as long as it's used.
+	virtual AsyncMesh* LoadMeshAsync(const FilePath& fileName) = 0;
+
+	//! Starts loading a font in the background, like LoadTextureAsync().
+	//! \param[in] fileName The file path of the font
+	//! \return The handle to poll. Hold() it for as long as it's used.
+	virtual AsyncFont* LoadFontAsync(const FilePath& fileName) = 0;
+
+	//! Creates the resources of Load*Async() calls that finished decoding,
+	//! until the upload budget is used up. SimpleApplication calls it once
+	//! per frame.
+	virtual void UpdateAsyncLoads() = 0;
+
+	//! Set how many bytes of pixels, vertices and indices UpdateAsyncLoads()
+	//! creates at most per call, so loading doesn't stall the frame.
+	virtual void SetAsyncUploadBudget(UInt32 bytesPerFrame) = 0;
+
+	//! Get the cache that deduplicates the textures, meshes and shaders loaded
+	//! from files. Loading a file that is cached returns the cached resource.
+	//! Call ResourceCache::Purge() to delete those that aren't used anymore.
+	virtual ResourceCache* GetResourceCache() = 0;
+
+	//! Converts a mesh file to a mesh cache (see MakoMeshCache.h), which
+	//! loads much faster. The format of the mesh file is auto-detected by it's
+	//! extension, and it's loader has to support LoadForMeshCache().
+	//! \param[in] source The file path of the mesh
+	//! \param[in] dest The file path of the mesh cache to write. Mesh caches
+	//! are loaded by LoadMeshFromFile() if it ends with .makomeshcache.
+	virtual void ConvertMeshToMeshCache(const FilePath& source, const FilePath& dest) = 0;
+
+	//! Converts a texture file to a DDS file (see MakoDDS.h), compressed to a
+	//! block compressed format, with a full chain of mip levels. The levels
+	//! are generated with MF_KAISER and compressed in parallel. Compressed
+	//! textures take 4 to 8 times less memory, and load without being decoded.
+	//! \param[in] source The file path of the texture. It's format is
+	//! auto-detected by it's extension.
+	//! \param[in] dest The file path of the DDS file to write
+	//! \param[in] format CF_BC1 for opaque textures or textures with 1 bit
+	//! alpha, CF_BC3 for textures with alpha, CF_BC4 for one channel and CF_BC5
+	//! for normal maps. CF_R8G8B8A8 writes the mip levels uncompressed.
+	virtual void ConvertTextureToDDS(const FilePath& source, const FilePath& dest,
+									 COLOR_FORMAT format) = 0;
+
 	//! Set the new texture filtering mode
 	//! \param[in] mode The new texture filtering mode
 	virtual void SetTextureFilteringMode(TEXTURE_FILTER_MODE mode) = 0;
@@ -283,7 +357,7 @@ public:
 	//! \parma[in] text The text to draw
 	//! \param[in] font The font to draw the text with
 	//! \param[in] pos The screen position of where to draw the text, up-left
-	//! centered.
+	//! centered. Lines are separated by '\n'.
 	virtual void Draw2dText(const String& text, Font* font, const Pos2d& pos) = 0;
 	
 	//! Create a MeshData.
@@ -311,6 +385,14 @@ public:
 	//! in world space
 	virtual void DrawIndexedMeshData(IndexedMeshData* mb) = 0;
 
+	//! Draw a range of primitives of a mesh buffer, indexed or not, without
+	//! binding any material. The caller binds the material, e.g. the RenderQueue
+	//! which only rebinds materials when they change.
+	//! \param[in] mb The mesh buffer to draw
+	//! \param[in] firstPrim The first primitive to draw
+	//! \param[in] numPrims The number of primitives to draw
+	virtual void DrawMeshDataPrimitives(MeshData* mb, UInt32 firstPrim, UInt32 numPrims) = 0;
+
 	//! Draw a 2d texture
 	//! \param[in] pos The position, left-up corner centered
 	//! \param[in] tex The texture to be drawn
@@ -318,6 +400,13 @@ public:
 	virtual void Draw2dTexture(const Position2d& pos,
 		Texture* tex, const Rotation2d& rot) = 0;
 
+	//! Draw quads of one texture, alpha blended, in as few draw calls as the
+	//! implementation can. Text and sprites are drawn with it.
+	//! \param[in] tex The texture of every quad
+	//! \param[in] quads The quads, drawn in order
+	//! \param[in] numQuads The number of quads
+	virtual void Draw2dQuads(Texture* tex, const Quad2d* quads, UInt32 numQuads) = 0;
+
 	//! Virtual deconstructor
 	virtual ~GraphicsDevice() {}
 };
@@ -0,0 +1,325 @@
+#include "MakoImageResampler.h"
+#include "MakoArrayList.h"
+#include "MakoJobSystem.h"
+#include "MakoApplication.h"
+#include "MakoSIMD.h"
+#include "MakoMath.h"
+#include <math.h>
+#include <string.h>
+
+MAKO_BEGIN_NAMESPACE
+
+//! Number of entries of the linear to sRGB table. Linear values are rounded
+//! to multiples of 1 / (LINEAR_TO_SRGB_SIZE - 1) before they are looked up,
+//! which is fine enough that every 8 bit value survives the round trip.
+static const UInt32 LINEAR_TO_SRGB_SIZE = 8192;
+
+//! The width of the Kaiser window, and it's shape parameter
+static const Float32 KAISER_SUPPORT = 3.f;
+static const Float32 KAISER_BETA    = 4.f;
+
+//! Destination rows are filtered in blocks of about this many pixels, which
+//! are also the smallest amount of work that is given to a job.
+static const UInt32 PIXELS_PER_BLOCK = 32768;
+
+//! Tables to convert between 8 bit and linear values, which are built when
+//! the engine is loaded.
+struct GammaTables
+{
+	//! The linear value of every 8 bit sRGB value
+	Float32 srgbToLinear[256];
+	UInt8 linearToSRGB[LINEAR_TO_SRGB_SIZE];
+
+	GammaTables()
+	{
+		for (UInt32 i = 0; i < 256; ++i)
+		{
+			const Float32 c = i / 255.f;
+			srgbToLinear[i] = c <= .04045f ? c / 12.92f : powf((c + .055f) / 1.055f, 2.4f);
+		}
+		for (UInt32 i = 0; i < LINEAR_TO_SRGB_SIZE; ++i)
+		{
+			const Float32 l = i / static_cast<Float32>(LINEAR_TO_SRGB_SIZE - 1);
+			const Float32 c = l <= .0031308f ? l * 12.92f : 1.055f * powf(l, 1.f / 2.4f) - .055f;
+			linearToSRGB[i] = static_cast<UInt8>(Clamp(c, 0.f, 1.f) * 255.f + .5f);
+		}
+	}
+};
+
+static const GammaTables gammaTables;
+
+//! Converts a row of pixels to linear floats, 4 per pixel
+static void RowToLinear(const UInt8* in, Float32* out, UInt32 numPixels)
+{
+	const Float32* table = gammaTables.srgbToLinear;
+	for (UInt32 i = 0; i < numPixels; ++i, in += 4, out += 4)
+	{
+		out[0] = table[in[0]];
+		out[1] = table[in[1]];
+		out[2] = table[in[2]];
+		out[3] = in[3] * (1.f / 255.f);
+	}
+}
+
+//! Converts a row of linear floats back to pixels. Filters with negative
+//! lobes overshoot, so the values are clamped.
+static void RowFromLinear(const Float32* in, UInt8* out, UInt32 numPixels)
+{
+	const UInt8* table = gammaTables.linearToSRGB;
+	const Float32 scale = static_cast<Float32>(LINEAR_TO_SRGB_SIZE - 1);
+	for (UInt32 i = 0; i < numPixels; ++i, in += 4, out += 4)
+	{
+		out[0] = table[static_cast<UInt32>(Clamp(in[0], 0.f, 1.f) * scale + .5f)];
+		out[1] = table[static_cast<UInt32>(Clamp(in[1], 0.f, 1.f) * scale + .5f)];
+		out[2] = table[static_cast<UInt32>(Clamp(in[2], 0.f, 1.f) * scale + .5f)];
+		out[3] = static_cast<UInt8>(Clamp(in[3], 0.f, 1.f) * 255.f + .5f);
+	}
+}
+
+//! Get how far from it's center a filter is not 0
+static Float32 GetFilterSupport(RESAMPLE_FILTER filter)
+{
+	switch (filter)
+	{
+	case RF_BOX:         return .5f;
+	case RF_TENT:        return 1.f;
+	case RF_CATMULL_ROM: return 2.f;
+	case RF_KAISER:      return KAISER_SUPPORT;
+	default:             return 0.f;
+	}
+}
+
+//! The modified Bessel function of the first kind of order 0, for the Kaiser window
+static Float32 BesselI0(Float32 x)
+{
+	Float32 sum = 1.f, term = 1.f;
+	for (UInt32 k = 1; k < 20; ++k)
+	{
+		const Float32 t = x / (2.f * k);
+		term *= t * t;
+		sum += term;
+		if (term < sum * 1e-7f)
+			break;
+	}
+	return sum;
+}
+
+//! Evaluates a filter at a distance of x pixels from it's center
+static Float32 EvaluateFilter(RESAMPLE_FILTER filter, Float32 x)
+{
+	x = Abs(x);
+	switch (filter)
+	{
+	case RF_BOX:
+		// Pixels exactly on the border are shared by both sides
+		return x < .5f ? 1.f : (x == .5f ? .5f : 0.f);
+	case RF_TENT:
+		return x < 1.f ? 1.f - x : 0.f;
+	case RF_CATMULL_ROM:
+		if (x < 1.f)
+			return (1.5f * x - 2.5f) * x * x + 1.f;
+		if (x < 2.f)
+			return ((-.5f * x + 2.5f) * x - 4.f) * x + 2.f;
+		return 0.f;
+	case RF_KAISER:
+		{
+			if (x >= KAISER_SUPPORT)
+				return 0.f;
+			const Float32 r = x / KAISER_SUPPORT;
+			const Float32 window = BesselI0(KAISER_BETA * sqrtf(1.f - r * r)) / BesselI0(KAISER_BETA);
+			const Float32 px = 3.14159265f * x;
+			return x < 1e-5f ? window : window * sinf(px) / px;
+		}
+	default:
+		return 0.f;
+	}
+}
+
+//! The taps of a filter for every pixel along one axis of the destination image
+struct ResampleAxis
+{
+	//! The most taps any pixel has, and the stride of weights
+	UInt32 maxTaps;
+	//! The first source pixel of the taps of each destination pixel
+	ArrayList<UInt32> first;
+	//! The number of taps of each destination pixel
+	ArrayList<UInt32> numTaps;
+	//! maxTaps weights for each destination pixel, which add up to 1
+	ArrayList<Float32> weights;
+};
+
+//! Finds the taps of every destination pixel along an axis. Taps outside of
+//! the source are clamped to the edge, so they stay contiguous.
+static void BuildResampleAxis(ResampleAxis& axis, UInt32 srcLength, UInt32 dstLength,
+							  RESAMPLE_FILTER filter)
+{
+	const Float32 scale   = static_cast<Float32>(srcLength) / dstLength;
+	const Float32 stretch = Max(scale, 1.f);
+	const Float32 support = GetFilterSupport(filter) * stretch;
+
+	axis.maxTaps = static_cast<UInt32>(ceilf(support * 2.f)) + 2;
+	axis.first.resize(dstLength);
+	axis.numTaps.resize(dstLength);
+	axis.weights.assign(dstLength * axis.maxTaps, 0.f);
+
+	for (UInt32 d = 0; d < dstLength; ++d)
+	{
+		// The center of the destination pixel, in source pixels
+		const Float32 center = (d + .5f) * scale - .5f;
+		const Int32 lo = static_cast<Int32>(floorf(center - support));
+		const Int32 hi = static_cast<Int32>(ceilf(center + support));
+		const Int32 first = Clamp(lo, 0, static_cast<Int32>(srcLength) - 1);
+		Float32* w = &axis.weights[d * axis.maxTaps];
+
+		Float32 sum = 0.f;
+		for (Int32 s = lo; s <= hi; ++s)
+		{
+			const Float32 weight = EvaluateFilter(filter, (s - center) / stretch);
+			w[Clamp(s, 0, static_cast<Int32>(srcLength) - 1) - first] += weight;
+			sum += weight;
+		}
+
+		// Taps at either end with no weight are skipped
+		UInt32 begin = 0, end = Clamp(hi, 0, static_cast<Int32>(srcLength) - 1) - first + 1;
+		while (end > begin + 1 && w[end - 1] == 0.f)
+			--end;
+		while (begin + 1 < end && w[begin] == 0.f)
+			++begin;
+
+		if (sum == 0.f)
+		{
+			// Can't happen with the filters above, but don't divide by 0
+			w[begin] = sum = 1.f;
+			end = begin + 1;
+		}
+
+		for (UInt32 i = begin; i < end; ++i)
+			w[i - begin] = w[i] / sum;
+		for (UInt32 i = end - begin; i < axis.maxTaps; ++i)
+			w[i] = 0.f;
+
+		axis.first[d]   = first + begin;
+		axis.numTaps[d] = end - begin;
+	}
+}
+
+//! out[i] += in[i] * weight for count floats, count being a multiple of 4
+static MAKO_INLINE void AddScaled(Float32* out, const Float32* in, Float32 weight, UInt32 count)
+{
+#ifdef MAKO_SSE_AVAILABLE
+	if (GetSIMDLevel() != SL_SCALAR)
+	{
+		const __m128 w = _mm_set1_ps(weight);
+		for (UInt32 i = 0; i < count; i += 4)
+			_mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(_mm_loadu_ps(in + i), w)));
+		return;
+	}
+#endif
+	for (UInt32 i = 0; i < count; ++i)
+		out[i] += in[i] * weight;
+}
+
+//! Filters one pixel of a row: out = the sum of the numTaps pixels at in,
+//! weighted by w.
+static MAKO_INLINE void FilterPixel(Float32* out, const Float32* in, const Float32* w, UInt32 numTaps)
+{
+#ifdef MAKO_SSE_AVAILABLE
+	if (GetSIMDLevel() != SL_SCALAR)
+	{
+		__m128 sum = _mm_setzero_ps();
+		for (UInt32 t = 0; t < numTaps; ++t)
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(in + t * 4), _mm_set1_ps(w[t])));
+		_mm_storeu_ps(out, sum);
+		return;
+	}
+#endif
+	out[0] = out[1] = out[2] = out[3] = 0.f;
+	for (UInt32 t = 0; t < numTaps; ++t)
+	{
+		out[0] += in[t * 4 + 0] * w[t];
+		out[1] += in[t * 4 + 1] * w[t];
+		out[2] += in[t * 4 + 2] * w[t];
+		out[3] += in[t * 4 + 3] * w[t];
+	}
+}
+
+//! Resamples ranges of rows of the destination image. Each block of rows
+//! filters the source rows it needs horizontally, and then filters those
+//! vertically, so only a few rows are kept as floats at once.
+struct ResamplePass
+{
+	const UInt8* src;
+	UInt8* dst;
+	UInt32 srcWidth, dstWidth;
+	const ResampleAxis* horizontal;
+	const ResampleAxis* vertical;
+	//! The number of destination rows filtered at once
+	UInt32 blockRows;
+
+	void operator () (UInt32 begin, UInt32 end)
+	{
+		const UInt32 rowFloats = dstWidth * 4;
+		ArrayList<Float32> srcRow(srcWidth * 4), dstRow(rowFloats), rows;
+
+		for (UInt32 blockBegin = begin; blockBegin < end; blockBegin += blockRows)
+		{
+			const UInt32 blockEnd = Min(blockBegin + blockRows, end);
+
+			// Vertical taps only move forward, so the block needs the rows from
+			// the first tap of it's first row to the last tap of it's last row
+			const UInt32 firstRow = vertical->first[blockBegin];
+			const UInt32 endRow = vertical->first[blockEnd - 1] + vertical->numTaps[blockEnd - 1];
+			rows.resize((endRow - firstRow) * rowFloats);
+
+			for (UInt32 y = firstRow; y < endRow; ++y)
+			{
+				RowToLinear(src + y * srcWidth * 4, &srcRow[0], srcWidth);
+
+				Float32* out = &rows[(y - firstRow) * rowFloats];
+				for (UInt32 x = 0; x < dstWidth; ++x)
+					FilterPixel(out + x * 4, &srcRow[horizontal->first[x] * 4],
+						&horizontal->weights[x * horizontal->maxTaps], horizontal->numTaps[x]);
+			}
+
+			for (UInt32 y = blockBegin; y < blockEnd; ++y)
+			{
+				// Whole rows are added up, so the rows are read in order
+				memset(&dstRow[0], 0, rowFloats * sizeof(Float32));
+				const Float32* w = &vertical->weights[y * vertical->maxTaps];
+				for (UInt32 t = 0; t < vertical->numTaps[y]; ++t)
+					AddScaled(&dstRow[0], &rows[(vertical->first[y] + t - firstRow) * rowFloats],
+						w[t], rowFloats);
+
+				RowFromLinear(&dstRow[0], dst + y * rowFloats, dstWidth);
+			}
+		}
+	}
+};
+
+void ResampleImageRGBA8(const UInt8* src, const Size2d& srcSize,
+						UInt8* dst, const Size2d& dstSize, RESAMPLE_FILTER filter)
+{
+	if (!srcSize.x || !srcSize.y || !dstSize.x || !dstSize.y)
+		return;
+
+	ResampleAxis horizontal, vertical;
+	BuildResampleAxis(horizontal, srcSize.x, dstSize.x, filter);
+	BuildResampleAxis(vertical, srcSize.y, dstSize.y, filter);
+
+	ResamplePass pass;
+	pass.src        = src;
+	pass.dst        = dst;
+	pass.srcWidth   = srcSize.x;
+	pass.dstWidth   = dstSize.x;
+	pass.horizontal = &horizontal;
+	pass.vertical   = &vertical;
+	pass.blockRows  = Max(PIXELS_PER_BLOCK / Max(srcSize.x, dstSize.x), 1u);
+
+	JobSystem* js = APP()->JS();
+	if (js && dstSize.y > pass.blockRows)
+		js->ParallelFor(dstSize.y, pass, pass.blockRows);
+	else
+		pass(0, dstSize.y);
+}
+
+MAKO_END_NAMESPACE
@@ -0,0 +1,51 @@
+#pragma once
+#include "MakoCommon.h"
+#include "MakoVec2d.h"
+
+MAKO_BEGIN_NAMESPACE
+
+//! The filters ResampleImageRGBA8() can resample with
+enum RESAMPLE_FILTER
+{
+	//! Averages the source pixels that cover a destination pixel. Halving an
+	//! image with it averages 2x2 pixels.
+	RF_BOX,
+	//! A triangle filter. Magnifying with it is bilinear interpolation.
+	RF_TENT,
+	//! The Catmull-Rom cubic spline. Magnifying with it is bicubic interpolation.
+	RF_CATMULL_ROM,
+	//! A sinc filter, windowed by a Kaiser window over 3 pixels. Sharper than
+	//! the box filter when minifying, at the cost of some ringing.
+	RF_KAISER,
+	RF_ENUM_LENGTH
+};
+
+//! Resamples an image of 8 bit RGBA pixels (CF_R8G8B8A8) to another size.
+//! It's gamma-correct: red, green and blue are converted from sRGB to linear
+//! values before they are filtered, and back afterwards. Alpha is filtered
+//! as it is. When minifying, filters are stretched over all of the source
+//! pixels that are covered by a destination pixel.
+//! The filter is separable: blocks of destination rows filter the source
+//! rows they need horizontally, and then those vertically. The blocks run in
+//! parallel if the Application has a JobSystem, and are vectorized with SSE.
+//! \param[in] src The pixels of the source image, row by row.
+//! \param[out] dst Receives dstSize.x * dstSize.y pixels. Must not overlap src.
+MAKO_API void ResampleImageRGBA8(const UInt8* src, const Size2d& srcSize,
+								 UInt8* dst, const Size2d& dstSize, RESAMPLE_FILTER filter);
+
+//! Get the size of the mip level below a level of size size: half of it,
+//! rounded down, but at least 1.
+MAKO_INLINE Size2d GetNextMipLevelSize(const Size2d& size)
+{ return Size2d(size.x > 1 ? size.x / 2 : 1, size.y > 1 ? size.y / 2 : 1); }
+
+//! Get the number of levels of a full mip chain of an image of size size,
+//! from size down to 1x1.
+MAKO_INLINE UInt32 GetMipChainLength(const Size2d& size)
+{
+	UInt32 levels = 1;
+	for (UInt32 s = size.x > size.y ? size.x : size.y; s > 1; s /= 2)
+		++levels;
+	return levels;
+}
+
+MAKO_END_NAMESPACE
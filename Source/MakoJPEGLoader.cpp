@@ -4,6 +4,7 @@
 #include "MakoApplication.h"
 #include "MakoGraphicsDevice.h"
 #include "MakoStream.h"
+#include "MakoBufferedStream.h"
 
 MAKO_BEGIN_NAMESPACE
 
@@ -15,11 +16,27 @@ void JPEGLoader::init_source(j_decompress_ptr cinfo)
 
 boolean JPEGLoader::fill_input_buffer(j_decompress_ptr cinfo)
 {
-	JPEGLoader* loader = (JPEGLoader*)cinfo->client_data;
+	// client_data is the stream being decoded, libjpeg reads straight out
+	// of it's buffer
+	BufferedInputStream* istream = (BufferedInputStream*)cinfo->client_data;
+
+	// Hand libjpeg everything that's buffered and consume it right away. It
+	// stays valid until the stream is read again, which only happens here.
+	UInt32 cBytes;
+	const void* data = istream->PeekBuffered(cBytes);
+	if (!cBytes)
+	{
+		// The file ended early, so insert a fake EOI marker like libjpeg's
+		// own data sources do.
+		static const JOCTET eoi[2] = { 0xFF, JPEG_EOI };
+		cinfo->src->next_input_byte = eoi;
+		cinfo->src->bytes_in_buffer = 2;
+		return 1;
+	}
 
-	cinfo->src->next_input_byte  = &loader->input;
-	loader->istream->ReadTo(&loader->input, 1);
-	cinfo->src->bytes_in_buffer  = 1;
+	istream->Skip(cBytes);
+	cinfo->src->next_input_byte  = static_cast<const JOCTET*>(data);
+	cinfo->src->bytes_in_buffer  = cBytes;
 	
 	return 1;
 }
@@ -30,11 +47,17 @@ void JPEGLoader::skip_input_data(j_decompress_ptr cinfo, long count)
 	jpeg_source_mgr* src = cinfo->src;
 	if (count > 0)
 	{
-		//src->bytes_in_buffer -= count;
-		//src->next_input_byte += count;
-		JPEGLoader* loader = ((JPEGLoader*)cinfo->client_data);
+		if ((size_t)count <= src->bytes_in_buffer)
+		{
+			src->bytes_in_buffer -= count;
+			src->next_input_byte += count;
+			return;
+		}
+
+		// The rest of the bytes libjpeg has were consumed from the stream already
+		BufferedInputStream* istream = (BufferedInputStream*)cinfo->client_data;
 
-		loader->istream->Skip(count);
+		istream->Skip(count - src->bytes_in_buffer);
 
 		src->bytes_in_buffer = 0;
 	}
@@ -82,21 +105,16 @@ void JPEGLoader::output_message(j_common_ptr cinfo)
 	MAKO_DEBUG_BREAK;
 }
 
-Texture* JPEGLoader::Load(InputStream* stream)
+bool JPEGLoader::Decode(InputStream* source, TextureCreationParams& params)
 {
-	istream = stream;
+	BufferedInputStream stream(source);
 	UInt8** rowPtr = nullptr;
-	//UInt32 cBytes  = stream->GetSize();
-	stream->ReadTo(&input, 1);
-
-	//UInt8* input   = new UInt8[cBytes];
-	//stream->ReadTo(input, cBytes);
 
 	// allocate and initialize JPEG decompression object
 	jpeg_decompress_struct cinfo;
 	JpegErrorMgr jerr;
 
-	cinfo.client_data = this;
+	cinfo.client_data = &stream;
 
 	// We have to set up the error handler first, in case the initialization
 	// step fails.  (Unlikely, but it could happen if you are out of memory.)
@@ -134,9 +152,9 @@ Texture* JPEGLoader::Load(InputStream* stream)
 	jpeg_source_mgr jsrc;
 	cinfo.src = &jsrc;
 
-	// Set up data pointer
-	jsrc.bytes_in_buffer = 1; //cBytes;
-	jsrc.next_input_byte = &input;
+	// Nothing is buffered yet, so libjpeg calls fill_input_buffer() first
+	jsrc.bytes_in_buffer = 0;
+	jsrc.next_input_byte = nullptr;
 
 	jsrc.init_source       = init_source;
 	jsrc.fill_input_buffer = fill_input_buffer;
@@ -205,12 +223,11 @@ Texture* JPEGLoader::Load(InputStream* stream)
 
 	delete [] output;
 	
-	TextureCreationParams params;
 	params.data   = output2;
 	params.size   = Size2d(width, height);
 	params.format = CF_R8G8B8A8;
-
-	return APP()->GD()->CreateTexture(params);
+	params.generateMipMaps = true;
+	return true;
 }
 
 MAKO_END_NAMESPACE
\ No newline at end of file
@@ -11,19 +11,18 @@ MAKO_BEGIN_NAMESPACE
 
 // Forward declaration
 class Application;
+class BufferedInputStream;
 
 class JPEGLoader : public TextureLoader
 {
-	UInt8 input;
-	InputStream* istream;
 public:
-	MAKO_INLINE JPEGLoader() : istream(nullptr) {}
+	MAKO_INLINE JPEGLoader() {}
 	MAKO_INLINE ~JPEGLoader() {}
 
-	bool IsLoadableFileExt(const String& ext) const
+	bool IsLoadableFileExt(const StringView& ext) const
 	{ return ext == Text("jpg") || ext == Text("jpeg"); }
 
-	Texture* Load(InputStream* stream);
+	bool Decode(InputStream* stream, TextureCreationParams& params);
 
 	// Receives control for a fatal error.  Information sufficient to
 	// generate the error message has been stored in cinfo->err; call
@@ -0,0 +1,321 @@
+#include "MakoJobSystem.h"
+#include "MakoException.h"
+
+MAKO_BEGIN_NAMESPACE
+
+struct Job
+{
+	JobFunction fn;
+	ParallelForFunction rangeFn;
+	void* data;
+	UInt32 begin, end;
+	JobGroup* group;
+	//! Unfinished jobs it continues, plus one until it's submitted
+	volatile Int32 waitCount;
+	Job* continuations[JobSystem::MAX_CONTINUATIONS];
+	UInt32 numContinuations;
+};
+
+//! The JobSystem the calling thread belongs to, and the index of it's queue
+static MAKO_THREAD_LOCAL JobSystem* threadJobSystem = nullptr;
+static MAKO_THREAD_LOCAL UInt32 threadIndex = 0;
+
+JobSystem::JobSystem(UInt32 numWorkers)
+: numQueued(0), numSleeping(0), shutdown(0)
+{
+	if (!numWorkers)
+	{
+		const UInt32 numHardwareThreads = Thread::GetNumHardwareThreads();
+		numWorkers = numHardwareThreads > 1 ? numHardwareThreads - 1 : 1;
+	}
+
+	queues.resize(numWorkers + 1);
+	for (UInt32 i = 0; i < queues.size(); ++i)
+	{
+		queues[i] = new Queue;
+		queues[i]->top = queues[i]->bottom = 0;
+	}
+
+	threadJobSystem = this;
+	threadIndex     = 0;
+
+	// workerStarts doesn't move, the workers keep pointers into it
+	workerStarts.resize(numWorkers);
+	workers.reserve(numWorkers);
+	for (UInt32 i = 0; i < numWorkers; ++i)
+	{
+		workerStarts[i].js    = this;
+		workerStarts[i].index = i + 1;
+		workers.push_back(new Thread(&WorkerMain, &workerStarts[i]));
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	AtomicExchange(&shutdown, 1);
+	wakeUp.Post(AtomicExchange(&numSleeping, 0));
+
+	for (UInt32 i = 0; i < workers.size(); ++i)
+		delete workers[i];
+
+	// Jobs that never ran
+	for (UInt32 i = 0; i < queues.size(); ++i)
+	{
+		for (UInt32 j = queues[i]->top; j != queues[i]->bottom; ++j)
+			delete queues[i]->jobs[j % QUEUE_SIZE];
+		delete queues[i];
+	}
+
+	if (threadJobSystem == this)
+		threadJobSystem = nullptr;
+}
+
+void JobSystem::WorkerMain(void* arg)
+{
+	WorkerStart* start = static_cast<WorkerStart*>(arg);
+	JobSystem* js = start->js;
+	threadJobSystem = js;
+	threadIndex     = start->index;
+
+	while (!AtomicLoad(&js->shutdown))
+	{
+		Job* job = js->FindJob(threadIndex);
+		if (job)
+		{
+			js->Execute(job);
+			continue;
+		}
+
+		// Spin for a bit before sleeping, jobs often come in bursts
+		for (UInt32 i = 0; i < 64 && !job; ++i)
+		{
+			if (AtomicLoad(&js->numQueued))
+				job = js->FindJob(threadIndex);
+			else
+				CPUPause();
+		}
+
+		if (job)
+			js->Execute(job);
+		else
+			js->Sleep();
+	}
+}
+
+UInt32 JobSystem::GetThreadIndex() const
+{
+	// Threads that don't belong to the JobSystem share the first queue
+	return threadJobSystem == this ? threadIndex : 0;
+}
+
+void JobSystem::Push(Job* job)
+{
+	Queue* q = queues[GetThreadIndex()];
+	q->lock.Lock();
+	if (q->bottom - q->top == QUEUE_SIZE)
+	{
+		q->lock.Unlock();
+		Execute(job);
+		return;
+	}
+	q->jobs[q->bottom % QUEUE_SIZE] = job;
+	++q->bottom;
+	q->lock.Unlock();
+
+	AtomicIncrement(&numQueued);
+	WakeWorker();
+}
+
+Job* JobSystem::Pop(UInt32 thread)
+{
+	Queue* q = queues[thread];
+	if (q->top == q->bottom)
+		return nullptr;
+
+	Job* job = nullptr;
+	q->lock.Lock();
+	if (q->top != q->bottom)
+	{
+		--q->bottom;
+		job = q->jobs[q->bottom % QUEUE_SIZE];
+	}
+	q->lock.Unlock();
+	return job;
+}
+
+Job* JobSystem::Steal(UInt32 thread)
+{
+	Queue* q = queues[thread];
+	if (q->top == q->bottom)
+		return nullptr;
+
+	Job* job = nullptr;
+	if (q->lock.TryLock())
+	{
+		if (q->top != q->bottom)
+		{
+			job = q->jobs[q->top % QUEUE_SIZE];
+			++q->top;
+		}
+		q->lock.Unlock();
+	}
+	return job;
+}
+
+Job* JobSystem::FindJob(UInt32 thread)
+{
+	Job* job = Pop(thread);
+
+	// Steal from the other threads, starting with the next one, so the
+	// thieves don't all go for the same queue
+	for (UInt32 i = 1; !job && i < queues.size(); ++i)
+		job = Steal((thread + i) % queues.size());
+
+	if (job)
+		AtomicDecrement(&numQueued);
+	return job;
+}
+
+void JobSystem::Execute(Job* job)
+{
+	if (job->rangeFn)
+		job->rangeFn(job->begin, job->end, job->data);
+	else
+		job->fn(job->data);
+
+	for (UInt32 i = 0; i < job->numContinuations; ++i)
+	{
+		if (AtomicDecrement(&job->continuations[i]->waitCount) == 0)
+			Push(job->continuations[i]);
+	}
+
+	// The group is done once the job's continuations are queued, so their
+	// groups can't be waited on too early
+	if (job->group)
+		AtomicDecrement(&job->group->pending);
+	delete job;
+}
+
+void JobSystem::WakeWorker()
+{
+	// Claim one of the sleeping workers, which then has a post waiting for it
+	Int32 sleeping = AtomicLoad(&numSleeping);
+	while (sleeping > 0)
+	{
+		const Int32 previous = AtomicCompareExchange(&numSleeping, sleeping - 1, sleeping);
+		if (previous == sleeping)
+		{
+			wakeUp.Post();
+			return;
+		}
+		sleeping = previous;
+	}
+}
+
+void JobSystem::Sleep()
+{
+	AtomicIncrement(&numSleeping);
+
+	// Push() and the destructor change their counter before they look at
+	// numSleeping, so either they see this worker or it sees them.
+	if (AtomicLoad(&numQueued) || AtomicLoad(&shutdown))
+	{
+		// Take back the increment, unless it was claimed already
+		Int32 sleeping = AtomicLoad(&numSleeping);
+		while (sleeping > 0)
+		{
+			const Int32 previous = AtomicCompareExchange(&numSleeping, sleeping - 1, sleeping);
+			if (previous == sleeping)
+				return;
+			sleeping = previous;
+		}
+	}
+
+	wakeUp.Wait();
+}
+
+Job* JobSystem::CreateJob(JobFunction fn, void* data, JobGroup* group)
+{
+	Job* job = new Job;
+	job->fn      = fn;
+	job->rangeFn = nullptr;
+	job->data    = data;
+	job->begin   = job->end = 0;
+	job->group   = group;
+	job->waitCount        = 1;
+	job->numContinuations = 0;
+
+	if (group)
+		AtomicIncrement(&group->pending);
+	return job;
+}
+
+void JobSystem::AddContinuation(Job* job, Job* continuation)
+{
+	if (job->numContinuations == MAX_CONTINUATIONS)
+		throw Exception(Text("Too many continuations in JobSystem::AddContinuation()"));
+
+	AtomicIncrement(&continuation->waitCount);
+	job->continuations[job->numContinuations++] = continuation;
+}
+
+void JobSystem::Submit(Job* job)
+{
+	if (AtomicDecrement(&job->waitCount) == 0)
+		Push(job);
+}
+
+bool JobSystem::RunJob()
+{
+	Job* job = FindJob(GetThreadIndex());
+	if (!job)
+		return false;
+	Execute(job);
+	return true;
+}
+
+void JobSystem::Wait(JobGroup* group)
+{
+	while (!group->IsDone())
+	{
+		if (!RunJob())
+			CPUPause();
+	}
+}
+
+void JobSystem::ParallelFor(UInt32 count, ParallelForFunction fn, void* data,
+							UInt32 minBatchSize, JobGroup* group)
+{
+	if (!count)
+		return;
+
+	// A few ranges per thread, so threads that finish early can steal some
+	UInt32 batchSize = (count + queues.size() * 4 - 1) / (queues.size() * 4);
+	if (batchSize < minBatchSize)
+		batchSize = minBatchSize;
+	if (!batchSize)
+		batchSize = 1;
+
+	if (!group && batchSize >= count)
+	{
+		fn(0, count, data);
+		return;
+	}
+
+	JobGroup localGroup;
+	JobGroup* g = group ? group : &localGroup;
+
+	for (UInt32 begin = 0; begin < count; begin += batchSize)
+	{
+		Job* job = CreateJob(nullptr, data, g);
+		job->rangeFn = fn;
+		job->begin   = begin;
+		job->end     = count - begin > batchSize ? begin + batchSize : count;
+		Submit(job);
+	}
+
+	if (!group)
+		Wait(&localGroup);
+}
+
+MAKO_END_NAMESPACE
@@ -0,0 +1,159 @@
+#pragma once
+#include "MakoCommon.h"
+#include "MakoArrayList.h"
+#include "MakoAtomic.h"
+#include "MakoThread.h"
+
+MAKO_BEGIN_NAMESPACE
+
+//! The function of a job
+typedef void (*JobFunction)(void* data);
+
+//! The function of a JobSystem::ParallelFor(). It's called with ranges
+//! [begin, end) of indices.
+typedef void (*ParallelForFunction)(UInt32 begin, UInt32 end, void* data);
+
+// Forward declarations
+class JobSystem;
+struct Job;
+
+//! Counts the jobs of a group that haven't finished yet. Poll IsDone() to
+//! find out if they are done without blocking, or call JobSystem::Wait().
+class JobGroup
+{
+	friend class JobSystem;
+private:
+	volatile Int32 pending;
+
+	// Not copyable
+	JobGroup(const JobGroup&);
+	JobGroup& operator = (const JobGroup&);
+public:
+	MAKO_INLINE JobGroup()
+	: pending(0) {}
+
+	//! Check if every job of the group finished
+	MAKO_INLINE bool IsDone() const
+	{ return AtomicLoad(&pending) == 0; }
+};
+
+//! Runs jobs on a fixed pool of worker threads. Every thread, the thread that
+//! created the JobSystem included, has it's own queue of jobs. Threads push
+//! the jobs they submit to the bottom of their queue and take jobs from
+//! there too, so the jobs a thread creates run while their data is still in
+//! it's cache. Threads that run out of jobs steal them from the top of the
+//! other threads' queues. Workers that couldn't find any go to sleep until
+//! a job is submitted.
+//!
+//! A job can have continuations, jobs that are submitted as soon as it and
+//! every other job they continue finished.
+class JobSystem
+{
+public:
+	enum
+	{
+		//! The most continuations a job can have
+		MAX_CONTINUATIONS = 8,
+		//! The most jobs a thread's queue can hold. Jobs submitted to a full
+		//! queue run right away.
+		QUEUE_SIZE = 4096
+	};
+private:
+	struct Queue
+	{
+		SpinLock lock;
+		Job* jobs[QUEUE_SIZE];
+		volatile UInt32 top, bottom;
+	};
+
+	struct WorkerStart
+	{
+		JobSystem* js;
+		UInt32 index;
+	};
+
+	//! The queue of each thread, 0 is the thread that created the JobSystem
+	ArrayList<Queue*> queues;
+	ArrayList<Thread*> workers;
+	ArrayList<WorkerStart> workerStarts;
+
+	Semaphore wakeUp;
+	//! Jobs in all queues
+	volatile Int32 numQueued;
+	//! Workers that are going to sleep and weren't woken up yet
+	volatile Int32 numSleeping;
+	volatile Int32 shutdown;
+
+	static void WorkerMain(void* arg);
+
+	//! Get the index of the calling thread's queue
+	UInt32 GetThreadIndex() const;
+
+	void Push(Job* job);
+	Job* Pop(UInt32 thread);
+	Job* Steal(UInt32 thread);
+	Job* FindJob(UInt32 thread);
+	void Execute(Job* job);
+	void WakeWorker();
+	void Sleep();
+public:
+	//! Starts the worker threads.
+	//! \param[in] numWorkers The number of worker threads. 0 starts one less
+	//! than the processors can run at the same time, so that every hardware
+	//! thread runs one thread, the calling thread included.
+	MAKO_API JobSystem(UInt32 numWorkers = 0);
+
+	//! Stops the worker threads. Jobs that are still queued don't run.
+	MAKO_API ~JobSystem();
+
+	//! Creates a job that calls fn(data). The job doesn't run until it's
+	//! passed to Submit().
+	//! \param[in] group If not nullptr, the group counts the job from now on
+	//! until it finished.
+	MAKO_API Job* CreateJob(JobFunction fn, void* data, JobGroup* group = nullptr);
+
+	//! Makes continuation wait for job to finish. It must be called before
+	//! job is submitted. continuation runs after every job it continues
+	//! finished, and after it was submitted itself.
+	MAKO_API void AddContinuation(Job* job, Job* continuation);
+
+	//! Queues a job created by CreateJob(). Jobs are deleted after they ran.
+	MAKO_API void Submit(Job* job);
+
+	//! Runs a queued job on the calling thread, if there is one.
+	//! \return true if a job ran.
+	MAKO_API bool RunJob();
+
+	//! Runs queued jobs on the calling thread until every job of group
+	//! finished. To wait without blocking, poll JobGroup::IsDone() and call
+	//! RunJob() while waiting instead.
+	MAKO_API void Wait(JobGroup* group);
+
+	//! Calls fn for ranges of indices that together cover [0, count), in
+	//! parallel.
+	//! \param[in] minBatchSize The least indices a range has, except for the
+	//! last one. Ranges are made bigger if count is large, so there are only
+	//! a few of them per thread.
+	//! \param[in] group If nullptr, ParallelFor() returns after every range
+	//! was processed. Otherwise it returns right away, and the group counts the
+	//! ranges, so data must stay alive until it's done.
+	MAKO_API void ParallelFor(UInt32 count, ParallelForFunction fn, void* data,
+							  UInt32 minBatchSize = 1, JobGroup* group = nullptr);
+
+	//! Calls f(begin, end) for ranges of indices that together cover
+	//! [0, count), in parallel, and returns when all of them were processed.
+	template <typename F>
+	MAKO_INLINE void ParallelFor(UInt32 count, F& f, UInt32 minBatchSize = 1)
+	{ ParallelFor(count, &CallFunctor<F>, &f, minBatchSize); }
+
+	//! Get the number of threads that run jobs, the thread that created the
+	//! JobSystem included
+	MAKO_INLINE UInt32 GetNumThreads() const
+	{ return queues.size(); }
+private:
+	template <typename F>
+	static void CallFunctor(UInt32 begin, UInt32 end, void* f)
+	{ (*static_cast<F*>(f))(begin, end); }
+};
+
+MAKO_END_NAMESPACE
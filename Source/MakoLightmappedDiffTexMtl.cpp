@@ -52,5 +52,16 @@ void LightmappedDiffTexMtl::Bind(GraphicsDevice* gd) const
 	GetCgShader()->EndEditingParameters();
 }
 
+void LightmappedDiffTexMtl::BindTransform(GraphicsDevice* gd) const
+{
+	GetCgShader()->BeginEditingParameters();
+
+	modelViewProjCgParam->SetValue((gd->GetTransform(TS_PROJECTION) *
+		                            gd->GetTransform(TS_VIEW) *
+									gd->GetTransform(TS_WORLD)).GetTransposed());
+
+	GetCgShader()->EndEditingParameters();
+}
+
 
 MAKO_END_NAMESPACE
\ No newline at end of file
@@ -22,7 +22,11 @@ public:
 	MAKO_INLINE Int32 GetType() const
 	{ return MTLT_LIGHTMAPPED_DIFF_TEX; }
 	
+	MAKO_INLINE Texture* GetTexture() const
+	{ return difftex; }
+
 	MAKO_API void Bind(GraphicsDevice* gd) const;
+	MAKO_API void BindTransform(GraphicsDevice* gd) const;
 };
 
 MAKO_END_NAMESPACE
\ No newline at end of file
@@ -16,7 +16,7 @@ public:
 	//! file extensions are not case-sensitive, it is
 	//! a precondition that ext is in all lower-case.
 	//! Example of an extension given: "jpg".
-	virtual bool IsLoadableFileExt(const String& ext) const = 0;
+	virtual bool IsLoadableFileExt(const StringView& ext) const = 0;
 };
 
 MAKO_END_NAMESPACE
\ No newline at end of file
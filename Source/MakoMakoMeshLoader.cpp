@@ -7,6 +7,9 @@
 #include "MakoString.h"
 #include "MakoStandardVertex.h"
 #include "MakoT2Vertex.h"
+#include "MakoVertexWelder.h"
+#include "MakoMeshManipulator.h"
+#include "MakoIndexedMeshData.h"
 #include "Makomath.h"
 #include "MakoApplication.h"
 #include "MakoGraphicsDevice.h"
@@ -14,34 +17,44 @@
 #include "MakoDiffTexMtl.h"
 #include "MakoOSDevice.h"
 #include "MakoStream.h"
+#include "MakoBufferedStream.h"
 #include "MakoFileSystem.h"
+#include "MakoMeshCache.h"
+#include "MakoDecodedMesh.h"
+#include "MakoMesh.h"
 #include "makomeshtypes.h"
+#include "MakoAllocator.h"
 
 MAKO_BEGIN_NAMESPACE
 
-Mesh* MakoMeshLoader::Load(InputStream* stream)
+bool MakoMeshLoader::Decode(InputStream* source, DecodedMesh& mesh)
 {
-	SimpleMesh* mesh = new SimpleMesh;
+	BufferedInputStream in(source);
 
 	MakoMeshHeader mh;
-	stream->Read(mh);
+	in.Read(mh);
 	
 	ArrayList<String> strtable(mh.numStrings);
-	ArrayList<Texture*> texturesLoaded(mh.numStrings);
-	memset(&texturesLoaded[0], 0, sizeof(Texture*) * texturesLoaded.size());
+	// The index of every string in mesh.texturePaths, once a material uses it
+	const UInt32 unused = 0xFFFFFFFF;
+	ArrayList<UInt32> textureIndices(mh.numStrings, unused);
 
 	for (UInt i = 0; i < mh.numStrings; ++i)
-		stream->Read(strtable[i]);
+		in.Read(strtable[i]);
+
+	mesh.subMeshes.reserve(mh.numSubMeshes);
 
 	for (UInt iSubMesh = 0; iSubMesh < mh.numSubMeshes; ++iSubMesh)
 	{
 		MakoSubMeshHeader smh;
-		stream->Read(smh);
+		in.Read(smh);
 
-		IndexedMeshDataCreationParams p;
+		mesh.subMeshes.push_back(DecodedSubMesh());
+		DecodedSubMesh& sm = mesh.subMeshes.back();
+		IndexedMeshDataCreationParams& p = sm.params;
 
 		ArrayList<Pos3d> vertPositions(smh.numVerts);
-		ArrayList<UInt16>   indices(smh.numFaces*3);
+		ArrayList<UInt32> indices(smh.numFaces*3);
 
 		if (indices.size() % 3 != 0)
 		{
@@ -51,91 +64,91 @@ Mesh* MakoMeshLoader::Load(InputStream* stream)
 
 		// Load the number of texcoords in every channel
 		UInt32 totalNumTCoordVerts;
-		stream->Read(totalNumTCoordVerts);
+		in.Read(totalNumTCoordVerts);
 
 		ArrayList<Vec2df> tcoords(totalNumTCoordVerts);
 
 		// Load vertspos
-		stream->ReadTo(&vertPositions[0], sizeof(Pos3d) * vertPositions.size());
+		in.ReadSpan(&vertPositions[0], vertPositions.size());
 
 		// Load texcoords
-		stream->ReadTo(&tcoords[0], sizeof(TCoord) * tcoords.size());
+		in.ReadSpan(&tcoords[0], tcoords.size());
 
+		// Faces share vertices that are equal in every channel, so the index
+		// buffer really indexes instead of just numbering the vertices.
 		ArrayList<StandardVertex> sverts;
 		ArrayList<T2Vertex> t2verts;
+		VertexWelder<StandardVertex> sweld(sverts, smh.numFaces*3);
+		VertexWelder<T2Vertex> t2weld(t2verts, smh.numTCoordChannels == 2 ? smh.numFaces*3 : 0);
+		UInt32 v1, v2, v3;
+		UInt32 posi, posi2, posi3;
+		// The texcoord indices of a face only take a few bytes, so they come
+		// from the pools instead of the heap
+		ArrayList<UInt32, PoolAllocator<UInt32, MC_MESH> > texci(smh.numTCoordChannels),
+			texci2(smh.numTCoordChannels), texci3(smh.numTCoordChannels);
 
 		UInt32 indicesCount = 0;
 		// Parse faces, generate indices/sverts from them.
 		for (UInt iFace = 0; iFace < smh.numFaces; ++iFace)
 		{
 			UInt8 entrytype;
-			stream->Read(entrytype);
+			in.Read(entrytype);
 			switch (entrytype)
 			{
 			case MMET_DIFFTEXTURE:
 				{
-					FilePath fp;
-					UInt32 texfpIndex = stream->Read32BitUInt();
-					if (texturesLoaded[texfpIndex])
-					{
-						p.materials[indicesCount/3] = new DiffTexMtl(texturesLoaded[texfpIndex]);
-					}
-					else if (!(fp = APP()->FS()->FindFile(strtable[texfpIndex])).GetAbs().IsEmpty())
-					{
-						texturesLoaded[texfpIndex] = APP()->GD()->LoadTextureFromFile(fp);
-						p.materials[indicesCount/3] = new DiffTexMtl(texturesLoaded[texfpIndex]);
-					}
-					else
+					UInt32 texfpIndex = in.Read32BitUInt();
+					if (texfpIndex >= mh.numStrings)
+						throw Exception(Text("There was an error in the Mako Mesh loader."));
+
+					// Textures are loaded once, no matter how many materials use them
+					if (textureIndices[texfpIndex] == unused)
 					{
-						APP()->GetConsole()->Log(LL_MEDIUM, Text("Failed to load texture (") + strtable[texfpIndex] + Text(") in MakoMeshLoader::Load()"));
+						textureIndices[texfpIndex] = mesh.texturePaths.size();
+						mesh.texturePaths.push_back(strtable[texfpIndex]);
 					}
+					sm.textures[indicesCount/3] = textureIndices[texfpIndex];
 
 					--iFace; // doesn't count as a face.
 					break;
 				}
 			case MMET_FACE:
 				{
-					UInt32 posi, posi2, posi3;
-					ArrayList<UInt32> texci(smh.numTCoordChannels), texci2(smh.numTCoordChannels),
-					               texci3(smh.numTCoordChannels);
-
-					stream->Read(posi);
+					in.Read(posi);
 					for (UInt channel = 0; channel < smh.numTCoordChannels; ++channel)
-						stream->Read(texci[channel]);
+						in.Read(texci[channel]);
 
-					stream->Read(posi2);
+					in.Read(posi2);
 					for (UInt channel = 0; channel < smh.numTCoordChannels; ++channel)
-						stream->Read(texci2[channel]);
+						in.Read(texci2[channel]);
 
-					stream->Read(posi3);
+					in.Read(posi3);
 					for (UInt channel = 0; channel < smh.numTCoordChannels; ++channel)
-						stream->Read(texci3[channel]);
+						in.Read(texci3[channel]);
 
 					switch (smh.numTCoordChannels)
 					{
 					case 0:
-						sverts.push_back(StandardVertex(vertPositions[posi],  0.f));
-						sverts.push_back(StandardVertex(vertPositions[posi2], 0.f));
-						sverts.push_back(StandardVertex(vertPositions[posi3], 0.f));
+						v1 = sweld.Add(StandardVertex(vertPositions[posi],  0.f));
+						v2 = sweld.Add(StandardVertex(vertPositions[posi2], 0.f));
+						v3 = sweld.Add(StandardVertex(vertPositions[posi3], 0.f));
 						break;
 					case 1:
-						sverts.push_back(StandardVertex(vertPositions[posi],  tcoords[texci[0]]));
-						sverts.push_back(StandardVertex(vertPositions[posi2], tcoords[texci2[0]]));
-						sverts.push_back(StandardVertex(vertPositions[posi3], tcoords[texci3[0]]));
+						v1 = sweld.Add(StandardVertex(vertPositions[posi],  tcoords[texci[0]]));
+						v2 = sweld.Add(StandardVertex(vertPositions[posi2], tcoords[texci2[0]]));
+						v3 = sweld.Add(StandardVertex(vertPositions[posi3], tcoords[texci3[0]]));
 						break;
 					case 2:
-						t2verts.push_back(T2Vertex(vertPositions[posi],  tcoords[texci[0]],  tcoords[texci[1]]));
-						t2verts.push_back(T2Vertex(vertPositions[posi2], tcoords[texci2[0]], tcoords[texci2[1]]));
-						t2verts.push_back(T2Vertex(vertPositions[posi3], tcoords[texci3[0]], tcoords[texci3[1]]));
+						v1 = t2weld.Add(T2Vertex(vertPositions[posi],  tcoords[texci[0]],  tcoords[texci[1]]));
+						v2 = t2weld.Add(T2Vertex(vertPositions[posi2], tcoords[texci2[0]], tcoords[texci2[1]]));
+						v3 = t2weld.Add(T2Vertex(vertPositions[posi3], tcoords[texci3[0]], tcoords[texci3[1]]));
 						break;
 					}
 
-					indices[indicesCount] = indicesCount + 2;
-					++indicesCount;
-					indices[indicesCount] = indicesCount + 0;
-					++indicesCount;
-					indices[indicesCount] = indicesCount - 2;
-					++indicesCount;
+					// The winding order is flipped
+					indices[indicesCount++] = v3;
+					indices[indicesCount++] = v2;
+					indices[indicesCount++] = v1;
 					break;
 				}
 			}
@@ -146,25 +159,60 @@ Mesh* MakoMeshLoader::Load(InputStream* stream)
 		if (smh.numTCoordChannels == 1 || smh.numTCoordChannels == 0)
 		{
 			p.numVertices = sverts.size();
-			p.vertices = static_cast<void*>(&sverts[0]);
 			p.vertexType = VT_STANDARD;
+			sm.vertices.assign(reinterpret_cast<const UInt8*>(&sverts[0]),
+			                   reinterpret_cast<const UInt8*>(&sverts[0] + sverts.size()));
 		}
 		else if (smh.numTCoordChannels == 2)
 		{
 			p.numVertices = t2verts.size();
-			p.vertices = static_cast<void*>(&t2verts[0]);
 			p.vertexType = VT_T2;
+			sm.vertices.assign(reinterpret_cast<const UInt8*>(&t2verts[0]),
+			                   reinterpret_cast<const UInt8*>(&t2verts[0] + t2verts.size()));
 		}
 		p.primitiveType = PT_TRIANGLELIST;
-		p.vertBufferIndexType  = VBIT_16;
-		p.vertBufferIndices = static_cast<void*>(&indices[0]);
-		if (p.materials.size() == 0)
-			p.materials[0] = APP()->GD()->GetDefaultMaterial();
 
-		mesh->AddSubMesh(APP()->GetGraphicsDevice()->CreateIndexedMeshData(p));
+		// 16 bit indices are enough unless there are more vertices than they
+		// can address
+		if (p.numVertices <= 0xFFFF)
+		{
+			ArrayList<UInt16, PoolAllocator<UInt16, MC_MESH> > indices16;
+			indices16.assign(indices.begin(), indices.end());
+			p.vertBufferIndexType = VBIT_16;
+			sm.indices.assign(reinterpret_cast<const UInt8*>(&indices16[0]),
+			                  reinterpret_cast<const UInt8*>(&indices16[0] + indices16.size()));
+		}
+		else
+		{
+			p.vertBufferIndexType = VBIT_32;
+			sm.indices.assign(reinterpret_cast<const UInt8*>(&indices[0]),
+			                  reinterpret_cast<const UInt8*>(&indices[0] + indices.size()));
+		}
+		if (sm.textures.empty())
+			sm.textures[0] = DecodedSubMesh::DEFAULT_MATERIAL;
+
+		// Reorder the triangles for the post-transform cache once, here
+		if (!sm.vertices.empty() && !sm.indices.empty())
+		{
+			ArrayList<UInt32> rangeStarts;
+			typedef Map<UInt32, UInt32>::const_iterator TexturesIt;
+			for (TexturesIt it = sm.textures.begin(); it != sm.textures.end(); ++it)
+				rangeStarts.push_back((*it).first);
+
+			APP()->GetMeshManipulator()->OptimizeTriangleList(&sm.vertices[0], p.numVertices,
+				p.vertexType, &sm.indices[0], p.numVertBufferIndices, p.vertBufferIndexType,
+				rangeStarts);
+		}
 	}
 
-	return mesh;
+	return true;
+}
+
+Mesh* MakoMeshLoader::Load(InputStream* source, ArrayList<MeshCacheSubMesh>* cacheSubMeshes)
+{
+	DecodedMesh decoded;
+	Decode(source, decoded);
+	return LoadDecodedMesh(decoded, cacheSubMeshes);
 }
 
 MAKO_END_NAMESPACE
\ No newline at end of file
@@ -10,15 +10,25 @@ class Application;
 // Meshloader capable of loading obj meshes.
 class MakoMeshLoader : public MeshLoader
 {
+private:
+	//! \param[out] cacheSubMeshes If not nullptr, receives a MeshCacheSubMesh
+	//! for every sub mesh.
+	Mesh* Load(InputStream* stream, ArrayList<MeshCacheSubMesh>* cacheSubMeshes);
 public:
 	MAKO_INLINE MakoMeshLoader() {}
 	MAKO_INLINE ~MakoMeshLoader() {}
 
-	bool IsLoadableFileExt(const String& ext) const
+	bool IsLoadableFileExt(const StringView& ext) const
 	{ return ext == Text("makomesh"); }
 
 	// Loads a wavefront mesh from file
-	virtual Mesh* Load(InputStream* stream);
+	MAKO_INLINE Mesh* Load(InputStream* stream)
+	{ return Load(stream, nullptr); }
+
+	MAKO_INLINE Mesh* LoadForMeshCache(InputStream* stream, ArrayList<MeshCacheSubMesh>& subMeshes)
+	{ return Load(stream, &subMeshes); }
+
+	bool Decode(InputStream* stream, DecodedMesh& mesh);
 };
 
 MAKO_END_NAMESPACE
\ No newline at end of file
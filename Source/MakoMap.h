@@ -87,12 +87,15 @@ MAKO_BEGIN_NAMESPACE
 //! This container, as well as other Mako containers, are identical to their inherited stl classes.
 //! To find documentation on methods and more, look up these stl classes.
 //! When C++0x is released, this will be a typedef instead
-template <typename Key, typename T, typename Compare = std::less<Key> >
-class Map : public std::map<Key, T, Compare>
+//!
+//! Like ArrayList, Map takes an allocator, which is std::allocator by default.
+template <typename Key, typename T, typename Compare = std::less<Key>,
+          typename A = std::allocator<std::pair<const Key, T> > >
+class Map : public std::map<Key, T, Compare, A>
 {
 public:
 	MAKO_INLINE Map() {}
-	MAKO_INLINE Map(const Map<Key, T, Compare>& map) : std::map<Key, T, Compare>(map) {}
+	MAKO_INLINE Map(const Map<Key, T, Compare, A>& map) : std::map<Key, T, Compare, A>(map) {}
 	MAKO_INLINE ~Map() {}
 };
 
@@ -0,0 +1,86 @@
+#include "MakoMappedFile.h"
+#include "MakoOS.h"
+#include "MakoException.h"
+#if MAKO_PLATFORM != MAKO_PLATFORM_WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MAKO_BEGIN_NAMESPACE
+
+#if MAKO_PLATFORM == MAKO_PLATFORM_WIN32
+
+MappedFile::MappedFile(const FilePath& filePath)
+: data(nullptr), size(0), fileHandle(INVALID_HANDLE_VALUE), mappingHandle(nullptr)
+{
+	fileHandle = CreateFileW(filePath.GetAbs().ToWStringData(), GENERIC_READ, FILE_SHARE_READ,
+	                         nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+		throw Exception(Text("Failed to open [") + filePath.GetAbs() + Text("] in MappedFile::MappedFile()"));
+
+	size = GetFileSize(fileHandle, nullptr);
+
+	// Empty files can't be mapped
+	if (!size)
+		return;
+
+	mappingHandle = CreateFileMappingW(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mappingHandle)
+		data = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+
+	if (!data)
+	{
+		if (mappingHandle)
+			CloseHandle(mappingHandle);
+		CloseHandle(fileHandle);
+		throw Exception(Text("Failed to map [") + filePath.GetAbs() + Text("] in MappedFile::MappedFile()"));
+	}
+}
+
+MappedFile::~MappedFile()
+{
+	if (data)
+		UnmapViewOfFile(data);
+	if (mappingHandle)
+		CloseHandle(mappingHandle);
+	CloseHandle(fileHandle);
+}
+
+#else
+
+MappedFile::MappedFile(const FilePath& filePath)
+: data(nullptr), size(0), fd(-1)
+{
+	fd = open(filePath.GetAbs().ToASCII(), O_RDONLY);
+	if (fd == -1)
+		throw Exception(Text("Failed to open [") + filePath.GetAbs() + Text("] in MappedFile::MappedFile()"));
+
+	struct stat st;
+	if (fstat(fd, &st) == 0)
+		size = (UInt32)st.st_size;
+
+	// Empty files can't be mapped
+	if (!size)
+		return;
+
+	void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (mapped == MAP_FAILED)
+	{
+		close(fd);
+		throw Exception(Text("Failed to map [") + filePath.GetAbs() + Text("] in MappedFile::MappedFile()"));
+	}
+	data = mapped;
+}
+
+MappedFile::~MappedFile()
+{
+	if (data)
+		munmap(const_cast<void*>(data), size);
+	close(fd);
+}
+
+#endif
+
+MAKO_END_NAMESPACE
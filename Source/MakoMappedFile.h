@@ -0,0 +1,39 @@
+#pragma once
+#include "MakoCommon.h"
+#include "MakoFilePath.h"
+
+MAKO_BEGIN_NAMESPACE
+
+//! Maps a whole file into memory for reading. The operating system pages
+//! the file in as it's accessed, so nothing is copied or read up front.
+//! The data stays valid until the MappedFile is destroyed.
+class MappedFile
+{
+private:
+	const void* data;
+	UInt32 size;
+#if MAKO_PLATFORM == MAKO_PLATFORM_WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#else
+	int fd;
+#endif
+
+	// Not copyable
+	MappedFile(const MappedFile&);
+	MappedFile& operator = (const MappedFile&);
+public:
+	//! Maps the file at filePath. Throws an Exception if it can't be opened.
+	MAKO_API MappedFile(const FilePath& filePath);
+	MAKO_API ~MappedFile();
+
+	//! Get the contents of the file
+	MAKO_INLINE const void* GetData() const
+	{ return data; }
+
+	//! Get the size of the file in bytes
+	MAKO_INLINE UInt32 GetSize() const
+	{ return size; }
+};
+
+MAKO_END_NAMESPACE
@@ -0,0 +1,7 @@
+#include "MakoMaterial.h"
+
+MAKO_BEGIN_NAMESPACE
+
+MAKO_DEFINE_OBJECT_POOL(Material)
+
+MAKO_END_NAMESPACE
@@ -1,7 +1,7 @@
 #pragma once
 
 #include "MakoCommon.h"
-#include "MakoReferenceCounted.h"
+#include "MakoObjectPool.h"
 
 MAKO_BEGIN_NAMESPACE
 
@@ -23,16 +23,43 @@ enum MATERAL_TYPE
 
 class Texture;
 class GraphicsDevice;
+class CgShader;
 
 //! This class defines how something is drawn. For instance,
 //! there is a material that draws things with a texture. Inside
 //! each implementation of Material contains contains 
-class Material : public ReferenceCounted
+//! Materials are allocated from the pool GetPool() returns.
+class Material : public PooledObject<Material>
 {
 public:
+	//! Get the pool every Material is allocated from
+	MAKO_API static ObjectPool& GetPool();
+
 	virtual void Bind(GraphicsDevice* gd) const = 0;
 	virtual void UnBind(GraphicsDevice* gd) const {}
 	virtual Int32 GetType() const = 0;
+
+	//! Called instead of Bind() when the material is still bound, but the
+	//! TS_WORLD transformation changed. By default it binds the whole
+	//! material again; materials that can update only their transformations
+	//! override it to do that.
+	virtual void BindTransform(GraphicsDevice* gd) const
+	{ Bind(gd); }
+
+	//! Whether the material blends with what's behind it. Translucent draw
+	//! calls are drawn after every opaque one, back to front.
+	virtual bool IsTranslucent() const
+	{ return false; }
+
+	//! Get the shader the material binds, if any. Draw calls are sorted by it,
+	//! and materials of the same type and shader don't have to be unbound
+	//! before binding the next one, since Bind() sets all of it's state.
+	virtual CgShader* GetCgShader() const
+	{ return nullptr; }
+
+	//! Get the main texture the material binds, if any. Draw calls are sorted by it.
+	virtual Texture* GetTexture() const
+	{ return nullptr; }
 };
 
 MAKO_END_NAMESPACE
\ No newline at end of file
@@ -309,13 +309,19 @@ MAKO_INLINE const Int8* fast_atof_move(const Int8* in, Float32 & out)
 	{
 		++in;
 
-		const char * afterDecimal = in;
-		Float32 decimal = strtof10 ( in, &afterDecimal );
-		decimal *= fast_atof_table[afterDecimal - in];
-
-		value += decimal;
+		// The table only scales up to 15 digits, and a Float32 can't hold
+		// more than that anyway, so the rest are skipped
+		Int8 digits[16];
+		UInt32 numDigits = 0;
+		while ( ( *in >= '0') && ( *in <= '9' ) )
+		{
+			if (numDigits < 15)
+				digits[numDigits++] = *in;
+			++in;
+		}
+		digits[numDigits] = '\0';
 
-		in = afterDecimal;
+		value += strtof10 ( digits ) * fast_atof_table[numDigits];
 	}
 
 	if ('e' == *in || 'E' == *in)
@@ -3,6 +3,7 @@
 #include "MakoVec3d.h"
 #include "MakoVec2d.h"
 #include "MakoMath.h"
+#include "MakoSIMD.h"
 
 MAKO_BEGIN_NAMESPACE
 
@@ -172,6 +173,14 @@ public:
 	//! An alternate transform vector method, writing into an array of 4 floats
 	void TransformVect(T *out,const Vec3df &in) const;
 
+	//! Transforms count vectors by this matrix, as TransformVect(Vec3df&, const Vec3df&)
+	//! does. out may be in.
+	void TransformVects(Vec3df* out, const Vec3df* in, UInt32 count) const;
+
+	//! Transforms count vectors by this matrix into an array of count*4 Ts, as
+	//! TransformVect(T*, const Vec3df&) does.
+	void TransformVects(T* out, const Vec3df* in, UInt32 count) const;
+
 	//! Translate a vector by the translation part of this matrix.
 	void TranslateVect(Vec3df& vect) const;
 
@@ -191,6 +200,14 @@ public:
 	//! \return Returns false if there is no inverse matrix.
 	bool GetInverse(Matrix4<T>& out) const;
 
+	//! Sets out[i] to a[i] * b[i], for every i below count. Like SetByproductNoCheck(),
+	//! this doesn't check whether the matrices are identity matrices.
+	static void MultiplyBatch(Matrix4<T>* out, const Matrix4<T>* a, const Matrix4<T>* b, UInt32 count);
+
+	//! Sets out[i] to a * b[i], for every i below count. Useful for multiplying
+	//! many world matrices with the same view-projection matrix.
+	static void MultiplyBatch(Matrix4<T>* out, const Matrix4<T>& a, const Matrix4<T>* b, UInt32 count);
+
 	//! Builds a right-handed perspective projection matrix based on a field of view
 	Matrix4<T>& BuildProjectionMatrixPerspectiveFovRH(Float32 fieldOfViewRadians, Float32 aspectRatio, Float32 zNear, Float32 zFar);
 
@@ -884,6 +901,34 @@ MAKO_INLINE void Matrix4<T>::TransformVect(T *out, const Vec3df &in) const
 }
 
 
+template <typename T>
+MAKO_INLINE void Matrix4<T>::TransformVects(Vec3df* out, const Vec3df* in, UInt32 count) const
+{
+	for (UInt32 i = 0; i < count; ++i)
+		TransformVect(out[i], in[i]);
+}
+
+template <typename T>
+MAKO_INLINE void Matrix4<T>::TransformVects(T* out, const Vec3df* in, UInt32 count) const
+{
+	for (UInt32 i = 0; i < count; ++i)
+		TransformVect(&out[i*4], in[i]);
+}
+
+template <typename T>
+MAKO_INLINE void Matrix4<T>::MultiplyBatch(Matrix4<T>* out, const Matrix4<T>* a, const Matrix4<T>* b, UInt32 count)
+{
+	for (UInt32 i = 0; i < count; ++i)
+		out[i].SetByproductNoCheck(a[i], b[i]);
+}
+
+template <typename T>
+MAKO_INLINE void Matrix4<T>::MultiplyBatch(Matrix4<T>* out, const Matrix4<T>& a, const Matrix4<T>* b, UInt32 count)
+{
+	for (UInt32 i = 0; i < count; ++i)
+		out[i].SetByproductNoCheck(a, b[i]);
+}
+
 //! Multiplies this matrix by a 1x4 matrix
 template <typename T>
 MAKO_INLINE void Matrix4<T>::MultiplyWith1x4Matrix(T* matrix) const
@@ -1550,6 +1595,101 @@ MAKO_INLINE Matrix4<T> operator*(const T scalar, const Matrix4<T>& mat)
 { return mat*scalar; }
 
 
+/////////////////////////////////////////////////////////////////
+// Float32 specializations, which use the kernels of MakoSIMD.h
+
+#ifdef MAKO_SSE_AVAILABLE
+template <>
+MAKO_INLINE Matrix4<Float32>& Matrix4<Float32>::SetByproductNoCheck(const Matrix4<Float32>& other_a, const Matrix4<Float32>& other_b)
+{
+	if (GetSIMDLevel() != SL_SCALAR)
+		Matrix4fMultiplySSE(M, other_a.M, other_b.M);
+	else
+		Matrix4fMultiplyScalar(M, other_a.M, other_b.M);
+	definitelyIdentityMatrix = false;
+	return *this;
+}
+
+template <>
+MAKO_INLINE Matrix4<Float32> Matrix4<Float32>::operator * (const Matrix4<Float32>& m2) const
+{
+	if (this->IsIdentity())
+		return m2;
+	if (m2.IsIdentity())
+		return *this;
+
+	Matrix4<Float32> m3(CS_NOTHING);
+	m3.SetByproductNoCheck(*this, m2);
+	return m3;
+}
+
+template <>
+MAKO_INLINE void Matrix4<Float32>::TransformVect(Float32* out, const Vec3df& in) const
+{
+	if (GetSIMDLevel() != SL_SCALAR)
+	{
+		_mm_storeu_ps(out, Matrix4fTransformSSE(M, in.x, in.y, in.z));
+	}
+	else
+	{
+		out[0] = in.x*M[0] + in.y*M[4] + in.z*M[8] + M[12];
+		out[1] = in.x*M[1] + in.y*M[5] + in.z*M[9] + M[13];
+		out[2] = in.x*M[2] + in.y*M[6] + in.z*M[10] + M[14];
+		out[3] = in.x*M[3] + in.y*M[7] + in.z*M[11] + M[15];
+	}
+}
+
+template <>
+MAKO_INLINE bool Matrix4<Float32>::GetInverse(Matrix4<Float32>& out) const
+{
+	if (this->IsIdentity())
+	{
+		out=*this;
+		return true;
+	}
+
+	if (GetSIMDLevel() != SL_SCALAR ? !Matrix4fInverseSSE(out.M, M) : !Matrix4fInverseScalar(out.M, M))
+		return false;
+
+	out.definitelyIdentityMatrix = definitelyIdentityMatrix;
+	return true;
+}
+#endif
+
+template <>
+MAKO_INLINE void Matrix4<Float32>::TransformVects(Vec3df* out, const Vec3df* in, UInt32 count) const
+{ Matrix4fTransformBatch(&out->x, 3, M, &in->x, count); }
+
+template <>
+MAKO_INLINE void Matrix4<Float32>::TransformVects(Float32* out, const Vec3df* in, UInt32 count) const
+{ Matrix4fTransformBatch(out, 4, M, &in->x, count); }
+
+template <>
+MAKO_INLINE void Matrix4<Float32>::MultiplyBatch(Matrix4<Float32>* out, const Matrix4<Float32>* a,
+												  const Matrix4<Float32>* b, UInt32 count)
+{
+	if (!count)
+		return;
+
+	Matrix4fMultiplyBatch(out->M, sizeof(Matrix4<Float32>), a->M, sizeof(Matrix4<Float32>),
+						  b->M, sizeof(Matrix4<Float32>), count);
+	for (UInt32 i = 0; i < count; ++i)
+		out[i].definitelyIdentityMatrix = false;
+}
+
+template <>
+MAKO_INLINE void Matrix4<Float32>::MultiplyBatch(Matrix4<Float32>* out, const Matrix4<Float32>& a,
+												  const Matrix4<Float32>* b, UInt32 count)
+{
+	if (!count)
+		return;
+
+	Matrix4fMultiplyBatch(out->M, sizeof(Matrix4<Float32>), a.M, 0,
+						  b->M, sizeof(Matrix4<Float32>), count);
+	for (UInt32 i = 0; i < count; ++i)
+		out[i].definitelyIdentityMatrix = false;
+}
+
 //! Typedef for Float32 matrix
 typedef Matrix4<Float32> Matrix4f;
 
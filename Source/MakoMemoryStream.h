@@ -25,8 +25,11 @@ public:
 	MAKO_INLINE void ReadTo(void* buffer, UInt32 cBytes)
 	{ memcpy(buffer, data, cBytes); data += cBytes; }
 
+	MAKO_INLINE bool IsSeekable() const
+	{ return true; }
+
 	MAKO_INLINE UInt32 Tell() const
-	{ return origPtr - data; }
+	{ return data - origPtr; }
 
 	MAKO_INLINE void Seek(UInt32 byte)
 	{ data = (origPtr + byte); }
@@ -0,0 +1,139 @@
+#include "MakoMeshCache.h"
+#include "MakoMeshData.h"
+#include "MakoIndexedMeshData.h"
+#include "MakoStream.h"
+#include <string.h>
+
+MAKO_BEGIN_NAMESPACE
+
+static MAKO_INLINE UInt32 AlignUp(UInt32 offset, UInt32 alignment)
+{ return (offset + alignment - 1) & ~(alignment - 1); }
+
+void WriteMeshCache(const ArrayList<MeshCacheSubMesh>& subMeshes, OutputStream* stream)
+{
+	typedef Map<UInt32, Material*>::const_iterator SubMtlsIt;
+
+	// The string table, without duplicates
+	ArrayList<String> strings;
+	ArrayList<MeshCacheMaterial> materials;
+	ArrayList<MeshCacheSubMeshHeader> smhs(subMeshes.size());
+
+	for (UInt32 i = 0; i < subMeshes.size(); ++i)
+	{
+		const MeshData* mb = subMeshes[i].mb;
+		const Map<UInt32, Material*>& submats = mb->GetSubMaterials();
+
+		smhs[i].numMaterials = submats.size();
+		for (SubMtlsIt it = submats.begin(); it != submats.end(); ++it)
+		{
+			MeshCacheMaterial mtl;
+			mtl.firstPrimitive = (*it).first;
+			mtl.type           = MCMT_DEFAULT;
+			mtl.texture        = 0;
+
+			Map<UInt32, String>::const_iterator tex = subMeshes[i].textures.find((*it).first);
+			if (tex != subMeshes[i].textures.end())
+			{
+				mtl.type = MCMT_DIFF_TEX;
+				for (mtl.texture = 0; mtl.texture < strings.size(); ++mtl.texture)
+					if (strings[mtl.texture] == (*tex).second)
+						break;
+				if (mtl.texture == strings.size())
+					strings.push_back((*tex).second);
+			}
+
+			materials.push_back(mtl);
+		}
+	}
+
+	// Lay out the file
+	MeshCacheHeader h;
+	h.magic           = MESH_CACHE_MAGIC;
+	h.version         = MESH_CACHE_VERSION;
+	h.numSubMeshes    = subMeshes.size();
+	h.subMeshesOffset = sizeof(MeshCacheHeader);
+	h.numStrings      = strings.size();
+
+	UInt32 offset = h.subMeshesOffset + sizeof(MeshCacheSubMeshHeader) * h.numSubMeshes;
+	for (UInt32 i = 0; i < subMeshes.size(); ++i)
+	{
+		smhs[i].materialsOffset = offset;
+		offset += sizeof(MeshCacheMaterial) * smhs[i].numMaterials;
+	}
+
+	h.stringsOffset = offset;
+	ArrayList<UInt32> stringOffsets(strings.size());
+	offset += sizeof(UInt32) * strings.size();
+	for (UInt32 i = 0; i < strings.size(); ++i)
+	{
+		stringOffsets[i] = offset;
+		offset += sizeof(StringChar) * (strings[i].GetLength() + 1);
+	}
+
+	for (UInt32 i = 0; i < subMeshes.size(); ++i)
+	{
+		const MeshData* mb = subMeshes[i].mb;
+		MeshCacheSubMeshHeader& smh = smhs[i];
+
+		smh.vertexType     = mb->GetVertexType();
+		smh.numVertices    = mb->GetNumVertices();
+		smh.primitiveType  = mb->GetPrimitiveType();
+		smh.numPrimitives  = mb->GetNumPrimitives();
+		smh.verticesOffset = offset = AlignUp(offset, MESH_CACHE_ALIGNMENT);
+		offset += smh.vertexType * smh.numVertices;
+
+		if (mb->IsIndexed())
+		{
+			const IndexedMeshData* imb = static_cast<const IndexedMeshData*>(mb);
+			smh.indexType  = imb->GetVertexBufferIndexType();
+			smh.numIndices = imb->GetNumVertexBufferIndices();
+		}
+		else
+		{
+			smh.indexType  = VBIT_16;
+			smh.numIndices = 0;
+		}
+		smh.indicesOffset = offset = AlignUp(offset, MESH_CACHE_ALIGNMENT);
+		offset += smh.indexType * smh.numIndices;
+
+		const AABBox3df& box = mb->GetBoundingBox();
+		const Sphere3df& sphere = mb->GetBoundingSphere();
+		smh.boxMin[0] = box.minEdge.x; smh.boxMin[1] = box.minEdge.y; smh.boxMin[2] = box.minEdge.z;
+		smh.boxMax[0] = box.maxEdge.x; smh.boxMax[1] = box.maxEdge.y; smh.boxMax[2] = box.maxEdge.z;
+		smh.sphereCenter[0] = sphere.center.x;
+		smh.sphereCenter[1] = sphere.center.y;
+		smh.sphereCenter[2] = sphere.center.z;
+		smh.sphereRadius    = sphere.radius;
+	}
+	h.fileSize = offset;
+
+	// Copy everything into place, so the file is written at once
+	ArrayList<UInt8> file(h.fileSize, 0);
+	memcpy(&file[0], &h, sizeof(h));
+	if (h.numSubMeshes)
+		memcpy(&file[h.subMeshesOffset], &smhs[0], sizeof(MeshCacheSubMeshHeader) * h.numSubMeshes);
+	if (!materials.empty())
+		memcpy(&file[smhs[0].materialsOffset], &materials[0], sizeof(MeshCacheMaterial) * materials.size());
+	if (h.numStrings)
+		memcpy(&file[h.stringsOffset], &stringOffsets[0], sizeof(UInt32) * h.numStrings);
+	for (UInt32 i = 0; i < strings.size(); ++i)
+	{
+		// The data of empty strings is nullptr
+		if (strings[i].GetLength())
+			memcpy(&file[stringOffsets[i]], strings[i].GetData(), sizeof(StringChar) * strings[i].GetLength());
+	}
+
+	for (UInt32 i = 0; i < subMeshes.size(); ++i)
+	{
+		const MeshData* mb = subMeshes[i].mb;
+		memcpy(&file[smhs[i].verticesOffset], mb->GetVertices(), smhs[i].vertexType * smhs[i].numVertices);
+		if (smhs[i].numIndices)
+			memcpy(&file[smhs[i].indicesOffset],
+			       static_cast<const IndexedMeshData*>(mb)->GetVertexBufferIndices(),
+			       smhs[i].indexType * smhs[i].numIndices);
+	}
+
+	stream->WriteData(&file[0], file.size());
+}
+
+MAKO_END_NAMESPACE
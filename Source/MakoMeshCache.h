@@ -0,0 +1,114 @@
+#pragma once
+#include "MakoCommon.h"
+#include "MakoArrayList.h"
+#include "MakoMap.h"
+#include "MakoString.h"
+
+MAKO_BEGIN_NAMESPACE
+
+// Forward declarations
+class MeshData;
+class OutputStream;
+
+//! A mesh cache is a precompiled mesh, laid out so that loading it is one file
+//! map followed by creating the MeshDatas from pointers into the mapped bytes.
+//! The file is made of, in this order:
+//!
+//! - a MeshCacheHeader
+//! - a MeshCacheSubMeshHeader for every sub mesh
+//! - the MeshCacheMaterials of every sub mesh
+//! - the string table: an offset for every string, followed by the strings
+//!   themselves as '\0' terminated StringChars
+//! - the vertices and indices of every sub mesh, each starting at a multiple
+//!   of MESH_CACHE_ALIGNMENT
+//!
+//! All offsets are in bytes from the start of the file. Mesh caches are made by
+//! GraphicsDevice::ConvertMeshToMeshCache(), and the vertices in them are
+//! already welded and optimized by the loader they were converted from.
+
+//! The first four bytes of every mesh cache, "MKMC"
+const UInt32 MESH_CACHE_MAGIC = 0x434D4B4D;
+
+//! Mesh caches of other versions are rejected. Increment this whenever the layout
+//! of the file changes.
+const UInt32 MESH_CACHE_VERSION = 1;
+
+//! Vertex and index blobs start at multiples of this many bytes
+const UInt32 MESH_CACHE_ALIGNMENT = 16;
+
+struct MeshCacheHeader
+{
+	UInt32 magic;
+	UInt32 version;
+	//! The size of the whole file, so truncated files are detected
+	UInt32 fileSize;
+	UInt32 numSubMeshes;
+	//! Offset of numSubMeshes MeshCacheSubMeshHeaders
+	UInt32 subMeshesOffset;
+	UInt32 numStrings;
+	//! Offset of numStrings UInt32 string offsets
+	UInt32 stringsOffset;
+};
+
+struct MeshCacheSubMeshHeader
+{
+	//! A VERTEX_TYPE
+	UInt32 vertexType;
+	UInt32 numVertices;
+	UInt32 verticesOffset;
+	//! A VERTEX_BUFFER_INDEX_TYPE
+	UInt32 indexType;
+	//! 0 if the sub mesh isn't indexed
+	UInt32 numIndices;
+	UInt32 indicesOffset;
+	//! A PRIMITIVE_TYPE
+	UInt32 primitiveType;
+	UInt32 numPrimitives;
+	UInt32 numMaterials;
+	//! Offset of numMaterials MeshCacheMaterials, ordered by firstPrimitive
+	UInt32 materialsOffset;
+	//! The bounding box and sphere of the vertices, so they don't have to be
+	//! calculated when loading
+	Float32 boxMin[3], boxMax[3];
+	Float32 sphereCenter[3], sphereRadius;
+};
+
+//! The materials a mesh cache can describe
+enum MESH_CACHE_MATERIAL_TYPE
+{
+	//! The default material of the GraphicsDevice
+	MCMT_DEFAULT,
+	//! A DiffTexMtl, texture is the path of it's texture
+	MCMT_DIFF_TEX,
+	MCMT_ENUM_LENGTH
+};
+
+struct MeshCacheMaterial
+{
+	//! The material is used from this primitive on
+	UInt32 firstPrimitive;
+	//! A MESH_CACHE_MATERIAL_TYPE
+	UInt32 type;
+	//! Index of the texture path in the string table, if the type has one
+	UInt32 texture;
+};
+
+//! A sub mesh to write to a mesh cache. Materials don't know where their textures
+//! were loaded from, so the loader that created mb tells.
+struct MeshCacheSubMesh
+{
+	MAKO_INLINE MeshCacheSubMesh()
+	: mb(nullptr) {}
+
+	MeshData* mb;
+
+	//! The texture path of every sub material of mb that is a DiffTexMtl, by the
+	//! primitive it starts at. Every other sub material is written as the
+	//! default material.
+	Map<UInt32, String> textures;
+};
+
+//! Writes a mesh cache of subMeshes to stream.
+MAKO_API void WriteMeshCache(const ArrayList<MeshCacheSubMesh>& subMeshes, OutputStream* stream);
+
+MAKO_END_NAMESPACE
@@ -0,0 +1,167 @@
+#include "MakoMeshCacheLoader.h"
+#include "MakoMeshCache.h"
+#include "MakoMappedFile.h"
+#include "MakoSimpleMesh.h"
+#include "MakoIndexedMeshData.h"
+#include "MakoApplication.h"
+#include "MakoGraphicsDevice.h"
+#include "MakoConsole.h"
+#include "MakoDiffTexMtl.h"
+#include "MakoFileSystem.h"
+#include "MakoException.h"
+#include "MakoStream.h"
+#include "MakoDecodedMesh.h"
+#include "MakoUtilities.h"
+
+MAKO_BEGIN_NAMESPACE
+
+//! Throws if [offset, offset + count * elementSize) isn't inside of a file of fileSize bytes
+static void CheckRange(UInt32 offset, UInt32 count, UInt32 elementSize, UInt32 fileSize)
+{
+	if (offset > fileSize || (elementSize && count > (fileSize - offset) / elementSize))
+		throw Exception(Text("The mesh cache is corrupt"));
+}
+
+//! Checks that numPrimitives primitives of a type don't need more than the
+//! numElements vertices or indices they're drawn from
+static void CheckPrimitives(UInt32 numPrimitives, UInt32 type, UInt32 numElements)
+{
+	if (type < PT_POINTLIST || type > PT_TRIANGLEFAN)
+		throw Exception(Text("The mesh cache is corrupt"));
+	// No primitive needs more than 3 elements, so the count can't overflow
+	if (numPrimitives > 0xFFFFFFFF / 3 ||
+		CalcVBIndexPosFromPrimCount(numPrimitives, (PRIMITIVE_TYPE)type) > numElements)
+		throw Exception(Text("The mesh cache is corrupt"));
+}
+
+//! Reads the string at offset, which has to end before the file does
+static String ReadString(const UInt8* bytes, UInt32 offset, UInt32 fileSize)
+{
+	CheckRange(offset, 0, 0, fileSize);
+	const StringChar* str = reinterpret_cast<const StringChar*>(bytes + offset);
+	const UInt32 maxLength = (fileSize - offset) / sizeof(StringChar);
+
+	UInt32 length = 0;
+	while (length < maxLength && str[length] != StringChar('\0'))
+		++length;
+	if (length == maxLength)
+		throw Exception(Text("The mesh cache is corrupt"));
+
+	return String(str, length);
+}
+
+Mesh* MeshCacheLoader::Load(InputStream* stream)
+{
+	DecodedMesh decoded;
+	Decode(stream, decoded);
+
+	ArrayList<Texture*> textures;
+	LoadDecodedMeshTextures(decoded, textures);
+	return CreateDecodedMesh(APP()->GD(), decoded, textures);
+}
+
+Mesh* MeshCacheLoader::LoadFromFile(const FilePath& filePath)
+{
+	MappedFile file(filePath);
+	return LoadFromMemory(file.GetData(), file.GetSize());
+}
+
+Mesh* MeshCacheLoader::LoadFromMemory(const void* data, UInt32 size)
+{
+	DecodedMesh decoded;
+	DecodeFromMemory(data, size, decoded);
+
+	ArrayList<Texture*> textures;
+	LoadDecodedMeshTextures(decoded, textures);
+	return CreateDecodedMesh(APP()->GD(), decoded, textures);
+}
+
+bool MeshCacheLoader::Decode(InputStream* stream, DecodedMesh& mesh)
+{
+	mesh.data.resize(stream->GetSize());
+	if (mesh.data.empty())
+		throw Exception(Text("MeshCacheLoader::Decode() needs a stream with a fixed size"));
+
+	stream->ReadTo(&mesh.data[0], mesh.data.size());
+	DecodeFromMemory(&mesh.data[0], mesh.data.size(), mesh);
+	return true;
+}
+
+void MeshCacheLoader::DecodeFromMemory(const void* data, UInt32 size, DecodedMesh& mesh)
+{
+	const UInt8* bytes = static_cast<const UInt8*>(data);
+
+	if (size < sizeof(MeshCacheHeader))
+		throw Exception(Text("The mesh cache is corrupt"));
+
+	const MeshCacheHeader& h = *reinterpret_cast<const MeshCacheHeader*>(bytes);
+	if (h.magic != MESH_CACHE_MAGIC)
+		throw Exception(Text("The file is not a mesh cache"));
+	if (h.version != MESH_CACHE_VERSION)
+		throw Exception(Text("The mesh cache is of an unsupported version, convert the mesh again"));
+	if (h.fileSize != size)
+		throw Exception(Text("The mesh cache is corrupt"));
+
+	CheckRange(h.subMeshesOffset, h.numSubMeshes, sizeof(MeshCacheSubMeshHeader), size);
+	CheckRange(h.stringsOffset, h.numStrings, sizeof(UInt32), size);
+
+	const MeshCacheSubMeshHeader* smhs = reinterpret_cast<const MeshCacheSubMeshHeader*>(bytes + h.subMeshesOffset);
+	const UInt32* stringOffsets = reinterpret_cast<const UInt32*>(bytes + h.stringsOffset);
+
+	// Every string is a texture path, and materials refer to them by index
+	mesh.texturePaths.resize(h.numStrings);
+	for (UInt32 i = 0; i < h.numStrings; ++i)
+		mesh.texturePaths[i] = ReadString(bytes, stringOffsets[i], size);
+
+	mesh.subMeshes.resize(h.numSubMeshes);
+	for (UInt32 iSubMesh = 0; iSubMesh < h.numSubMeshes; ++iSubMesh)
+	{
+		const MeshCacheSubMeshHeader& smh = smhs[iSubMesh];
+
+		if (smh.vertexType != VT_STANDARD && smh.vertexType != VT_T2 &&
+			smh.vertexType != VT_NORMAL)
+			throw Exception(Text("The mesh cache is corrupt"));
+		if (smh.indexType != VBIT_16 && smh.indexType != VBIT_32)
+			throw Exception(Text("The mesh cache is corrupt"));
+		CheckRange(smh.verticesOffset, smh.numVertices, smh.vertexType, size);
+		CheckRange(smh.indicesOffset, smh.numIndices, smh.indexType, size);
+		CheckRange(smh.materialsOffset, smh.numMaterials, sizeof(MeshCacheMaterial), size);
+		CheckPrimitives(smh.numPrimitives, smh.primitiveType,
+			smh.numIndices ? smh.numIndices : smh.numVertices);
+
+		DecodedSubMesh& sm = mesh.subMeshes[iSubMesh];
+		IndexedMeshDataCreationParams& p = sm.params;
+		p.vertices             = const_cast<UInt8*>(bytes + smh.verticesOffset);
+		p.numVertices          = smh.numVertices;
+		p.vertexType           = (VERTEX_TYPE)smh.vertexType;
+		p.numPrimitives        = smh.numPrimitives;
+		p.primitiveType        = (PRIMITIVE_TYPE)smh.primitiveType;
+		p.vertBufferIndices    = const_cast<UInt8*>(bytes + smh.indicesOffset);
+		p.numVertBufferIndices = smh.numIndices;
+		p.vertBufferIndexType  = (VERTEX_BUFFER_INDEX_TYPE)smh.indexType;
+		p.boundingBox = AABBox3df(Vec3df(smh.boxMin[0], smh.boxMin[1], smh.boxMin[2]),
+		                          Vec3df(smh.boxMax[0], smh.boxMax[1], smh.boxMax[2]));
+		p.boundingSphere = Sphere3df(Vec3df(smh.sphereCenter[0], smh.sphereCenter[1], smh.sphereCenter[2]),
+		                             smh.sphereRadius);
+
+		const MeshCacheMaterial* mtls = reinterpret_cast<const MeshCacheMaterial*>(bytes + smh.materialsOffset);
+		for (UInt32 iMtl = 0; iMtl < smh.numMaterials; ++iMtl)
+		{
+			const MeshCacheMaterial& mtl = mtls[iMtl];
+			// A mesh without primitives may still have a material at 0
+			if (mtl.firstPrimitive && mtl.firstPrimitive >= smh.numPrimitives)
+				throw Exception(Text("The mesh cache is corrupt"));
+			if (mtl.type != MCMT_DIFF_TEX)
+			{
+				sm.textures[mtl.firstPrimitive] = DecodedSubMesh::DEFAULT_MATERIAL;
+				continue;
+			}
+
+			if (mtl.texture >= h.numStrings)
+				throw Exception(Text("The mesh cache is corrupt"));
+			sm.textures[mtl.firstPrimitive] = mtl.texture;
+		}
+	}
+}
+
+MAKO_END_NAMESPACE
@@ -0,0 +1,37 @@
+#pragma once
+#include "MakoMeshLoader.h"
+
+MAKO_BEGIN_NAMESPACE
+
+//! Loads mesh caches (see MakoMeshCache.h). The vertices and indices are
+//! handed to the GraphicsDevice straight from the file's bytes, so there's
+//! no per vertex work when loading.
+class MeshCacheLoader : public MeshLoader
+{
+public:
+	MAKO_INLINE MeshCacheLoader() {}
+	MAKO_INLINE ~MeshCacheLoader() {}
+
+	bool IsLoadableFileExt(const StringView& ext) const
+	{ return ext == Text("makomeshcache"); }
+
+	//! Reads the whole stream into memory, then loads it like LoadFromMemory()
+	virtual Mesh* Load(InputStream* stream);
+
+	//! Maps the file into memory, then loads it like LoadFromMemory()
+	virtual Mesh* LoadFromFile(const FilePath& filePath);
+
+	//! Loads a mesh cache.
+	//! \param[in] data The mesh cache. It's only read during the call.
+	//! \param[in] size The size of data in bytes
+	Mesh* LoadFromMemory(const void* data, UInt32 size);
+
+	//! Reads the whole stream into mesh.data, then decodes it like DecodeFromMemory()
+	virtual bool Decode(InputStream* stream, DecodedMesh& mesh);
+
+	//! Decodes a mesh cache. The sub meshes point into data instead of
+	//! copying the vertices and indices.
+	void DecodeFromMemory(const void* data, UInt32 size, DecodedMesh& mesh);
+};
+
+MAKO_END_NAMESPACE
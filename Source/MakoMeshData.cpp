@@ -3,6 +3,8 @@
 
 MAKO_BEGIN_NAMESPACE
 
+MAKO_DEFINE_OBJECT_POOL(MeshData)
+
 ////////////////////////////////////////////////////////////////////////////////////////
 // Constructor(s)/Deconstructor
 MeshData::MeshData(GraphicsDevice* gd, const MeshDataCreationParams& p)
@@ -25,6 +27,14 @@ MeshData::MeshData(GraphicsDevice* gd, const MeshDataCreationParams& p)
 			(*it).second->Hold();
 	}
 
+	if (p.boundingBox.IsEmpty())
+		RecalculateBoundingVolumes();
+	else
+	{
+		boundingBox    = p.boundingBox;
+		boundingSphere = p.boundingSphere;
+	}
+
 	hvb = gd->CreateVertexHardwareBuffer(this);
 }
 
@@ -54,4 +64,32 @@ void MeshData::SetMaterial(Material* m)
 	subMaterials[0] = m;
 }
 
+void MeshData::RecalculateBoundingVolumes()
+{
+	// Every vertex type starts with it's position
+	boundingBox.MakeEmpty();
+	const Byte* v = (const Byte*)vertices;
+	for (UInt32 i = 0; i < numVertices; ++i, v += vertexType)
+		boundingBox.AddInternalPoint(*(const Position3d*)v);
+
+	if (boundingBox.IsEmpty())
+	{
+		boundingSphere = Sphere3df();
+		return;
+	}
+
+	// Centered on the box, which is tighter than the box's corners
+	const Position3d center = boundingBox.GetCenter();
+	Float32 maxDistSq = 0.f;
+	v = (const Byte*)vertices;
+	for (UInt32 i = 0; i < numVertices; ++i, v += vertexType)
+	{
+		const Vec3df d = *(const Position3d*)v - center;
+		const Float32 distSq = d.x*d.x + d.y*d.y + d.z*d.z;
+		if (distSq > maxDistSq)
+			maxDistSq = distSq;
+	}
+	boundingSphere = Sphere3df(center, sqrt(maxDistSq));
+}
+
 MAKO_END_NAMESPACE
\ No newline at end of file
@@ -1,9 +1,11 @@
 #pragma once
-#include "MakoReferenceCounted.h"
+#include "MakoObjectPool.h"
 #include "MakoVertex.h"
 #include "MakoMap.h"
 #include "MakoMaterial.h"
 #include "MakoHardwareBuffer.h"
+#include "MakoAABBox3d.h"
+#include "MakoSphere3d.h"
 
 MAKO_BEGIN_NAMESPACE
 
@@ -145,13 +147,20 @@ struct MeshDataCreationParams
 	//! then the whole MeshData will be drawn with only NullMaterial. This flexible
 	//! system allows for multi-sub object materials.
 	Map<UInt32, Material*> materials;
+
+	//! The bounding box and sphere of the vertices, if they're already known,
+	//! like when they were stored with the vertices. Default: an empty box, which
+	//! means they're calculated from the vertices.
+	AABBox3df boundingBox;
+	Sphere3df boundingSphere;
 };
 
 
 //! A MeshData is a class that represents a set of vertices (and optionally indices)
 //! representing a shape that is rendered following it's primitive type. By default,
 //! it also stores it's mesh information in GPU memory, with VertexHardwareBuffer.
-class MeshData : public ReferenceCounted
+//! MeshDatas are allocated from the pool GetPool() returns.
+class MeshData : public PooledObject<MeshData>
 {
 private:
 	Map<UInt32, Material*> subMaterials;
@@ -166,10 +175,16 @@ private:
 	VertexHardwareBuffer* hvb;
 
 	UInt32 flags;
+
+	AABBox3df boundingBox;
+	Sphere3df boundingSphere;
 public:
 	MAKO_API MeshData(GraphicsDevice* gd, const MeshDataCreationParams& params);
 	MAKO_API ~MeshData();
 
+	//! Get the pool every MeshData is allocated from
+	MAKO_API static ObjectPool& GetPool();
+
 	//! Get the VertexHardwareBuffer for this MeshData.
 	//! \return The VertexHardwareBuffer for this MeshData, if it exists.
 	//! this method will return a nullptr if a VertexHardwareBuffer has not
@@ -243,6 +258,20 @@ public:
 	//! Clears all sub materials, then sets the new material as drawing from
 	//! primitive 0
 	MAKO_API void SetMaterial(Material* m);
+
+	//! Get the axis aligned box around the vertices, in the space of the
+	//! MeshData. It's calculated when the MeshData is created.
+	MAKO_INLINE const AABBox3df& GetBoundingBox() const
+	{ return boundingBox; }
+
+	//! Get the sphere around the vertices, in the space of the MeshData.
+	//! It's calculated when the MeshData is created.
+	MAKO_INLINE const Sphere3df& GetBoundingSphere() const
+	{ return boundingSphere; }
+
+	//! Recalculates the bounding box and sphere. Must be called after the
+	//! positions of the vertices were changed through GetVertices().
+	MAKO_API void RecalculateBoundingVolumes();
 };
 
 MAKO_END_NAMESPACE
\ No newline at end of file
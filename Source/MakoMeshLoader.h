@@ -3,12 +3,16 @@
 #include "MakoString.h"
 #include "MakoStandardVertex.h"
 #include "MakoLoader.h"
+#include "MakoArrayList.h"
+#include "MakoFileStream.h"
 
 MAKO_BEGIN_NAMESPACE
 
 // Forward declarations
 class Mesh;
 class InputStream;
+struct MeshCacheSubMesh;
+struct DecodedMesh;
 
 //! This class can load Meshes from data
 class MeshLoader : public Loader
@@ -17,6 +21,34 @@ public:
 	//! Load a static mesh from a file
 	//! \param[in] filePath The file path of the mesh
 	virtual Mesh* Load(InputStream* stream) = 0;
+
+	//! Load a static mesh from a file. Loaders that can do better than
+	//! reading the file through a stream override this.
+	//! \param[in] filePath The file path of the mesh
+	virtual Mesh* LoadFromFile(const FilePath& filePath)
+	{
+		FileInputStream* file = new FileInputStream(filePath);
+		file->Hold();
+		Mesh* m = Load(file);
+		file->Drop();
+		return m;
+	}
+
+	//! Load a static mesh from data, and describe it's sub meshes so they
+	//! can be written to a mesh cache.
+	//! \param[out] subMeshes Receives a MeshCacheSubMesh for every sub mesh
+	//! \return The mesh, or nullptr if this loader's meshes can't be converted
+	//! to mesh caches.
+	virtual Mesh* LoadForMeshCache(InputStream* stream, ArrayList<MeshCacheSubMesh>& subMeshes)
+	{ return nullptr; }
+
+	//! Decode a static mesh without creating it or it's textures, so that
+	//! can be done later on the thread that renders. Decode() doesn't use the
+	//! GraphicsDevice, and may be called by several threads at once.
+	//! \param[out] mesh Receives the decoded mesh
+	//! \return false if this loader can't decode meshes without creating them.
+	virtual bool Decode(InputStream* stream, DecodedMesh& mesh)
+	{ return false; }
 	
 	virtual ~MeshLoader() {}
 };
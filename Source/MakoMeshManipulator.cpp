@@ -8,6 +8,9 @@
 #include "MakoArrayList.h"
 #include "Makomath.h"
 #include "MakoGraphicsDevice.h"
+#include "MakoIndexedMeshData.h"
+#include "MakoMesh.h"
+#include <algorithm>
 
 MAKO_BEGIN_NAMESPACE
 
@@ -776,4 +779,346 @@ Mesh* MeshManipulator::MakePlane(Float32 size, Float32 textureCoordsScale)
 }
 
 
+/////////////////////////////////////////////////////////////////
+// Optimization
+
+//! Sorts clusters by their overdraw score, highest first
+struct ClusterScoreGreater
+{
+	const ArrayList<Float32>& scores;
+
+	ClusterScoreGreater(const ArrayList<Float32>& scores)
+		: scores(scores) {}
+
+	MAKO_INLINE bool operator () (UInt32 a, UInt32 b) const
+	{ return scores[a] > scores[b]; }
+};
+
+//! Reorders the numTris triangles of indices for a FIFO cache of cacheSize
+//! vertices (Tipsify). The reordered triangles are appended to out, and the
+//! triangle (relative to indices) at which each cluster starts to clusterStarts.
+//! A cluster starts whenever the algorithm runs into a dead end, and has to
+//! continue at a vertex that probably isn't in the cache anymore.
+static void Tipsify(const UInt32* indices, UInt32 numTris, UInt32 numVertices, UInt32 cacheSize,
+					ArrayList<UInt32>& out, ArrayList<UInt32>& clusterStarts)
+{
+	if (!numTris)
+		return;
+
+	UInt32 i, j, k;
+
+	// The triangles of every vertex, and how many of them aren't emitted yet
+	ArrayList<UInt32> liveTris(numVertices, 0), offsets(numVertices + 1, 0), adjacency(numTris * 3);
+	for (i = 0; i < numTris * 3; ++i)
+		++liveTris[indices[i]];
+	for (i = 0; i < numVertices; ++i)
+		offsets[i + 1] = offsets[i] + liveTris[i];
+	ArrayList<UInt32> fill;
+	fill.assign(offsets.begin(), offsets.end() - 1);
+	for (i = 0; i < numTris * 3; ++i)
+		adjacency[fill[indices[i]]++] = i / 3;
+
+	// A vertex is in the cache if less than cacheSize vertices were added
+	// after it was.
+	ArrayList<UInt32> cacheTimes(numVertices, 0);
+	UInt32 time = cacheSize + 1;
+
+	ArrayList<UInt8> emitted(numTris, 0);
+	ArrayList<UInt32> deadEnds, candidates;
+	UInt32 cursor = 0;
+	Int32 fan = (Int32)indices[0];
+	bool newCluster = true;
+
+	while (fan >= 0)
+	{
+		if (newCluster)
+		{
+			clusterStarts.push_back(out.size() / 3);
+			newCluster = false;
+		}
+
+		// Emit every triangle around the fanning vertex
+		candidates.clear();
+		for (j = offsets[fan]; j < offsets[fan + 1]; ++j)
+		{
+			const UInt32 t = adjacency[j];
+			if (emitted[t])
+				continue;
+			emitted[t] = 1;
+
+			for (k = 0; k < 3; ++k)
+			{
+				const UInt32 v = indices[t * 3 + k];
+				out.push_back(v);
+				deadEnds.push_back(v);
+				candidates.push_back(v);
+				--liveTris[v];
+				if (time - cacheTimes[v] > cacheSize)
+					cacheTimes[v] = time++;
+			}
+		}
+
+		// Continue at the oldest vertex of the last triangles that will still
+		// be in the cache after it's triangles were emitted
+		fan = -1;
+		Int32 bestPriority = -1;
+		for (j = 0; j < candidates.size(); ++j)
+		{
+			const UInt32 v = candidates[j];
+			if (!liveTris[v])
+				continue;
+
+			Int32 priority = 0;
+			if (time - cacheTimes[v] + 2 * liveTris[v] <= cacheSize)
+				priority = (Int32)(time - cacheTimes[v]);
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				fan          = (Int32)v;
+			}
+		}
+
+		if (fan < 0)
+		{
+			// Dead end: continue at the most recently used vertex that has
+			// triangles left, or at any vertex that has.
+			while (!deadEnds.empty())
+			{
+				const UInt32 v = deadEnds.back();
+				deadEnds.pop_back();
+				if (liveTris[v])
+				{
+					fan = (Int32)v;
+					break;
+				}
+			}
+			if (fan < 0)
+			{
+				while (cursor < numVertices && !liveTris[cursor])
+					++cursor;
+				if (cursor < numVertices)
+					fan = (Int32)cursor;
+			}
+			newCluster = true;
+		}
+	}
+}
+
+//! Sorts the clusters of numTris triangles so that clusters facing away from
+//! the center of the triangles are drawn first (Sander et al. 2007). Front
+//! faces are clockwise, like D3D9 culls by default. Returns the triangles in out.
+static void SortClustersForOverdraw(const UInt32* indices, UInt32 numTris,
+									const ArrayList<UInt32>& clusterStarts,
+									const Byte* vertices, UInt32 vertexStride,
+									ArrayList<UInt32>& out)
+{
+	const UInt32 numClusters = clusterStarts.size();
+	ArrayList<Vec3df> centers(numClusters, Vec3df(0.f)), normals(numClusters, Vec3df(0.f));
+	ArrayList<Float32> areas(numClusters, 0.f);
+	Vec3df meshCenter(0.f);
+	Float32 meshArea = 0.f;
+
+	UInt32 c, t;
+	for (c = 0; c < numClusters; ++c)
+	{
+		const UInt32 end = c + 1 < numClusters ? clusterStarts[c + 1] : numTris;
+		for (t = clusterStarts[c]; t < end; ++t)
+		{
+			// Every vertex type starts with it's position
+			const Vec3df& p0 = *(const Position3d*)(vertices + indices[t * 3 + 0] * vertexStride);
+			const Vec3df& p1 = *(const Position3d*)(vertices + indices[t * 3 + 1] * vertexStride);
+			const Vec3df& p2 = *(const Position3d*)(vertices + indices[t * 3 + 2] * vertexStride);
+
+			// The cross product's length is twice the area, so summing it
+			// weights the normal by area
+			const Vec3df e1 = p1 - p0, e2 = p2 - p0;
+			const Vec3df n(e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x);
+			const Float32 area = n.Length() * 0.5f;
+			const Vec3df center = (p0 + p1 + p2) / 3.f;
+
+			normals[c] += n;
+			centers[c] += center * area;
+			areas[c]   += area;
+			meshCenter += center * area;
+			meshArea   += area;
+		}
+	}
+	if (meshArea > 0.f)
+		meshCenter /= meshArea;
+
+	ArrayList<Float32> scores(numClusters, 0.f);
+	ArrayList<UInt32> order(numClusters);
+	for (c = 0; c < numClusters; ++c)
+	{
+		order[c] = c;
+		const Float32 len = normals[c].Length();
+		if (areas[c] > 0.f && len > 0.f)
+		{
+			const Vec3df d = centers[c] / areas[c] - meshCenter;
+			scores[c] = (d.x * normals[c].x + d.y * normals[c].y + d.z * normals[c].z) / len;
+		}
+	}
+	std::stable_sort(order.begin(), order.end(), ClusterScoreGreater(scores));
+
+	for (c = 0; c < numClusters; ++c)
+	{
+		const UInt32 cluster = order[c];
+		const UInt32 end = cluster + 1 < numClusters ? clusterStarts[cluster + 1] : numTris;
+		out.insert(out.end(), indices + clusterStarts[cluster] * 3, indices + end * 3);
+	}
+}
+
+Float32 MeshManipulator::CalcACMR(const UInt32* indices, UInt32 numIndices, UInt32 numVertices,
+								  UInt32 cacheSize)
+{
+	if (numIndices < 3)
+		return 0.f;
+
+	// Same FIFO model as Tipsify()
+	ArrayList<UInt32> cacheTimes(numVertices, 0);
+	UInt32 time = cacheSize + 1, misses = 0;
+	for (UInt32 i = 0; i < numIndices; ++i)
+	{
+		if (time - cacheTimes[indices[i]] > cacheSize)
+		{
+			cacheTimes[indices[i]] = time++;
+			++misses;
+		}
+	}
+	return Float32(misses) / Float32(numIndices / 3);
+}
+
+void MeshManipulator::OptimizeTriangleList(void* vertexData, UInt32 numVertices, UInt32 stride,
+										   void* indexData, UInt32 numIndices,
+										   VERTEX_BUFFER_INDEX_TYPE indexType,
+										   const ArrayList<UInt32>& rangeStarts, bool optimizeOverdraw,
+										   UInt32 cacheSize, MeshOptimizationReport* report)
+{
+	if (numIndices < 3 || !numVertices)
+		return;
+
+	UInt32 i;
+	ArrayList<UInt32> indices(numIndices);
+	if (indexType == VBIT_16)
+	{
+		const UInt16* in = static_cast<const UInt16*>(indexData);
+		for (i = 0; i < numIndices; ++i)
+			indices[i] = in[i];
+	}
+	else
+		memcpy(&indices[0], indexData, numIndices * sizeof(UInt32));
+
+	if (report)
+	{
+		report->acmrBefore  = CalcACMR(&indices[0], numIndices, numVertices, cacheSize);
+		report->numClusters = 0;
+	}
+
+	Byte* vertices = static_cast<Byte*>(vertexData);
+
+	// The triangles before the first range are a range of their own, so
+	// every triangle is in exactly one range
+	const UInt32 numTris = numIndices / 3;
+	ArrayList<UInt32> starts;
+	starts.reserve(rangeStarts.size() + 1);
+	if (rangeStarts.empty() || rangeStarts[0] != 0)
+		starts.push_back(0);
+	for (i = 0; i < rangeStarts.size(); ++i)
+	{
+		if (i && rangeStarts[i] < rangeStarts[i - 1])
+			throw Exception(Text("The range starts given to MeshManipulator::OptimizeTriangleList() aren't in ascending order."));
+		starts.push_back(rangeStarts[i]);
+	}
+
+	// Reorder the triangles of every range on it's own, so they keep
+	// their materials
+	ArrayList<UInt32> optimized, tipsified, clusterStarts;
+	optimized.reserve(numIndices);
+
+	for (UInt32 r = 0; r < starts.size(); ++r)
+	{
+		const UInt32 first = Min(starts[r], numTris);
+		const UInt32 end   = r + 1 < starts.size() ? Min(starts[r + 1], numTris) : numTris;
+		if (first >= end)
+			continue;
+
+		tipsified.clear();
+		clusterStarts.clear();
+		Tipsify(&indices[first * 3], end - first, numVertices, cacheSize, tipsified, clusterStarts);
+
+		if (optimizeOverdraw && clusterStarts.size() > 1)
+			SortClustersForOverdraw(&tipsified[0], end - first, clusterStarts, vertices, stride, optimized);
+		else
+			optimized.insert(optimized.end(), tipsified.begin(), tipsified.end());
+
+		if (report && optimizeOverdraw)
+			report->numClusters += clusterStarts.size();
+	}
+
+	// Indices past the last whole triangle aren't drawn, but are kept
+	optimized.insert(optimized.end(), indices.begin() + optimized.size(), indices.end());
+
+	// Number the vertices in the order they're first used, then move them there
+	const UInt32 unused = 0xFFFFFFFF;
+	ArrayList<UInt32> remap(numVertices, unused);
+	UInt32 nextVertex = 0;
+	for (i = 0; i < numIndices; ++i)
+	{
+		if (remap[optimized[i]] == unused)
+			remap[optimized[i]] = nextVertex++;
+		optimized[i] = remap[optimized[i]];
+	}
+	for (i = 0; i < numVertices; ++i)
+		if (remap[i] == unused)
+			remap[i] = nextVertex++;
+
+	ArrayList<Byte> oldVertices;
+	oldVertices.assign(vertices, vertices + numVertices * stride);
+	for (i = 0; i < numVertices; ++i)
+		memcpy(vertices + remap[i] * stride, &oldVertices[i * stride], stride);
+
+	if (indexType == VBIT_16)
+	{
+		UInt16* out = static_cast<UInt16*>(indexData);
+		for (i = 0; i < numIndices; ++i)
+			out[i] = (UInt16)optimized[i];
+	}
+	else
+		memcpy(indexData, &optimized[0], numIndices * sizeof(UInt32));
+
+	if (report)
+		report->acmrAfter = CalcACMR(&optimized[0], numIndices, numVertices, cacheSize);
+}
+
+void MeshManipulator::OptimizeIndexedMeshData(IndexedMeshData* mb, bool optimizeOverdraw,
+											  UInt32 cacheSize, MeshOptimizationReport* report)
+{
+	if (mb->GetPrimitiveType() != PT_TRIANGLELIST)
+		return;
+
+	const Map<UInt32, Material*>& submats = mb->GetSubMaterials();
+	typedef Map<UInt32, Material*>::const_iterator submatsIt;
+	ArrayList<UInt32> rangeStarts;
+	for (submatsIt it = submats.begin(); it != submats.end(); ++it)
+		rangeStarts.push_back((*it).first);
+
+	OptimizeTriangleList(mb->GetVertices(), mb->GetNumVertices(), mb->GetVertexType(),
+						 mb->GetVertexBufferIndices(), mb->GetNumVertexBufferIndices(),
+						 mb->GetVertexBufferIndexType(), rangeStarts, optimizeOverdraw,
+						 cacheSize, report);
+
+	if (mb->GetVertexHardwareBuffer())
+		mb->GetVertexHardwareBuffer()->Update();
+	if (mb->GetIndexHardwareBuffer())
+		mb->GetIndexHardwareBuffer()->Update();
+}
+
+void MeshManipulator::OptimizeMesh(Mesh* mesh, bool optimizeOverdraw, UInt32 cacheSize)
+{
+	for (UInt32 i = 0; i < mesh->GetNumSubMeshes(); ++i)
+		if (mesh->GetSubMesh(i)->IsIndexed())
+			OptimizeIndexedMeshData(static_cast<IndexedMeshData*>(mesh->GetSubMesh(i)),
+									optimizeOverdraw, cacheSize);
+}
+
 MAKO_END_NAMESPACE
\ No newline at end of file
@@ -1,9 +1,28 @@
 #pragma once
 #include "MakoCommon.h"
+#include "MakoArrayList.h"
+#include "MakoIndexedMeshData.h"
 
 MAKO_BEGIN_NAMESPACE
 
 class Application;
+class Mesh;
+class IndexedMeshData;
+
+//! What MeshManipulator::OptimizeIndexedMeshData() did
+struct MeshOptimizationReport
+{
+	//! Average cache miss ratio: vertices transformed per triangle, with a FIFO
+	//! post-transform cache. 3 is the worst possible, around 0.6 is very good.
+	Float32 acmrBefore;
+	Float32 acmrAfter;
+	//! Number of clusters the triangles were sorted in to reduce overdraw,
+	//! 0 if they weren't.
+	UInt32 numClusters;
+
+	MAKO_INLINE MeshOptimizationReport()
+		: acmrBefore(0.f), acmrAfter(0.f), numClusters(0) {}
+};
 
 //! This class deals with manipulating/creating meshes.
 class MeshManipulator
@@ -53,6 +72,40 @@ public:
 	//! normals flipped.
 	//! \return The skybox mesh
 	MAKO_API Mesh* MakeSkybox();
+
+	//! Reorders the triangles of a triangle list, so that the GPU's
+	//! post-transform cache transforms fewer vertices (Tipsify, Sander et al.
+	//! 2007). Then the vertices are reordered by when they're first used, so
+	//! they are fetched sequentially. Triangles never move out of their sub
+	//! material's range. Both hardware buffers are updated. Meshes that aren't
+	//! triangle lists are left alone.
+	//! \param[in] mb The mesh buffer to optimize in place
+	//! \param[in] optimizeOverdraw (Optional) Also sort the clusters Tipsify
+	//! produces so that those facing outwards are drawn first, which occlude
+	//! the others more often. Costs a little cache efficiency.
+	//! \param[in] cacheSize (Optional) The size of the FIFO cache to optimize for
+	//! \param[out] report (Optional) Receives the cache miss ratios before and after
+	MAKO_API void OptimizeIndexedMeshData(IndexedMeshData* mb, bool optimizeOverdraw = true,
+		UInt32 cacheSize = 16, MeshOptimizationReport* report = nullptr);
+
+	//! Does what OptimizeIndexedMeshData() does to a triangle list that isn't
+	//! in a MeshData yet, so it can be done on any thread.
+	//! \param[in] stride The size of a vertex in bytes
+	//! \param[in] rangeStarts The first triangle of every range of triangles that
+	//! has to stay together, like sub materials do, in ascending order. The
+	//! triangles before the first one are a range of their own.
+	MAKO_API void OptimizeTriangleList(void* vertices, UInt32 numVertices, UInt32 stride,
+		void* indices, UInt32 numIndices, VERTEX_BUFFER_INDEX_TYPE indexType,
+		const ArrayList<UInt32>& rangeStarts, bool optimizeOverdraw = true,
+		UInt32 cacheSize = 16, MeshOptimizationReport* report = nullptr);
+
+	//! Calls OptimizeIndexedMeshData() for every indexed sub mesh of mesh.
+	MAKO_API void OptimizeMesh(Mesh* mesh, bool optimizeOverdraw = true, UInt32 cacheSize = 16);
+
+	//! Calculates the average cache miss ratio of a triangle list with a FIFO
+	//! post-transform cache of cacheSize vertices.
+	MAKO_API Float32 CalcACMR(const UInt32* indices, UInt32 numIndices, UInt32 numVertices,
+		UInt32 cacheSize = 16);
 };
 
 
@@ -4,6 +4,7 @@
 #include "MakoGraphicsDevice.h"
 #include "MakoMesh.h"
 #include "MakoMeshData.h"
+#include "MakoScene3d.h"
 
 MAKO_BEGIN_NAMESPACE
 
@@ -27,11 +28,36 @@ MeshSceneNode::~MeshSceneNode()
 
 void MeshSceneNode::Draw(GraphicsDevice* gd)
 {
+	DrawSubMeshes(gd, GetScene() ? &GetScene()->GetRenderQueue() : nullptr);
+}
+
+void MeshSceneNode::DrawSubMeshes(GraphicsDevice* gd, RenderQueue* queue)
+{
+	// The node as a whole was already tested by the scene
+	const Frustum* frustum = nullptr;
+	if (mesh->GetNumSubMeshes() > 1 && GetScene() && GetScene()->IsCullingEnabled())
+		frustum = &GetScene()->GetViewFrustum();
+
+	if (!queue)
+		gd->SetTransform(GetAbsoluteTransformation(), TS_WORLD);
 	for (UInt i = 0; i < mesh->GetNumSubMeshes(); ++i)
 	{
-		gd->SetTransform(GetAbsoluteTransformation(), TS_WORLD);
-		gd->DrawMeshData(mesh->GetSubMesh(i));
+		MeshData* mb = mesh->GetSubMesh(i);
+		if (frustum && frustum->Test(mb->GetBoundingSphere().GetTransformed(GetAbsoluteTransformation())) == FTR_OUTSIDE)
+			continue;
+		if (queue)
+			queue->Submit(mb, GetAbsoluteTransformation());
+		else
+			gd->DrawMeshData(mb);
 	}
 }
 
+NODE_BOUNDS MeshSceneNode::GetBoundingBox(AABBox3df& box) const
+{
+	box.MakeEmpty();
+	for (UInt i = 0; i < mesh->GetNumSubMeshes(); ++i)
+		box.AddInternalBox(mesh->GetSubMesh(i)->GetBoundingBox());
+	return NB_BOX;
+}
+
 MAKO_END_NAMESPACE
\ No newline at end of file
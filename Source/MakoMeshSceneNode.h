@@ -8,6 +8,7 @@ MAKO_BEGIN_NAMESPACE
 
 // Forward declarations
 class Mesh;
+class RenderQueue;
 
 struct MeshSceneNodeCreationParams : public Scene3dNodeCreationParams
 {
@@ -36,13 +37,23 @@ public:
 	//! Virtual deconstructor, drops mesh and mat
 	MAKO_API virtual ~MeshSceneNode();
 	
-	//! Draws the mesh with GraphicsDevice::DrawMeshData().
+	//! Submits the mesh to the scene's RenderQueue, which draws it after the
+	//! whole scene was traversed. If the mesh has more than one sub mesh,
+	//! those outside of the scene's view frustum are skipped.
 	MAKO_API virtual void Draw(GraphicsDevice* gd);
+
+	//! The union of the bounding boxes of the sub meshes.
+	MAKO_API virtual NODE_BOUNDS GetBoundingBox(AABBox3df& box) const;
 	
 	//! Get the mesh that this MeshSceneNode draws.
 	//! \return The mesh that this MeshSceneNode draws.
 	MAKO_INLINE Mesh* GetMesh()
 	{ return mesh; }
+protected:
+	//! Submits the sub meshes to queue, or draws them right away with
+	//! GraphicsDevice::DrawMeshData() if queue is nullptr. Nodes that change
+	//! the state of gd around drawing have to draw right away.
+	MAKO_API void DrawSubMeshes(GraphicsDevice* gd, RenderQueue* queue);
 };
 
 MAKO_END_NAMESPACE
\ No newline at end of file
@@ -14,7 +14,9 @@ enum NETWORKING_DEVICE_TYPE
 	//! familiar Berkeley socket style routines and a set of Windows-specific
 	//! extensions. (Taken from the Winsock Programmer's FAQ)
 	NDT_WINSOCK2,
-	NDT_ENUM_LENGTH
+	NDT_ENUM_LENGTH,
+	//! Picks the best device that is available
+	NDT_AUTO
 };
 
 //! This class provides functionality for all things networking.
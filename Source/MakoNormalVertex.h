@@ -0,0 +1,56 @@
+#pragma once
+#include "MakoVertex.h"
+#include "MakoVec3d.h"
+#include "MakoVec2d.h"
+#include "MakoColor.h"
+#include "MakoException.h"
+
+MAKO_BEGIN_NAMESPACE
+
+// D3D9 REQUIRES ORDER TO BE FOR VERTICES IN MEMORY:
+// 1. POSITION    (Float32 X, Y, Z)
+// 2. NORMAL      (Float32 X, Y, Z)
+// 2. COLOR       (UInt32 COLOR)
+// 3. D3DFVF_TEX1 (Float32 U, V)
+// 4. D3DFVF_TEX2 (Float32 U, V)
+
+//! A NormalVertex has a position, a normal and a 0th tcoord channel.
+class NormalVertex // : public Vertex
+{
+public:
+	Position3d pos;
+	Vec3df normal;
+	TCoord tcoord0;
+
+	MAKO_INLINE NormalVertex(const Position3d& pos = Pos3d(0.f),
+		const Vec3df& normal = Vec3df(0.f), const TCoord& tcoord = TCoord(0.f))
+		: pos(pos), normal(normal), tcoord0(tcoord) {}
+
+	MAKO_INLINE NormalVertex(const NormalVertex& nvert)
+		: pos(nvert.pos), normal(nvert.normal), tcoord0(nvert.tcoord0) {}
+
+	MAKO_INLINE ~NormalVertex() {}
+
+	MAKO_INLINE bool operator == (const NormalVertex& nvert)
+	{ return pos == nvert.pos && normal == nvert.normal && tcoord0 == nvert.tcoord0; }
+
+	MAKO_INLINE const Position3d& GetPosition() const
+	{ return pos; }
+
+	MAKO_INLINE void SetPosition(const Position3d& p)
+	{ pos = p; }
+
+	MAKO_INLINE const Vec3df& GetNormal() const
+	{ return normal; }
+
+	MAKO_INLINE void SetNormal(const Vec3df& n)
+	{ normal = n; }
+
+	MAKO_INLINE const TCoord& GetTCoord0() const
+	{ return tcoord0; }
+
+	MAKO_INLINE void SetTCoord0(const TCoord& tc)
+	{ tcoord0 = tc; }
+};
+
+MAKO_END_NAMESPACE
@@ -1,297 +1,780 @@
-#if 0
 #include "MakoObjMeshLoader.h"
-#include "MakoSimpleMesh.h"
-#include "MakoFileIO.h"
-#include "MakoArrayList.h"
-#include "MakoVec3d.h"
-#include "MakoVec3d.h"
-#include "MakoString.h"
-#include "MakoStandardVertex.h"
-#include "Makomath.h"
+#include "MakoDecodedMesh.h"
+#include "MakoNormalVertex.h"
+#include "MakoVertexWelder.h"
+#include "MakoMeshManipulator.h"
+#include "MakoMeshCache.h"
+#include "MakoIndexedMeshData.h"
+#include "MakoJobSystem.h"
 #include "MakoApplication.h"
-#include "MakoGraphicsDevice.h"
+#include "MakoFileSystem.h"
+#include "MakoFileStream.h"
+#include "MakoException.h"
+#include "MakoString.h"
+#include "MakoMath.h"
+#include <string.h>
 
 MAKO_BEGIN_NAMESPACE
-static const UInt32 WORD_BUFFER_LENGTH = 512;
 
-//! Constructor
-ObjMeshLoader::ObjMeshLoader(Application* app)
-{ this->app = app; }
+//! Relative (negative) indices are stored relative to the first element of
+//! their chunk, minus this, so they can't be mistaken for absolute ones,
+//! which are positive, until the chunks are merged.
+static const Int32 RELATIVE_INDEX_BIAS = 0x40000000;
+
+//! A missing index of an ObjCorner
+static const UInt32 NO_INDEX = 0xFFFFFFFF;
+
+//! A run of characters of a file, which isn't '\0' terminated
+struct ObjToken
+{
+	const Int8* begin;
+	UInt32 length;
+};
+
+//! A usemtl statement
+struct ObjMaterialUse
+{
+	//! The face of the chunk the material is used from on
+	UInt32 face;
+	ObjToken name;
+	//! The index of the material, set when the chunks are merged
+	UInt32 material;
+};
+
+//! A material of a mtllib file
+struct ObjMaterial
+{
+	ArrayList<Int8> name;
+	//! The path of the diffuse texture, where it was found if it was, empty
+	//! if there is none
+	String texture;
+};
+
+//! A corner of a triangle, as 0 based indices into the merged elements
+struct ObjCorner
+{
+	UInt32 position, tcoord, normal;
+};
+
+//! What a chunk of whole lines of an OBJ file contains
+struct ObjChunk
+{
+	MAKO_INLINE ObjChunk()
+	: begin(nullptr), end(nullptr), positionsOffset(0), tcoordsOffset(0), normalsOffset(0),
+	  firstMaterial(0), missingNormals(false), error(nullptr) {}
+
+	const Int8* begin;
+	const Int8* end;
+
+	ArrayList<Vec3df> positions, normals;
+	ArrayList<Vec2df> tcoords;
+
+	//! The position, tcoord and normal index of every corner of every face.
+	//! Absolute indices are 1 based like in the file, 0 means missing.
+	ArrayList<Int32> corners;
+	//! The number of corners of each face
+	ArrayList<UInt32> faceSizes;
+	ArrayList<ObjMaterialUse> materialUses;
+	ArrayList<ObjToken> materialLibs;
+
+	//! The number of elements the chunks before this one have
+	UInt32 positionsOffset, tcoordsOffset, normalsOffset;
+	//! The material the chunk's faces use until it's first usemtl statement
+	UInt32 firstMaterial;
+
+	//! The triangles of every material, once the faces are resolved
+	ArrayList<ArrayList<ObjCorner> > triangles;
+	bool missingNormals;
+
+	//! Why resolving the faces failed, nullptr if it didn't
+	const char* error;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////
+// Tokenizing
+
+static MAKO_INLINE const Int8* SkipSpaces(const Int8* p)
+{
+	while (*p == ' ' || *p == '\t')
+		++p;
+	return p;
+}
+
+static MAKO_INLINE bool IsEndOfLine(Int8 c)
+{ return c == '\n' || c == '\r' || c == '\0'; }
+
+//! Get the start of the line after the one p is in
+static MAKO_INLINE const Int8* NextLine(const Int8* p, const Int8* end)
+{
+	const Int8* newline = static_cast<const Int8*>(memchr(p, '\n', end - p));
+	return newline ? newline + 1 : end;
+}
 
-ObjMeshLoader::~ObjMeshLoader()
-{}
+//! Check if p starts with keyword, followed by a space
+static MAKO_INLINE bool IsKeyword(const Int8* p, const char* keyword, UInt32 length)
+{
+	// Stops at the '\0' at the end of the text
+	for (UInt32 i = 0; i < length; ++i)
+	{
+		if (p[i] != keyword[i])
+			return false;
+	}
+	return p[length] == ' ' || p[length] == '\t';
+}
 
-Mesh* ObjMeshLoader::Load(InputStream* stream)
+//! Reads the token at p, which ends at a space
+static MAKO_INLINE const Int8* ReadToken(const Int8* p, ObjToken& token)
 {
-	Int8* contents = static_cast<Int8*>(new Byte[stream->GetSize()]);
-	Int8* const copyOfContents = contents;
-	stream->ReadTo(contents, stream->GetSize());
+	token.begin = p;
+	while (!IsCharSpace(*p) && *p)
+		++p;
+	token.length = p - token.begin;
+	return p;
+}
 
-	const UInt32 fileSize = stream->GetSize();
-	//FileIO::ReadBinaryFile(filePath, contents, &fileSize);
-	const Int8* const bufEnd = contents + fileSize;
+//! Reads the rest of the line as one token, without the spaces around it
+static const Int8* ReadRestOfLine(const Int8* p, ObjToken& token)
+{
+	p = SkipSpaces(p);
+	token.begin = p;
+	while (!IsEndOfLine(*p))
+		++p;
+
+	const Int8* last = p;
+	while (last != token.begin && (last[-1] == ' ' || last[-1] == '\t'))
+		--last;
+	token.length = last - token.begin;
+	return p;
+}
 
-	if (!fileSize)
-		return nullptr;
+//! Check if a number starts at p
+static MAKO_INLINE bool IsNumberStart(const Int8* p)
+{
+	if (*p == '-')
+		++p;
+	return IsCharDigit(*p) || *p == '.';
+}
 
-	const UInt32 WORD_BUFFER_LENGTH = 512;
+static MAKO_INLINE bool TokenEquals(const ObjToken& token, const Int8* name, UInt32 length)
+{ return token.length == length && (!length || memcmp(token.begin, name, length) == 0); }
 
-	ArrayList<StandardVertex> verts;
-	//ArrayList<UInt16> indices;
-	
-	ArrayList<Vec3df> positions;
-	ArrayList<Vec2df> texcoords;
+static String TokenToString(const ObjToken& token)
+{
+	String s;
+	for (UInt32 i = 0; i < token.length; ++i)
+		s += static_cast<StringChar>(static_cast<UInt8>(token.begin[i]));
+	return s;
+}
 
-	UInt32 cvt = 0, cv = 0, cvn = 0, cf = 0;
-	// Process obj information
-	const Int8* bufPtr = contents;
-	while(bufPtr != bufEnd)
+//! Reads an index of a face's corner. Relative indices are made relative to
+//! the start of the chunk.
+//! \param[in] count The number of elements of the index' kind in the chunk so far
+static MAKO_INLINE const Int8* ReadIndex(const Int8* p, UInt32 count, Int32& index)
+{
+	if (*p != '-' && !IsCharDigit(*p))
 	{
-		switch(*bufPtr)
+		index = 0;
+		return p;
+	}
+
+	const char* after;
+	const Int32 i = strtol10(p, &after);
+	index = i < 0 ? static_cast<Int32>(count) + i - RELATIVE_INDEX_BIAS : i;
+	return after;
+}
+
+//! Parses the lines of a chunk
+static void ParseChunk(ObjChunk& chunk)
+{
+	const Int8* p = chunk.begin;
+	while (p < chunk.end)
+	{
+		p = SkipSpaces(p);
+		switch (*p)
 		{
-			// mtllib (material)
-		case 'm':
+		case 'v':
+			if (p[1] == ' ' || p[1] == '\t')
 			{
+				Vec3df v;
+				p = fast_atof_move(SkipSpaces(p + 2), v.x);
+				p = fast_atof_move(SkipSpaces(p), v.y);
+				p = fast_atof_move(SkipSpaces(p), v.z);
+				v.z = -v.z;
+				chunk.positions.push_back(v);
+			}
+			else if (IsKeyword(p, "vt", 2))
+			{
+				Vec2df tc;
+				p = fast_atof_move(SkipSpaces(p + 3), tc.x);
+				p = fast_atof_move(SkipSpaces(p), tc.y);
+				tc.y = 1.f - tc.y;
+				chunk.tcoords.push_back(tc);
+			}
+			else if (IsKeyword(p, "vn", 2))
+			{
+				Vec3df n;
+				p = fast_atof_move(SkipSpaces(p + 3), n.x);
+				p = fast_atof_move(SkipSpaces(p), n.y);
+				p = fast_atof_move(SkipSpaces(p), n.z);
+				n.z = -n.z;
+				chunk.normals.push_back(n);
 			}
 			break;
-		case 'v':
+		case 'f':
+			if (p[1] == ' ' || p[1] == '\t')
 			{
-				// v, vn, vt
-				switch(*(bufPtr+1))
+				// v, v/vt, v//vn or v/vt/vn
+				p += 2;
+				UInt32 numCorners = 0;
+				for (;;)
 				{
-				case ' ':
-					{
-						// Vertex
-						positions.push_back(ReadVec3df(bufPtr, bufEnd));
-						++cv;
-					}
-					break;
-				case 'n':
-					{
-						// Normal
-						++cvn;
-					}
-					break;
+					p = SkipSpaces(p);
+					if (*p != '-' && !IsCharDigit(*p))
+						break;
 
-				case 't':
+					Int32 v, vt = 0, vn = 0;
+					p = ReadIndex(p, chunk.positions.size(), v);
+					if (*p == '/')
 					{
-						// Texcoord
-						texcoords.push_back(ReadVec2df(bufPtr, bufEnd));
-						++cvt;
+						p = ReadIndex(p + 1, chunk.tcoords.size(), vt);
+						if (*p == '/')
+							p = ReadIndex(p + 1, chunk.normals.size(), vn);
 					}
-					break;
+					chunk.corners.push_back(v);
+					chunk.corners.push_back(vt);
+					chunk.corners.push_back(vn);
+					++numCorners;
+
+					// Skip whatever is left of a malformed corner
+					while (!IsCharSpace(*p) && *p)
+						++p;
 				}
-				break;
+
+				// Lines and points aren't faces
+				if (numCorners >= 3)
+					chunk.faceSizes.push_back(numCorners);
+				else
+					chunk.corners.resize(chunk.corners.size() - numCorners * 3);
 			}
-		case 'g':
+			break;
+		case 'u':
+			if (IsKeyword(p, "usemtl", 6))
 			{
-				// Group
+				ObjMaterialUse use;
+				use.face     = chunk.faceSizes.size();
+				use.material = 0;
+				p = ReadRestOfLine(p + 7, use.name);
+				chunk.materialUses.push_back(use);
 			}
 			break;
-
-		case 's':
+		case 'm':
+			if (IsKeyword(p, "mtllib", 6))
 			{
-				// Smoothing group
+				p = SkipSpaces(p + 7);
+				while (!IsEndOfLine(*p))
+				{
+					ObjToken lib;
+					p = SkipSpaces(ReadToken(p, lib));
+					chunk.materialLibs.push_back(lib);
+				}
 			}
 			break;
+		}
 
-		case 'u':
+		p = NextLine(p, chunk.end);
+	}
+}
+
+//! Parses chunks
+struct ObjChunkParser
+{
+	ArrayList<ObjChunk>& chunks;
+
+	ObjChunkParser(ArrayList<ObjChunk>& chunks)
+	: chunks(chunks) {}
+
+	void operator () (UInt32 begin, UInt32 end)
+	{
+		for (UInt32 i = begin; i < end; ++i)
+			ParseChunk(chunks[i]);
+	}
+};
+
+//! Find a file that a file in dir refers to. It's looked for in dir first,
+//! and then by the FileSystem.
+//! \param[in] dir The directory of the referring file, or an empty path if
+//! it isn't known
+//! \return The path of the file, or an empty path if it wasn't found
+static FilePath FindReferencedFile(const DirectoryPath& dir, const String& name)
+{
+	FilePath found;
+	if (!dir.GetFull().IsEmpty())
+		found = APP()->FS()->FindFile(dir.GetFull() + StringChar('/') + name);
+	if (found.GetAbs().IsEmpty())
+		found = APP()->FS()->FindFile(name);
+	return found;
+}
+
+//! Skips the options of a texture map statement, like "-s 1 1 1" or
+//! "-clamp on", which come before the file name. The first argument of an
+//! option is always skipped, and up to two more if they're numbers, so a
+//! file name can't start with '-', or be a number after "-o", "-s", "-t"
+//! or "-mm".
+static const Int8* SkipMapOptions(const Int8* p)
+{
+	for (;;)
+	{
+		p = SkipSpaces(p);
+		if (*p != '-')
+			return p;
+
+		ObjToken option, arg;
+		p = SkipSpaces(ReadToken(p, option));
+		UInt32 numArgs = 1;
+		if (TokenEquals(option, "-o", 2) || TokenEquals(option, "-s", 2) || TokenEquals(option, "-t", 2))
+			numArgs = 3;
+		else if (TokenEquals(option, "-mm", 3))
+			numArgs = 2;
+
+		for (UInt32 i = 0; i < numArgs && !IsEndOfLine(*p); ++i)
+		{
+			if (i > 0 && !IsNumberStart(p))
+				break;
+			p = SkipSpaces(ReadToken(p, arg));
+		}
+	}
+}
+
+//! Parses the material libraries of a mesh into materials. Libraries are
+//! looked for in the directory of the OBJ file first, and textures in the
+//! directory of the library that declares them, and then both by the
+//! FileSystem. Libraries that aren't found are skipped, so their materials
+//! are the default material.
+//! \param[in] objDir The directory of the OBJ file, or an empty path if it
+//! isn't known
+static void ReadMaterialLibs(const ArrayList<ObjChunk>& chunks, const DirectoryPath& objDir,
+							 ArrayList<ObjMaterial>& materials)
+{
+	for (UInt32 iChunk = 0; iChunk < chunks.size(); ++iChunk)
+	{
+		for (UInt32 iLib = 0; iLib < chunks[iChunk].materialLibs.size(); ++iLib)
+		{
+			const FilePath found = FindReferencedFile(objDir,
+				TokenToString(chunks[iChunk].materialLibs[iLib]));
+			if (found.GetAbs().IsEmpty())
+				continue;
+			const DirectoryPath libDir = found.GetDir();
+
+			FileInputStream* file = new FileInputStream(found);
+			file->Hold();
+			const UInt32 size = file->GetSize();
+			ArrayList<Int8> text(size + 1, '\0');
+			try
 			{
-				// Usemtl
+				if (size)
+					file->ReadTo(&text[0], size);
 			}
-			break;
-		case 'f':
+			catch (Exception&)
 			{
-				/*
-				v  -5.0000 0.0000 5.0000
-				# 8 vertices
+				file->Drop();
+				throw;
+			}
+			file->Drop();
 
-				vt 5.5000 -4.5000 -4.5000
-				# 8 texture coords
+			const Int8* p = &text[0];
+			const Int8* const end = p + size;
+			while (p < end)
+			{
+				p = SkipSpaces(p);
+				if (IsKeyword(p, "newmtl", 6))
+				{
+					ObjToken name;
+					p = ReadRestOfLine(p + 7, name);
+					materials.push_back(ObjMaterial());
+					materials.back().name.assign(name.begin, name.begin + name.length);
+				}
+				else if (IsKeyword(p, "map_Kd", 6) && !materials.empty())
+				{
+					// The file name is the rest of the line, so it may
+					// contain spaces. It's kept as it is if it isn't found,
+					// so the failure to load it names it.
+					ObjToken path;
+					p = ReadRestOfLine(SkipMapOptions(p + 7), path);
+					const String name = TokenToString(path);
+					const FilePath texture = FindReferencedFile(libDir, name);
+					materials.back().texture = texture.GetAbs().IsEmpty() ? name : texture.GetAbs();
+				}
+				p = NextLine(p, end);
+			}
+		}
+	}
+}
 
-				f 1/1 2/2 3/3 
-				# 12 faces
-				*/
+////////////////////////////////////////////////////////////////////////////////////////
+// Merging
 
-				// Face
-				// vertex/texture/normal
-				UInt32 posi,  texci, posi2, texci2, posi3, texci3;
-				
-				const Int8* p;
-				std::string str;
-				for (p = bufPtr+2; *p != '/' && !IsCharSpace(*p); ++p)
-					str += *p;
+//! Resolves a corner index of a chunk to a 0 based index into the merged
+//! elements.
+//! \return false if the index is out of range.
+static MAKO_INLINE bool ResolveIndex(Int32 index, UInt32 offset, UInt32 total, UInt32& out)
+{
+	Int64 resolved;
+	if (index > 0)
+		resolved = static_cast<Int64>(index) - 1;
+	else if (index < 0)
+		resolved = static_cast<Int64>(offset) + index + RELATIVE_INDEX_BIAS;
+	else
+	{
+		out = NO_INDEX;
+		return true;
+	}
 
-				posi =  CStringDataToS32(str.c_str());
+	out = static_cast<UInt32>(resolved);
+	return resolved >= 0 && resolved < total;
+}
 
-				str.clear();
-				for (p += 1; *p != '/' && !IsCharSpace(*p); ++p)
-					str += *p;
+//! Resolves the indices of the faces of chunks, and triangulates them
+struct ObjFaceResolver
+{
+	ArrayList<ObjChunk>& chunks;
+	UInt32 numPositions, numTCoords, numNormals, numMaterials;
 
-				texci =  CStringDataToS32(str.c_str());
+	ObjFaceResolver(ArrayList<ObjChunk>& chunks, UInt32 numPositions, UInt32 numTCoords,
+					UInt32 numNormals, UInt32 numMaterials)
+	: chunks(chunks), numPositions(numPositions), numTCoords(numTCoords),
+	  numNormals(numNormals), numMaterials(numMaterials) {}
 
-				str.clear();
-				for (p += 1; *p != '/' && !IsCharSpace(*p); ++p)
-					str += *p;
+	void operator () (UInt32 begin, UInt32 end)
+	{
+		for (UInt32 i = begin; i < end; ++i)
+			Resolve(chunks[i]);
+	}
 
-				posi2 =  CStringDataToS32(str.c_str());
+	void Resolve(ObjChunk& chunk)
+	{
+		chunk.triangles.resize(numMaterials);
 
-				str.clear();
-				for (p += 1; *p != '/' && !IsCharSpace(*p); ++p)
-					str += *p;
+		UInt32 material = chunk.firstMaterial;
+		UInt32 nextUse = 0;
+		const Int32* corners = chunk.corners.empty() ? nullptr : &chunk.corners[0];
+		ObjCorner polygon[3];
 
-				texci2 =  CStringDataToS32(str.c_str());
+		for (UInt32 iFace = 0; iFace < chunk.faceSizes.size(); ++iFace)
+		{
+			while (nextUse < chunk.materialUses.size() && chunk.materialUses[nextUse].face == iFace)
+				material = chunk.materialUses[nextUse++].material;
+
+			ArrayList<ObjCorner>& triangles = chunk.triangles[material];
+			const UInt32 numCorners = chunk.faceSizes[iFace];
+			for (UInt32 iCorner = 0; iCorner < numCorners; ++iCorner, corners += 3)
+			{
+				ObjCorner c;
+				if (!ResolveIndex(corners[0], chunk.positionsOffset, numPositions, c.position) ||
+					c.position == NO_INDEX ||
+					!ResolveIndex(corners[1], chunk.tcoordsOffset, numTCoords, c.tcoord) ||
+					!ResolveIndex(corners[2], chunk.normalsOffset, numNormals, c.normal))
+				{
+					chunk.error = "A face of the OBJ file has an index that is out of range";
+					return;
+				}
+				if (c.normal == NO_INDEX)
+					chunk.missingNormals = true;
 
-				str.clear();
-				for (p += 1; *p != '/' && !IsCharSpace(*p); ++p)
-					str += *p;
+				// Fan triangulation, with the winding order flipped
+				if (iCorner < 2)
+					polygon[iCorner] = c;
+				else
+				{
+					polygon[2] = c;
+					triangles.push_back(polygon[0]);
+					triangles.push_back(polygon[2]);
+					triangles.push_back(polygon[1]);
+					polygon[1] = c;
+				}
+			}
+		}
+	}
+};
 
-				posi3 =  CStringDataToS32(str.c_str());
+//! Builds the sub mesh of every material
+struct ObjSubMeshBuilder
+{
+	const ArrayList<ObjChunk>& chunks;
+	const ArrayList<Vec3df>& positions;
+	const ArrayList<Vec2df>& tcoords;
+	const ArrayList<Vec3df>& normals;
+	//! The normal of every position, for corners without one
+	const ArrayList<Vec3df>& generatedNormals;
+	ArrayList<DecodedSubMesh>& subMeshes;
+
+	ObjSubMeshBuilder(const ArrayList<ObjChunk>& chunks, const ArrayList<Vec3df>& positions,
+					  const ArrayList<Vec2df>& tcoords, const ArrayList<Vec3df>& normals,
+					  const ArrayList<Vec3df>& generatedNormals,
+					  ArrayList<DecodedSubMesh>& subMeshes)
+	: chunks(chunks), positions(positions), tcoords(tcoords), normals(normals),
+	  generatedNormals(generatedNormals), subMeshes(subMeshes) {}
+
+	void operator () (UInt32 begin, UInt32 end)
+	{
+		for (UInt32 i = begin; i < end; ++i)
+			Build(i);
+	}
 
-				str.clear();
-				for (p += 1; *p != '/' && !IsCharSpace(*p); ++p)
-					str += *p;
+	void Build(UInt32 material)
+	{
+		UInt32 numCorners = 0;
+		for (UInt32 i = 0; i < chunks.size(); ++i)
+			numCorners += chunks[i].triangles[material].size();
+		if (!numCorners)
+			return;
 
-				texci3 =  CStringDataToS32(str.c_str());
+		DecodedSubMesh& sm = subMeshes[material];
+		IndexedMeshDataCreationParams& p = sm.params;
 
-				verts.push_back(StandardVertex(positions[posi-1], texcoords[texci-1]));
-				verts.push_back(StandardVertex(positions[posi2-1], texcoords[texci2-1]));
-				verts.push_back(StandardVertex(positions[posi3-1], texcoords[texci3-1]));
+		ArrayList<NormalVertex> verts;
+		VertexWelder<NormalVertex> weld(verts, numCorners);
+		ArrayList<UInt32> indices;
+		indices.reserve(numCorners);
 
-				//indices.push_back(indices.size() + 2);
-				//indices.push_back(indices.size() + 0);
-				//indices.push_back(indices.size() - 2));
-			}
-			break;
-		case '#':
+		for (UInt32 iChunk = 0; iChunk < chunks.size(); ++iChunk)
+		{
+			const ArrayList<ObjCorner>& triangles = chunks[iChunk].triangles[material];
+			for (UInt32 i = 0; i < triangles.size(); ++i)
 			{
-				// Comment
+				const ObjCorner& c = triangles[i];
+				indices.push_back(weld.Add(NormalVertex(positions[c.position],
+					c.normal != NO_INDEX ? normals[c.normal] : generatedNormals[c.position],
+					c.tcoord != NO_INDEX ? tcoords[c.tcoord] : TCoord(0.f))));
 			}
-		default:
-			break;
 		}
-		// End switch, eat up rest of line
-		GoNextLine(bufPtr, bufEnd);
-	}
-
-	SimpleMesh* mesh = new SimpleMesh;
 
-	MeshDataCreationParams p;
-	p.numPrimitives = verts.size()/3;
-	p.numVertices   = verts.size();
-	p.primitiveType = PT_TRIANGLELIST;
-	p.vertexType    = VT_STANDARD;
-	p.vertices      = static_cast<void*>(&verts[0]);
-	
-	mesh->AddSubMesh(app->GetGraphicsDevice()->CreateMeshData(p));
+		p.numPrimitives        = indices.size()/3;
+		p.numVertBufferIndices = indices.size();
+		p.numVertices          = verts.size();
+		p.vertexType           = VT_NORMAL;
+		p.primitiveType        = PT_TRIANGLELIST;
+		sm.vertices.assign(reinterpret_cast<const UInt8*>(&verts[0]),
+		                   reinterpret_cast<const UInt8*>(&verts[0] + verts.size()));
+
+		// 16 bit indices are enough unless there are more vertices than they
+		// can address
+		if (p.numVertices <= 0xFFFF)
+		{
+			ArrayList<UInt16> indices16;
+			indices16.assign(indices.begin(), indices.end());
+			p.vertBufferIndexType = VBIT_16;
+			sm.indices.assign(reinterpret_cast<const UInt8*>(&indices16[0]),
+			                  reinterpret_cast<const UInt8*>(&indices16[0] + indices16.size()));
+		}
+		else
+		{
+			p.vertBufferIndexType = VBIT_32;
+			sm.indices.assign(reinterpret_cast<const UInt8*>(&indices[0]),
+			                  reinterpret_cast<const UInt8*>(&indices[0] + indices.size()));
+		}
 
-	delete [] copyOfContents;
+		// Reorder the triangles for the post-transform cache once, here
+		ArrayList<UInt32> rangeStarts(1, 0);
+		APP()->GetMeshManipulator()->OptimizeTriangleList(&sm.vertices[0], p.numVertices,
+			p.vertexType, &sm.indices[0], p.numVertBufferIndices, p.vertBufferIndexType,
+			rangeStarts);
+	}
+};
 
-	return mesh;
+//! Calls f for ranges of [0, count), with the JobSystem if there is one
+template <typename F>
+static void RunParallel(UInt32 count, F& f)
+{
+	JobSystem* js = APP()->JS();
+	if (js)
+		js->ParallelFor(count, f);
+	else
+		f(0, count);
 }
 
-//! skip current word and stop at beginning of next one
-void ObjMeshLoader::GoNextWord(const Int8*& buf, const Int8* const bufEnd, bool acrossNewlines)
+////////////////////////////////////////////////////////////////////////////////////////
+// ObjMeshLoader
+
+bool ObjMeshLoader::Decode(InputStream* stream, DecodedMesh& mesh)
 {
-	// skip current word
-	while(( buf != bufEnd ) && !IsCharSpace(*buf))
-		++buf;
+	// The text is '\0' terminated, so the last number of the file ends
+	const UInt32 size = stream->GetSize();
+	ArrayList<Int8> text(size + 1, '\0');
+	if (size)
+		stream->ReadTo(&text[0], size);
+
+	// Split the file into chunks of whole lines
+	const Int8* const begin = &text[0];
+	const Int8* const end = begin + size;
+	ArrayList<ObjChunk> chunks(size / CHUNK_SIZE + 1);
+	const Int8* p = begin;
+	for (UInt32 i = 0; i < chunks.size(); ++i)
+	{
+		const Int8* target = begin + static_cast<UInt64>(size) * (i + 1) / chunks.size();
+		chunks[i].begin = p;
+		if (i + 1 == chunks.size())
+			chunks[i].end = end;
+		else
+			chunks[i].end = target > p ? NextLine(target - 1, end) : p;
+		p = chunks[i].end;
+	}
 
-	return GoFirstWord(buf, bufEnd, acrossNewlines);
-}
+	ObjChunkParser parser(chunks);
+	RunParallel(chunks.size(), parser);
 
-// copies the current word from the inBuf to the outBuf
-UInt32 ObjMeshLoader::CopyWord(Int8* outBuf, const Int8* const inBuf, UInt32 outBufLength, const Int8* const bufEnd)
-{
-	if (!outBufLength)
-		return 0;
-	if (!inBuf)
+	// Merge the elements of the chunks
+	UInt32 numPositions = 0, numTCoords = 0, numNormals = 0;
+	for (UInt32 i = 0; i < chunks.size(); ++i)
 	{
-		*outBuf = 0;
-		return 0;
+		chunks[i].positionsOffset = numPositions;
+		chunks[i].tcoordsOffset   = numTCoords;
+		chunks[i].normalsOffset   = numNormals;
+		numPositions += chunks[i].positions.size();
+		numTCoords   += chunks[i].tcoords.size();
+		numNormals   += chunks[i].normals.size();
 	}
 
-	UInt32 i = 0;
-	while(inBuf[i])
+	ArrayList<Vec3df> positions, normals;
+	ArrayList<Vec2df> tcoords;
+	positions.reserve(numPositions);
+	tcoords.reserve(numTCoords);
+	normals.reserve(numNormals);
+	for (UInt32 i = 0; i < chunks.size(); ++i)
 	{
-		if (IsCharSpace(inBuf[i]) || &(inBuf[i]) == bufEnd)
-			break;
-		++i;
+		positions.insert(positions.end(), chunks[i].positions.begin(), chunks[i].positions.end());
+		tcoords.insert(tcoords.end(), chunks[i].tcoords.begin(), chunks[i].tcoords.end());
+		normals.insert(normals.end(), chunks[i].normals.begin(), chunks[i].normals.end());
+		ArrayList<Vec3df>().swap(chunks[i].positions);
+		ArrayList<Vec2df>().swap(chunks[i].tcoords);
+		ArrayList<Vec3df>().swap(chunks[i].normals);
 	}
 
-	UInt32 length = std::min(i, outBufLength-1);
-	for (UInt j=0; j<length; ++j)
-		outBuf[j] = inBuf[j];
+	// Number the materials in the order they're used. Material 0 is for the
+	// faces before the first usemtl statement.
+	ArrayList<ObjToken> materialNames(1);
+	materialNames[0].begin  = begin;
+	materialNames[0].length = 0;
+	UInt32 material = 0;
+	for (UInt32 iChunk = 0; iChunk < chunks.size(); ++iChunk)
+	{
+		chunks[iChunk].firstMaterial = material;
+		for (UInt32 iUse = 0; iUse < chunks[iChunk].materialUses.size(); ++iUse)
+		{
+			ObjMaterialUse& use = chunks[iChunk].materialUses[iUse];
+			for (material = 0; material < materialNames.size(); ++material)
+			{
+				if (TokenEquals(use.name, materialNames[material].begin, materialNames[material].length))
+					break;
+			}
+			if (material == materialNames.size())
+				materialNames.push_back(use.name);
+			use.material = material;
+		}
+	}
 
-	outBuf[i] = 0;
-	return length;
-}
+	ObjFaceResolver resolver(chunks, numPositions, numTCoords, numNormals, materialNames.size());
+	RunParallel(chunks.size(), resolver);
 
-void ObjMeshLoader::GoAndCopyNextWord(Int8* outBuf, const Int8*& inBuf, UInt32 outBufLength, const Int8* const bufEnd)
-{
-	GoNextWord(inBuf, bufEnd, false);
-	CopyWord(outBuf, inBuf, outBufLength, bufEnd);
-}
+	bool missingNormals = false;
+	for (UInt32 i = 0; i < chunks.size(); ++i)
+	{
+		if (chunks[i].error)
+			throw Exception(ToString(chunks[i].error));
+		missingNormals = missingNormals || chunks[i].missingNormals;
+		ArrayList<Int32>().swap(chunks[i].corners);
+		ArrayList<UInt32>().swap(chunks[i].faceSizes);
+	}
 
-// Read 3d vector of floats
-Vec3df ObjMeshLoader::ReadVec3df(const Int8*& bufPtr, const Int8* const bufEnd)
-{
-	Vec3df vec;
-	const UInt32 WORD_BUFFER_LENGTH = 256;
-	Int8 wordBuffer[WORD_BUFFER_LENGTH];
-
-	GoAndCopyNextWord(wordBuffer, bufPtr, WORD_BUFFER_LENGTH, bufEnd);
-	// change handedness
-	vec.x = FastCStringDataToS32(wordBuffer);
-	GoAndCopyNextWord(wordBuffer, bufPtr, WORD_BUFFER_LENGTH, bufEnd);
-	vec.z = FastCStringDataToS32(wordBuffer);
-	GoAndCopyNextWord(wordBuffer, bufPtr, WORD_BUFFER_LENGTH, bufEnd);
-	vec.y = FastCStringDataToS32(wordBuffer);
-
-	return vec;
-}
+	// Corners without a normal get the sum of the normals of the triangles
+	// around their position, which weighs them by their area
+	ArrayList<Vec3df> generatedNormals;
+	if (missingNormals)
+	{
+		generatedNormals.assign(numPositions, Vec3df(0.f));
+		for (UInt32 iChunk = 0; iChunk < chunks.size(); ++iChunk)
+		{
+			for (UInt32 iMaterial = 0; iMaterial < materialNames.size(); ++iMaterial)
+			{
+				const ArrayList<ObjCorner>& triangles = chunks[iChunk].triangles[iMaterial];
+				for (UInt32 i = 0; i < triangles.size(); i += 3)
+				{
+					const Vec3df& a = positions[triangles[i].position];
+					const Vec3df n = CrossProduct(positions[triangles[i + 1].position] - a,
+					                              positions[triangles[i + 2].position] - a);
+					// Degenerate triangles have no direction to add
+					if (!(n.x * n.x + n.y * n.y + n.z * n.z > 0.f))
+						continue;
+					generatedNormals[triangles[i].position]     += n;
+					generatedNormals[triangles[i + 1].position] += n;
+					generatedNormals[triangles[i + 2].position] += n;
+				}
+			}
+		}
+		// Positions only degenerate triangles use get an arbitrary normal
+		for (UInt32 i = 0; i < numPositions; ++i)
+		{
+			Vec3df& n = generatedNormals[i];
+			const Float32 length = n.Length();
+			if (length > 0.f)
+				n /= length;
+			else
+				n = Vec3df(0.f, 1.f, 0.f);
+		}
+	}
 
-// Read 2d vector of floats
-Vec2df ObjMeshLoader::ReadVec2df(const Int8*& bufPtr, const Int8* const bufEnd)
-{
-	const UInt32 WORD_BUFFER_LENGTH = 256;
-	Int8 wordBuffer[WORD_BUFFER_LENGTH];
+	ArrayList<DecodedSubMesh> subMeshes(materialNames.size());
+	ObjSubMeshBuilder builder(chunks, positions, tcoords, normals, generatedNormals, subMeshes);
+	RunParallel(materialNames.size(), builder);
 
-	Vec2df vec;
+	// Every material that has faces is a sub mesh, textured with the diffuse
+	// texture of the material of the same name
+	ArrayList<ObjMaterial> libMaterials;
+	ReadMaterialLibs(chunks, FilePath(stream->GetFilePath()).GetDir(), libMaterials);
 
-	GoAndCopyNextWord(wordBuffer, bufPtr, WORD_BUFFER_LENGTH, bufEnd);
-	vec.x = FastCStringDataToS32(wordBuffer);
-	GoAndCopyNextWord(wordBuffer, bufPtr, WORD_BUFFER_LENGTH, bufEnd);
-	vec.y =  - FastCStringDataToS32(wordBuffer); // change handedness
+	for (UInt32 iMaterial = 0; iMaterial < subMeshes.size(); ++iMaterial)
+	{
+		DecodedSubMesh& built = subMeshes[iMaterial];
+		if (built.indices.empty())
+			continue;
 
-	return vec;
-}
+		UInt32 texture = DecodedSubMesh::DEFAULT_MATERIAL;
+		const ObjToken& name = materialNames[iMaterial];
+		for (UInt32 i = 0; i < libMaterials.size(); ++i)
+		{
+			const ObjMaterial& mtl = libMaterials[i];
+			if (!name.length || !TokenEquals(name, mtl.name.empty() ? nullptr : &mtl.name[0], mtl.name.size()))
+				continue;
 
-// Read until line break is reached and stop at the next non-space character
-void ObjMeshLoader::GoNextLine(const Int8*& buf, const Int8* const bufEnd)
-{
-	// look for newline characters
-	while(buf != bufEnd)
-	{
-		// found it, so leave
-		if (*buf=='\n' || *buf=='\r')
+			if (!mtl.texture.IsEmpty())
+			{
+				for (texture = 0; texture < mesh.texturePaths.size(); ++texture)
+				{
+					if (mesh.texturePaths[texture] == mtl.texture)
+						break;
+				}
+				if (texture == mesh.texturePaths.size())
+					mesh.texturePaths.push_back(mtl.texture);
+			}
 			break;
-		++buf;
+		}
+
+		// The vertices and indices are moved, they can be big
+		mesh.subMeshes.push_back(DecodedSubMesh());
+		DecodedSubMesh& sm = mesh.subMeshes.back();
+		sm.params = built.params;
+		sm.vertices.swap(built.vertices);
+		sm.indices.swap(built.indices);
+		sm.textures[0] = texture;
 	}
-	return GoFirstWord(buf, bufEnd);
+
+	return true;
 }
 
-// Skip space characters and stop on first non-space
-void ObjMeshLoader::GoFirstWord(const Int8*& buf, const Int8* const bufEnd, bool acrossNewlines)
+Mesh* ObjMeshLoader::Load(InputStream* stream, ArrayList<MeshCacheSubMesh>* cacheSubMeshes)
 {
-	// Skip space characters
-	if (acrossNewlines)
-		while((buf != bufEnd) && IsCharSpace(*buf))
-			++buf;
-	else
-		while((buf != bufEnd) && IsCharSpace(*buf) && (*buf != '\n'))
-			++buf;
+	DecodedMesh decoded;
+	Decode(stream, decoded);
+	return LoadDecodedMesh(decoded, cacheSubMeshes);
 }
 
 MAKO_END_NAMESPACE
-#endif
\ No newline at end of file
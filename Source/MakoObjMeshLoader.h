@@ -1,35 +1,49 @@
-#if 0
 #pragma once
 
 #include "MakoMeshLoader.h"
 
 MAKO_BEGIN_NAMESPACE
 
-class Application;
-
-// Meshloader capable of loading obj meshes.
+//! Loads Wavefront OBJ meshes, and the diffuse textures (map_Kd) of the
+//! materials in their mtllib files.
+//!
+//! The file is tokenized in place. It's split into chunks of whole lines,
+//! which are parsed in parallel by the JobSystem and merged afterwards.
+//! Polygons are triangulated as fans, so they have to be convex. Every
+//! material the faces use becomes a sub mesh of NormalVertex vertices, which
+//! are welded. Faces without vn normals get smooth normals, generated from
+//! the faces around their positions. Groups, objects and smoothing groups
+//! are ignored.
+//!
+//! OBJ files are right handed, so z is negated and the winding order is
+//! flipped. v is flipped too, since OBJ's texture origin is at the bottom.
 class ObjMeshLoader : public MeshLoader
 {
 private:
-	Application* app;
+	//! \param[out] cacheSubMeshes If not nullptr, receives a MeshCacheSubMesh
+	//! for every sub mesh.
+	Mesh* Load(InputStream* stream, ArrayList<MeshCacheSubMesh>* cacheSubMeshes);
 public:
-	ObjMeshLoader(Application* app);
-	virtual ~ObjMeshLoader();
+	enum
+	{
+		//! Files are split into chunks of about this many bytes
+		CHUNK_SIZE = 1024 * 1024
+	};
 
-	// Loads a wavefront mesh from file
-	virtual Mesh* Load(InputStream* stream);
+	MAKO_INLINE ObjMeshLoader() {}
+	MAKO_INLINE ~ObjMeshLoader() {}
 
-private:
-	void GoNextLine(const Int8*& buf, const Int8* const bufEnd);
-	void GoFirstWord(const Int8*& buf, const Int8* const bufEnd, bool acrossNewlines = true);
-	void GoAndCopyNextWord(Int8* outBuf, const Int8*& inBuf, UInt32 outBufLength, const Int8* const pBufEnd);
-	Vec3df ReadVec3df(const Int8*& bufPtr, const Int8* const bufEnd);
-	Vec2df ReadVec2df(const Int8*& bufPtr, const Int8* const bufEnd);
-	// Skip current word and stop at beginning of next one
-	void GoNextWord(const Int8*& buf, const Int8* const bufEnd, bool acrossNewlines = true);
-	// Copies the current word from the inBuf to the outBuf
-	UInt32 CopyWord(Int8* outBuf, const Int8* const inBuf, UInt32 outBufLength, const Int8* const bufEnd);
+	bool IsLoadableFileExt(const StringView& ext) const
+	{ return ext == Text("obj"); }
+
+	//! Loads a wavefront mesh from a stream
+	MAKO_INLINE Mesh* Load(InputStream* stream)
+	{ return Load(stream, nullptr); }
+
+	MAKO_INLINE Mesh* LoadForMeshCache(InputStream* stream, ArrayList<MeshCacheSubMesh>& subMeshes)
+	{ return Load(stream, &subMeshes); }
+
+	bool Decode(InputStream* stream, DecodedMesh& mesh);
 };
 
 MAKO_END_NAMESPACE
-#endif
\ No newline at end of file
@@ -0,0 +1,150 @@
+#include "MakoObjectPool.h"
+
+MAKO_BEGIN_NAMESPACE
+
+//! Get the size class of an allocation that isn't larger than MAX_BLOCK_SIZE
+static MAKO_INLINE UInt32 GetSizeClass(size_t size)
+{ return size == 0 ? 0 : static_cast<UInt32>((size - 1) / ObjectPool::BLOCK_ALIGNMENT); }
+
+ObjectPool::ObjectPool()
+{
+	for (UInt32 i = 0; i < NUM_SIZE_CLASSES; ++i)
+	{
+		sizeClasses[i].freeBlocks = nullptr;
+		sizeClasses[i].numBlocksUsed = 0;
+	}
+}
+
+ObjectPool::~ObjectPool()
+{
+	for (UInt32 i = 0; i < NUM_SIZE_CLASSES; ++i)
+	{
+		for (UInt32 c = 0; c < sizeClasses[i].chunks.size(); ++c)
+			::operator delete(sizeClasses[i].chunks[c]);
+	}
+}
+
+void* ObjectPool::Allocate(size_t size)
+{
+	if (size > MAX_BLOCK_SIZE)
+		return ::operator new(size);
+
+	const UInt32 sc = GetSizeClass(size);
+	const UInt32 blockSize = (sc + 1) * BLOCK_ALIGNMENT;
+	ScopedLock<SpinLock> l(lock);
+
+	SizeClass& c = sizeClasses[sc];
+	if (!c.freeBlocks)
+	{
+		// Allocate a chunk, and put it's blocks on the free list in order, so
+		// objects allocated one after another are next to each other
+		UInt8* chunk = static_cast<UInt8*>(::operator new(blockSize * BLOCKS_PER_CHUNK));
+		c.chunks.push_back(chunk);
+		for (UInt32 i = BLOCKS_PER_CHUNK; i-- > 0;)
+		{
+			FreeBlock* b = reinterpret_cast<FreeBlock*>(chunk + i * blockSize);
+			b->next = c.freeBlocks;
+			c.freeBlocks = b;
+		}
+	}
+
+	FreeBlock* b = c.freeBlocks;
+	c.freeBlocks = b->next;
+	++c.numBlocksUsed;
+	return b;
+}
+
+void ObjectPool::Free(void* p, size_t size)
+{
+	if (!p)
+		return ;
+	if (size > MAX_BLOCK_SIZE)
+	{
+		::operator delete(p);
+		return ;
+	}
+
+	ScopedLock<SpinLock> l(lock);
+	SizeClass& c = sizeClasses[GetSizeClass(size)];
+	FreeBlock* b = static_cast<FreeBlock*>(p);
+	b->next = c.freeBlocks;
+	c.freeBlocks = b;
+	--c.numBlocksUsed;
+}
+
+UInt32 ObjectPool::Trim()
+{
+	UInt32 freed = 0;
+	ScopedLock<SpinLock> l(lock);
+	for (UInt32 i = 0; i < NUM_SIZE_CLASSES; ++i)
+	{
+		SizeClass& c = sizeClasses[i];
+		if (c.numBlocksUsed || c.chunks.empty())
+			continue;
+
+		for (UInt32 ci = 0; ci < c.chunks.size(); ++ci)
+			::operator delete(c.chunks[ci]);
+		freed += c.chunks.size() * (i + 1) * BLOCK_ALIGNMENT * BLOCKS_PER_CHUNK;
+		c.chunks.clear();
+		c.freeBlocks = nullptr;
+	}
+	return freed;
+}
+
+UInt32 ObjectPool::AddObject(ReferenceCounted* object)
+{
+	ScopedLock<SpinLock> l(lock);
+	if (freeSlots.empty())
+	{
+		Slot s = { object, 0 };
+		slots.push_back(s);
+		return slots.size() - 1;
+	}
+
+	const UInt32 index = freeSlots.back();
+	freeSlots.pop_back();
+	slots[index].object = object;
+	return index;
+}
+
+void ObjectPool::RemoveObject(UInt32 index)
+{
+	ScopedLock<SpinLock> l(lock);
+	slots[index].object = nullptr;
+	++slots[index].generation;
+	freeSlots.push_back(index);
+}
+
+UInt32 ObjectPool::GetGeneration(UInt32 index) const
+{
+	ScopedLock<SpinLock> l(lock);
+	return slots[index].generation;
+}
+
+ReferenceCounted* ObjectPool::FindObject(UInt32 index, UInt32 generation) const
+{
+	ScopedLock<SpinLock> l(lock);
+	if (index >= slots.size() || slots[index].generation != generation)
+		return nullptr;
+
+	// Objects waiting to be destroyed keep their slot until they are
+	ReferenceCounted* object = slots[index].object;
+	return object && object->GetReferenceCount() > 0 ? object : nullptr;
+}
+
+UInt32 ObjectPool::GetNumObjects() const
+{
+	ScopedLock<SpinLock> l(lock);
+	return slots.size() - freeSlots.size();
+}
+
+UInt32 ObjectPool::GetMemoryUsage() const
+{
+	UInt32 usage = 0;
+	ScopedLock<SpinLock> l(lock);
+	for (UInt32 i = 0; i < NUM_SIZE_CLASSES; ++i)
+		usage += sizeClasses[i].chunks.size() * (i + 1) * BLOCK_ALIGNMENT * BLOCKS_PER_CHUNK;
+	return usage;
+}
+
+MAKO_END_NAMESPACE
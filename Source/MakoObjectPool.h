@@ -0,0 +1,179 @@
+#pragma once
+#include "MakoCommon.h"
+#include "MakoReferenceCounted.h"
+#include "MakoArrayList.h"
+#include "MakoThread.h"
+
+MAKO_BEGIN_NAMESPACE
+
+//! Refers to an object of a PooledObject type without holding it. Get the
+//! object with T::FromHandle(), which returns nullptr once the object was
+//! dropped for the last time, even when another object reuses it's slot.
+template <class T>
+struct PoolHandle
+{
+	MAKO_INLINE PoolHandle()
+		: index(0xFFFFFFFF), generation(0) {}
+
+	MAKO_INLINE PoolHandle(UInt32 index, UInt32 generation)
+		: index(index), generation(generation) {}
+
+	MAKO_INLINE bool operator==(const PoolHandle& other) const
+	{ return index == other.index && generation == other.generation; }
+
+	MAKO_INLINE bool operator!=(const PoolHandle& other) const
+	{ return !(*this == other); }
+
+	//! The slot of the object in it's pool
+	UInt32 index;
+	//! The number of times the slot was reused when the handle was made
+	UInt32 generation;
+};
+
+//! Allocates the objects of a type, and gives them slots that PoolHandles
+//! refer to. Objects are allocated from chunks of BLOCKS_PER_CHUNK blocks of
+//! the same size, so objects of a type lie next to each other instead of all
+//! over the heap. Freed blocks are reused; chunks are only freed by Trim(),
+//! so a level can be unloaded by dropping it's objects, calling
+//! ReferenceCounted::DestroyDroppedObjects(), and then Trim().
+//!
+//! It can be used by any thread.
+class ObjectPool
+{
+public:
+	enum
+	{
+		//! Block sizes are multiples of it
+		BLOCK_ALIGNMENT = 16,
+		//! Larger objects are allocated with the global operator new
+		MAX_BLOCK_SIZE = 1024,
+		BLOCKS_PER_CHUNK = 64,
+		NUM_SIZE_CLASSES = MAX_BLOCK_SIZE / BLOCK_ALIGNMENT
+	};
+private:
+	struct FreeBlock
+	{
+		FreeBlock* next;
+	};
+
+	//! The blocks of one size
+	struct SizeClass
+	{
+		FreeBlock* freeBlocks;
+		ArrayList<void*> chunks;
+		UInt32 numBlocksUsed;
+	};
+
+	struct Slot
+	{
+		//! nullptr if the slot is free
+		ReferenceCounted* object;
+		//! Incremented every time the slot is freed, so old handles to it
+		//! become invalid
+		UInt32 generation;
+	};
+
+	mutable SpinLock lock;
+	SizeClass sizeClasses[NUM_SIZE_CLASSES];
+	ArrayList<Slot> slots;
+	ArrayList<UInt32> freeSlots;
+
+	// Not copyable
+	ObjectPool(const ObjectPool&);
+	ObjectPool& operator = (const ObjectPool&);
+public:
+	MAKO_API ObjectPool();
+
+	//! Frees every chunk. The objects in them must have been destroyed.
+	MAKO_API ~ObjectPool();
+
+	//! Allocate the memory of an object
+	MAKO_API void* Allocate(size_t size);
+
+	//! Free memory Allocate() returned
+	//! \param[in] size The size it was allocated with
+	MAKO_API void Free(void* p, size_t size);
+
+	//! Frees the chunks of every size no object is allocated with anymore
+	//! \return The number of bytes that were freed
+	MAKO_API UInt32 Trim();
+
+	//! Give an object a slot
+	//! \return The index of the slot
+	MAKO_API UInt32 AddObject(ReferenceCounted* object);
+
+	//! Free the slot of an object, so it's handles become invalid
+	MAKO_API void RemoveObject(UInt32 index);
+
+	//! Get the generation of a slot
+	MAKO_API UInt32 GetGeneration(UInt32 index) const;
+
+	//! Get the object in a slot, or nullptr if the generation doesn't match,
+	//! or the object was dropped for the last time
+	MAKO_API ReferenceCounted* FindObject(UInt32 index, UInt32 generation) const;
+
+	//! Get the number of objects that have a slot
+	MAKO_API UInt32 GetNumObjects() const;
+
+	//! Get the number of bytes the chunks take up
+	MAKO_API UInt32 GetMemoryUsage() const;
+};
+
+//! The base class of the types that are allocated from an ObjectPool. T is
+//! the type inheriting from it, which has to declare
+//! static ObjectPool& GetPool(), and define it in it's source file with
+//! MAKO_DEFINE_OBJECT_POOL(T). Sub classes of T are allocated from the same
+//! pool.
+//!
+//! The pool is created by the first call to GetPool(), so static objects of
+//! other files can be created before the pool's file is initialized. It's
+//! also created before main(), so threads never create it at once. It's
+//! never deleted, since objects held by static objects are dropped after
+//! the static destructors ran.
+template <class T>
+class PooledObject : public ReferenceCounted
+{
+private:
+	//! The slot of the object in the pool
+	UInt32 poolSlot;
+public:
+	MAKO_INLINE PooledObject()
+	{ poolSlot = T::GetPool().AddObject(this); }
+
+	MAKO_INLINE PooledObject(const PooledObject& other)
+	: ReferenceCounted(other)
+	{ poolSlot = T::GetPool().AddObject(this); }
+
+	MAKO_INLINE ~PooledObject()
+	{ T::GetPool().RemoveObject(poolSlot); }
+
+	//! Keeps the slot of the object
+	MAKO_INLINE PooledObject& operator = (const PooledObject& other)
+	{ ReferenceCounted::operator=(other); return *this; }
+
+	MAKO_INLINE static void* operator new(size_t size)
+	{ return T::GetPool().Allocate(size); }
+
+	MAKO_INLINE static void operator delete(void* p, size_t size)
+	{ T::GetPool().Free(p, size); }
+
+	//! Get a handle to the object
+	MAKO_INLINE PoolHandle<T> GetHandle() const
+	{ return PoolHandle<T>(poolSlot, T::GetPool().GetGeneration(poolSlot)); }
+
+	//! Get the object a handle refers to, or nullptr if it was dropped for
+	//! the last time
+	MAKO_INLINE static T* FromHandle(const PoolHandle<T>& handle)
+	{ return static_cast<T*>(T::GetPool().FindObject(handle.index, handle.generation)); }
+};
+
+//! Defines T::GetPool() of a PooledObject<T>
+#define MAKO_DEFINE_OBJECT_POOL(T) \
+	ObjectPool& T::GetPool() \
+	{ \
+		static ObjectPool* pool = new ObjectPool; \
+		return *pool; \
+	} \
+	static ObjectPool& T##PoolInit = T::GetPool();
+
+MAKO_END_NAMESPACE
@@ -1,5 +1,6 @@
 #include "MakoPNGLoader.h"
 #include "MakoStream.h"
+#include "MakoBufferedStream.h"
 #include "MakoTexture.h"
 #include "MakoException.h"
 #include "MakoApplication.h"
@@ -17,13 +18,16 @@ static void png_cpexcept_error(png_structp png_ptr, png_const_charp msg)
 // PNG function for file reading
 void PNGAPI user_read_data_fcn(png_structp png_ptr, png_bytep data, png_size_t length)
 {
-	InputStream* is = static_cast<InputStream*>(png_ptr->io_ptr);
+	BufferedInputStream* is = static_cast<BufferedInputStream*>(png_ptr->io_ptr);
 	is->ReadTo(data, length);
 }
 
 // load in the image data
-Texture* PNGLoader::Load(InputStream* stream)
+bool PNGLoader::Decode(InputStream* source, TextureCreationParams& params)
 {
+	// libpng reads chunk headers and CRCs a few bytes at a time
+	BufferedInputStream stream(source);
+
 	//Used to point to image rows
 	UInt8** rowPointers = nullptr;
 	UInt8* data         = nullptr;
@@ -33,13 +37,13 @@ Texture* PNGLoader::Load(InputStream* stream)
 	png_byte buffer[8];
 	
 	// Read the first few bytes of the PNG file
-	stream->ReadTo(buffer, 8);
+	stream.ReadTo(buffer, 8);
 
 	// Check if it really is a PNG file
 	if(png_sig_cmp(buffer, 0, 8))
 	{
 		// not really a png
-		return 0;
+		return false;
 	}
 
 	// Allocate the png read struct
@@ -48,7 +52,7 @@ Texture* PNGLoader::Load(InputStream* stream)
 	if (!png_ptr)
 	{
 		// Internal PNG create read struct failure
-		return 0;
+		return false;
 	}
 
 	// Allocate the png info struct
@@ -57,7 +61,7 @@ Texture* PNGLoader::Load(InputStream* stream)
 	{
 		// Internal PNG create info struct failure
 		png_destroy_read_struct(&png_ptr, NULL, NULL);
-		return 0;
+		return false;
 	}
 
 	// for proper error handling
@@ -73,7 +77,7 @@ Texture* PNGLoader::Load(InputStream* stream)
 	}
 
 	// changed by zola so we don't need to have public FILE pointers
-	png_set_read_fn(png_ptr, stream, user_read_data_fcn);
+	png_set_read_fn(png_ptr, &stream, user_read_data_fcn);
 
 	png_set_sig_bytes(png_ptr, 8); // Tell png that we read the signature
 
@@ -157,7 +161,7 @@ Texture* PNGLoader::Load(InputStream* stream)
 	{
 		// Internal PNG create row pointers failure
 		png_destroy_read_struct(&png_ptr, NULL, NULL);
-		return 0;
+		return false;
 	}
 
 	UInt colorStride;
@@ -215,13 +219,11 @@ Texture* PNGLoader::Load(InputStream* stream)
 			ptr[3] = 255;
 		}
 	}
-	TextureCreationParams texParams;
-	texParams.format = CF_R8G8B8A8;
-	texParams.size.x = width;
-	texParams.size.y = height;
-	texParams.data   = data2;
-
-	Texture* texture = APP()->GD()->CreateTexture(texParams);
+	params.format = CF_R8G8B8A8;
+	params.size.x = width;
+	params.size.y = height;
+	params.data   = data2;
+	params.generateMipMaps = true;
 
 	// Clean up
 	delete [] rowPointers;
@@ -229,7 +231,7 @@ Texture* PNGLoader::Load(InputStream* stream)
 		delete [] data;
 	png_destroy_read_struct(&png_ptr,&info_ptr, 0); // Clean up memory
 
-	return texture;
+	return true;
 }
 
 MAKO_END_NAMESPACE
\ No newline at end of file
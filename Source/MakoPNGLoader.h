@@ -13,10 +13,10 @@ public:
 	MAKO_INLINE PNGLoader() {}
 	MAKO_INLINE ~PNGLoader() {}
 
-	bool IsLoadableFileExt(const String& ext) const
+	bool IsLoadableFileExt(const StringView& ext) const
 	{ return ext == Text("png"); }
 
-	Texture* Load(InputStream* stream);
+	bool Decode(InputStream* stream, TextureCreationParams& params);
 };
 
 MAKO_END_NAMESPACE
\ No newline at end of file
@@ -13,6 +13,7 @@
 #include "MakoVertex.h"
 #include "MakoStandardVertex.h"
 #include "MakoT2Vertex.h"
+#include "MakoNormalVertex.h"
 
 #define VEC3DF_TO_NXVEC3(VEC3DF) NxVec3(VEC3DF.x, VEC3DF.y, VEC3DF.z)
 
@@ -70,6 +71,8 @@ PhysXStaticTriangleMeshActor::PhysXStaticTriangleMeshActor(PhysXSceneManager* sc
 				fverts[ivb + numVertsHandled] = ((static_cast<const StandardVertex*>(mb->GetVertices()))[ivb]).GetPosition() * scale;
 			else if (mb->GetVertexType() == VT_T2)
 				fverts[ivb + numVertsHandled] = ((static_cast<const T2Vertex*>(mb->GetVertices()))[ivb]).GetPosition() * scale;
+			else if (mb->GetVertexType() == VT_NORMAL)
+				fverts[ivb + numVertsHandled] = ((static_cast<const NormalVertex*>(mb->GetVertices()))[ivb]).GetPosition() * scale;
 
 		}
 		// Put indices from each meshbuffer into final indices,
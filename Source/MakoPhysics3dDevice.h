@@ -36,7 +36,9 @@ enum PHYSICS_3D_DEVICE_TYPE
 #ifdef MAKO_PHYSX_AVAILABLE
 	P3DT_PHYSX,
 #endif
-	P3DT_ENUM_LENGTH
+	P3DT_ENUM_LENGTH,
+	//! Picks the best device that is available
+	P3DT_AUTO
 };
 
 //! This device manages 3d physics
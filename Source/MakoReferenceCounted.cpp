@@ -1,23 +1,59 @@
 #include "MakoReferenceCounted.h"
+#include "MakoArrayList.h"
+#include "MakoThread.h"
 
 MAKO_BEGIN_NAMESPACE
 
+//! Set while destruction is deferred
+static volatile Int32 destructionDeferred = 0;
+//! The objects waiting for DestroyDroppedObjects(), guarded by droppedLock
+static SpinLock droppedLock;
+static ArrayList<const ReferenceCounted*> droppedObjects;
+
 bool ReferenceCounted::Drop() const
 {
-	--referenceCounter;
-	
-	if (referenceCounter == 0)
+	const Int32 count = AtomicDecrement(&referenceCounter);
+	if (count > 0)
+		return false;
+	if (count < 0)
+		MAKO_DEBUG_BREAK;
+
+	if (AtomicLoad(&destructionDeferred))
 	{
-		delete this;
-		return true;
+		ScopedLock<SpinLock> l(droppedLock);
+		droppedObjects.push_back(this);
 	}
-	if (referenceCounter < 0)
-	{
-		MAKO_DEBUG_BREAK;
+	else
 		delete this;
-		return true;
+	return true;
+}
+
+void ReferenceCounted::SetDestructionDeferred(bool deferred)
+{ AtomicExchange(&destructionDeferred, deferred ? 1 : 0); }
+
+bool ReferenceCounted::IsDestructionDeferred()
+{ return AtomicLoad(&destructionDeferred) != 0; }
+
+UInt32 ReferenceCounted::DestroyDroppedObjects()
+{
+	// Destructors drop other objects, which are queued again, so it loops
+	// until none were dropped
+	ArrayList<const ReferenceCounted*> objects;
+	UInt32 destroyed = 0;
+	for (;;)
+	{
+		droppedLock.Lock();
+		objects.swap(droppedObjects);
+		droppedLock.Unlock();
+
+		if (objects.empty())
+			return destroyed;
+
+		for (UInt32 i = 0; i < objects.size(); ++i)
+			delete objects[i];
+		destroyed += objects.size();
+		objects.clear();
 	}
-	return false;
 }
 
-MAKO_END_NAMESPACE
\ No newline at end of file
+MAKO_END_NAMESPACE
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "MakoCommon.h"
+#include "MakoAtomic.h"
 
 MAKO_BEGIN_NAMESPACE
 
@@ -8,10 +9,17 @@ MAKO_BEGIN_NAMESPACE
 //! if you no longer need the object, you have to call Drop(). This will destroy 
 //! the object, if Hold() was not called in another part of you program, 
 //! because this part still needs the object.
+//!
+//! The reference counter is atomic, so objects may be held and dropped by
+//! any thread. While destruction is deferred (see SetDestructionDeferred()),
+//! objects dropped for the last time are only destroyed by
+//! DestroyDroppedObjects(), so they can't be destroyed while another thread,
+//! or a Scene3d traversal, still uses them. An object can't be held again
+//! after it was dropped for the last time.
 class ReferenceCounted
 {
 private:
-	mutable Int32 referenceCounter;
+	mutable volatile Int32 referenceCounter;
 public:
 	// Constructor sets referenceCounter to zero
 	MAKO_API MAKO_INLINE ReferenceCounted() : referenceCounter(0) {}
@@ -23,15 +31,30 @@ public:
 	//! should later also call Drop() to it. f an object never gets as much Hold() as
 	//! Release() calls, it will never be destroyed.
 	MAKO_API MAKO_INLINE void Hold() const
-	{ ++referenceCounter; }
+	{ AtomicIncrement(&referenceCounter); }
 
-	//! Drops the object. Decrements the reference counter by one. If the object is deleted, Drop() will
-	//! return true. Else, it will return false.
+	//! Drops the object. Decrements the reference counter by one. If the object is deleted, or queued
+	//! to be deleted by DestroyDroppedObjects(), Drop() will return true. Else, it will return false.
 	MAKO_API bool Drop() const;
 
 	//! Get the reference count.
 	MAKO_API MAKO_INLINE Int32 GetReferenceCount() const
 	{ return referenceCounter; }
+
+	//! Set whether objects dropped for the last time are destroyed right
+	//! away, or queued until DestroyDroppedObjects() is called. It's off by
+	//! default; SimpleApplication turns it on, and destroys the dropped
+	//! objects at the end of every frame.
+	MAKO_API static void SetDestructionDeferred(bool deferred);
+
+	MAKO_API static bool IsDestructionDeferred();
+
+	//! Destroys the objects that were dropped for the last time while
+	//! destruction was deferred, including those their destructors drop.
+	//! It must not be called while the objects may still be used, like
+	//! during a Scene3d traversal.
+	//! \return The number of objects that were destroyed
+	MAKO_API static UInt32 DestroyDroppedObjects();
 };
 
 MAKO_END_NAMESPACE
@@ -0,0 +1,140 @@
+#include "MakoRenderQueue.h"
+#include "MakoGraphicsDevice.h"
+#include "MakoMeshData.h"
+#include "MakoMaterial.h"
+#include <algorithm>
+#include <string.h>
+
+MAKO_BEGIN_NAMESPACE
+
+//! Hashes a pointer into bits bits. The low bits of pointers are mostly
+//! alignment, so they are shifted out before multiplying (Fibonacci hashing).
+static MAKO_INLINE UInt64 HashPointer(const void* p, UInt32 bits)
+{ return (UInt64)(((UInt32)((size_t)p >> 4) * 2654435761u) >> (32 - bits)); }
+
+RenderQueue::RenderQueue()
+: numMaterialBinds(0), numDrawCalls(0) {}
+
+UInt64 RenderQueue::MakeSortKey(const Material* mtl, Float32 depth)
+{
+	// Positive floats compare like their bits, so the upper half of the bits
+	// is a coarse, but ordered depth. Draw calls behind the camera go first.
+	if (!(depth > 0.f))
+		depth = 0.f;
+	UInt32 depthBits;
+	memcpy(&depthBits, &depth, sizeof(depthBits));
+
+	// The sign bit of the depth is clear, so it fits in the 31 bits below
+	// the translucent bit. Subtracting it from the largest depth draws the
+	// farthest first.
+	if (mtl->IsTranslucent())
+		return ((UInt64)1 << 63) |
+			   ((UInt64)(0x7FFFFFFF - depthBits) << 32) |
+			   (HashPointer(mtl, 16) << 16);
+
+	return ((UInt64)(mtl->GetType() & 0x7) << 60) |
+		   (HashPointer(mtl->GetCgShader(), 12) << 48) |
+		   (HashPointer(mtl->GetTexture(), 16) << 32) |
+		   (HashPointer(mtl, 16) << 16) |
+		   (UInt64)(depthBits >> 16);
+}
+
+void RenderQueue::Begin(const Matrix4f& view)
+{
+	this->view = view;
+	drawCalls.clear();
+	sortEntries.clear();
+	transforms.clear();
+}
+
+void RenderQueue::Submit(MeshData* mb, const Matrix4f& world)
+{
+	const Map<UInt32, Material*>& submats = mb->GetSubMaterials();
+	typedef Map<UInt32, Material*>::const_iterator submatsIt;
+
+	for (submatsIt it = submats.begin(); it != submats.end(); ++it)
+	{
+		// Prims to draw go up to the next pair's primitive position
+		submatsIt next = it;
+		++next;
+		UInt32 primsEnd = next != submats.end() ? (*next).first : mb->GetNumPrimitives();
+
+		Submit(mb, (*it).second, (*it).first, primsEnd - (*it).first, world);
+	}
+}
+
+void RenderQueue::Submit(MeshData* mb, Material* mtl, UInt32 firstPrim, UInt32 numPrims,
+						 const Matrix4f& world)
+{
+	if (!numPrims)
+		return;
+
+	// Draw calls submitted with the same transformation share it, so it's
+	// only set once when they're drawn after another.
+	if (transforms.empty() || !(transforms.back() == world))
+		transforms.push_back(world);
+
+	DrawCall dc;
+	dc.mb        = mb;
+	dc.mtl       = mtl;
+	dc.firstPrim = firstPrim;
+	dc.numPrims  = numPrims;
+	dc.transform = transforms.size() - 1;
+
+	// The depth of the origin of the draw call's world transformation
+	Vec3df viewPos;
+	view.TransformVect(viewPos, world.GetTranslation());
+
+	SortEntry e;
+	e.key      = MakeSortKey(mtl, viewPos.z);
+	e.drawCall = drawCalls.size();
+
+	drawCalls.push_back(dc);
+	sortEntries.push_back(e);
+}
+
+void RenderQueue::Flush(GraphicsDevice* gd)
+{
+	std::sort(sortEntries.begin(), sortEntries.end());
+
+	numMaterialBinds = 0;
+	numDrawCalls     = sortEntries.size();
+
+	const Material* bound = nullptr;
+	UInt32 boundTransform = 0xFFFFFFFF;
+	for (UInt32 i = 0; i < sortEntries.size(); ++i)
+	{
+		const DrawCall& dc = drawCalls[sortEntries[i].drawCall];
+		const bool transformChanged = dc.transform != boundTransform;
+
+		// Materials read TS_WORLD when they're bound, so it's set first
+		if (transformChanged)
+			gd->SetTransform(transforms[dc.transform], TS_WORLD);
+
+		if (dc.mtl != bound)
+		{
+			// Materials of the same type and shader overwrite each other's state
+			if (bound && (bound->GetType() != dc.mtl->GetType() ||
+						  bound->GetCgShader() != dc.mtl->GetCgShader()))
+				bound->UnBind(gd);
+
+			dc.mtl->Bind(gd);
+			bound = dc.mtl;
+			++numMaterialBinds;
+		}
+		else if (transformChanged)
+			dc.mtl->BindTransform(gd);
+
+		boundTransform = dc.transform;
+		gd->DrawMeshDataPrimitives(dc.mb, dc.firstPrim, dc.numPrims);
+	}
+
+	if (bound)
+		bound->UnBind(gd);
+
+	drawCalls.clear();
+	sortEntries.clear();
+	transforms.clear();
+}
+
+MAKO_END_NAMESPACE
@@ -0,0 +1,100 @@
+#pragma once
+#include "MakoCommon.h"
+#include "MakoArrayList.h"
+#include "MakoMatrix4.h"
+
+MAKO_BEGIN_NAMESPACE
+
+// Forward declarations
+class GraphicsDevice;
+class MeshData;
+class Material;
+
+//! Collects the draw calls of a frame, so they can be sorted by the state
+//! they need before they are submitted to the GraphicsDevice. Every sub
+//! material range of a MeshData is one draw call. Each gets a 64 bit sort
+//! key. The most significant bit is set for translucent materials, so they
+//! are drawn in a second pass after every opaque draw call. The rest of the
+//! key of an opaque draw call is made of, from the most to the least
+//! significant bits:
+//!
+//! - the type of the material (3 bits)
+//! - the shader of the material (12 bits)
+//! - the texture of the material (16 bits)
+//! - the material itself (16 bits)
+//! - the depth of the draw call in view space, front to back (16 bits)
+//!
+//! Translucent draw calls have to be blended in order, so their key is
+//! their depth, back to front (31 bits), followed by the material (16 bits).
+//!
+//! Shaders, textures and materials are hashed into their bits, so different
+//! ones may share them; that only makes the sorting less effective.
+//! When the queue is flushed, a material is only bound when it differs from
+//! the previous draw call's material. Draw calls that only change the world
+//! transformation call Material::BindTransform() instead.
+class RenderQueue
+{
+private:
+	struct DrawCall
+	{
+		MeshData* mb;
+		Material* mtl;
+		UInt32 firstPrim;
+		UInt32 numPrims;
+		//! Index into transforms
+		UInt32 transform;
+	};
+
+	struct SortEntry
+	{
+		UInt64 key;
+		//! Index into drawCalls
+		UInt32 drawCall;
+
+		MAKO_INLINE bool operator < (const SortEntry& rhs) const
+		{ return key < rhs.key || (key == rhs.key && drawCall < rhs.drawCall); }
+	};
+
+	ArrayList<DrawCall> drawCalls;
+	ArrayList<SortEntry> sortEntries;
+	ArrayList<Matrix4f> transforms;
+	Matrix4f view;
+
+	UInt32 numMaterialBinds;
+	UInt32 numDrawCalls;
+
+	static UInt64 MakeSortKey(const Material* mtl, Float32 depth);
+public:
+	MAKO_API RenderQueue();
+
+	//! Removes every draw call and starts a new frame.
+	//! \param[in] view The view transformation the depth of draw calls is measured in.
+	MAKO_API void Begin(const Matrix4f& view);
+
+	//! Adds a draw call for every sub material of mb.
+	//! \param[in] mb The mesh buffer to draw. It has to stay alive until Flush().
+	//! \param[in] world The world transformation to draw mb with
+	MAKO_API void Submit(MeshData* mb, const Matrix4f& world);
+
+	//! Adds a draw call for a range of primitives of mb, drawn with mtl.
+	MAKO_API void Submit(MeshData* mb, Material* mtl, UInt32 firstPrim, UInt32 numPrims,
+						 const Matrix4f& world);
+
+	//! Sorts the draw calls, submits them to gd and removes them.
+	//! Changes the TS_WORLD transformation of gd.
+	MAKO_API void Flush(GraphicsDevice* gd);
+
+	//! Get the number of draw calls that are waiting to be flushed
+	MAKO_INLINE UInt32 GetNumQueuedDrawCalls() const
+	{ return drawCalls.size(); }
+
+	//! Get the number of draw calls the last Flush() submitted
+	MAKO_INLINE UInt32 GetNumDrawCalls() const
+	{ return numDrawCalls; }
+
+	//! Get the number of times the last Flush() bound a material
+	MAKO_INLINE UInt32 GetNumMaterialBinds() const
+	{ return numMaterialBinds; }
+};
+
+MAKO_END_NAMESPACE
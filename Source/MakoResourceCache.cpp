@@ -0,0 +1,178 @@
+#include "MakoResourceCache.h"
+#include "MakoTexture.h"
+#include "MakoMesh.h"
+#include "MakoIndexedMeshData.h"
+#include "MakoCgShader.h"
+#include "MakoArrayList.h"
+
+MAKO_BEGIN_NAMESPACE
+
+ResourceCache::ResourceCache()
+{
+	for (UInt32 i = 0; i < RCT_ENUM_LENGTH; ++i)
+		memoryUsage[i] = 0;
+}
+
+ResourceCache::~ResourceCache()
+{ Clear(); }
+
+StringId ResourceCache::MakeKey(const FilePath& found, const StringView& options)
+{
+	String key;
+	key.Reserve(found.GetAbs().GetLength() + options.GetLength() + 1);
+	key.Append(found.GetAbs());
+	key.Append(StringChar('|'));
+	key.Append(options);
+	return InternString(key);
+}
+
+StringId ResourceCache::MakeKey(const FilePath& found, UInt32 options)
+{
+	String key;
+	key.Reserve(found.GetAbs().GetLength() + 11);
+	key.Append(found.GetAbs());
+	key.Append(StringChar('|'));
+	key.Append32BitUInt(options);
+	return InternString(key);
+}
+
+UInt32 ResourceCache::GetTextureSize(const Texture* texture)
+{ return texture->GetDataSize(); }
+
+UInt32 ResourceCache::GetMeshSize(const Mesh* mesh)
+{
+	UInt32 size = 0;
+	for (UInt32 i = 0; i < mesh->GetNumSubMeshes(); ++i)
+	{
+		const MeshData* md = mesh->GetSubMesh(i);
+		size += md->GetNumVertices() * md->GetVertexType();
+		if (md->IsIndexed())
+		{
+			const IndexedMeshData* imd = static_cast<const IndexedMeshData*>(md);
+			size += imd->GetNumVertexBufferIndices() * imd->GetVertexBufferIndexType();
+		}
+	}
+	return size;
+}
+
+bool ResourceCache::Contains(RESOURCE_CACHE_TYPE type, StringId key) const
+{
+	ScopedLock<Mutex> scoped(lock);
+	return entries[type].find(key) != entries[type].end();
+}
+
+ReferenceCounted* ResourceCache::Find(RESOURCE_CACHE_TYPE type, StringId key) const
+{
+	ScopedLock<Mutex> scoped(lock);
+	EntryMap::const_iterator it = entries[type].find(key);
+	return it != entries[type].end() ? (*it).second.resource : nullptr;
+}
+
+Texture* ResourceCache::FindTexture(StringId key) const
+{ return static_cast<Texture*>(Find(RCT_TEXTURE, key)); }
+
+Mesh* ResourceCache::FindMesh(StringId key) const
+{ return static_cast<Mesh*>(Find(RCT_MESH, key)); }
+
+CgShader* ResourceCache::FindShader(StringId key) const
+{ return static_cast<CgShader*>(Find(RCT_SHADER, key)); }
+
+void ResourceCache::Add(RESOURCE_CACHE_TYPE type, StringId key, ReferenceCounted* resource,
+						UInt32 size)
+{
+	resource->Hold();
+
+	ReferenceCounted* replaced = nullptr;
+	lock.Lock();
+	EntryMap::iterator it = entries[type].find(key);
+	if (it != entries[type].end())
+	{
+		replaced = (*it).second.resource;
+		memoryUsage[type] -= (*it).second.size;
+	}
+
+	Entry& e = entries[type][key];
+	e.resource = resource;
+	e.size     = size;
+	memoryUsage[type] += size;
+	lock.Unlock();
+
+	if (replaced)
+		replaced->Drop();
+}
+
+void ResourceCache::AddTexture(StringId key, Texture* texture)
+{ Add(RCT_TEXTURE, key, texture, GetTextureSize(texture)); }
+
+void ResourceCache::AddMesh(StringId key, Mesh* mesh)
+{ Add(RCT_MESH, key, mesh, GetMeshSize(mesh)); }
+
+void ResourceCache::AddShader(StringId key, CgShader* shader, UInt32 size)
+{ Add(RCT_SHADER, key, shader, size); }
+
+UInt32 ResourceCache::Purge(RESOURCE_CACHE_TYPE type)
+{
+	// Resources are dropped after the lock is released, since a mesh that is
+	// deleted drops it's textures
+	ArrayList<ReferenceCounted*> unused;
+	UInt32 freed = 0;
+
+	lock.Lock();
+	EntryMap::iterator it = entries[type].begin();
+	while (it != entries[type].end())
+	{
+		if ((*it).second.resource->GetReferenceCount() == 1)
+		{
+			unused.push_back((*it).second.resource);
+			freed += (*it).second.size;
+			entries[type].erase(it++);
+		}
+		else
+			++it;
+	}
+	memoryUsage[type] -= freed;
+	lock.Unlock();
+
+	for (UInt32 i = 0; i < unused.size(); ++i)
+		unused[i]->Drop();
+	return freed;
+}
+
+UInt32 ResourceCache::Purge()
+{
+	UInt32 freed = 0;
+	for (;;)
+	{
+		UInt32 freedNow = 0;
+		for (UInt32 i = 0; i < RCT_ENUM_LENGTH; ++i)
+			freedNow += Purge(static_cast<RESOURCE_CACHE_TYPE>(i));
+
+		// Meshes only drop their textures when they're destroyed
+		if (ReferenceCounted::IsDestructionDeferred())
+			ReferenceCounted::DestroyDroppedObjects();
+
+		if (!freedNow)
+			return freed;
+		freed += freedNow;
+	}
+}
+
+void ResourceCache::Clear()
+{
+	ArrayList<ReferenceCounted*> resources;
+
+	lock.Lock();
+	for (UInt32 i = 0; i < RCT_ENUM_LENGTH; ++i)
+	{
+		for (EntryMap::iterator it = entries[i].begin(); it != entries[i].end(); ++it)
+			resources.push_back((*it).second.resource);
+		entries[i].clear();
+		memoryUsage[i] = 0;
+	}
+	lock.Unlock();
+
+	for (UInt32 i = 0; i < resources.size(); ++i)
+		resources[i]->Drop();
+}
+
+MAKO_END_NAMESPACE
@@ -0,0 +1,134 @@
+#pragma once
+#include "MakoCommon.h"
+#include "MakoString.h"
+#include "MakoStringId.h"
+#include "MakoFilePath.h"
+#include "MakoMap.h"
+#include "MakoThread.h"
+#include "MakoReferenceCounted.h"
+#include "MakoAllocator.h"
+
+MAKO_BEGIN_NAMESPACE
+
+// Forward declarations
+class Texture;
+class Mesh;
+class CgShader;
+
+//! The types of resources a ResourceCache keeps apart
+enum RESOURCE_CACHE_TYPE
+{
+	RCT_TEXTURE,
+	RCT_MESH,
+	RCT_SHADER,
+	RCT_ENUM_LENGTH
+};
+
+//! Deduplicates the resources a GraphicsDevice loads from files. Resources
+//! are keyed by the path FileSystem::FindFile() resolved their file to, and
+//! the options they were loaded with (see MakeKey()), so loading a file twice
+//! returns the same resource, no matter which directory it was found through.
+//! Keys are interned, so finding a resource compares StringIds instead of
+//! paths.
+//!
+//! The cache holds every resource it contains once. Resources only the cache
+//! holds aren't used anymore, and are dropped by Purge(). The memory each type
+//! of resource takes up is tracked, to decide when purging is worth it.
+//!
+//! Contains() may be called by any thread, everything else only by the thread
+//! that renders, since it holds and drops resources.
+class ResourceCache
+{
+private:
+	struct Entry
+	{
+		ReferenceCounted* resource;
+		UInt32 size;
+	};
+
+	typedef Map<StringId, Entry, std::less<StringId>,
+		PoolAllocator<std::pair<const StringId, Entry>, MC_GRAPHICS> > EntryMap;
+
+	EntryMap entries[RCT_ENUM_LENGTH];
+	UInt32 memoryUsage[RCT_ENUM_LENGTH];
+	//! Guards entries, so Contains() can be called by any thread
+	mutable Mutex lock;
+
+	ReferenceCounted* Find(RESOURCE_CACHE_TYPE type, StringId key) const;
+	void Add(RESOURCE_CACHE_TYPE type, StringId key, ReferenceCounted* resource,
+			 UInt32 size);
+public:
+	MAKO_API ResourceCache();
+
+	//! Drops every resource
+	MAKO_API ~ResourceCache();
+
+	//! Make the key of a resource, by interning the path and the options.
+	//! Use FindInternedString() to see what a key was made of.
+	//! \param[in] found The path FileSystem::FindFile() resolved the file to
+	//! \param[in] options What the resource was loaded with, besides the file.
+	//! Resources loaded from the same file with different options are kept apart.
+	MAKO_API static StringId MakeKey(const FilePath& found, const StringView& options);
+
+	//! Make the key of a resource, whose options are a number (like the
+	//! format it was loaded as).
+	MAKO_API static StringId MakeKey(const FilePath& found, UInt32 options);
+
+	//! Get the number of bytes a texture's pixels take up
+	MAKO_API static UInt32 GetTextureSize(const Texture* texture);
+
+	//! Get the number of bytes the vertices and indices of a mesh take up
+	MAKO_API static UInt32 GetMeshSize(const Mesh* mesh);
+
+	//! Check if a resource is cached. Unlike the Find*() methods, this may be
+	//! called by any thread.
+	MAKO_API bool Contains(RESOURCE_CACHE_TYPE type, StringId key) const;
+
+	//! Find a cached texture.
+	//! \return The texture, or nullptr if it isn't cached. The cache holds
+	//! it, so Hold() it to keep it after the next Purge().
+	MAKO_API Texture* FindTexture(StringId key) const;
+
+	//! Find a cached mesh, like FindTexture()
+	MAKO_API Mesh* FindMesh(StringId key) const;
+
+	//! Find a cached shader, like FindTexture()
+	MAKO_API CgShader* FindShader(StringId key) const;
+
+	//! Adds a texture to the cache, which holds it. A resource that was cached
+	//! with the same key before is replaced.
+	MAKO_API void AddTexture(StringId key, Texture* texture);
+
+	//! Adds a mesh to the cache, like AddTexture()
+	MAKO_API void AddMesh(StringId key, Mesh* mesh);
+
+	//! Adds a shader to the cache, like AddTexture()
+	//! \param[in] size The number of bytes to count the shader as, like the
+	//! size of it's source.
+	MAKO_API void AddShader(StringId key, CgShader* shader, UInt32 size);
+
+	//! Drops the resources of a type only the cache holds.
+	//! \return The number of bytes the dropped resources took up.
+	MAKO_API UInt32 Purge(RESOURCE_CACHE_TYPE type);
+
+	//! Drops every resource only the cache holds. Dropping meshes may leave
+	//! their textures only held by the cache, so it purges until nothing is
+	//! dropped anymore. While destruction is deferred, it destroys the
+	//! dropped objects after every round, so it must not be called while
+	//! they may still be used (see ReferenceCounted::DestroyDroppedObjects()).
+	//! \return The number of bytes the dropped resources took up.
+	MAKO_API UInt32 Purge();
+
+	//! Drops every resource, whether it's still used or not
+	MAKO_API void Clear();
+
+	//! Get the number of bytes the cached resources of a type take up
+	MAKO_INLINE UInt32 GetMemoryUsage(RESOURCE_CACHE_TYPE type) const
+	{ return memoryUsage[type]; }
+
+	//! Get the number of cached resources of a type
+	MAKO_INLINE UInt32 GetNumResources(RESOURCE_CACHE_TYPE type) const
+	{ return entries[type].size(); }
+};
+
+MAKO_END_NAMESPACE
@@ -0,0 +1,416 @@
+#include "MakoSIMD.h"
+#include "MakoMath.h"
+
+#ifdef MAKO_SSE_AVAILABLE
+	#if MAKO_COMPILER == MAKO_COMPILER_MSVC
+		#include <intrin.h>
+		#if _MSC_VER >= 1600
+			#define MAKO_AVX_AVAILABLE
+			#define MAKO_AVX_FUNCTION
+		#endif
+	#elif MAKO_COMPILER == MAKO_COMPILER_GNUC
+		#include <cpuid.h>
+		#if (__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+			#define MAKO_AVX_AVAILABLE
+			#define MAKO_AVX_FUNCTION __attribute__((target("avx")))
+		#endif
+	#endif
+
+	#ifdef MAKO_AVX_AVAILABLE
+		#include <immintrin.h>
+	#endif
+#endif
+
+MAKO_BEGIN_NAMESPACE
+
+/////////////////////////////////////////////////////////////////
+// CPU detection
+
+static UInt32 DetectCPUFeatures()
+{
+	UInt32 features = 0;
+#ifdef MAKO_SSE_AVAILABLE
+	UInt32 ecx, edx;
+	#if MAKO_COMPILER == MAKO_COMPILER_MSVC
+		int regs[4];
+		__cpuid(regs, 1);
+		ecx = (UInt32)regs[2];
+		edx = (UInt32)regs[3];
+	#else
+		UInt32 eax, ebx;
+		if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+			return 0;
+	#endif
+
+	if (edx & (1 << 25)) features |= CPUF_SSE;
+	if (edx & (1 << 26)) features |= CPUF_SSE2;
+	if (ecx & (1 << 0))  features |= CPUF_SSE3;
+	if (ecx & (1 << 19)) features |= CPUF_SSE41;
+
+	// AVX needs the CPU to support it (bit 28), and the OS to save the
+	// YMM registers on context switches (OSXSAVE, bit 27, and XCR0).
+	#ifdef MAKO_AVX_AVAILABLE
+	if ((ecx & (1 << 27)) && (ecx & (1 << 28)))
+	{
+		UInt32 xcr0;
+		#if MAKO_COMPILER == MAKO_COMPILER_MSVC
+			xcr0 = (UInt32)_xgetbv(0);
+		#else
+			UInt32 xcr0hi;
+			__asm__ ("xgetbv" : "=a" (xcr0), "=d" (xcr0hi) : "c" (0));
+		#endif
+		if ((xcr0 & 6) == 6)
+			features |= CPUF_AVX;
+	}
+	#endif
+#endif
+	return features;
+}
+
+UInt32 GetCPUFeatures()
+{
+	static const UInt32 features = DetectCPUFeatures();
+	return features;
+}
+
+//! The best SIMD_LEVEL that both the compiler and the processor support
+static SIMD_LEVEL GetBestSIMDLevel()
+{
+#ifdef MAKO_AVX_AVAILABLE
+	if (GetCPUFeatures() & CPUF_AVX)
+		return SL_AVX;
+#endif
+#ifdef MAKO_SSE_AVAILABLE
+	if (GetCPUFeatures() & CPUF_SSE)
+		return SL_SSE;
+#endif
+	return SL_SCALAR;
+}
+
+SIMD_LEVEL simdLevel = GetBestSIMDLevel();
+
+SIMD_LEVEL SetSIMDLevel(SIMD_LEVEL level)
+{
+	SIMD_LEVEL best = GetBestSIMDLevel();
+	simdLevel = level > best ? best : level;
+	return simdLevel;
+}
+
+/////////////////////////////////////////////////////////////////
+// Inverse
+
+bool Matrix4fInverseScalar(Float32* out, const Float32* m)
+{
+	Float32 r[16];
+	Float32 d = (m[0] * m[5] - m[1] * m[4]) * (m[10] * m[15] - m[11] * m[14]) -
+		(m[0] * m[6] - m[2] * m[4]) * (m[9] * m[15] - m[11] * m[13]) +
+		(m[0] * m[7] - m[3] * m[4]) * (m[9] * m[14] - m[10] * m[13]) +
+		(m[1] * m[6] - m[2] * m[5]) * (m[8] * m[15] - m[11] * m[12]) -
+		(m[1] * m[7] - m[3] * m[5]) * (m[8] * m[14] - m[10] * m[12]) +
+		(m[2] * m[7] - m[3] * m[6]) * (m[8] * m[13] - m[9] * m[12]);
+
+	if( IsZero ( d ) )
+		return false;
+
+	d = Reciprocal ( d );
+
+	r[0] = d * (m[5] * (m[10] * m[15] - m[11] * m[14]) +
+		m[6] * (m[11] * m[13] - m[9] * m[15]) +
+		m[7] * (m[9] * m[14] - m[10] * m[13]));
+	r[1] = d * (m[9] * (m[2] * m[15] - m[3] * m[14]) +
+		m[10] * (m[3] * m[13] - m[1] * m[15]) +
+		m[11] * (m[1] * m[14] - m[2] * m[13]));
+	r[2] = d * (m[13] * (m[2] * m[7] - m[3] * m[6]) +
+		m[14] * (m[3] * m[5] - m[1] * m[7]) +
+		m[15] * (m[1] * m[6] - m[2] * m[5]));
+	r[3] = d * (m[1] * (m[7] * m[10] - m[6] * m[11]) +
+		m[2] * (m[5] * m[11] - m[7] * m[9]) +
+		m[3] * (m[6] * m[9] - m[5] * m[10]));
+	r[4] = d * (m[6] * (m[8] * m[15] - m[11] * m[12]) +
+		m[7] * (m[10] * m[12] - m[8] * m[14]) +
+		m[4] * (m[11] * m[14] - m[10] * m[15]));
+	r[5] = d * (m[10] * (m[0] * m[15] - m[3] * m[12]) +
+		m[11] * (m[2] * m[12] - m[0] * m[14]) +
+		m[8] * (m[3] * m[14] - m[2] * m[15]));
+	r[6] = d * (m[14] * (m[0] * m[7] - m[3] * m[4]) +
+		m[15] * (m[2] * m[4] - m[0] * m[6]) +
+		m[12] * (m[3] * m[6] - m[2] * m[7]));
+	r[7] = d * (m[2] * (m[7] * m[8] - m[4] * m[11]) +
+		m[3] * (m[4] * m[10] - m[6] * m[8]) +
+		m[0] * (m[6] * m[11] - m[7] * m[10]));
+	r[8] = d * (m[7] * (m[8] * m[13] - m[9] * m[12]) +
+		m[4] * (m[9] * m[15] - m[11] * m[13]) +
+		m[5] * (m[11] * m[12] - m[8] * m[15]));
+	r[9] = d * (m[11] * (m[0] * m[13] - m[1] * m[12]) +
+		m[8] * (m[1] * m[15] - m[3] * m[13]) +
+		m[9] * (m[3] * m[12] - m[0] * m[15]));
+	r[10] = d * (m[15] * (m[0] * m[5] - m[1] * m[4]) +
+		m[12] * (m[1] * m[7] - m[3] * m[5]) +
+		m[13] * (m[3] * m[4] - m[0] * m[7]));
+	r[11] = d * (m[3] * (m[5] * m[8] - m[4] * m[9]) +
+		m[0] * (m[7] * m[9] - m[5] * m[11]) +
+		m[1] * (m[4] * m[11] - m[7] * m[8]));
+	r[12] = d * (m[4] * (m[10] * m[13] - m[9] * m[14]) +
+		m[5] * (m[8] * m[14] - m[10] * m[12]) +
+		m[6] * (m[9] * m[12] - m[8] * m[13]));
+	r[13] = d * (m[8] * (m[2] * m[13] - m[1] * m[14]) +
+		m[9] * (m[0] * m[14] - m[2] * m[12]) +
+		m[10] * (m[1] * m[12] - m[0] * m[13]));
+	r[14] = d * (m[12] * (m[2] * m[5] - m[1] * m[6]) +
+		m[13] * (m[0] * m[6] - m[2] * m[4]) +
+		m[14] * (m[1] * m[4] - m[0] * m[5]));
+	r[15] = d * (m[0] * (m[5] * m[10] - m[6] * m[9]) +
+		m[1] * (m[6] * m[8] - m[4] * m[10]) +
+		m[2] * (m[4] * m[9] - m[5] * m[8]));
+	
+
+	memcpy(out, r, 16*sizeof(Float32));
+	return true;
+}
+
+#ifdef MAKO_SSE_AVAILABLE
+//! Swizzles the elements of v
+#define MAKO_SWIZZLE(v, x, y, z, w) _mm_shuffle_ps(v, v, _MM_SHUFFLE(w, z, y, x))
+
+//! 2x2 row major matrix multiply: a * b
+static MAKO_REALINLINE __m128 Mat2Mul(__m128 a, __m128 b)
+{
+	return _mm_add_ps(_mm_mul_ps(a, MAKO_SWIZZLE(b, 0,3,0,3)),
+		_mm_mul_ps(MAKO_SWIZZLE(a, 1,0,3,2), MAKO_SWIZZLE(b, 2,1,2,1)));
+}
+
+//! 2x2 row major matrix adjugate multiply: adj(a) * b
+static MAKO_REALINLINE __m128 Mat2AdjMul(__m128 a, __m128 b)
+{
+	return _mm_sub_ps(_mm_mul_ps(MAKO_SWIZZLE(a, 3,3,0,0), b),
+		_mm_mul_ps(MAKO_SWIZZLE(a, 1,1,2,2), MAKO_SWIZZLE(b, 2,3,0,1)));
+}
+
+//! 2x2 row major matrix multiply adjugate: a * adj(b)
+static MAKO_REALINLINE __m128 Mat2MulAdj(__m128 a, __m128 b)
+{
+	return _mm_sub_ps(_mm_mul_ps(a, MAKO_SWIZZLE(b, 3,0,3,0)),
+		_mm_mul_ps(MAKO_SWIZZLE(a, 1,0,3,2), MAKO_SWIZZLE(b, 2,1,2,1)));
+}
+
+bool Matrix4fInverseSSE(Float32* out, const Float32* m)
+{
+	const __m128 r0 = _mm_loadu_ps(m);
+	const __m128 r1 = _mm_loadu_ps(m + 4);
+	const __m128 r2 = _mm_loadu_ps(m + 8);
+	const __m128 r3 = _mm_loadu_ps(m + 12);
+
+	// The 2x2 blocks of m:
+	// | A B |
+	// | C D |
+	const __m128 A = _mm_movelh_ps(r0, r1);
+	const __m128 B = _mm_movehl_ps(r1, r0);
+	const __m128 C = _mm_movelh_ps(r2, r3);
+	const __m128 D = _mm_movehl_ps(r3, r2);
+
+	// (|A|, |B|, |C|, |D|)
+	const __m128 detSub = _mm_sub_ps(
+		_mm_mul_ps(_mm_shuffle_ps(r0, r2, _MM_SHUFFLE(2,0,2,0)), _mm_shuffle_ps(r1, r3, _MM_SHUFFLE(3,1,3,1))),
+		_mm_mul_ps(_mm_shuffle_ps(r0, r2, _MM_SHUFFLE(3,1,3,1)), _mm_shuffle_ps(r1, r3, _MM_SHUFFLE(2,0,2,0))));
+	const __m128 detA = MAKO_SWIZZLE(detSub, 0,0,0,0);
+	const __m128 detB = MAKO_SWIZZLE(detSub, 1,1,1,1);
+	const __m128 detC = MAKO_SWIZZLE(detSub, 2,2,2,2);
+	const __m128 detD = MAKO_SWIZZLE(detSub, 3,3,3,3);
+
+	const __m128 D_C = Mat2AdjMul(D, C);
+	const __m128 A_B = Mat2AdjMul(A, B);
+
+	// The adjugates of the blocks of the inverse, times |M|
+	__m128 X_ = _mm_sub_ps(_mm_mul_ps(detD, A), Mat2Mul(B, D_C));
+	__m128 W_ = _mm_sub_ps(_mm_mul_ps(detA, D), Mat2Mul(C, A_B));
+	__m128 Y_ = _mm_sub_ps(_mm_mul_ps(detB, C), Mat2MulAdj(D, A_B));
+	__m128 Z_ = _mm_sub_ps(_mm_mul_ps(detC, B), Mat2MulAdj(A, D_C));
+
+	// |M| = |A|*|D| + |B|*|C| - tr(adj(A)B * adj(D)C)
+	__m128 tr = _mm_mul_ps(A_B, MAKO_SWIZZLE(D_C, 0,2,1,3));
+	tr = _mm_add_ps(tr, _mm_movehl_ps(tr, tr));
+	tr = _mm_add_ss(tr, MAKO_SWIZZLE(tr, 1,1,1,1));
+	const Float32 det = _mm_cvtss_f32(detA) * _mm_cvtss_f32(detD) +
+		_mm_cvtss_f32(detB) * _mm_cvtss_f32(detC) - _mm_cvtss_f32(tr);
+
+	if (IsZero(det))
+		return false;
+
+	const Float32 rdet = Reciprocal(det);
+	const __m128 rDetM = _mm_setr_ps(rdet, -rdet, -rdet, rdet);
+	X_ = _mm_mul_ps(X_, rDetM);
+	Y_ = _mm_mul_ps(Y_, rDetM);
+	Z_ = _mm_mul_ps(Z_, rDetM);
+	W_ = _mm_mul_ps(W_, rDetM);
+
+	// Apply the adjugate and store
+	_mm_storeu_ps(out,      _mm_shuffle_ps(X_, Y_, _MM_SHUFFLE(1,3,1,3)));
+	_mm_storeu_ps(out + 4,  _mm_shuffle_ps(X_, Y_, _MM_SHUFFLE(0,2,0,2)));
+	_mm_storeu_ps(out + 8,  _mm_shuffle_ps(Z_, W_, _MM_SHUFFLE(1,3,1,3)));
+	_mm_storeu_ps(out + 12, _mm_shuffle_ps(Z_, W_, _MM_SHUFFLE(0,2,0,2)));
+	return true;
+}
+
+#undef MAKO_SWIZZLE
+#endif
+
+/////////////////////////////////////////////////////////////////
+// Batches
+
+//! Advances a pointer to a Float32 by a number of bytes
+#define MAKO_ADVANCE(ptr, bytes) ptr = (Float32*)((Byte*)(ptr) + (bytes))
+#define MAKO_ADVANCE_CONST(ptr, bytes) ptr = (const Float32*)((const Byte*)(ptr) + (bytes))
+
+#ifdef MAKO_AVX_AVAILABLE
+//! Computes one product, two rows at a time: each 256 bit register holds
+//! two rows of b, and then those two rows of the product.
+static MAKO_AVX_FUNCTION void Matrix4fMultiplyAVX(Float32* out, const Float32* a, const Float32* b)
+{
+	const __m256 a0 = _mm256_broadcast_ps((const __m128*)a);
+	const __m256 a1 = _mm256_broadcast_ps((const __m128*)(a + 4));
+	const __m256 a2 = _mm256_broadcast_ps((const __m128*)(a + 8));
+	const __m256 a3 = _mm256_broadcast_ps((const __m128*)(a + 12));
+
+	const __m256 b01 = _mm256_loadu_ps(b);
+	const __m256 b23 = _mm256_loadu_ps(b + 8);
+
+	__m256 r01 = _mm256_mul_ps(a0, _mm256_shuffle_ps(b01, b01, _MM_SHUFFLE(0,0,0,0)));
+	r01 = _mm256_add_ps(r01, _mm256_mul_ps(a1, _mm256_shuffle_ps(b01, b01, _MM_SHUFFLE(1,1,1,1))));
+	r01 = _mm256_add_ps(r01, _mm256_mul_ps(a2, _mm256_shuffle_ps(b01, b01, _MM_SHUFFLE(2,2,2,2))));
+	r01 = _mm256_add_ps(r01, _mm256_mul_ps(a3, _mm256_shuffle_ps(b01, b01, _MM_SHUFFLE(3,3,3,3))));
+
+	__m256 r23 = _mm256_mul_ps(a0, _mm256_shuffle_ps(b23, b23, _MM_SHUFFLE(0,0,0,0)));
+	r23 = _mm256_add_ps(r23, _mm256_mul_ps(a1, _mm256_shuffle_ps(b23, b23, _MM_SHUFFLE(1,1,1,1))));
+	r23 = _mm256_add_ps(r23, _mm256_mul_ps(a2, _mm256_shuffle_ps(b23, b23, _MM_SHUFFLE(2,2,2,2))));
+	r23 = _mm256_add_ps(r23, _mm256_mul_ps(a3, _mm256_shuffle_ps(b23, b23, _MM_SHUFFLE(3,3,3,3))));
+
+	_mm256_storeu_ps(out, r01);
+	_mm256_storeu_ps(out + 8, r23);
+}
+
+static MAKO_AVX_FUNCTION void Matrix4fMultiplyBatchAVX(Float32* out, UInt32 outStride,
+													   const Float32* a, UInt32 aStride,
+													   const Float32* b, UInt32 bStride,
+													   UInt32 count)
+{
+	for (UInt32 i = 0; i < count; ++i)
+	{
+		Matrix4fMultiplyAVX(out, a, b);
+		MAKO_ADVANCE(out, outStride);
+		MAKO_ADVANCE_CONST(a, aStride);
+		MAKO_ADVANCE_CONST(b, bStride);
+	}
+	// Avoid the penalty of mixing AVX and legacy SSE code
+	_mm256_zeroupper();
+}
+
+//! Transforms two vectors per iteration into 4 component vectors
+static MAKO_AVX_FUNCTION void Matrix4fTransformBatch4AVX(Float32* out, const Float32* m,
+														 const Float32* in, UInt32 count)
+{
+	const __m256 m0 = _mm256_broadcast_ps((const __m128*)m);
+	const __m256 m1 = _mm256_broadcast_ps((const __m128*)(m + 4));
+	const __m256 m2 = _mm256_broadcast_ps((const __m128*)(m + 8));
+	const __m256 m3 = _mm256_broadcast_ps((const __m128*)(m + 12));
+
+	UInt32 i = 0;
+	for (; i + 1 < count; i += 2, in += 6, out += 8)
+	{
+		__m256 r = _mm256_mul_ps(m0, _mm256_setr_ps(in[0], in[0], in[0], in[0], in[3], in[3], in[3], in[3]));
+		r = _mm256_add_ps(r, _mm256_mul_ps(m1, _mm256_setr_ps(in[1], in[1], in[1], in[1], in[4], in[4], in[4], in[4])));
+		r = _mm256_add_ps(r, _mm256_mul_ps(m2, _mm256_setr_ps(in[2], in[2], in[2], in[2], in[5], in[5], in[5], in[5])));
+		_mm256_storeu_ps(out, _mm256_add_ps(r, m3));
+	}
+	_mm256_zeroupper();
+
+	if (i < count)
+		_mm_storeu_ps(out, Matrix4fTransformSSE(m, in[0], in[1], in[2]));
+}
+#endif
+
+void Matrix4fMultiplyBatch(Float32* out, UInt32 outStride,
+						   const Float32* a, UInt32 aStride,
+						   const Float32* b, UInt32 bStride,
+						   UInt32 count)
+{
+	switch (GetSIMDLevel())
+	{
+#ifdef MAKO_AVX_AVAILABLE
+	case SL_AVX:
+		Matrix4fMultiplyBatchAVX(out, outStride, a, aStride, b, bStride, count);
+		return;
+#endif
+#ifdef MAKO_SSE_AVAILABLE
+	case SL_SSE:
+		for (UInt32 i = 0; i < count; ++i)
+		{
+			Matrix4fMultiplySSE(out, a, b);
+			MAKO_ADVANCE(out, outStride);
+			MAKO_ADVANCE_CONST(a, aStride);
+			MAKO_ADVANCE_CONST(b, bStride);
+		}
+		return;
+#endif
+	default:
+		for (UInt32 i = 0; i < count; ++i)
+		{
+			Matrix4fMultiplyScalar(out, a, b);
+			MAKO_ADVANCE(out, outStride);
+			MAKO_ADVANCE_CONST(a, aStride);
+			MAKO_ADVANCE_CONST(b, bStride);
+		}
+		return;
+	}
+}
+
+void Matrix4fTransformBatch(Float32* out, UInt32 outComponents,
+							const Float32* m, const Float32* in,
+							UInt32 count)
+{
+	const SIMD_LEVEL level = GetSIMDLevel();
+
+#ifdef MAKO_AVX_AVAILABLE
+	if (level == SL_AVX && outComponents == 4)
+	{
+		Matrix4fTransformBatch4AVX(out, m, in, count);
+		return;
+	}
+#endif
+
+#ifdef MAKO_SSE_AVAILABLE
+	if (level >= SL_SSE)
+	{
+		if (outComponents == 4)
+		{
+			for (UInt32 i = 0; i < count; ++i, in += 3, out += 4)
+				_mm_storeu_ps(out, Matrix4fTransformSSE(m, in[0], in[1], in[2]));
+		}
+		else
+		{
+			// Only 3 floats are written per vector, so in may be out
+			for (UInt32 i = 0; i < count; ++i, in += 3, out += 3)
+			{
+				const __m128 r = Matrix4fTransformSSE(m, in[0], in[1], in[2]);
+				_mm_storel_pi((__m64*)out, r);
+				_mm_store_ss(out + 2, _mm_movehl_ps(r, r));
+			}
+		}
+		return;
+	}
+#endif
+
+	for (UInt32 i = 0; i < count; ++i, in += 3, out += outComponents)
+	{
+		const Float32 x = in[0], y = in[1], z = in[2];
+		out[0] = x*m[0] + y*m[4] + z*m[8]  + m[12];
+		out[1] = x*m[1] + y*m[5] + z*m[9]  + m[13];
+		out[2] = x*m[2] + y*m[6] + z*m[10] + m[14];
+		if (outComponents == 4)
+			out[3] = x*m[3] + y*m[7] + z*m[11] + m[15];
+	}
+}
+
+#undef MAKO_ADVANCE
+#undef MAKO_ADVANCE_CONST
+
+MAKO_END_NAMESPACE
@@ -0,0 +1,127 @@
+#pragma once
+#include "MakoCommon.h"
+#include <string.h>
+
+// SSE is used wherever the compiler may emit it: always on x64, and on x86
+// when compiling with /arch:SSE or higher (-msse with GCC).
+#if defined (_M_X64) || defined (_M_AMD64) || defined (__x86_64__) || \
+	(defined (_M_IX86_FP) && _M_IX86_FP >= 1) || defined (__SSE__)
+	#define MAKO_SSE_AVAILABLE
+	#include <xmmintrin.h>
+#endif
+
+MAKO_BEGIN_NAMESPACE
+
+//! Instruction set extensions reported by GetCPUFeatures()
+enum CPU_FEATURE
+{
+	CPUF_SSE   = 1 << 0,
+	CPUF_SSE2  = 1 << 1,
+	CPUF_SSE3  = 1 << 2,
+	CPUF_SSE41 = 1 << 3,
+	//! Only reported if the operating system saves the AVX registers, too.
+	CPUF_AVX   = 1 << 4
+};
+
+//! The widest instruction set the Matrix4<Float32> kernels may use.
+enum SIMD_LEVEL
+{
+	SL_SCALAR,
+	SL_SSE,
+	SL_AVX
+};
+
+//! Get the CPU_FEATUREs of the processor this is running on, OR'ed together.
+//! The cpuid instruction is only executed the first time.
+MAKO_API UInt32 GetCPUFeatures();
+
+//! The SIMD_LEVEL that is currently used. It is set to the best level the
+//! processor supports when the engine is loaded; use SetSIMDLevel() to change it.
+extern MAKO_API SIMD_LEVEL simdLevel;
+
+//! Get the SIMD_LEVEL that is currently used by the Matrix4<Float32> kernels.
+MAKO_INLINE SIMD_LEVEL GetSIMDLevel()
+{ return simdLevel; }
+
+//! Force the Matrix4<Float32> kernels to use a certain SIMD_LEVEL, e.g. to
+//! compare them with the scalar code. Levels the processor (or the compiler)
+//! doesn't support are lowered to the best one that is supported.
+//! \return The level that is used from now on.
+MAKO_API SIMD_LEVEL SetSIMDLevel(SIMD_LEVEL level);
+
+/////////////////////////////////////////////////////////////////
+// Matrix4<Float32> kernels. Matrices are 16 floats, laid out like
+// Matrix4::M. The output may alias any of the inputs.
+
+//! out = a * b, as Matrix4::SetByproductNoCheck() does it.
+MAKO_INLINE void Matrix4fMultiplyScalar(Float32* out, const Float32* a, const Float32* b)
+{
+	Float32 m[16];
+	for (UInt32 c = 0; c < 4; ++c)
+	{
+		const Float32* bc = &b[c*4];
+		m[c*4+0] = a[0]*bc[0] + a[4]*bc[1] + a[8]*bc[2]  + a[12]*bc[3];
+		m[c*4+1] = a[1]*bc[0] + a[5]*bc[1] + a[9]*bc[2]  + a[13]*bc[3];
+		m[c*4+2] = a[2]*bc[0] + a[6]*bc[1] + a[10]*bc[2] + a[14]*bc[3];
+		m[c*4+3] = a[3]*bc[0] + a[7]*bc[1] + a[11]*bc[2] + a[15]*bc[3];
+	}
+	memcpy(out, m, 16*sizeof(Float32));
+}
+
+//! out = the inverse of m, calculated with Cramer's rule like Matrix4::GetInverse().
+//! \return false if m has no inverse, out is not modified then.
+MAKO_API bool Matrix4fInverseScalar(Float32* out, const Float32* m);
+
+#ifdef MAKO_SSE_AVAILABLE
+//! SSE version of Matrix4fMultiplyScalar()
+MAKO_INLINE void Matrix4fMultiplySSE(Float32* out, const Float32* a, const Float32* b)
+{
+	const __m128 a0 = _mm_loadu_ps(a);
+	const __m128 a1 = _mm_loadu_ps(a + 4);
+	const __m128 a2 = _mm_loadu_ps(a + 8);
+	const __m128 a3 = _mm_loadu_ps(a + 12);
+
+	// Row c of the result is the rows of a, weighted by row c of b. Every row of
+	// b is read before the same row of out is written, so out may be b.
+	for (UInt32 c = 0; c < 16; c += 4)
+	{
+		const __m128 bc = _mm_loadu_ps(b + c);
+		__m128 r = _mm_mul_ps(a0, _mm_shuffle_ps(bc, bc, _MM_SHUFFLE(0,0,0,0)));
+		r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_shuffle_ps(bc, bc, _MM_SHUFFLE(1,1,1,1))));
+		r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_shuffle_ps(bc, bc, _MM_SHUFFLE(2,2,2,2))));
+		r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_shuffle_ps(bc, bc, _MM_SHUFFLE(3,3,3,3))));
+		_mm_storeu_ps(out + c, r);
+	}
+}
+
+//! out = x*m[0..3] + y*m[4..7] + z*m[8..11] + m[12..15], the 4 component
+//! result of Matrix4::TransformVect(T*, const Vec3df&).
+MAKO_INLINE __m128 Matrix4fTransformSSE(const Float32* m, Float32 x, Float32 y, Float32 z)
+{
+	__m128 r = _mm_mul_ps(_mm_loadu_ps(m), _mm_set1_ps(x));
+	r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(m + 4), _mm_set1_ps(y)));
+	r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(m + 8), _mm_set1_ps(z)));
+	return _mm_add_ps(r, _mm_loadu_ps(m + 12));
+}
+
+//! SSE version of Matrix4fInverseScalar(). It inverts the four 2x2 blocks of
+//! m instead of expanding every cofactor.
+MAKO_API bool Matrix4fInverseSSE(Float32* out, const Float32* m);
+#endif
+
+//! Sets out[i] = a[i] * b[i] for count matrices. The strides are in bytes,
+//! so the matrices can be members of larger structures, like Matrix4<Float32>.
+//! A stride of 0 uses the same matrix for every product. Uses GetSIMDLevel().
+MAKO_API void Matrix4fMultiplyBatch(Float32* out, UInt32 outStride,
+									const Float32* a, UInt32 aStride,
+									const Float32* b, UInt32 bStride,
+									UInt32 count);
+
+//! Transforms count vectors of 3 Float32s by m. out receives count vectors of
+//! outComponents (3 or 4) Float32s, like the two Matrix4::TransformVect() overloads
+//! would write them. out may be in, if outComponents is 3. Uses GetSIMDLevel().
+MAKO_API void Matrix4fTransformBatch(Float32* out, UInt32 outComponents,
+									 const Float32* m, const Float32* in,
+									 UInt32 count);
+
+MAKO_END_NAMESPACE
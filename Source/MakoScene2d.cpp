@@ -1,27 +1,264 @@
 #include "MakoScene2d.h"
+#include <algorithm>
+#include <cmath>
 
 MAKO_BEGIN_NAMESPACE
 
+//! Orders siblings by their draw order; std::stable_sort keeps siblings of
+//! the same order in the order they were added
+struct Scene2dDrawOrderLess
+{
+	MAKO_INLINE bool operator()(const Scene2dNode* a, const Scene2dNode* b) const
+	{ return a->GetDrawOrder() < b->GetDrawOrder(); }
+};
+
+//! Get the bucket of the grid cell (x, y)
+static MAKO_INLINE UInt32 HashCell(Int32 x, Int32 y)
+{
+	return ((static_cast<UInt32>(x) * 73856093u) ^ (static_cast<UInt32>(y) * 19349663u)) &
+		(Scene2d::GRID_BUCKETS - 1);
+}
+
+//! Get the cell a screen coordinate is in
+static MAKO_INLINE Int32 GetCell(Float32 v)
+{ return static_cast<Int32>(floorf(v / Scene2d::GRID_CELL_SIZE)); }
+
+Scene2d::Scene2d()
+: drawRanksDirty(false), queryStamp(0), viewportPos(0, 0), viewportSize(0, 0)
+{
+	buckets.resize(GRID_BUCKETS);
+
+	root = new Root2dSceneNode;
+	root->scene = this;
+	root->Hold();
+}
+
+Scene2d::~Scene2d()
+{
+	// Nodes held elsewhere outlive the scene, so they're taken out of it first
+	for (UInt32 i = 0; i < root->GetNumberOfChildren(); ++i)
+		RemoveNode_r(root->GetChild(i));
+	root->scene = nullptr;
+	root->Drop();
+}
+
 Scene2d::Root2dSceneNode* Scene2d::GetRootNode() const
 { return root; }
 
 void Scene2d::DrawAll()
 {
-	UpdateThenDrawChildren_r(root);
+	// Sort the nodes that moved into the grid again
+	for (UInt32 i = 0; i < movedNodes.size(); ++i)
+	{
+		movedNodes[i]->boundsMoved = false;
+		RemoveFromGrid(movedNodes[i]);
+		InsertIntoGrid(movedNodes[i]);
+	}
+	movedNodes.clear();
+
+	if (drawRanksDirty)
+	{
+		UInt32 rank = 0;
+		UpdateDrawRanks_r(root, rank);
+		drawRanksDirty = false;
+	}
+
+	visible.clear();
+	++queryStamp;
+	if (viewportSize.x == 0 || viewportSize.y == 0)
+	{
+		for (UInt32 i = 0; i < slots.size(); ++i)
+		{
+			if (slots[i].node)
+			{
+				VisibleNode v = { slots[i].node->drawRank, slots[i].node };
+				visible.push_back(v);
+			}
+		}
+	}
+	else
+	{
+		const Vec2df minCorner(static_cast<Float32>(viewportPos.x), static_cast<Float32>(viewportPos.y));
+		const Vec2df maxCorner(minCorner.x + viewportSize.x, minCorner.y + viewportSize.y);
+		const Int32 x0 = GetCell(minCorner.x), y0 = GetCell(minCorner.y);
+		const Int32 x1 = GetCell(maxCorner.x), y1 = GetCell(maxCorner.y);
+
+		if (static_cast<UInt32>(x1 - x0 + 1) * static_cast<UInt32>(y1 - y0 + 1) >= GRID_BUCKETS)
+		{
+			// The viewport covers more cells than there are buckets
+			for (UInt32 b = 0; b < buckets.size(); ++b)
+				for (UInt32 i = 0; i < buckets[b].size(); ++i)
+					CollectVisible(buckets[b][i], minCorner, maxCorner);
+		}
+		else
+		{
+			for (Int32 y = y0; y <= y1; ++y)
+			{
+				for (Int32 x = x0; x <= x1; ++x)
+				{
+					const Bucket& bucket = buckets[HashCell(x, y)];
+					for (UInt32 i = 0; i < bucket.size(); ++i)
+						CollectVisible(bucket[i], minCorner, maxCorner);
+				}
+			}
+		}
+
+		for (UInt32 i = 0; i < looseNodes.size(); ++i)
+			CollectVisible(looseNodes[i], minCorner, maxCorner);
+	}
+
+	std::sort(visible.begin(), visible.end());
+
+	// Updating a node may remove others from the scene, so they're held
+	// until they're drawn, and skipped once they're removed
+	for (UInt32 i = 0; i < visible.size(); ++i)
+		visible[i].node->Hold();
+
+	for (UInt32 i = 0; i < visible.size(); ++i)
+	{
+		Scene2dNode* n = visible[i].node;
+		if (n->scene == this)
+			n->Update();
+		if (n->scene == this)
+			n->Draw(&spriteBatch);
+		n->Drop();
+	}
+
+	spriteBatch.Flush(APP()->GetGraphicsDevice());
 }
 
-void Scene2d::UpdateThenDrawChildren_r(Scene2dNode* n)
+void Scene2d::CollectVisible(Scene2dNode* n, const Vec2df& minCorner, const Vec2df& maxCorner)
 {
-	if (n->GetNumberOfChildren() == 0)
+	if (n->queryStamp == queryStamp)
 		return ;
+	n->queryStamp = queryStamp;
 
-	for (UInt16 i = 0; i < n->GetNumberOfChildren(); i++)
+	if (n->size.x != 0 && n->size.y != 0)
 	{
-		n->GetChild(i)->Update();
-		n->GetChild(i)->Draw();
-		UpdateThenDrawChildren_r(n->GetChild(i));
+		Vec2df nmin, nmax;
+		n->GetBounds(nmin, nmax);
+		if (nmax.x < minCorner.x || nmax.y < minCorner.y || nmin.x > maxCorner.x || nmin.y > maxCorner.y)
+			return ;
 	}
+
+	VisibleNode v = { n->drawRank, n };
+	visible.push_back(v);
 }
 
-MAKO_END_NAMESPACE
+void Scene2d::AddNode_r(Scene2dNode* n)
+{
+	n->scene = this;
 
+	if (freeSlots.empty())
+	{
+		NodeSlot s = { n, 0 };
+		n->slot = slots.size();
+		slots.push_back(s);
+	}
+	else
+	{
+		n->slot = freeSlots.back();
+		freeSlots.pop_back();
+		slots[n->slot].node = n;
+	}
+
+	InsertIntoGrid(n);
+	drawRanksDirty = true;
+
+	for (UInt32 i = 0; i < n->children.size(); ++i)
+		AddNode_r(n->children[i]);
+}
+
+void Scene2d::RemoveNode_r(Scene2dNode* n)
+{
+	for (UInt32 i = 0; i < n->children.size(); ++i)
+		RemoveNode_r(n->children[i]);
+
+	RemoveFromGrid(n);
+	if (n->boundsMoved)
+	{
+		movedNodes.erase(std::find(movedNodes.begin(), movedNodes.end(), n));
+		n->boundsMoved = false;
+	}
+
+	slots[n->slot].node = nullptr;
+	++slots[n->slot].generation;
+	freeSlots.push_back(n->slot);
+
+	n->scene = nullptr;
+	drawRanksDirty = true;
+}
+
+void Scene2d::InsertIntoGrid(Scene2dNode* n)
+{
+	if (n->size.x != 0 && n->size.y != 0)
+	{
+		Vec2df minCorner, maxCorner;
+		n->GetBounds(minCorner, maxCorner);
+		n->cells[0] = GetCell(minCorner.x);
+		n->cells[1] = GetCell(minCorner.y);
+		n->cells[2] = GetCell(maxCorner.x);
+		n->cells[3] = GetCell(maxCorner.y);
+
+		const UInt32 numCells = static_cast<UInt32>(n->cells[2] - n->cells[0] + 1) *
+		                        static_cast<UInt32>(n->cells[3] - n->cells[1] + 1);
+		if (numCells <= GRID_MAX_NODE_CELLS)
+		{
+			for (Int32 y = n->cells[1]; y <= n->cells[3]; ++y)
+				for (Int32 x = n->cells[0]; x <= n->cells[2]; ++x)
+					buckets[HashCell(x, y)].push_back(n);
+			return ;
+		}
+	}
+
+	n->looseIndex = looseNodes.size();
+	looseNodes.push_back(n);
+}
+
+void Scene2d::RemoveFromGrid(Scene2dNode* n)
+{
+	if (n->looseIndex != 0xFFFFFFFF)
+	{
+		// Swap it with the last one
+		looseNodes[n->looseIndex] = looseNodes.back();
+		looseNodes[n->looseIndex]->looseIndex = n->looseIndex;
+		looseNodes.pop_back();
+		n->looseIndex = 0xFFFFFFFF;
+		return ;
+	}
+
+	// A node is in a bucket once for every one of it's cells that hashes to it
+	for (Int32 y = n->cells[1]; y <= n->cells[3]; ++y)
+	{
+		for (Int32 x = n->cells[0]; x <= n->cells[2]; ++x)
+		{
+			Bucket& bucket = buckets[HashCell(x, y)];
+			for (UInt32 i = 0; i < bucket.size(); ++i)
+			{
+				if (bucket[i] == n)
+				{
+					bucket[i] = bucket.back();
+					bucket.pop_back();
+					break;
+				}
+			}
+		}
+	}
+}
+
+void Scene2d::UpdateDrawRanks_r(Scene2dNode* n, UInt32& rank)
+{
+	if (!n->childrenSorted)
+	{
+		std::stable_sort(n->children.begin(), n->children.end(), Scene2dDrawOrderLess());
+		n->childrenSorted = true;
+	}
+
+	for (UInt32 i = 0; i < n->children.size(); ++i)
+	{
+		n->children[i]->drawRank = rank++;
+		UpdateDrawRanks_r(n->children[i], rank);
+	}
+}
+
+MAKO_END_NAMESPACE
@@ -4,11 +4,18 @@
 #include "MakoVec3d.h"
 #include "MakoCamera.h"
 #include "MakoApplication.h"
+#include "MakoSpriteBatch.h"
+#include "MakoAllocator.h"
 
 MAKO_BEGIN_NAMESPACE
 
+//! A 2d scene: a tree of Scene2dNodes that are updated and drawn every
+//! frame by DrawAll(), in their draw order. Nodes with a size are kept in a
+//! uniform grid of GRID_CELL_SIZE pixels, so only the ones on the viewport
+//! are found, without visiting the others.
 class Scene2d : public ReferenceCounted
 {
+	friend class Scene2dNode;
 private:
 	class Root2dSceneNode : public Scene2dNode
 	{
@@ -17,23 +24,117 @@ private:
 		MAKO_INLINE ~Root2dSceneNode() {}
 	};
 
+	struct NodeSlot
+	{
+		//! nullptr if the slot is free
+		Scene2dNode* node;
+		//! Incremented every time the slot is freed, so old handles to it
+		//! become invalid
+		UInt32 generation;
+	};
+
+	//! A node that is drawn this frame, sorted by it's draw rank
+	struct VisibleNode
+	{
+		UInt32 drawRank;
+		Scene2dNode* node;
+		MAKO_INLINE bool operator<(const VisibleNode& other) const
+		{ return drawRank < other.drawRank; }
+	};
+
 	Root2dSceneNode* root;
+	//! Every Sprite of the scene is queued in it and drawn at the end of DrawAll()
+	SpriteBatch spriteBatch;
+
+	//! Every node but the root, addressed by Scene2dNodeHandles
+	ArrayList<NodeSlot> slots;
+	ArrayList<UInt32> freeSlots;
+
+	//! Buckets are small, and grow and shrink as nodes move, so they're
+	//! allocated from the pools
+	typedef ArrayList<Scene2dNode*, PoolAllocator<Scene2dNode*, MC_SCENE> > Bucket;
+
+	//! The buckets of the grid. The infinite grid is hashed into them, so
+	//! cells far apart may share a bucket; queries test the bounds of the
+	//! nodes they find.
+	ArrayList<Bucket> buckets;
+	//! Nodes that are tested on every query instead of being in the grid:
+	//! those of size 0, and those that cover too many cells
+	ArrayList<Scene2dNode*> looseNodes;
+	//! Nodes whose bounds changed since they were put into the grid
+	ArrayList<Scene2dNode*> movedNodes;
+	//! Set when nodes were added or removed, or their draw order changed
+	bool drawRanksDirty;
+	UInt32 queryStamp;
+	//! The nodes DrawAll() draws, kept so it's memory is reused
+	ArrayList<VisibleNode> visible;
+
+	Pos2d viewportPos;
+	Size2d viewportSize;
+
+	//! Gives a node and it's children slots, and puts them into the grid
+	void AddNode_r(Scene2dNode* n);
+	//! Takes a node and it's children out of the scene
+	void RemoveNode_r(Scene2dNode* n);
+
+	void InsertIntoGrid(Scene2dNode* n);
+	void RemoveFromGrid(Scene2dNode* n);
+
+	//! Adds n to visible if the query didn't find it yet, and it's bounds
+	//! are on the viewport
+	void CollectVisible(Scene2dNode* n, const Vec2df& minCorner, const Vec2df& maxCorner);
 
-	// Recursive function
-	void UpdateThenDrawChildren_r(Scene2dNode* n);
+	//! Numbers the nodes in the order they're drawn: depth first, and
+	//! siblings by their draw order
+	void UpdateDrawRanks_r(Scene2dNode* n, UInt32& rank);
 public:
-	MAKO_INLINE Scene2d()
-	{
-		root = new Root2dSceneNode;
-		root->Hold();
-	}
-	
-	MAKO_INLINE ~Scene2d()
-	{ root->Drop(); }
+	//! The width and height of a cell of the grid, in pixels
+	static const Int32 GRID_CELL_SIZE = 128;
+	//! The number of buckets the grid is hashed into
+	static const UInt32 GRID_BUCKETS = 4096;
+	//! Nodes covering more cells are tested on every query instead
+	static const UInt32 GRID_MAX_NODE_CELLS = 64;
+
+	MAKO_API Scene2d();
+	MAKO_API ~Scene2d();
 
+	//! Updates and draws every node on the viewport, in their draw order,
+	//! and then the sprites they queued.
 	void DrawAll();
 
 	Root2dSceneNode* GetRootNode() const;
+
+	//! Get the node a handle refers to, or nullptr if it's not in the scene
+	//! anymore
+	MAKO_INLINE Scene2dNode* GetNode(const Scene2dNodeHandle& handle) const
+	{
+		if (handle.index >= slots.size() || slots[handle.index].generation != handle.generation)
+			return nullptr;
+		return slots[handle.index].node;
+	}
+
+	//! Set the rectangle of the screen nodes are culled against. Nodes
+	//! outside of it are neither updated nor drawn. A size of 0, the
+	//! default, turns culling off.
+	MAKO_INLINE void SetViewport(const Pos2d& pos, const Size2d& size)
+	{ viewportPos = pos; viewportSize = size; }
+
+	MAKO_INLINE const Pos2d& GetViewportPosition() const
+	{ return viewportPos; }
+
+	MAKO_INLINE const Size2d& GetViewportSize() const
+	{ return viewportSize; }
+
+	//! Get the number of nodes in the scene, without the root
+	MAKO_INLINE UInt32 GetNumNodes() const
+	{ return slots.size() - freeSlots.size(); }
+
+	//! Get the number of nodes the last DrawAll() updated and drew
+	MAKO_INLINE UInt32 GetNumVisibleNodes() const
+	{ return visible.size(); }
+
+	MAKO_INLINE const SpriteBatch& GetSpriteBatch() const
+	{ return spriteBatch; }
 };
 
-MAKO_END_NAMESPACE
\ No newline at end of file
+MAKO_END_NAMESPACE
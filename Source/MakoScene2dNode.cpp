@@ -3,6 +3,7 @@
 #include "MakoApplication.h"
 #include "MakoScene2d.h"
 #include "MakoMaterial.h"
+#include <cmath>
 
 MAKO_BEGIN_NAMESPACE
 
@@ -12,17 +13,19 @@ Scene2dNode::Scene2dNode(const Position2d& pos,
 						 const Rotation2d& rot,
 						 Scene2dNode* parent,
 						 bool isRootSceneNode)
+: size(0, 0), drawOrder(0), scene(nullptr), slot(0), drawRank(0), looseIndex(0xFFFFFFFF),
+  queryStamp(0), boundsMoved(false), childrenSorted(true)
 {
 	this->pos = pos;
 	this->rot = rot;
-	
+
 	if (!isRootSceneNode)
 	{
 		if (parent)
 			this->parent = parent;
 		else
 			this->parent = APP()->GetActive2dScene()->GetRootNode();
-		
+
 		this->parent->AddChild(this);
 	}
 	else
@@ -33,70 +36,46 @@ Scene2dNode::Scene2dNode(const Position2d& pos,
 
 Scene2dNode::~Scene2dNode()
 {
-	for (LinkedList<Scene2dNode*>::iterator it = children.begin();
-		it != children.end();
-		++it)
-	{
-		(*it)->Drop();
-	}
+	for (UInt32 i = 0; i < children.size(); ++i)
+		children[i]->Drop();
 }
 
 /////////////////////////////////////////////////////////////////
 // Methods
 
-UInt16           Scene2dNode::GetNumberOfChildren() const
-{ return children.size(); }
-
-Scene2dNode* Scene2dNode::GetChild(UInt16 index) const
-{
-	UInt16 c = 0;
-	LinkedList<Scene2dNode*>::const_iterator it = children.begin();
-	while (it != children.end())
-	{
-		if (c == index)
-		{
-			return *it;
-		}
-		++it; ++c;
-	}
-
-	return nullptr;
-}
-
 void          Scene2dNode::AddChild(Scene2dNode* node)
 {
 	node->Hold();
+	node->parent = this;
 	children.push_back(node);
+	childrenSorted = false;
+
+	if (scene)
+		scene->AddNode_r(node);
 }
 
-void          Scene2dNode::RemoveChild(UInt16 index)
+void          Scene2dNode::RemoveChild(UInt32 index)
 {
-	UInt16 c = 0;
-	LinkedList<Scene2dNode*>::const_iterator it = children.begin();
-	while (it != children.end())
-	{
-		if (c == index)
-		{
-			Scene2dNode* temp = *it;
-			children.erase(it);
-			temp->Drop();
-			return ;
-		}
-		++it; ++c;
-	}
+	if (index >= children.size())
+		return ;
+
+	Scene2dNode* temp = children[index];
+	if (scene)
+		scene->RemoveNode_r(temp);
+
+	// Erasing keeps the siblings in their draw order
+	children.erase(children.begin() + index);
+	temp->parent = nullptr;
+	temp->Drop();
 }
 
 void          Scene2dNode::RemoveChild(Scene2dNode* n)
 {
-	for (LinkedList<Scene2dNode*>::iterator it = children.begin();
-		it != children.end();
-		++it)
+	for (UInt32 i = 0; i < children.size(); ++i)
 	{
-		if (*it == n)
+		if (children[i] == n)
 		{
-			Scene2dNode* temp = *it;
-			children.erase(it);
-			temp->Drop();
+			RemoveChild(i);
 			return;
 		}
 	}
@@ -105,11 +84,39 @@ void          Scene2dNode::RemoveChild(Scene2dNode* n)
 Scene2dNode* Scene2dNode::GetParent() const
 { return parent; }
 
+Scene2dNodeHandle Scene2dNode::GetHandle() const
+{
+	if (!scene || !parent)
+		return Scene2dNodeHandle();
+	return Scene2dNodeHandle(slot, scene->slots[slot].generation);
+}
+
 void          Scene2dNode::SetPosition(const Position2d& pos)
-{ this->pos = pos; }
+{
+	this->pos = pos;
+	BoundsChanged();
+}
 
 void          Scene2dNode::SetRotation(const Rotation2d& rot)
-{ this->rot = rot; }
+{
+	this->rot = rot;
+	BoundsChanged();
+}
+
+void          Scene2dNode::SetSize(const Size2d& size)
+{
+	this->size = size;
+	BoundsChanged();
+}
+
+void          Scene2dNode::SetDrawOrder(Int32 order)
+{
+	drawOrder = order;
+	if (parent)
+		parent->childrenSorted = false;
+	if (scene)
+		scene->drawRanksDirty = true;
+}
 
 const Position2d& Scene2dNode::GetPosition() const
 { return pos; }
@@ -117,5 +124,29 @@ const Position2d& Scene2dNode::GetPosition() const
 const Rotation2d& Scene2dNode::GetRotation() const
 { return rot; }
 
-MAKO_END_NAMESPACE
+void Scene2dNode::GetBounds(Vec2df& minCorner, Vec2df& maxCorner) const
+{
+	// The node rotates around it's centre, like a Sprite
+	const Float32 hw = size.x * .5f, hh = size.y * .5f;
+	const Float32 cx = pos.x + hw, cy = pos.y + hh;
+	Float32 ex = hw, ey = hh;
+	if (rot != 0.f)
+	{
+		const Float32 c = fabsf(cosf(rot)), s = fabsf(sinf(rot));
+		ex = hw * c + hh * s;
+		ey = hw * s + hh * c;
+	}
+	minCorner = Vec2df(cx - ex, cy - ey);
+	maxCorner = Vec2df(cx + ex, cy + ey);
+}
 
+void Scene2dNode::BoundsChanged()
+{
+	if (scene && parent && !boundsMoved)
+	{
+		boundsMoved = true;
+		scene->movedNodes.push_back(this);
+	}
+}
+
+MAKO_END_NAMESPACE
@@ -3,25 +3,81 @@
 #include "MakoCommon.h"
 #include "MakoVec2d.h"
 #include "MakoReferenceCounted.h"
-#include "MakoLinkedList.h"
+#include "MakoArrayList.h"
 
 MAKO_BEGIN_NAMESPACE
 
 class Application;
+class SpriteBatch;
+class Scene2d;
 
+//! Refers to a node of a Scene2d without holding it. It's valid for as long
+//! as the node is in the scene; after that, Scene2d::GetNode() returns
+//! nullptr for it, even when another node reuses the slot it referred to.
+struct Scene2dNodeHandle
+{
+	MAKO_INLINE Scene2dNodeHandle()
+		: index(0xFFFFFFFF), generation(0) {}
+
+	MAKO_INLINE Scene2dNodeHandle(UInt32 index, UInt32 generation)
+		: index(index), generation(generation) {}
+
+	MAKO_INLINE bool operator==(const Scene2dNodeHandle& other) const
+	{ return index == other.index && generation == other.generation; }
+
+	MAKO_INLINE bool operator!=(const Scene2dNodeHandle& other) const
+	{ return !(*this == other); }
+
+	//! The slot of the node in it's Scene2d
+	UInt32 index;
+	//! The number of times the slot was reused when the handle was made
+	UInt32 generation;
+};
+
+//! A node of a Scene2d. Positions are in screen space, and not relative to
+//! the parent. The children of a node are stored in an array, in the order
+//! they're drawn in (see SetDrawOrder()).
+//! A node with a size is culled against the viewport of it's scene: when
+//! it's off the screen, it's neither updated nor drawn. Nodes of size 0 are
+//! never culled.
 class Scene2dNode : public ReferenceCounted
 {
+	friend class Scene2d;
 private:
 	Position2d pos;
 	Rotation2d rot;
+	Size2d size;
 	Scene2dNode* parent;
-	LinkedList<Scene2dNode*> children;
+	ArrayList<Scene2dNode*> children;
+	Int32 drawOrder;
+
+	//! The scene the node is in, or nullptr
+	Scene2d* scene;
+	//! The node's slot in the scene
+	UInt32 slot;
+	//! The position of the node in the order the whole scene is drawn in
+	UInt32 drawRank;
+	//! The range of grid cells the node is in: x0, y0, x1 and y1
+	Int32 cells[4];
+	//! The node's index in the scene's list of nodes that aren't in the
+	//! grid, or 0xFFFFFFFF
+	UInt32 looseIndex;
+	//! The last query of the scene that found the node
+	UInt32 queryStamp;
+	//! Set when the bounds changed since the scene last sorted the node
+	//! into it's grid
+	bool boundsMoved;
+	//! Cleared when the draw order of a child changed
+	bool childrenSorted;
+
+	//! Tells the scene the bounds changed
+	void BoundsChanged();
 public:
 	MAKO_API Scene2dNode
 		(
-			const Position2d& pos = Pos2d(0), 
-			const Rotation2d& rot = Rot2d(0), 
-			Scene2dNode* parent = nullptr, 
+			const Position2d& pos = Pos2d(0),
+			const Rotation2d& rot = Rot2d(0),
+			Scene2dNode* parent = nullptr,
 			bool isRootSceneNode = false
 		);
 	MAKO_API virtual ~Scene2dNode();
@@ -29,19 +85,57 @@ public:
 	virtual void Draw() {}
 	virtual void Update() {}
 
-	MAKO_API UInt16 GetNumberOfChildren() const;
-	MAKO_API Scene2dNode* GetChild(UInt16 index) const;
+	//! Draws the node as part of a Scene2d, which draws the SpriteBatch after
+	//! every node. Nodes that can be batched queue themselves in it; the
+	//! others are drawn right away by Draw(), which is what this does by
+	//! default, so they're below the batched ones.
+	virtual void Draw(SpriteBatch* batch) { Draw(); }
+
+	MAKO_INLINE UInt32 GetNumberOfChildren() const
+	{ return children.size(); }
+
+	MAKO_INLINE Scene2dNode* GetChild(UInt32 index) const
+	{ return children[index]; }
+
 	MAKO_API void AddChild(Scene2dNode* node);
-	MAKO_API void RemoveChild(UInt16 index);
+	MAKO_API void RemoveChild(UInt32 index);
 	MAKO_API void RemoveChild(Scene2dNode* n);
 
 	MAKO_API Scene2dNode* GetParent() const;
 
+	//! Get the scene the node is in, or nullptr if it was removed from it
+	MAKO_INLINE Scene2d* GetScene() const
+	{ return scene; }
+
+	//! Get a handle to the node, which is invalid if the node isn't in a scene
+	MAKO_API Scene2dNodeHandle GetHandle() const;
+
 	MAKO_API void SetPosition(const Position2d& pos);
 	MAKO_API void SetRotation(const Rotation2d& rot);
-	
+
 	MAKO_API const Position2d& GetPosition() const;
 	MAKO_API const Rotation2d& GetRotation() const;
+
+	//! Set the size of the node on the screen, before it's rotated around
+	//! it's centre. The node is culled with it; it's 0 by default.
+	MAKO_API void SetSize(const Size2d& size);
+
+	MAKO_INLINE const Size2d& GetSize() const
+	{ return size; }
+
+	//! Get the screen space box around the rotated node
+	MAKO_API void GetBounds(Vec2df& minCorner, Vec2df& maxCorner) const;
+
+	//! Set the order of the node among it's siblings. Siblings of a lower
+	//! order are drawn first; siblings of the same order in the order they
+	//! were added. A node is drawn before it's children. It's 0 by default.
+	//! Sprites are ordered by their layer (see Sprite::SetLayer()) before
+	//! their draw order, so a Sprite on a higher layer is drawn over every
+	//! one on a lower layer.
+	MAKO_API void SetDrawOrder(Int32 order);
+
+	MAKO_INLINE Int32 GetDrawOrder() const
+	{ return drawOrder; }
 };
 
 MAKO_END_NAMESPACE
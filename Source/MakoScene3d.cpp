@@ -1,4 +1,5 @@
 #include "MakoScene3d.h"
+#include "MakoAllocator.h"
 #include "MakoMeshSceneNode.h"
 #include "MakoSkybox.h"
 #include "MakoEntity3d.h"
@@ -17,7 +18,8 @@ MAKO_BEGIN_NAMESPACE
 typedef LinkedList<Scene3dNode*>::const_iterator llcs3dnit;
 
 Scene3d::Scene3d()
-: cam(nullptr)
+: cam(nullptr), hierarchyChanged(true), transformsChanged(false), bvhChanged(true),
+  cullingEnabled(true), numCulledNodes(0)
 {
 	root = new Scene3dNode();
 	root->parent = nullptr;
@@ -26,45 +28,242 @@ Scene3d::Scene3d()
 }
 
 Scene3d::~Scene3d()
-{ cam->Drop(); root->Drop(); }
+{
+	for (ArrayList<Scene3dNode*>::iterator it = flatNodes.begin(); it != flatNodes.end(); ++it)
+		(*it)->Drop();
+	cam->Drop(); root->Drop();
+}
 
 void Scene3d::DrawAll()
 {
-	
-	UpdateNodes_r(root);
-	root->UpdateAbsoluteTransformation();
-	PostUpdateNodes_r(root);
-	DrawNodes_r(root);
-	
+	if (hierarchyChanged)
+		FlattenHierarchy();
+
+	// Index 0 is the root, which isn't updated or drawn. Nodes added during
+	// a pass are picked up in the next one, since the hierarchy is only
+	// flattened again in UpdateWorldTransforms().
+	UInt32 i;
+	for (i = 1; i < flatNodes.size(); ++i)
+		flatNodes[i]->Update();
+
+	UpdateWorldTransforms();
+
+	for (i = 1; i < flatNodes.size(); ++i)
+		flatNodes[i]->PostUpdate();
+
+	DrawNodes(APP()->GD());
 }
 
-void Scene3d::UpdateNodes_r(Scene3dNode* n)
+void Scene3d::DrawNodes(GraphicsDevice* gd)
 {
-	for (llcs3dnit it = n->GetChildren().begin(); it != n->GetChildren().end(); ++it)
+	numCulledNodes = 0;
+
+	UInt32 i;
+	if (cullingEnabled)
 	{
-		(*it)->Update();
-		UpdateNodes_r((*it));
+		frustum.Build(gd->GetTransform(TS_PROJECTION) * gd->GetTransform(TS_VIEW));
+
+		// Find the visible nodes with the BVH, instead of testing every node.
+		// Nodes with infinite bounds are always visible, the ones without
+		// bounds never are.
+		visibleFlags.assign(flatNodes.size(), 0);
+		queryItems.clear();
+		bvh.QueryFrustum(frustum, queryItems);
+		for (i = 0; i < queryItems.size(); ++i)
+			visibleFlags[bvhItemNodes[queryItems[i]]] = 1;
+	}
+	else
+		frustum = Frustum();
+
+	renderQueue.Begin(gd->GetTransform(TS_VIEW));
+
+	// The nodes are still drawn in the order of the hierarchy. Nodes that
+	// submit to the render queue are drawn after all others.
+	for (i = 1; i < flatNodes.size(); ++i)
+	{
+		if (cullingEnabled && !visibleFlags[i] && !(boundsFlags[i] & BF_INFINITE))
+		{
+			++numCulledNodes;
+			continue;
+		}
+
+		flatNodes[i]->PreDraw();
+		flatNodes[i]->Draw(gd);
+		flatNodes[i]->PostDraw();
 	}
+
+	renderQueue.Flush(gd);
 }
-void Scene3d::PostUpdateNodes_r(Scene3dNode* n)
+
+void Scene3d::FlattenHierarchy()
 {
-	for (llcs3dnit it = n->GetChildren().begin(); it != n->GetChildren().end(); ++it)
+	for (ArrayList<Scene3dNode*>::iterator it = flatNodes.begin(); it != flatNodes.end(); ++it)
 	{
-		(*it)->PostUpdate();
-		PostUpdateNodes_r((*it));
+		(*it)->flatIndex = Scene3dNode::INVALID_FLAT_INDEX;
+		(*it)->Drop();
 	}
+	flatNodes.clear();
+	flatParents.clear();
+
+	FlattenHierarchy_r(root, -1);
+
+	// Everything is recalculated after the hierarchy changed
+	localTransforms.resize(flatNodes.size());
+	worldTransforms.resize(flatNodes.size());
+	worldBounds.resize(flatNodes.size());
+	boundsFlags.assign(flatNodes.size(), 0);
+	dirtyFlags.assign(flatNodes.size(), DF_LOCAL);
+	flatBVHItems.assign(flatNodes.size(), BVH3d::INVALID_ITEM);
+
+	hierarchyChanged  = false;
+	transformsChanged = true;
+	bvhChanged        = true;
 }
 
-void Scene3d::DrawNodes_r(Scene3dNode* n)
+void Scene3d::FlattenHierarchy_r(Scene3dNode* n, Int32 parentIndex)
 {
-	GraphicsDevice* gd = APP()->GD();
+	Int32 index = (Int32)flatNodes.size();
+
+	n->Hold();
+	n->scene     = this;
+	n->flatIndex = (UInt32)index;
+	flatNodes.push_back(n);
+	flatParents.push_back(parentIndex);
+
 	for (llcs3dnit it = n->GetChildren().begin(); it != n->GetChildren().end(); ++it)
+		FlattenHierarchy_r(*it, index);
+}
+
+void Scene3d::UpdateWorldTransforms()
+{
+	if (hierarchyChanged)
+		FlattenHierarchy();
+
+	if (!transformsChanged)
+		return;
+
+	const UInt32 numNodes = flatNodes.size();
+	for (UInt32 i = 0; i < numNodes; ++i)
 	{
-		(*it)->PreDraw();
-		(*it)->Draw(gd);
-		(*it)->PostDraw();
-		DrawNodes_r((*it));
+		const Int32 p = flatParents[i];
+
+		// Parents come before their children, so their flags are final here
+		if (p >= 0 && dirtyFlags[p])
+			dirtyFlags[i] |= DF_WORLD;
+
+		if (!dirtyFlags[i])
+			continue;
+
+		if (dirtyFlags[i] & DF_LOCAL)
+			localTransforms[i] = flatNodes[i]->GetTransformation();
+
+		if (p >= 0)
+			worldTransforms[i].SetByproduct(worldTransforms[p], localTransforms[i]);
+		else
+			worldTransforms[i] = localTransforms[i];
+		flatNodes[i]->absTransformation = worldTransforms[i];
+
+		// The node moved, so it's bounds moved too
+		AABBox3df box;
+		const NODE_BOUNDS nb = flatNodes[i]->GetBoundingBox(box);
+		worldBounds[i] = nb == NB_BOX ? box.GetTransformed(worldTransforms[i]) : AABBox3df();
+		boundsFlags[i] = nb == NB_INFINITE ? BF_INFINITE : 0;
+
+		// Nodes that got or lost their bounds change the items of the BVH
+		const UInt32 item = flatBVHItems[i];
+		if (worldBounds[i].IsEmpty() == (item != BVH3d::INVALID_ITEM))
+			bvhChanged = true;
+		else if (item != BVH3d::INVALID_ITEM && !bvhChanged)
+			bvh.SetItemBox(item, worldBounds[i]);
+	}
+
+	if (numNodes)
+		memset(&dirtyFlags[0], 0, numNodes * sizeof(UInt8));
+	transformsChanged = false;
+
+	// Moving nodes only refit the BVH, until they moved so far from where it
+	// was built that building it again is worth it. Static geometry is only
+	// built once, when it's added.
+	if (!bvhChanged)
+	{
+		bvh.Refit();
+		bvhChanged = bvh.IsDegraded();
 	}
+	if (bvhChanged)
+		RebuildBVH();
+}
+
+void Scene3d::RebuildBVH()
+{
+	// The boxes are only needed to build the BVH
+	ArrayList<AABBox3df, FrameAllocator<AABBox3df> > boxes;
+	boxes.reserve(flatNodes.size());
+	bvhItemNodes.clear();
+	for (UInt32 i = 0; i < flatNodes.size(); ++i)
+	{
+		if (worldBounds[i].IsEmpty())
+		{
+			flatBVHItems[i] = BVH3d::INVALID_ITEM;
+			continue;
+		}
+		flatBVHItems[i] = bvhItemNodes.size();
+		bvhItemNodes.push_back(i);
+		boxes.push_back(worldBounds[i]);
+	}
+
+	if (boxes.empty())
+		bvh.Clear();
+	else
+		bvh.Build(&boxes[0], boxes.size());
+	bvhChanged = false;
+}
+
+/////////////////////////////////////////////////////////////////
+// Queries
+
+void Scene3d::UpdateForQuery()
+{
+	if (!hierarchyChanged)
+		UpdateWorldTransforms();
+}
+
+Scene3dNode* Scene3d::RayCast(const Vec3df& start, const Vec3df& dir,
+							  Float32 maxDistance, Float32* distance)
+{
+	UpdateForQuery();
+
+	const Float32 len = dir.Length();
+	if (len == 0.f)
+		return nullptr;
+
+	Float32 t;
+	const UInt32 item = bvh.RayCast(start, dir / len, maxDistance, &t);
+	if (item == BVH3d::INVALID_ITEM)
+		return nullptr;
+
+	if (distance)
+		*distance = t;
+	return flatNodes[bvhItemNodes[item]];
+}
+
+void Scene3d::GetNodesInBox(const AABBox3df& box, ArrayList<Scene3dNode*>& out)
+{
+	UpdateForQuery();
+
+	queryItems.clear();
+	bvh.QueryBox(box, queryItems);
+	for (UInt32 i = 0; i < queryItems.size(); ++i)
+		out.push_back(flatNodes[bvhItemNodes[queryItems[i]]]);
+}
+
+void Scene3d::GetNodesInSphere(const Sphere3df& sphere, ArrayList<Scene3dNode*>& out)
+{
+	UpdateForQuery();
+
+	queryItems.clear();
+	bvh.QuerySphere(sphere, queryItems);
+	for (UInt32 i = 0; i < queryItems.size(); ++i)
+		out.push_back(flatNodes[bvhItemNodes[queryItems[i]]]);
 }
 
 void Scene3d::SetCamera(Camera* cam)
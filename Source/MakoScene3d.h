@@ -4,6 +4,11 @@
 #include "MakoScene3dNode.h"
 #include "MakoArrayList.h"
 #include "MakoMath.h"
+#include "MakoAABBox3d.h"
+#include "MakoSphere3d.h"
+#include "MakoFrustum.h"
+#include "MakoBVH3d.h"
+#include "MakoRenderQueue.h"
 
 MAKO_BEGIN_NAMESPACE
 
@@ -40,10 +45,98 @@ private:
 	Scene3dNode* root;
 	Camera* cam;
 
-	// Recursive functions
-	void UpdateNodes_r(Scene3dNode* n);
-	void PostUpdateNodes_r(Scene3dNode* n);
-	void DrawNodes_r(Scene3dNode* n);
+	//! Every node of the scene graph in depth first order, so a parent always
+	//! comes before it's children. The root is at index 0. Each node in here is
+	//! held, so nodes removed while the scene is being traversed stay valid
+	//! until the hierarchy is flattened again.
+	ArrayList<Scene3dNode*> flatNodes;
+	//! Index into flatNodes of each node's parent, -1 for the root.
+	ArrayList<Int32> flatParents;
+	//! Relative transformation of each node in flatNodes.
+	ArrayList<Matrix4f> localTransforms;
+	//! Absolute transformation of each node in flatNodes.
+	ArrayList<Matrix4f> worldTransforms;
+	//! Absolute bounding box of what each node in flatNodes draws itself.
+	ArrayList<AABBox3df> worldBounds;
+	//! BOUNDS_FLAGS of each node in flatNodes
+	ArrayList<UInt8> boundsFlags;
+	//! DIRTY_FLAGS of each node in flatNodes
+	ArrayList<UInt8> dirtyFlags;
+	//! Whether nodes were added or removed since the hierarchy was flattened.
+	bool hierarchyChanged;
+	//! Whether any node was flagged in dirtyFlags since the last update.
+	bool transformsChanged;
+
+	//! Spatial index over the worldBounds of the nodes that have bounds
+	BVH3d bvh;
+	//! Index into flatNodes of each item of bvh
+	ArrayList<UInt32> bvhItemNodes;
+	//! BVH item of each node in flatNodes, BVH3d::INVALID_ITEM if it has none.
+	ArrayList<UInt32> flatBVHItems;
+	//! Whether bvh has to be built again, instead of refitted.
+	bool bvhChanged;
+	//! Scratch arrays of the queries
+	ArrayList<UInt32> queryItems;
+	ArrayList<UInt8> visibleFlags;
+
+	//! Collects the draw calls of the nodes, so they can be sorted by state
+	RenderQueue renderQueue;
+
+	//! The frustum of the last frame, and whether nodes are culled against it.
+	Frustum frustum;
+	bool cullingEnabled;
+	UInt32 numCulledNodes;
+
+	enum DIRTY_FLAGS
+	{
+		//! The relative transformation of the node changed
+		DF_LOCAL = 1,
+		//! The absolute transformation of the node has to be recalculated
+		DF_WORLD = 2
+	};
+
+	enum BOUNDS_FLAGS
+	{
+		//! The node returned NB_INFINITE from Scene3dNode::GetBoundingBox()
+		BF_INFINITE = 1
+	};
+
+	//! Called by a node in this scene when it's relative transformation changed.
+	MAKO_INLINE void MarkNodeDirty(Scene3dNode* n)
+	{
+		if (n->flatIndex < dirtyFlags.size())
+		{
+			dirtyFlags[n->flatIndex] |= DF_LOCAL;
+			transformsChanged = true;
+		}
+	}
+
+	//! Called by a node in this scene when a child is added or removed.
+	MAKO_INLINE void MarkHierarchyChanged()
+	{ hierarchyChanged = true; }
+
+	//! Rebuilds flatNodes and the arrays parallel to it from the scene graph.
+	void FlattenHierarchy();
+	void FlattenHierarchy_r(Scene3dNode* n, Int32 parentIndex);
+
+	//! Recalculates the absolute transformations and bounds of the nodes that
+	//! changed, and of their children, in a single pass over the flattened
+	//! hierarchy. Then bvh is refitted to the new bounds.
+	void UpdateWorldTransforms();
+
+	//! Builds bvh again over the worldBounds of every node that has bounds.
+	void RebuildBVH();
+
+	//! Brings the bounds of moved nodes up to date for a query. Nodes added
+	//! since the last frame are left out, since the hierarchy may be
+	//! traversed right now.
+	void UpdateForQuery();
+
+	//! Draws the nodes whose bounds intersect the frustum, then flushes
+	//! the render queue.
+	void DrawNodes(GraphicsDevice* gd);
+
+	friend class Scene3dNode;
 public:
 	//! Constructor
 	Scene3d();
@@ -72,6 +165,68 @@ public:
 	//! Set the active Camera for this scene
 	//! \param[in] cam The new active camera
 	MAKO_API void SetCamera(Camera* cam);
+
+	//! Get every node of the scene in depth first order, as it was when the
+	//! last frame was drawn. The root node is the first element.
+	MAKO_INLINE const ArrayList<Scene3dNode*>& GetFlattenedNodes() const
+	{ return flatNodes; }
+
+	//! Get the absolute transformation of every node in GetFlattenedNodes(),
+	//! at the same indices.
+	MAKO_INLINE const ArrayList<Matrix4f>& GetWorldTransforms() const
+	{ return worldTransforms; }
+
+	//! Get the absolute bounding box of every node in GetFlattenedNodes(), at
+	//! the same indices. Nodes that don't return NB_BOX have an empty box.
+	MAKO_INLINE const ArrayList<AABBox3df>& GetWorldBoundingBoxes() const
+	{ return worldBounds; }
+
+	//! Get the spatial index of the scene. It's items are the nodes with
+	//! bounding boxes; use the queries below to get the nodes themselves.
+	MAKO_INLINE const BVH3d& GetBVH() const
+	{ return bvh; }
+
+	//! Finds the node whose bounding box is hit first by a ray.
+	//! Nodes that moved are taken into account right away, nodes that were
+	//! added only after the next frame was drawn.
+	//! \param[in] start The start of the ray
+	//! \param[in] dir The direction of the ray. Doesn't have to be normalized.
+	//! \param[in] maxDistance How far to look along the ray
+	//! \param[out] distance If not nullptr, receives the distance from start
+	//! at which the bounding box of the node was hit.
+	//! \return The node, or nullptr if no bounding box was hit.
+	MAKO_API Scene3dNode* RayCast(const Vec3df& start, const Vec3df& dir,
+								  Float32 maxDistance, Float32* distance = nullptr);
+
+	//! Appends the nodes whose bounding boxes overlap box to out
+	MAKO_API void GetNodesInBox(const AABBox3df& box, ArrayList<Scene3dNode*>& out);
+
+	//! Appends the nodes whose bounding boxes overlap sphere to out
+	MAKO_API void GetNodesInSphere(const Sphere3df& sphere, ArrayList<Scene3dNode*>& out);
+
+	//! Get the queue that nodes submit their draw calls to while the scene is
+	//! drawn. It's flushed after every node was drawn, in an order that
+	//! avoids rebinding materials.
+	MAKO_INLINE RenderQueue& GetRenderQueue()
+	{ return renderQueue; }
+
+	//! Get the view frustum the scene was culled against in the last frame.
+	//! It's built from the GraphicsDevice's projection and view transformations,
+	//! which the GraphicsDevice builds from the Camera in BeginScene().
+	MAKO_INLINE const Frustum& GetViewFrustum() const
+	{ return frustum; }
+
+	//! Enables or disables view frustum culling. It's enabled by default.
+	MAKO_INLINE void SetCullingEnabled(bool b)
+	{ cullingEnabled = b; }
+
+	MAKO_INLINE bool IsCullingEnabled() const
+	{ return cullingEnabled; }
+
+	//! Get the number of nodes that weren't drawn in the last frame, because
+	//! they were outside of the view frustum.
+	MAKO_INLINE UInt32 GetNumCulledNodes() const
+	{ return numCulledNodes; }
 };
 
 MAKO_END_NAMESPACE
\ No newline at end of file
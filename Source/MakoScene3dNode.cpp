@@ -9,6 +9,8 @@ MAKO_BEGIN_NAMESPACE
 // Linked-List-Scene-3d-Node-Iterator
 typedef LinkedList<Scene3dNode*>::iterator lls3dnit;
 
+MAKO_DEFINE_OBJECT_POOL(Scene3dNode)
+
 /////////////////////////////////////////////////////////////////
 // Constructor(s)/Deconstructor
 Scene3dNode::Scene3dNode(const Position3d& pos,
@@ -16,7 +18,7 @@ Scene3dNode::Scene3dNode(const Position3d& pos,
 						 const Scale3d& scale,
 						 bool isDynamic)
 						 : relPos(pos), relRot(rot), relScale(scale), scene(nullptr),
-						   parent(nullptr), isDynamic(isDynamic)
+						   parent(nullptr), isDynamic(isDynamic), flatIndex(INVALID_FLAT_INDEX)
 {}
 
 Scene3dNode::~Scene3dNode()
@@ -35,12 +37,32 @@ void Scene3dNode::UpdateAbsoluteTransformation()
 		(*it)->UpdateAbsoluteTransformation();
 }
 
+void Scene3dNode::MarkTransformDirty()
+{
+	if (scene)
+		scene->MarkNodeDirty(this);
+}
+
+void Scene3dNode::AddChild(Scene3dNode* node)
+{
+	node->Hold();
+	node->parent = this;
+	node->scene  = scene;
+	children.push_back(node);
+
+	if (scene)
+		scene->MarkHierarchyChanged();
+}
+
 void Scene3dNode::RemoveChild(Scene3dNode* n)
 {
 	for (lls3dnit it = children.begin(); it != children.end(); ++it)
 	{
 		if (*it == n)
 		{
+			if (scene)
+				scene->MarkHierarchyChanged();
+
 			Scene3dNode* temp = *it;
 			children.erase(it);
 			temp->Drop();
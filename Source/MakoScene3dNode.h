@@ -1,9 +1,10 @@
 #pragma once
 #include "MakoCommon.h"
 #include "MakoVec3d.h"
-#include "MakoReferenceCounted.h"
+#include "MakoObjectPool.h"
 #include "MakoLinkedList.h"
 #include "MakoMatrix4.h"
+#include "MakoAABBox3d.h"
 
 MAKO_BEGIN_NAMESPACE
 
@@ -39,6 +40,17 @@ struct Scene3dNodeCreationParams
 	bool       isDynamic;
 };
 
+//! Describes what Scene3dNode::GetBoundingBox() returned
+enum NODE_BOUNDS
+{
+	//! The node draws nothing itself
+	NB_NONE,
+	//! The node draws only inside of it's bounding box
+	NB_BOX,
+	//! The node can't be bounded, so it is never culled
+	NB_INFINITE
+};
+
 //! A scene node is a node in the hierarchical scene graph. Every scene
 //! node may have children, which are also scene nodes. Children move
 //! relative to their parent's position. If the parent of a node is not
@@ -46,7 +58,8 @@ struct Scene3dNodeCreationParams
 //! example easily possible to attach a light to a moving car, or to place
 //! a walking character on a moving platform on a moving ship.
 //! Almost any method in a node is called on it's children as well.
-class Scene3dNode : public ReferenceCounted
+//! Nodes are allocated from the pool GetPool() returns.
+class Scene3dNode : public PooledObject<Scene3dNode>
 {
 	friend class Scene3d;
 
@@ -77,13 +90,29 @@ class Scene3dNode : public ReferenceCounted
 
 	//! Relative scale of the scene node.
 	Scale3d relScale;
+
+	//! Index of this node in its scene's flattened hierarchy, or
+	//! INVALID_FLAT_INDEX if the scene hasn't flattened it (yet).
+	UInt32 flatIndex;
+protected:
+	//! Tells the scene that the relative transformation of this node
+	//! changed, so its absolute transformation (and it's children's) is
+	//! recalculated before the next frame is drawn. Sub classes that
+	//! change the relative orientation without the setters below must
+	//! call this.
+	MAKO_API void MarkTransformDirty();
 public:
+	enum { INVALID_FLAT_INDEX = 0xFFFFFFFF };
+
 	Scene3dNode(const Position3d& pos = Pos3d(0.f),
 				const Rotation3d& rot = Rot3d(0.f),
 				const Scale3d& scale  = Scale3d(1.f),
 				bool isDynamic = true);
 	virtual ~Scene3dNode();
 
+	//! Get the pool every Scene3dNode is allocated from
+	MAKO_API static ObjectPool& GetPool();
+
 	//! The scene node draws stuff in this function. It is
 	//! Can be implemented in sub classes of Scene3dnode
 	virtual void Draw(GraphicsDevice* gd) {}
@@ -97,11 +126,26 @@ public:
 	//! Can be implemented in sub classes of Scene3dnode
 	virtual void PostUpdate() {}
 
+	//! Called before Draw(). Not called if the node was culled.
 	virtual void PreDraw() {}
+	//! Called after Draw(). Not called if the node was culled. What the node
+	//! submitted to Scene3d::GetRenderQueue() is drawn later, after all nodes.
 	virtual void PostDraw() {}
 
+	//! Get the bounding box of what this node draws, not including it's
+	//! children, in the node's coordinate space. Scene3d uses it to skip nodes
+	//! that are outside of the view frustum, and for spatial queries. It is asked
+	//! again whenever the node's absolute transformation changes; call
+	//! MarkTransformDirty() if the bounds change otherwise.
+	//! \param[out] box The bounding box, if NB_BOX is returned.
+	//! \return How the node is bounded. The default is NB_INFINITE, so nodes
+	//! that don't know their bounds are never culled.
+	virtual NODE_BOUNDS GetBoundingBox(AABBox3df& box) const
+	{ return NB_INFINITE; }
+
 	//! Updates the absolute position based on the relative and the parents position,
-	//! recursively calls UpdateAbsoluteTransformation() on children.
+	//! recursively calls UpdateAbsoluteTransformation() on children. Scene3d
+	//! does not use this; it only recalculates the nodes that changed.
 	MAKO_API void UpdateAbsoluteTransformation();
 
 	//! Gets the children of this node
@@ -114,13 +158,7 @@ public:
 
 	//! Adds a child
 	//! \param[in] node The node to add as a child
-	MAKO_INLINE void AddChild(Scene3dNode* node)
-	{
-		node->Hold();
-		node->parent = this;
-		node->scene  = scene;
-		children.push_back(node);
-	}
+	MAKO_API void AddChild(Scene3dNode* node);
 
 	//! Removes a child
 	//! \param[in] node The node to remove from the list of
@@ -135,7 +173,7 @@ public:
 	//! Set the relative position of this node
 	//! \param[in] pos The new relative position
 	MAKO_INLINE virtual void SetPosition(const Position3d& pos)
-	{ if (isDynamic) relPos = pos; }
+	{ if (isDynamic && relPos != pos) { relPos = pos; MarkTransformDirty(); } }
 
 	//! Set the relative position of this node
 	//! \param[in] x The new relative x position
@@ -147,7 +185,7 @@ public:
 	//! Add to the current position
 	//! \param[in] vec The vector to add to the position
 	MAKO_INLINE void Move(const Vec3df& vec)
-	{ if (isDynamic) relPos += vec; }
+	{ if (isDynamic) { relPos += vec; MarkTransformDirty(); } }
 
 	//! Add to the current position
 	//! \param[in] x The x pos to add to the pos
@@ -160,13 +198,14 @@ public:
 			relPos.x += x;
 			relPos.y += y;
 			relPos.z += z;
+			MarkTransformDirty();
 		}
 	}
 	
 	//! Set the relative rotation of this node
 	//! \param[in] rot The new relative rotation
 	MAKO_INLINE virtual void SetRotation(const Rotation3d& rot)
-	{ if (isDynamic) relRot = rot; }
+	{ if (isDynamic && relRot != rot) { relRot = rot; MarkTransformDirty(); } }
 
 	//! Set the relative rotation of this node
 	//! \param[in] x The new relative x rotation
@@ -178,7 +217,7 @@ public:
 	//! Add to the current rotation
 	//! \param[in] vec The vector to add to the rotation
 	MAKO_INLINE void Rotate(const Vec3df& vec)
-	{ if (isDynamic) relRot += vec; }
+	{ if (isDynamic) { relRot += vec; MarkTransformDirty(); } }
 
 	//! Add to the current rotation
 	//! \param[in] x The x rot to add to the rot
@@ -191,13 +230,14 @@ public:
 			relRot.x += x;
 			relRot.y += y;
 			relRot.z += z;
+			MarkTransformDirty();
 		}
 	}
 
 	//! Set the relative scale of this node
 	//! \param[in] scale The new relative scale
 	MAKO_INLINE virtual void SetScale(const Size3d& scale)
-	{ if (isDynamic) relScale = scale; }
+	{ if (isDynamic && relScale != scale) { relScale = scale; MarkTransformDirty(); } }
 	
 	//! Set the relative scale of this node
 	//! \param[in] x The new relative x scale
@@ -209,7 +249,7 @@ public:
 	//! Add to the current scale
 	//! \param[in] vec The vector to add to the scale
 	MAKO_INLINE void Scale(const Vec3df& vec)
-	{ if (isDynamic) relScale += vec; }
+	{ if (isDynamic) { relScale += vec; MarkTransformDirty(); } }
 
 	//! Add to the current scale
 	//! \param[in] x The x scale to add to the scale
@@ -222,6 +262,7 @@ public:
 			relScale.x += x;
 			relScale.y += y;
 			relScale.z += z;
+			MarkTransformDirty();
 		}
 	}
 
@@ -267,7 +308,7 @@ public:
 	{ return absTransformation.GetScale(); }
 	
 	//! Get the absolute transformation of the node. Is recalculated before every 
-	//! frame.
+	//! frame in which it, or one of it's parents, changed.
 	//! \return The absolute transformation matrix.
 	MAKO_INLINE const Matrix4f& GetAbsoluteTransformation() const
 	{ return absTransformation; }
@@ -2,6 +2,7 @@
 #include "MakoWinsockDevice.h"
 #include "MakoXAudio2Device.h"
 #include "MakoD3D9Device.h"
+#include "MakoSoftwareDevice.h"
 #include "MakoSimpleKeyEventReceiver.h"
 #include "MakoScene3d.h"
 #include "MakoScene2d.h"
@@ -15,6 +16,8 @@
 #include "MakoWireframeMtl.h"
 #include "MakoNetworkingDevice.h"
 #include "MakoVERSION.h"
+#include "MakoAllocator.h"
+#include <algorithm>
 
 MAKO_BEGIN_NAMESPACE
 
@@ -22,13 +25,17 @@ MAKO_BEGIN_NAMESPACE
 // Initializer Methods/Deconstructor
 
 SimpleApplication::SimpleApplication()
-: eventReceivers(ET_ENUM_LENGTH), fpsUpdateCounter(0), fps(0), graphics(nullptr),
+: eventReceivers(ET_ENUM_LENGTH), dispatchingEvents(false), eventBatches(ET_ENUM_LENGTH), fpsUpdateCounter(0), fps(0), graphics(nullptr),
   audio(nullptr), phys3d(nullptr), scene3d(nullptr), scene2d(nullptr), rw(nullptr),
-  os(nullptr), mm(nullptr), console(nullptr), net(nullptr), fs(nullptr), isRunning(true)
+  os(nullptr), mm(nullptr), console(nullptr), net(nullptr), fs(nullptr),
+  jobs(nullptr), isRunning(true)
 {
 	/////////////////////////////////////////////////////////////////////////////
 	// Console
 	console = new Console();
+
+	// Objects dropped during a frame are destroyed at the end of it
+	ReferenceCounted::SetDestructionDeferred(true);
 	console->PrintLn(Text("Mako Game Engine v") + String::From32BitFloat(GetMakoVersion()) + '\n');
 
 	/////////////////////////////////////////////////////////////////////////////
@@ -40,20 +47,48 @@ SimpleApplication::SimpleApplication()
 	/////////////////////////////////////////////////////////////////////////////
 	// FileSystem
 	fs = new FileSystem();
+
+	/////////////////////////////////////////////////////////////////////////////
+	// JobSystem
+	jobs = new JobSystem();
+	console->PrintLn(Text("Initialized Job System (") + String::From32BitUInt(jobs->GetNumThreads()) +
+					 Text(" threads)"));
 }
 
 
 void SimpleApplication::InitGraphics(const GraphicsCreationParams& p)
 {
-	/////////////////////////////////////////////////////////////////////////////
-	// RenderedWindow
-	rw = os->CreateRenderedWindow(p.wndTitle, p.wndSize, p.fullscreen);
+	GRAPHICS_DEVICE_TYPE type = p.deviceType;
+	if (type == GDT_AUTO)
+	{
+		// Auto-detect
+#if defined(MAKO_D3D_AVAILABLE) && MAKO_D3D_VER >= MAKO_D3D_VER_9
+		type = GDT_D3D9;
+#else
+		type = GDT_SOFTWARE;
+#endif
+	}
 
-	/////////////////////////////////////////////////////////////////////////////
-	// GraphicsDevice
+	if (type == GDT_SOFTWARE)
+	{
+		/////////////////////////////////////////////////////////////////////////////
+		// GraphicsDevice (headless, so there is no RenderedWindow)
+		graphics = new SoftwareDevice(p.vsync, p.wndSize);
+	}
 #if defined(MAKO_D3D_AVAILABLE) && MAKO_D3D_VER >= MAKO_D3D_VER_9
-	graphics = new D3D9Device(p.vsync);
+	else if (type == GDT_D3D9)
+	{
+		/////////////////////////////////////////////////////////////////////////////
+		// RenderedWindow
+		rw = os->CreateRenderedWindow(p.wndTitle, p.wndSize, p.fullscreen);
+
+		/////////////////////////////////////////////////////////////////////////////
+		// GraphicsDevice
+		graphics = new D3D9Device(p.vsync);
+	}
 #endif
+	if (!graphics)
+		throw Exception(Text("No GraphicsDevice of the requested type is available."));
 	console->PrintLn(Text("Initialized Graphics (") + graphics->GetName() + StringChar(')'));
 	graphics->SetDefaultMaterial(new ColorMtl(graphics));
 
@@ -66,6 +101,7 @@ void SimpleApplication::InitGraphics(const GraphicsCreationParams& p)
 	/////////////////////////////////////////////////////////////////////////////
 	// Scene2d
 	scene2d = new Scene2d();
+	scene2d->SetViewport(Pos2d(0, 0), p.wndSize);
 	scene2d->Hold();
 	
 	/////////////////////////////////////////////////////////////////////////////
@@ -78,8 +114,11 @@ void SimpleApplication::InitNetworking(const NetworkingCreationParams& params)
 	/////////////////////////////////////////////////////////////////////////////
 	// NetworkingDevice
 #if MAKO_PLATFORM == MAKO_PLATFORM_WIN32
-	net = new WinsockDevice();
+	if (params.deviceType == NDT_AUTO || params.deviceType == NDT_WINSOCK2)
+		net = new WinsockDevice();
 #endif
+	if (!net)
+		throw Exception(Text("No NetworkingDevice of the requested type is available."));
 	console->PrintLn(Text("Initialized Networking (") + net->GetName() + StringChar(')'));
 }
 
@@ -88,8 +127,11 @@ void SimpleApplication::InitPhysics3d(const Physics3dCreationParams& params)
 	/////////////////////////////////////////////////////////////////////////////
 	// Physics3dDevice
 #ifdef MAKO_PHYSX_AVAILABLE
-	phys3d = new PhysXDevice();
+	if (params.deviceType == P3DT_AUTO || params.deviceType == P3DT_PHYSX)
+		phys3d = new PhysXDevice();
 #endif
+	if (!phys3d)
+		throw Exception(Text("No Physics3dDevice of the requested type is available."));
 	console->PrintLn(Text("Initialized 3D Physics (") + phys3d->GetName() + StringChar(')'));
 }
 
@@ -98,8 +140,11 @@ void SimpleApplication::InitAudio(const AudioCreationParams& params)
 	/////////////////////////////////////////////////////////////////////////////
 	// AudioDevice
 #ifdef MAKO_XAUDIO2_AVAILABLE
-	audio = new XAudio2Device();
+	if (params.deviceType == ADT_AUTO || params.deviceType == ADT_XAUDIO2)
+		audio = new XAudio2Device();
 #endif
+	if (!audio)
+		throw Exception(Text("No AudioDevice of the requested type is available."));
 	console->PrintLn(Text("Initialized Audio (") + audio->GetName() + StringChar(')'));
 }
 
@@ -108,19 +153,19 @@ SimpleApplication::~SimpleApplication()
 	if (scene3d) scene3d->Drop();
 	if (scene2d) scene2d->Drop();
 	
-	// Array List Linked List Event Receiver Iterator
-	typedef ArrayList<LinkedList<EventReceiver*> >::iterator Alllerit;
-	// Linked List Event Receiver Iterator
-	typedef LinkedList<EventReceiver*>::iterator Llerit;
-	for (Alllerit it1 = eventReceivers.begin(); it1 != eventReceivers.end(); ++it1)
+	for (UInt32 type = 0; type < eventReceivers.size(); ++type)
 	{
-		for (Llerit it2 = (*it1).begin(); it2 != (*it1).end();)
-		{
-			EventReceiver* temp = *it2;
-			it2 = (*it1).erase(it2);
-			temp->Drop();
-		}
+		for (UInt32 i = 0; i < eventReceivers[type].size(); ++i)
+			eventReceivers[type][i]->Drop();
+		eventReceivers[type].clear();
 	}
+	// Jobs may still be using the devices
+	if (jobs)     delete jobs;
+	jobs = nullptr;
+
+	// Destroy the dropped objects while the devices they belong to exist
+	ReferenceCounted::DestroyDroppedObjects();
+	ReferenceCounted::SetDestructionDeferred(false);
 	if (net)      delete net;
 	if (audio)    delete audio;
 	if (os)       delete os;
@@ -130,6 +175,7 @@ SimpleApplication::~SimpleApplication()
 	if (graphics) delete graphics;
 	if (fs)       delete fs;
 
+	if (console) console->Flush();
 #if defined (MAKO_DEBUG_MODE) && MAKO_PLATFORM == MAKO_PLATFORM_WIN32
 	if (console) OutputDebugStringW((Text("\n") + console->GetContents() + Text("\n")).ToWStringData());
 #endif
@@ -164,16 +210,23 @@ void SimpleApplication::AddEventReceiver(EventReceiver* er)
 
 void SimpleApplication::RemoveEventReceiver(EventReceiver* er)
 {
-	EVENT_TYPE type = er->GetTypeOfEventHandled();
-	LinkedList<EventReceiver*>::const_iterator iter;
-	for(iter  = eventReceivers[type].begin();
-		iter != eventReceivers[type].end();
-		++iter)
+	ArrayList<EventReceiver*>& receivers = eventReceivers[er->GetTypeOfEventHandled()];
+	for (UInt32 i = 0; i < receivers.size(); ++i)
 	{
-		if ((*iter) == er)
+		if (receivers[i] == er)
 		{
-			(*iter)->Drop();
-			eventReceivers[type].erase(iter);
+			if (dispatchingEvents)
+			{
+				// DispatchEvents() is iterating over the list, and the
+				// receiver may be in it's OnEvent()
+				receivers[i] = nullptr;
+				removedEventReceivers.push_back(er);
+			}
+			else
+			{
+				receivers.erase(receivers.begin() + i);
+				er->Drop();
+			}
 			return ;
 		}
 	}
@@ -184,62 +237,117 @@ void SimpleApplication::RemoveEventReceiver(EventReceiver* er)
 
 void SimpleApplication::PostEvent(Event* e)
 {
-	LinkedList<EventReceiver*>::const_iterator iter;
-	switch (e->GetEventType())
+	EventRecord record;
+	record.Set(e);
+	events.Post(record);
+}
+
+//! Sends an event to every receiver of it's type that wasn't removed
+template <class R, class E>
+static MAKO_INLINE void SendEvent(const ArrayList<EventReceiver*>& receivers, const E& e)
+{
+	// Receivers added by OnEvent() are appended, so they're sent it as well
+	for (UInt32 i = 0; i < receivers.size(); ++i)
 	{
-	case ET_KEY:
+		if (receivers[i])
+			static_cast<R*>(receivers[i])->OnEvent(&e);
+	}
+}
+
+void SimpleApplication::DispatchEvents()
+{
+	events.TakeAll(takenEvents);
+	for (UInt32 i = 0; i < takenEvents.size(); ++i)
+		eventBatches[takenEvents[i].type].push_back(takenEvents[i]);
+	takenEvents.clear();
+
+	// The batches are cleared and removed receivers dropped even if a
+	// receiver throws, so the events aren't sent again next frame
+	dispatchingEvents = true;
+	try
+	{
+		SendEventBatches();
+	}
+	catch (...)
+	{
+		FinishDispatchingEvents();
+		throw;
+	}
+	FinishDispatchingEvents();
+}
+
+void SimpleApplication::SendEventBatches()
+{
+	for (UInt32 type = 0; type < ET_ENUM_LENGTH; ++type)
+	{
+		const ArrayList<EventRecord>& batch = eventBatches[type];
+		const ArrayList<EventReceiver*>& receivers = eventReceivers[type];
+		if (batch.empty() || receivers.empty())
+			continue;
+
+		switch (type)
 		{
-			for(iter  = eventReceivers[e->GetEventType()].begin();
-				iter != eventReceivers[e->GetEventType()].end();
-				++iter)
+		case ET_KEY:
 			{
-				static_cast<KeyEventReceiver*>(*iter)->OnEvent(static_cast<KeyEvent*>(e));
+				for (UInt32 i = 0; i < batch.size(); ++i)
+					SendEvent<KeyEventReceiver>(receivers, KeyEvent(batch[i].key.key, batch[i].key.down));
+				break;
 			}
-			return ;
-		}
-	case ET_MOUSE_BTN:
-		{
-			for(iter  = eventReceivers[e->GetEventType()].begin();
-				iter != eventReceivers[e->GetEventType()].end();
-				++iter)
+		case ET_MOUSE_BTN:
 			{
-				static_cast<MouseButtonEventReceiver*>(*iter)->OnEvent(static_cast<MouseButtonEvent*>(e));
+				for (UInt32 i = 0; i < batch.size(); ++i)
+					SendEvent<MouseButtonEventReceiver>(receivers,
+						MouseButtonEvent(batch[i].mouseButton.btn, batch[i].mouseButton.down));
+				break;
 			}
-			return ;
-		}
-	case ET_MOUSE_MOVE:
-		{
-			for(iter  = eventReceivers[e->GetEventType()].begin();
-				iter != eventReceivers[e->GetEventType()].end();
-				++iter)
+		case ET_MOUSE_MOVE:
 			{
-				static_cast<MouseMoveEventReceiver*>(*iter)->OnEvent(static_cast<MouseMoveEvent*>(e));
+				for (UInt32 i = 0; i < batch.size(); ++i)
+					SendEvent<MouseMoveEventReceiver>(receivers,
+						MouseMoveEvent(Vec2di(batch[i].mouseMove.x, batch[i].mouseMove.y)));
+				break;
 			}
-			return ;
-		}
-	case ET_MOUSE_WHEEL:
-		{
-			for(iter  = eventReceivers[e->GetEventType()].begin();
-				iter != eventReceivers[e->GetEventType()].end();
-				++iter)
+		case ET_MOUSE_WHEEL:
 			{
-				static_cast<MouseWheelEventReceiver*>(*iter)->OnEvent(static_cast<MouseWheelEvent*>(e));
+				for (UInt32 i = 0; i < batch.size(); ++i)
+					SendEvent<MouseWheelEventReceiver>(receivers, MouseWheelEvent(batch[i].mouseWheel.movement));
+				break;
 			}
-			return ;
-		}
-	case ET_PHYSICS_3D_ACTOR_PAIR_EVENT:
-		{
-			for(iter  = eventReceivers[e->GetEventType()].begin();
-				iter != eventReceivers[e->GetEventType()].end();
-				++iter)
+		case ET_PHYSICS_3D_ACTOR_PAIR_EVENT:
 			{
-				static_cast<Physics3dActorPairEventRecevier*>(*iter)->OnEvent(static_cast<Physics3dActorPairEvent*>(e));
+				for (UInt32 i = 0; i < batch.size(); ++i)
+				{
+					const Physics3dActorPairEventData& d = batch[i].actorPair;
+					SendEvent<Physics3dActorPairEventRecevier>(receivers,
+						Physics3dActorPairEvent(d.actor1, d.actor2, d.ct));
+				}
+				break;
 			}
-			return ;
 		}
 	}
 }
 
+void SimpleApplication::FinishDispatchingEvents()
+{
+	dispatchingEvents = false;
+
+	for (UInt32 type = 0; type < ET_ENUM_LENGTH; ++type)
+		eventBatches[type].clear();
+
+	if (!removedEventReceivers.empty())
+	{
+		for (UInt32 type = 0; type < ET_ENUM_LENGTH; ++type)
+		{
+			ArrayList<EventReceiver*>& receivers = eventReceivers[type];
+			receivers.erase(std::remove(receivers.begin(), receivers.end(), static_cast<EventReceiver*>(nullptr)),
+				receivers.end());
+		}
+		for (UInt32 i = 0; i < removedEventReceivers.size(); ++i)
+			removedEventReceivers[i]->Drop();
+		removedEventReceivers.clear();
+	}
+}
+
 void SimpleApplication::SetScene(Scene3d* scene)
 { this->scene3d->Drop(); this->scene3d = scene; }
 
@@ -267,13 +375,19 @@ void SimpleApplication::Run()
 	while (isRunning)
 	{
 		if (graphics)
+		{
+			graphics->UpdateAsyncLoads();
 			graphics->BeginScene();
+		}
 
-		fpsUpdateCounter += os->GetChangeInTime();
-		if (fpsUpdateCounter > 1000)
+		if (os)
 		{
-			fps = CalculateFPS();
-			fpsUpdateCounter = 0;
+			fpsUpdateCounter += os->GetChangeInTime();
+			if (fpsUpdateCounter > 1000)
+			{
+				fps = CalculateFPS();
+				fpsUpdateCounter = 0;
+			}
 		}
 		if (scene3d)
 			scene3d->DrawAll();
@@ -289,9 +403,16 @@ void SimpleApplication::Run()
 		if (rw)
 			rw->Update();
 
+		// The devices posted the events of this frame while they were updated
+		DispatchEvents();
+
 		Frame();
 		if (graphics)
 			graphics->EndScene();
+		GetFrameArena().Reset();
+
+		// Nothing uses the objects that were dropped this frame anymore
+		ReferenceCounted::DestroyDroppedObjects();
 
 	}
 }
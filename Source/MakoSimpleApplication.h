@@ -9,6 +9,8 @@
 #include "MakoNetworkingDevice.h"
 #include "MakoPhysics3dDevice.h"
 #include "MakoFileSystem.h"
+#include "MakoJobSystem.h"
+#include "MakoEventQueue.h"
 
 MAKO_BEGIN_NAMESPACE
 
@@ -34,6 +36,9 @@ struct GraphicsCreationParams
 	//! with the vertical blanking interval, thus ensuring that only whole frames are seen 
 	//! on-screen.
 	bool vsync;
+
+	//! GDT_SOFTWARE renders headlessly: no RenderedWindow is created, and
+	//! wndSize is used as the size of the offscreen framebuffer.
 	GRAPHICS_DEVICE_TYPE deviceType;
 	
 	//! \param[in] deviceType By default this is set to be auto-detected.
@@ -41,8 +46,9 @@ struct GraphicsCreationParams
 		                               const Size2d& wndSize = Size2d(640, 480),
 									   bool fullscreen = false,
 									   bool vsync = true,
-									   GRAPHICS_DEVICE_TYPE deviceType = (GRAPHICS_DEVICE_TYPE)~0)
-									   : wndTitle(wndTitle), wndSize(wndSize), fullscreen(fullscreen), vsync(vsync) {}
+									   GRAPHICS_DEVICE_TYPE deviceType = GDT_AUTO)
+									   : wndTitle(wndTitle), wndSize(wndSize), fullscreen(fullscreen), vsync(vsync),
+									     deviceType(deviceType) {}
 	MAKO_INLINE ~GraphicsCreationParams() {}
 };
 
@@ -51,7 +57,7 @@ struct AudioCreationParams
 	AUDIO_DEVICE_TYPE deviceType;
 
 	//! \param[in] deviceType By default this is set to be auto-detected.
-	MAKO_INLINE AudioCreationParams(AUDIO_DEVICE_TYPE deviceType = (AUDIO_DEVICE_TYPE)~0)
+	MAKO_INLINE AudioCreationParams(AUDIO_DEVICE_TYPE deviceType = ADT_AUTO)
 		: deviceType(deviceType) {}
 	
 	MAKO_INLINE ~AudioCreationParams() {}
@@ -62,7 +68,7 @@ struct NetworkingCreationParams
 	NETWORKING_DEVICE_TYPE deviceType;
 
 	//! \param[in] deviceType By default this is set to be auto-detected.
-	MAKO_INLINE NetworkingCreationParams(NETWORKING_DEVICE_TYPE deviceType = (NETWORKING_DEVICE_TYPE)~0)
+	MAKO_INLINE NetworkingCreationParams(NETWORKING_DEVICE_TYPE deviceType = NDT_AUTO)
 		: deviceType(deviceType) {}
 	
 	MAKO_INLINE ~NetworkingCreationParams() {}
@@ -73,7 +79,7 @@ struct Physics3dCreationParams
 	PHYSICS_3D_DEVICE_TYPE deviceType;
 
 	//! \param[in] deviceType By default this is set to be auto-detected.
-	MAKO_INLINE Physics3dCreationParams(PHYSICS_3D_DEVICE_TYPE deviceType = (PHYSICS_3D_DEVICE_TYPE)~0)
+	MAKO_INLINE Physics3dCreationParams(PHYSICS_3D_DEVICE_TYPE deviceType = P3DT_AUTO)
 		: deviceType(deviceType) {}
 	
 	MAKO_INLINE ~Physics3dCreationParams() {}
@@ -82,6 +88,10 @@ struct Physics3dCreationParams
 //! This is a simple Mako application implementation to inherit from in order
 //! to program your game. This implementation is usually used for demos
 //! and not actual games.
+//!
+//! It's Console only keeps what's printed in memory. Call
+//! GetConsole()->SetLogToFile(true) or SetLogToStdOut(true) in Initialize()
+//! to write it to Mako.log or stdout, too.
 class SimpleApplication : public Application
 {
 private:
@@ -96,13 +106,30 @@ private:
 	Console*           console;
 	NetworkingDevice*  net;
 	FileSystem*        fs;
+	JobSystem*         jobs;
 
 
 	bool isRunning;
 	ArrayList<String> cmdLnArgs;
-	ArrayList<LinkedList<EventReceiver*> > eventReceivers;
+	//! The receivers of each EVENT_TYPE, in the order they were added.
+	//! Receivers removed while events are dispatched are set to nullptr,
+	//! and taken out of the list afterwards.
+	ArrayList<ArrayList<EventReceiver*> > eventReceivers;
+	ArrayList<EventReceiver*> removedEventReceivers;
+	bool dispatchingEvents;
+	EventQueue events;
+	//! The events DispatchEvents() took out of the queue, and those of each
+	//! EVENT_TYPE, kept so their memory is reused
+	ArrayList<EventRecord> takenEvents;
+	ArrayList<ArrayList<EventRecord> > eventBatches;
 	UInt32 fps;
 	UInt32 fpsUpdateCounter;
+
+	//! Sends the batches of events to their receivers
+	void SendEventBatches();
+	//! Clears the batches, and drops the receivers removed while they were
+	//! sent
+	void FinishDispatchingEvents();
 public:
 	//! Constructor for SimpleApplication. This should not be called 
 	//! by a user. It is called inside MAKO_RUN_APPLICATION().
@@ -147,6 +174,7 @@ public:
 	MAKO_INLINE Console*          GetConsole()          const { return console;  }
 	MAKO_INLINE Physics3dDevice*  GetPhysics3dDevice()  const { return phys3d;   }
 	MAKO_INLINE NetworkingDevice* GetNetworkingDevice() const { return net;      }
+	MAKO_INLINE JobSystem*        GetJobSystem()        const { return jobs;     }
 	
 	MAKO_INLINE const ArrayList<String>& GetCmdLnArgs() const
 	{ return cmdLnArgs; }
@@ -159,6 +187,7 @@ public:
 	{ return fps; }
 	
 	MAKO_API void PostEvent(Event* e);
+	MAKO_API void DispatchEvents();
 	MAKO_API void AddEventReceiver(EventReceiver* er);
 	MAKO_API void RemoveEventReceiver(EventReceiver* er);
 	MAKO_API void SetScene(Scene3d* scene);
@@ -56,7 +56,9 @@ void Skybox::Draw(GraphicsDevice* gd)
 	gd->SetTexAddressUMode(TAM_CLAMP);
 	gd->SetTexAddressVMode(TAM_CLAMP);
 
-	MeshSceneNode::Draw(gd);
+	// The address modes are restored below, so the skybox can't wait for the
+	// scene's RenderQueue
+	DrawSubMeshes(gd, nullptr);
 
 	gd->SetTexAddressUMode(oldModeU);
 	gd->SetTexAddressVMode(oldModeV);
@@ -50,6 +50,10 @@ public:
 	MAKO_API void PostDraw();
 
 	MAKO_API void PreDraw();
+
+	//! The skybox surrounds the camera, so it's never culled.
+	MAKO_INLINE NODE_BOUNDS GetBoundingBox(AABBox3df& box) const
+	{ return NB_INFINITE; }
 };
 
 MAKO_END_NAMESPACE
\ No newline at end of file
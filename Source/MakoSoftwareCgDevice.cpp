@@ -0,0 +1,55 @@
+#include "MakoSoftwareCgDevice.h"
+#include "MakoSoftwareCgShader.h"
+#include "MakoApplication.h"
+#include "MakoFileSystem.h"
+#include "MakoException.h"
+
+MAKO_BEGIN_NAMESPACE
+
+SoftwareCgDevice::SoftwareCgDevice(GraphicsDevice* gdevice)
+: gdevice(gdevice), boundShader(nullptr)
+{
+	memset(builtInShaders, 0, sizeof(CgShader*) * MCS_ENUM_LENGTH);
+}
+
+SoftwareCgDevice::~SoftwareCgDevice()
+{
+	for (UInt i = 0; i < MCS_ENUM_LENGTH; ++i)
+		if (builtInShaders[i])
+			builtInShaders[i]->Drop();
+}
+
+CgShader* SoftwareCgDevice::GetMakoCgShader(MAKO_CG_SHADER whichone)
+{
+	if (whichone >= MCS_ENUM_LENGTH)
+		throw Exception(Text("The parameter of type MAKO_CG_SHADER given to \
+							 SoftwareCgDevice::GetMakoCgShader() is invalid"));
+
+	// Every built-in shader is interpreted the same way, but they are
+	// kept apart so that their parameters do not alias each other.
+	if (!builtInShaders[whichone])
+	{
+		builtInShaders[whichone] = new SoftwareCgShader(this);
+		builtInShaders[whichone]->Hold();
+	}
+	return builtInShaders[whichone];
+}
+
+CgShader* SoftwareCgDevice::CreateShader(const ASCIIString& sourceCode,
+										 const ASCIIString& vertexProgName,
+										 const ASCIIString& fragProgName)
+{ return new SoftwareCgShader(this); }
+
+CgShader* SoftwareCgDevice::LoadShaderFromFile(const FilePath& fileName,
+											   const ASCIIString& vertexProgName,
+											   const ASCIIString& fragProgName)
+{
+	FilePath found = APP()->FS()->FindFile(fileName);
+	if (found.GetAbs().IsEmpty())
+		throw Exception(Text("The Cg shader [") + fileName.GetAbs() + Text("] does not exist"));
+
+	// The source is never compiled, so there is no need to read it.
+	return CreateShader(ASCIIString(), vertexProgName, fragProgName);
+}
+
+MAKO_END_NAMESPACE
@@ -0,0 +1,44 @@
+#pragma once
+#include "MakoCommon.h"
+#include "MakoCgDevice.h"
+
+MAKO_BEGIN_NAMESPACE
+
+// Forward declarations
+class GraphicsDevice;
+class SoftwareCgShader;
+
+//! The CgDevice of the SoftwareDevice. It does not link against the
+//! Cg runtime; see SoftwareCgShader for how shaders are interpreted.
+class SoftwareCgDevice : public CgDevice
+{
+private:
+	GraphicsDevice* gdevice;
+	CgShader* builtInShaders[MCS_ENUM_LENGTH];
+	SoftwareCgShader* boundShader;
+public:
+	SoftwareCgDevice(GraphicsDevice* gdevice);
+	~SoftwareCgDevice();
+
+	CgShader* LoadShaderFromFile(const FilePath& fp,
+		const ASCIIString& vertexProgName = defaultCgVertProgName,
+		const ASCIIString& fragProgName = defaultCgFragProgName);
+
+	CgShader* CreateShader(const ASCIIString& sourceCode,
+		const ASCIIString& vertexProgName = defaultCgVertProgName,
+		const ASCIIString& fragProgName = defaultCgFragProgName);
+
+	CgShader* GetMakoCgShader(MAKO_CG_SHADER whichone);
+
+	MAKO_INLINE GraphicsDevice* GetGraphicsDevice() const
+	{ return gdevice; }
+
+	//! \return The shader that was bound last, or nullptr if none is bound.
+	MAKO_INLINE SoftwareCgShader* GetBoundShader() const
+	{ return boundShader; }
+
+	MAKO_INLINE void SetBoundShader(SoftwareCgShader* shader)
+	{ boundShader = shader; }
+};
+
+MAKO_END_NAMESPACE
@@ -0,0 +1,79 @@
+#include "MakoSoftwareCgShader.h"
+#include "MakoSoftwareCgDevice.h"
+#include "MakoException.h"
+
+MAKO_BEGIN_NAMESPACE
+
+SoftwareCgShader::SoftwareCgShader(SoftwareCgDevice* cgdevice)
+: cgdevice(cgdevice), colorParam(nullptr)
+{}
+
+SoftwareCgShader::~SoftwareCgShader()
+{
+	if (cgdevice->GetBoundShader() == this)
+		cgdevice->SetBoundShader(nullptr);
+
+	for (ParamMap::iterator it = params.begin(); it != params.end(); ++it)
+		(*it).second->Drop();
+}
+
+void SoftwareCgShader::Bind()
+{ cgdevice->SetBoundShader(this); }
+
+void SoftwareCgShader::UnBind()
+{ cgdevice->SetBoundShader(nullptr); }
+
+CgDevice* SoftwareCgShader::GetCgDevice() const
+{ return cgdevice; }
+
+CgParameter* SoftwareCgShader::GetParameterByName(const ASCIIString& name,
+												  CG_PARAMETER_TYPE type,
+												  CG_PROGRAM_COMPONENT func)
+{
+	const StringId id = InternString(name);
+	ParamMap::iterator it = params.find(id);
+	if (it != params.end())
+	{
+		if ((*it).second->GetType() != type)
+			throw Exception(Text("Cg parameter by the name ") + ToString(name.GetData()) +
+			                Text(" was requested with two different types."));
+		return (*it).second;
+	}
+
+	CgParameter* param;
+
+	switch (type)
+	{
+	case CPT_FLOAT4:
+		{
+			SoftwareFloat4CgParam* p = new SoftwareFloat4CgParam;
+			// The float4 the SoftwareDevice shades with
+			if (name == "color")
+				colorParam = p;
+			param = p;
+			break;
+		}
+	case CPT_FLOAT4X4:
+		{
+			param = new SoftwareFloat4x4CgParam;
+			break;
+		}
+	case CPT_SAMPLER2D:
+		{
+			SoftwareSampler2dCgParam* p = new SoftwareSampler2dCgParam;
+			samplers.push_back(p);
+			param = p;
+			break;
+		}
+	default:
+		{
+			throw Exception(Text("Unknown CG_PARAMETER_TYPE given to SoftwareCgShader::GetParameterByName()."));
+		}
+	}
+
+	param->Hold();
+	params[id] = param;
+	return param;
+}
+
+MAKO_END_NAMESPACE
@@ -0,0 +1,107 @@
+#pragma once
+#include "MakoCommon.h"
+#include "MakoCgShader.h"
+#include "MakoCgParameters.h"
+#include "MakoArrayList.h"
+#include "MakoMap.h"
+#include "MakoString.h"
+#include "MakoStringId.h"
+
+MAKO_BEGIN_NAMESPACE
+
+// Forward declarations
+class SoftwareCgDevice;
+class Texture;
+
+class SoftwareFloat4CgParam : public Float4CgParam
+{
+private:
+	Float32 value[4];
+public:
+	MAKO_INLINE SoftwareFloat4CgParam()
+	{ value[0] = value[1] = value[2] = value[3] = 1.f; }
+	MAKO_INLINE ~SoftwareFloat4CgParam() {}
+
+	MAKO_INLINE void SetValue(Float32 arg1, Float32 arg2, Float32 arg3, Float32 arg4)
+	{ value[0] = arg1; value[1] = arg2; value[2] = arg3; value[3] = arg4; }
+
+	MAKO_INLINE const Float32* GetValue() const
+	{ return value; }
+};
+
+class SoftwareFloat4x4CgParam : public Float4x4CgParam
+{
+private:
+	Matrix4f value;
+public:
+	MAKO_INLINE SoftwareFloat4x4CgParam() {}
+	MAKO_INLINE ~SoftwareFloat4x4CgParam() {}
+
+	MAKO_INLINE void SetValue(const Matrix4f& data)
+	{ value = data; }
+
+	MAKO_INLINE const Matrix4f& GetValue() const
+	{ return value; }
+};
+
+class SoftwareSampler2dCgParam : public Sampler2dCgParam
+{
+private:
+	//! Not held; the material that sets it keeps the texture alive
+	//! for as long as it is bound.
+	Texture* tex;
+public:
+	MAKO_INLINE SoftwareSampler2dCgParam() : tex(nullptr) {}
+	MAKO_INLINE ~SoftwareSampler2dCgParam() {}
+
+	MAKO_INLINE void SetValue(Texture* tex)
+	{ this->tex = tex; }
+
+	MAKO_INLINE Texture* GetValue() const
+	{ return tex; }
+};
+
+//! The SoftwareDevice cannot execute Cg programs. A SoftwareCgShader
+//! only records the uniform values its materials set, and the
+//! SoftwareDevice interprets them with a fixed function pipeline:
+//! a float4 named "color" modulates every pixel, and every sampler2D
+//! (in the order they were first requested) is sampled with the
+//! texture coordinate channel of the same index and modulated in.
+//! That is enough to reproduce every built-in Mako material.
+class SoftwareCgShader : public CgShader
+{
+private:
+	typedef Map<StringId, CgParameter*> ParamMap;
+
+	SoftwareCgDevice* cgdevice;
+	//! The parameters by the id of their name
+	ParamMap params;
+	ArrayList<SoftwareSampler2dCgParam*> samplers;
+	SoftwareFloat4CgParam* colorParam;
+public:
+	SoftwareCgShader(SoftwareCgDevice* cgdevice);
+	~SoftwareCgShader();
+
+	void Bind();
+	void UnBind();
+
+	MAKO_INLINE void BeginEditingParameters() {}
+	MAKO_INLINE void EndEditingParameters() {}
+
+	CgParameter* GetParameterByName(const ASCIIString& name,
+		CG_PARAMETER_TYPE type, CG_PROGRAM_COMPONENT func);
+
+	CgDevice* GetCgDevice() const;
+
+	//! \return The "color" parameter, or nullptr if it was never requested.
+	MAKO_INLINE const SoftwareFloat4CgParam* GetColorParam() const
+	{ return colorParam; }
+
+	MAKO_INLINE UInt32 GetNumSamplers() const
+	{ return samplers.size(); }
+
+	MAKO_INLINE const SoftwareSampler2dCgParam* GetSampler(UInt32 i) const
+	{ return samplers[i]; }
+};
+
+MAKO_END_NAMESPACE
@@ -0,0 +1,830 @@
+#include "MakoSoftwareDevice.h"
+#include "MakoSoftwareVertexBuffer.h"
+#include "MakoSoftwareIndexBuffer.h"
+#include "MakoSoftwareTexture.h"
+#include "MakoSoftwareCgDevice.h"
+#include "MakoSoftwareCgShader.h"
+#include "MakoMaterial.h"
+#include "MakoApplication.h"
+#include "MakoScene3d.h"
+#include "MakoCamera.h"
+#include "MakoConsole.h"
+#include "MakoException.h"
+#include "MakoFileStream.h"
+#include "MakoUtilities.h"
+#include "MakoMath.h"
+#include <png.h>
+#include <cmath>
+
+MAKO_BEGIN_NAMESPACE
+
+/////////////////////////////////////////////////////////////////////////////
+// Helpers
+
+//! Applies a TEXTURE_ADDRESS_MODE to an integer texel coordinate.
+//! TAM_BORDER is treated as TAM_CLAMP, since there is no border color.
+static Int32 AddressTexel(Int32 i, Int32 n, TEXTURE_ADDRESS_MODE mode)
+{
+	switch (mode)
+	{
+	case TAM_WRAP:
+		{
+			i %= n;
+			return i < 0 ? i + n : i;
+		}
+	case TAM_MIRROR:
+		{
+			i %= 2 * n;
+			if (i < 0)
+				i += 2 * n;
+			return i >= n ? 2 * n - 1 - i : i;
+		}
+	case TAM_MIRRORONCE:
+		{
+			if (i < 0)
+				i = -i - 1;
+			return i >= n ? n - 1 : i;
+		}
+	default:
+		{
+			return i < 0 ? 0 : (i >= n ? n - 1 : i);
+		}
+	}
+}
+
+//! Keeps texture coordinates far away from the origin from overflowing
+//! when they are converted to texels.
+static MAKO_INLINE Float32 ClampTexelCoord(Float32 f)
+{ return Clamp(f, -1048576.f, 1048576.f); }
+
+// PNG function for error handling
+static void png_screenshot_error(png_structp png_ptr, png_const_charp msg)
+{
+	longjmp(png_jmpbuf(png_ptr), 1);
+}
+
+// PNG function for file writing
+static void PNGAPI png_screenshot_write_data(png_structp png_ptr, png_bytep data, png_size_t length)
+{
+	OutputStream* os = static_cast<OutputStream*>(png_get_io_ptr(png_ptr));
+	os->WriteData(data, static_cast<UInt32>(length));
+}
+
+// PNG function for flushing
+static void PNGAPI png_screenshot_flush(png_structp png_ptr)
+{}
+
+/////////////////////////////////////////////////////////////////////////////
+// Constructor(s)/Deconstructor
+
+SoftwareDevice::SoftwareDevice(bool vsync, const Size2d& size)
+: GenericGraphicsDevice(vsync), size(size), colorBuffer(size.x * size.y),
+  depthBuffer(size.x * size.y), backgroundColor(0, 0, 0, 255), deviceOptions(GDO_ENUM_LENGTH),
+  filterMode(TFM_BILINEAR), defaultmtl(nullptr), cgdev(nullptr),
+  vendornfo(Text("Mako software rasterizer"))
+{
+	if (size.x == 0 || size.y == 0)
+		throw Exception(Text("The framebuffer of a SoftwareDevice can not be empty."));
+
+	addressModes[0] = TAM_WRAP;
+	addressModes[1] = TAM_WRAP;
+
+	texelDensity[0] = texelDensity[1] = 0.f;
+
+	deviceOptions[GDO_WIREFRAME] = false;
+	deviceOptions[GDO_ZBUFFER]   = true;
+
+	cgdev = new SoftwareCgDevice(this);
+
+	Reset();
+}
+
+SoftwareDevice::~SoftwareDevice()
+{
+	DropResources();
+	if (defaultmtl)
+		defaultmtl->Drop();
+	if (cgdev)
+		delete cgdev;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Methods
+
+CgDevice* SoftwareDevice::GetCgDevice() const
+{ return cgdev; }
+
+Material* SoftwareDevice::GetDefaultMaterial()
+{ return defaultmtl; }
+
+void SoftwareDevice::SetDefaultMaterial(Material* mtl)
+{ if (defaultmtl) defaultmtl->Drop(); defaultmtl = mtl; defaultmtl->Hold(); }
+
+String SoftwareDevice::GetName() const
+{ return String(Text("Software")); }
+
+VertexHardwareBuffer* SoftwareDevice::CreateVertexHardwareBuffer(MeshData* parent)
+{ return new SoftwareVertexBuffer(parent); }
+
+IndexHardwareBuffer* SoftwareDevice::CreateIndexHardwareBuffer(IndexedMeshData* parent)
+{ return new SoftwareIndexBuffer(parent); }
+
+TextureHardwareBuffer* SoftwareDevice::CreateTextureHardwareBuffer(Texture* parent)
+{ return new SoftwareTexture(parent); }
+
+void SoftwareDevice::Reset()
+{
+	for (UInt32 i = 0; i < colorBuffer.size(); ++i)
+		colorBuffer[i] = backgroundColor;
+	for (UInt32 i = 0; i < depthBuffer.size(); ++i)
+		depthBuffer[i] = 1.f;
+}
+
+void SoftwareDevice::BeginScene()
+{
+	stats = SoftwareRenderStats();
+
+	// Clear the framebuffer to the background color and the z-buffer
+	Reset();
+
+	// A 2D only application, or a scene without a camera, draws untransformed
+	Scene3d* scene = APP()->GetActive3dScene();
+	Camera* cam = scene ? scene->GetCamera() : nullptr;
+	if (!cam)
+	{
+		GetTransform(TS_VIEW).MakeIdentity();
+		GetTransform(TS_PROJECTION).MakeIdentity();
+		return ;
+	}
+
+	GetTransform(TS_VIEW).BuildCameraLookAtMatrixLH(cam->GetPosition(), cam->GetTarget(),
+		Vec3df(0.f, 1.f, 0.f));
+
+	GetTransform(TS_PROJECTION).BuildProjectionMatrixPerspectiveFovLH
+		(
+			cam->GetFOV(),
+			(Float32)size.x/(Float32)size.y, // Aspect ratio
+			cam->GetNearViewPlane(),
+			cam->GetFarViewPlane()
+		);
+}
+
+void SoftwareDevice::EndScene()
+{
+	// There is nothing to present; the framebuffer stays readable
+	// until the next BeginScene().
+}
+
+void SoftwareDevice::DrawMeshData(MeshData* mb)
+{
+	if (mb->IsIndexed())
+		return DrawIndexedMeshData(static_cast<IndexedMeshData*>(mb));
+
+	DrawSubMaterials(mb);
+}
+
+void SoftwareDevice::DrawIndexedMeshData(IndexedMeshData* mb)
+{
+	DrawSubMaterials(mb);
+}
+
+void SoftwareDevice::DrawSubMaterials(MeshData* mb)
+{
+	const Map<UInt32, Material*>& submats = mb->GetSubMaterials();
+	typedef Map<UInt32, Material*>::const_iterator submatsIt;
+
+	for (submatsIt it = submats.begin(); it != submats.end(); ++it)
+	{
+		// Prims to draw go up to the next pair's primitive position
+		submatsIt next = it;
+		++next;
+		UInt32 primsEnd = next != submats.end() ? (*next).first : mb->GetNumPrimitives();
+
+		(*it).second->Bind(this);
+		++stats.materialBinds;
+
+		DrawMeshDataPrimitives(mb, (*it).first, primsEnd - (*it).first);
+
+		(*it).second->UnBind(this);
+	}
+}
+
+void SoftwareDevice::DrawMeshDataPrimitives(MeshData* mb, UInt32 firstPrim, UInt32 numPrims)
+{
+	++stats.drawCalls;
+
+	PRIMITIVE_TYPE pt = mb->GetPrimitiveType();
+	if (pt != PT_TRIANGLELIST && pt != PT_TRIANGLESTRIP && pt != PT_TRIANGLEFAN)
+		return ;
+
+	worldViewProj = GetTransform(TS_PROJECTION) * GetTransform(TS_VIEW) * GetTransform(TS_WORLD);
+
+	const Byte* vertices = static_cast<SoftwareVertexBuffer*>(mb->GetVertexHardwareBuffer())->GetVertices();
+	VERTEX_TYPE vt = mb->GetVertexType();
+
+	// indices is nullptr for non-indexed MeshDatas
+	const UInt32* indices = nullptr;
+	if (mb->IsIndexed())
+		indices = static_cast<SoftwareIndexBuffer*>(static_cast<IndexedMeshData*>(mb)->GetIndexHardwareBuffer())->GetIndices();
+
+	const SoftwareCgShader* shader = cgdev->GetBoundShader();
+
+	for (UInt32 prim = firstPrim; prim < firstPrim + numPrims; ++prim)
+	{
+		UInt32 tri[3];
+		switch (pt)
+		{
+		case PT_TRIANGLELIST:
+			tri[0] = prim * 3; tri[1] = prim * 3 + 1; tri[2] = prim * 3 + 2;
+			break;
+		case PT_TRIANGLESTRIP:
+			// Every other triangle is reversed to preserve the winding order
+			tri[0] = prim + (prim & 1); tri[1] = prim + 1 - (prim & 1); tri[2] = prim + 2;
+			break;
+		default: // PT_TRIANGLEFAN
+			tri[0] = 0; tri[1] = prim + 1; tri[2] = prim + 2;
+			break;
+		}
+
+		ClipVertex cv[3];
+		for (UInt i = 0; i < 3; ++i)
+		{
+			UInt32 vi = indices ? indices[tri[i]] : tri[i];
+			TransformVertex(vertices + vi * vt, vt, cv[i]);
+		}
+
+		++stats.trianglesSubmitted;
+		DrawTriangle(cv[0], cv[1], cv[2], shader);
+	}
+}
+
+void SoftwareDevice::TransformVertex(const Byte* vertex, VERTEX_TYPE vt, ClipVertex& out) const
+{
+	// Every vertex type starts with its position followed by its
+	// texture coordinate channels, except for the normal in between
+	const Float32* f = reinterpret_cast<const Float32*>(vertex);
+	worldViewProj.TransformVect(out.pos, Vec3df(f[0], f[1], f[2]));
+
+	const Float32* tc = vt == VT_NORMAL ? f + 6 : f + 3;
+	out.tcoords[0][0] = tc[0];
+	out.tcoords[0][1] = tc[1];
+	if (vt == VT_T2)
+	{
+		out.tcoords[1][0] = tc[2];
+		out.tcoords[1][1] = tc[3];
+	}
+	else
+	{
+		out.tcoords[1][0] = tc[0];
+		out.tcoords[1][1] = tc[1];
+	}
+}
+
+void SoftwareDevice::DrawTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2,
+								  const SoftwareCgShader* shader)
+{
+	const ClipVertex* in[3] = { &v0, &v1, &v2 };
+
+	// Trivially reject triangles that are completely outside one
+	// of the clip planes
+	UInt32 outside[5] = { 0, 0, 0, 0, 0 };
+	for (UInt i = 0; i < 3; ++i)
+	{
+		const Float32* p = in[i]->pos;
+		outside[0] += p[0] < -p[3];
+		outside[1] += p[0] >  p[3];
+		outside[2] += p[1] < -p[3];
+		outside[3] += p[1] >  p[3];
+		outside[4] += p[2] >  p[3];
+	}
+	for (UInt i = 0; i < 5; ++i)
+		if (outside[i] == 3)
+			return ;
+
+	// Clip against the near plane (z >= 0), which leaves at most 4 vertices
+	ClipVertex clipped[4];
+	UInt32 numClipped = 0;
+	for (UInt i = 0; i < 3; ++i)
+	{
+		const ClipVertex& a = *in[i];
+		const ClipVertex& b = *in[(i + 1) % 3];
+
+		if (a.pos[2] >= 0.f)
+			clipped[numClipped++] = a;
+
+		if ((a.pos[2] >= 0.f) != (b.pos[2] >= 0.f))
+		{
+			Float32 t = a.pos[2] / (a.pos[2] - b.pos[2]);
+			ClipVertex& c = clipped[numClipped++];
+			for (UInt j = 0; j < 4; ++j)
+				c.pos[j] = a.pos[j] + (b.pos[j] - a.pos[j]) * t;
+			for (UInt j = 0; j < 2; ++j)
+			{
+				c.tcoords[j][0] = a.tcoords[j][0] + (b.tcoords[j][0] - a.tcoords[j][0]) * t;
+				c.tcoords[j][1] = a.tcoords[j][1] + (b.tcoords[j][1] - a.tcoords[j][1]) * t;
+			}
+		}
+	}
+
+	if (numClipped < 3)
+		return ;
+
+	if (GetOption(GDO_WIREFRAME))
+		return RasterizeWireframe(clipped, numClipped, shader);
+
+	RasterizeTriangle(clipped, shader);
+	if (numClipped == 4)
+	{
+		ClipVertex fan[3] = { clipped[0], clipped[2], clipped[3] };
+		RasterizeTriangle(fan, shader);
+	}
+}
+
+void SoftwareDevice::RasterizeTriangle(const ClipVertex* v, const SoftwareCgShader* shader)
+{
+	Float32 sx[3], sy[3], sz[3], invw[3];
+	for (UInt i = 0; i < 3; ++i)
+	{
+		invw[i] = 1.f / v[i].pos[3];
+		sx[i] = (v[i].pos[0] * invw[i] *  .5f + .5f) * size.x;
+		sy[i] = (v[i].pos[1] * invw[i] * -.5f + .5f) * size.y;
+		sz[i] = v[i].pos[2] * invw[i];
+	}
+
+	// Cull counter-clockwise triangles, which is what Direct3D does by
+	// default. In screen space (y pointing down) clockwise triangles have
+	// a positive area.
+	Float32 area = (sx[1] - sx[0]) * (sy[2] - sy[0]) - (sy[1] - sy[0]) * (sx[2] - sx[0]);
+	if (area <= 0.f)
+		return ;
+
+	Int32 minx = Max(static_cast<Int32>(floorf(Min(sx[0], sx[1], sx[2]))), 0);
+	Int32 miny = Max(static_cast<Int32>(floorf(Min(sy[0], sy[1], sy[2]))), 0);
+	Int32 maxx = Min(static_cast<Int32>(ceilf(Max(sx[0], sx[1], sx[2]))), static_cast<Int32>(size.x) - 1);
+	Int32 maxy = Min(static_cast<Int32>(ceilf(Max(sy[0], sy[1], sy[2]))), static_cast<Int32>(size.y) - 1);
+	if (minx > maxx || miny > maxy)
+		return ;
+
+	++stats.trianglesRasterized;
+
+	// Edge i is opposite of vertex i. Its edge function, divided by the
+	// area, is vertex i's barycentric weight.
+	Float32 stepx[3], stepy[3], rowStart[3];
+	bool topLeft[3];
+	Float32 px = minx + .5f, py = miny + .5f;
+	for (UInt i = 0; i < 3; ++i)
+	{
+		UInt a = (i + 1) % 3, b = (i + 2) % 3;
+		stepx[i] = -(sy[b] - sy[a]);
+		stepy[i] =   sx[b] - sx[a];
+		rowStart[i] = (sx[b] - sx[a]) * (py - sy[a]) - (sy[b] - sy[a]) * (px - sx[a]);
+		topLeft[i] = (sy[a] == sy[b] && sx[b] > sx[a]) || sy[b] < sy[a];
+	}
+
+	bool textured = shader && shader->GetNumSamplers() != 0;
+	Color flat = textured ? Color() : Shade(0.f, 0.f, 0.f, 0.f, shader);
+
+	// The ratio of the triangle's area in texture space to it's area on the
+	// screen selects the mip level of the whole triangle
+	for (UInt i = 0; i < 2; ++i)
+	{
+		const Float32* t0 = v[0].tcoords[i], * t1 = v[1].tcoords[i], * t2 = v[2].tcoords[i];
+		Float32 texArea = (t1[0] - t0[0]) * (t2[1] - t0[1]) - (t1[1] - t0[1]) * (t2[0] - t0[0]);
+		texelDensity[i] = textured && filterMode != TFM_NONE ? Abs(texArea) / area : 0.f;
+	}
+
+	bool zbuffer = GetOption(GDO_ZBUFFER);
+	Float32 invArea = 1.f / area;
+
+	for (Int32 y = miny; y <= maxy; ++y)
+	{
+		Float32 e[3] = { rowStart[0], rowStart[1], rowStart[2] };
+		UInt32 index = y * size.x + minx;
+
+		for (Int32 x = minx; x <= maxx; ++x, ++index)
+		{
+			bool inside = true;
+			for (UInt i = 0; i < 3; ++i)
+				inside = inside && (e[i] > 0.f || (e[i] == 0.f && topLeft[i]));
+
+			if (inside)
+			{
+				Float32 b0 = e[0] * invArea, b1 = e[1] * invArea, b2 = e[2] * invArea;
+				Float32 z = b0 * sz[0] + b1 * sz[1] + b2 * sz[2];
+
+				if (z >= 0.f && z <= 1.f && (!zbuffer || z <= depthBuffer[index]))
+				{
+					if (zbuffer)
+						depthBuffer[index] = z;
+
+					if (textured)
+					{
+						// Perspective correct texture coordinates
+						Float32 w0 = b0 * invw[0], w1 = b1 * invw[1], w2 = b2 * invw[2];
+						Float32 iw = 1.f / (w0 + w1 + w2);
+						w0 *= iw; w1 *= iw; w2 *= iw;
+
+						colorBuffer[index] = Shade
+							(
+								w0 * v[0].tcoords[0][0] + w1 * v[1].tcoords[0][0] + w2 * v[2].tcoords[0][0],
+								w0 * v[0].tcoords[0][1] + w1 * v[1].tcoords[0][1] + w2 * v[2].tcoords[0][1],
+								w0 * v[0].tcoords[1][0] + w1 * v[1].tcoords[1][0] + w2 * v[2].tcoords[1][0],
+								w0 * v[0].tcoords[1][1] + w1 * v[1].tcoords[1][1] + w2 * v[2].tcoords[1][1],
+								shader
+							);
+					}
+					else
+					{
+						colorBuffer[index] = flat;
+					}
+					++stats.pixelsWritten;
+				}
+			}
+
+			e[0] += stepx[0];
+			e[1] += stepx[1];
+			e[2] += stepx[2];
+		}
+
+		rowStart[0] += stepy[0];
+		rowStart[1] += stepy[1];
+		rowStart[2] += stepy[2];
+	}
+}
+
+void SoftwareDevice::RasterizeWireframe(const ClipVertex* v, UInt32 numVerts,
+										const SoftwareCgShader* shader)
+{
+	texelDensity[0] = texelDensity[1] = 0.f;
+
+	Color c = Shade(v[0].tcoords[0][0], v[0].tcoords[0][1],
+		v[0].tcoords[1][0], v[0].tcoords[1][1], shader);
+
+	++stats.trianglesRasterized;
+
+	for (UInt32 i = 0; i < numVerts; ++i)
+	{
+		const ClipVertex& a = v[i];
+		const ClipVertex& b = v[(i + 1) % numVerts];
+
+		Float32 ax = (a.pos[0] / a.pos[3] *  .5f + .5f) * size.x;
+		Float32 ay = (a.pos[1] / a.pos[3] * -.5f + .5f) * size.y;
+		Float32 bx = (b.pos[0] / b.pos[3] *  .5f + .5f) * size.x;
+		Float32 by = (b.pos[1] / b.pos[3] * -.5f + .5f) * size.y;
+
+		// Simple DDA; lines are not depth tested
+		Float32 dx = bx - ax, dy = by - ay;
+		UInt32 steps = static_cast<UInt32>(Min(Max(Abs(dx), Abs(dy)),
+			static_cast<Float32>(size.x + size.y))) + 1;
+		Float32 incx = dx / steps, incy = dy / steps;
+		for (UInt32 s = 0; s <= steps; ++s, ax += incx, ay += incy)
+		{
+			if (ax < 0.f || ay < 0.f || ax >= size.x || ay >= size.y)
+				continue;
+			colorBuffer[static_cast<UInt32>(ay) * size.x + static_cast<UInt32>(ax)] = c;
+			++stats.pixelsWritten;
+		}
+	}
+}
+
+Color SoftwareDevice::Shade(Float32 u0, Float32 v0, Float32 u1, Float32 v1,
+							const SoftwareCgShader* shader) const
+{
+	if (!shader)
+		return Color(255, 255, 255, 255);
+
+	UInt32 r = 255, g = 255, b = 255, a = 255;
+
+	if (shader->GetColorParam())
+	{
+		const Float32* c = shader->GetColorParam()->GetValue();
+		r = static_cast<UInt32>(Clamp(c[0], 0.f, 1.f) * 255.f);
+		g = static_cast<UInt32>(Clamp(c[1], 0.f, 1.f) * 255.f);
+		b = static_cast<UInt32>(Clamp(c[2], 0.f, 1.f) * 255.f);
+		a = static_cast<UInt32>(Clamp(c[3], 0.f, 1.f) * 255.f);
+	}
+
+	for (UInt32 i = 0; i < shader->GetNumSamplers(); ++i)
+	{
+		Texture* tex = shader->GetSampler(i)->GetValue();
+		if (!tex)
+			continue;
+
+		const SoftwareTexture* stex = static_cast<SoftwareTexture*>(tex->GetTextureHardwareBuffer());
+		const UInt32 coordSet = i == 0 ? 0 : 1;
+		Color texel = Sample(stex, SelectMipLevel(stex, coordSet),
+			coordSet ? u1 : u0, coordSet ? v1 : v0);
+		r = r * texel.GetR() / 255;
+		g = g * texel.GetG() / 255;
+		b = b * texel.GetB() / 255;
+		a = a * texel.GetA() / 255;
+	}
+
+	return Color(static_cast<UInt8>(r), static_cast<UInt8>(g),
+		static_cast<UInt8>(b), static_cast<UInt8>(a));
+}
+
+UInt32 SoftwareDevice::SelectMipLevel(const SoftwareTexture* tex, UInt32 coordSet) const
+{
+	// Each level has a quarter of the texels of the one above it. Levels are
+	// rounded like log2(texels per pixel) / 2 would be.
+	Float32 texelsPerPixel = texelDensity[coordSet] * tex->GetSize().x * tex->GetSize().y;
+	UInt32 level = 0;
+	while (level + 1 < tex->GetNumMipLevels() && texelsPerPixel >= 2.f)
+	{
+		texelsPerPixel *= .25f;
+		++level;
+	}
+	return level;
+}
+
+Color SoftwareDevice::Sample(const SoftwareTexture* tex, UInt32 level, Float32 u, Float32 v) const
+{
+	Int32 w = static_cast<Int32>(tex->GetSize(level).x), h = static_cast<Int32>(tex->GetSize(level).y);
+	if (w == 0 || h == 0)
+		return Color(255, 255, 255, 255);
+
+	if (filterMode != TFM_BILINEAR && filterMode != TFM_ANISOTROPIC)
+	{
+		Int32 x = AddressTexel(static_cast<Int32>(floorf(ClampTexelCoord(u * w))), w, addressModes[0]);
+		Int32 y = AddressTexel(static_cast<Int32>(floorf(ClampTexelCoord(v * h))), h, addressModes[1]);
+		return tex->GetTexel(x, y, level);
+	}
+
+	Float32 fx = ClampTexelCoord(u * w - .5f), fy = ClampTexelCoord(v * h - .5f);
+	Float32 flx = floorf(fx), fly = floorf(fy);
+	Float32 ax = fx - flx, ay = fy - fly;
+
+	Int32 x0 = AddressTexel(static_cast<Int32>(flx),     w, addressModes[0]);
+	Int32 x1 = AddressTexel(static_cast<Int32>(flx) + 1, w, addressModes[0]);
+	Int32 y0 = AddressTexel(static_cast<Int32>(fly),     h, addressModes[1]);
+	Int32 y1 = AddressTexel(static_cast<Int32>(fly) + 1, h, addressModes[1]);
+
+	const UInt8* t00 = reinterpret_cast<const UInt8*>(&tex->GetTexel(x0, y0, level));
+	const UInt8* t10 = reinterpret_cast<const UInt8*>(&tex->GetTexel(x1, y0, level));
+	const UInt8* t01 = reinterpret_cast<const UInt8*>(&tex->GetTexel(x0, y1, level));
+	const UInt8* t11 = reinterpret_cast<const UInt8*>(&tex->GetTexel(x1, y1, level));
+
+	UInt8 out[4];
+	for (UInt i = 0; i < 4; ++i)
+	{
+		Float32 top    = t00[i] + (t10[i] - t00[i]) * ax;
+		Float32 bottom = t01[i] + (t11[i] - t01[i]) * ax;
+		out[i] = static_cast<UInt8>(top + (bottom - top) * ay + .5f);
+	}
+	return Color(out[0], out[1], out[2], out[3]);
+}
+
+void SoftwareDevice::Draw2dTexture(const Position2d& pos, Texture* tex, const Rotation2d& rot)
+{
+	const SoftwareTexture* stex = static_cast<SoftwareTexture*>(tex->GetTextureHardwareBuffer());
+	Float32 w = static_cast<Float32>(stex->GetSize().x), h = static_cast<Float32>(stex->GetSize().y);
+	Float32 cx = w / 2.f, cy = h / 2.f;
+	Float32 c = cosf(rot), s = sinf(rot);
+
+	// Like D3DXSprite, the texture is rotated around its centre and then
+	// moved to pos. Find the screen space bounds of the rotated corners.
+	Float32 minx = 0.f, miny = 0.f, maxx = 0.f, maxy = 0.f;
+	for (UInt i = 0; i < 4; ++i)
+	{
+		Float32 x = ((i & 1) ? w : 0.f) - cx, y = ((i & 2) ? h : 0.f) - cy;
+		Float32 rx = x * c - y * s + cx + pos.x;
+		Float32 ry = x * s + y * c + cy + pos.y;
+		minx = i == 0 ? rx : Min(minx, rx); maxx = i == 0 ? rx : Max(maxx, rx);
+		miny = i == 0 ? ry : Min(miny, ry); maxy = i == 0 ? ry : Max(maxy, ry);
+	}
+
+	Int32 x0 = Max(static_cast<Int32>(floorf(minx)), 0);
+	Int32 y0 = Max(static_cast<Int32>(floorf(miny)), 0);
+	Int32 x1 = Min(static_cast<Int32>(ceilf(maxx)), static_cast<Int32>(size.x) - 1);
+	Int32 y1 = Min(static_cast<Int32>(ceilf(maxy)), static_cast<Int32>(size.y) - 1);
+
+	for (Int32 y = y0; y <= y1; ++y)
+	{
+		for (Int32 x = x0; x <= x1; ++x)
+		{
+			// Map the pixel back into texture space
+			Float32 dx = x + .5f - pos.x - cx, dy = y + .5f - pos.y - cy;
+			Float32 tx =  dx * c + dy * s + cx;
+			Float32 ty = -dx * s + dy * c + cy;
+			if (tx < 0.f || ty < 0.f || tx >= w || ty >= h)
+				continue;
+
+			const Color& src = stex->GetTexel(static_cast<UInt>(tx), static_cast<UInt>(ty));
+			Color& dst = colorBuffer[y * size.x + x];
+
+			// Alpha blending
+			UInt32 a = src.GetA(), ia = 255 - a;
+			dst = Color
+				(
+					static_cast<UInt8>((src.GetR() * a + dst.GetR() * ia) / 255),
+					static_cast<UInt8>((src.GetG() * a + dst.GetG() * ia) / 255),
+					static_cast<UInt8>((src.GetB() * a + dst.GetB() * ia) / 255),
+					static_cast<UInt8>(Max(static_cast<UInt32>(dst.GetA()), a))
+				);
+			++stats.pixelsWritten;
+		}
+	}
+}
+
+void SoftwareDevice::Draw2dQuads(Texture* tex, const Quad2d* quads, UInt32 numQuads)
+{
+	const SoftwareTexture* stex = static_cast<SoftwareTexture*>(tex->GetTextureHardwareBuffer());
+
+	for (UInt32 i = 0; i < numQuads; ++i)
+	{
+		const Quad2d& q = quads[i];
+
+		// The quad is the parallelogram spanned by e1 and e2 from it's
+		// up-left corner. Pixels are mapped back onto it by inverting them.
+		const Float32 e1x = q.pos[1].x - q.pos[0].x, e1y = q.pos[1].y - q.pos[0].y;
+		const Float32 e2x = q.pos[3].x - q.pos[0].x, e2y = q.pos[3].y - q.pos[0].y;
+		const Float32 det = e1x * e2y - e1y * e2x;
+		if (Abs(det) < 1e-6f)
+			continue;
+		const Float32 invDet = 1.f / det;
+
+		Float32 minx = q.pos[0].x, miny = q.pos[0].y, maxx = minx, maxy = miny;
+		for (UInt j = 1; j < 4; ++j)
+		{
+			minx = Min(minx, q.pos[j].x); maxx = Max(maxx, q.pos[j].x);
+			miny = Min(miny, q.pos[j].y); maxy = Max(maxy, q.pos[j].y);
+		}
+
+		Int32 x0 = Max(static_cast<Int32>(floorf(minx)), 0);
+		Int32 y0 = Max(static_cast<Int32>(floorf(miny)), 0);
+		Int32 x1 = Min(static_cast<Int32>(ceilf(maxx)), static_cast<Int32>(size.x) - 1);
+		Int32 y1 = Min(static_cast<Int32>(ceilf(maxy)), static_cast<Int32>(size.y) - 1);
+
+		for (Int32 y = y0; y <= y1; ++y)
+		{
+			for (Int32 x = x0; x <= x1; ++x)
+			{
+				const Float32 dx = x + .5f - q.pos[0].x, dy = y + .5f - q.pos[0].y;
+				const Float32 s = (dx * e2y - dy * e2x) * invDet;
+				const Float32 t = (e1x * dy - e1y * dx) * invDet;
+				if (s < 0.f || t < 0.f || s >= 1.f || t >= 1.f)
+					continue;
+
+				const Color texel = Sample(stex, 0,
+					q.uv0.x + (q.uv1.x - q.uv0.x) * s, q.uv0.y + (q.uv1.y - q.uv0.y) * t);
+				const UInt32 r = texel.GetR() * q.color.GetR() / 255;
+				const UInt32 g = texel.GetG() * q.color.GetG() / 255;
+				const UInt32 b = texel.GetB() * q.color.GetB() / 255;
+				const UInt32 a = texel.GetA() * q.color.GetA() / 255;
+				if (!a)
+					continue;
+
+				// Alpha blending
+				Color& dst = colorBuffer[y * size.x + x];
+				UInt32 ia = 255 - a;
+				dst = Color
+					(
+						static_cast<UInt8>((r * a + dst.GetR() * ia) / 255),
+						static_cast<UInt8>((g * a + dst.GetG() * ia) / 255),
+						static_cast<UInt8>((b * a + dst.GetB() * ia) / 255),
+						static_cast<UInt8>(Max(static_cast<UInt32>(dst.GetA()), a))
+					);
+				++stats.pixelsWritten;
+			}
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Screenshots
+
+void SoftwareDevice::TakeScreenshot(const String& filePath, IMAGE_TYPE imageType)
+{
+	switch (imageType)
+	{
+	case IMGT_BMP:
+		WriteBMP(filePath);
+		break;
+	case IMGT_TGA:
+		WriteTGA(filePath);
+		break;
+	case IMGT_PNG:
+		WritePNG(filePath);
+		break;
+	default:
+		throw Exception(Text("The image type given to SoftwareDevice::TakeScreenshot() is not supported."));
+	}
+
+	MAKO_LOG(APP()->GetConsole(), LL_LOW, Text("Saved screenshot [") + filePath + StringChar(']'));
+}
+
+void SoftwareDevice::WriteBMP(const String& filePath) const
+{
+	FileOutputStream out(filePath);
+
+	UInt32 rowSize = (size.x * 3 + 3) & ~3;
+	UInt32 dataSize = rowSize * size.y;
+
+	// BITMAPFILEHEADER
+	out.Write8BitUInt('B');
+	out.Write8BitUInt('M');
+	out.Write32BitUInt(14 + 40 + dataSize);
+	out.Write32BitUInt(0);
+	out.Write32BitUInt(14 + 40);
+
+	// BITMAPINFOHEADER
+	out.Write32BitUInt(40);
+	out.Write32BitInt(size.x);
+	out.Write32BitInt(size.y);
+	out.Write16BitUInt(1);
+	out.Write16BitUInt(24);
+	out.Write32BitUInt(0);
+	out.Write32BitUInt(dataSize);
+	out.Write32BitInt(2835);
+	out.Write32BitInt(2835);
+	out.Write32BitUInt(0);
+	out.Write32BitUInt(0);
+
+	// Rows are stored bottom-up in BGR order
+	ArrayList<UInt8> row(rowSize);
+	for (UInt32 y = size.y; y-- != 0;)
+	{
+		const Color* in = &colorBuffer[y * size.x];
+		for (UInt32 x = 0; x < size.x; ++x)
+		{
+			row[x * 3]     = in[x].GetB();
+			row[x * 3 + 1] = in[x].GetG();
+			row[x * 3 + 2] = in[x].GetR();
+		}
+		out.WriteData(&row[0], rowSize);
+	}
+}
+
+void SoftwareDevice::WriteTGA(const String& filePath) const
+{
+	FileOutputStream out(filePath);
+
+	out.Write8BitUInt(0);  // ID length
+	out.Write8BitUInt(0);  // No color map
+	out.Write8BitUInt(2);  // Uncompressed true-color
+	for (UInt i = 0; i < 5; ++i)
+		out.Write8BitUInt(0); // Color map specification
+	out.Write16BitUInt(0); // X origin
+	out.Write16BitUInt(0); // Y origin
+	out.Write16BitUInt(static_cast<UInt16>(size.x));
+	out.Write16BitUInt(static_cast<UInt16>(size.y));
+	out.Write8BitUInt(32);
+	out.Write8BitUInt(0x28); // 8 alpha bits, top-left origin
+
+	ArrayList<UInt8> row(size.x * 4);
+	for (UInt32 y = 0; y < size.y; ++y)
+	{
+		const Color* in = &colorBuffer[y * size.x];
+		for (UInt32 x = 0; x < size.x; ++x)
+		{
+			row[x * 4]     = in[x].GetB();
+			row[x * 4 + 1] = in[x].GetG();
+			row[x * 4 + 2] = in[x].GetR();
+			row[x * 4 + 3] = in[x].GetA();
+		}
+		out.WriteData(&row[0], row.size());
+	}
+}
+
+void SoftwareDevice::WritePNG(const String& filePath) const
+{
+	FileOutputStream out(filePath);
+
+	png_structp png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING,
+		NULL, (png_error_ptr)png_screenshot_error, NULL);
+	if (!png_ptr)
+		throw Exception(Text("png_create_write_struct() failed in SoftwareDevice::WritePNG()"));
+
+	png_infop info_ptr = png_create_info_struct(png_ptr);
+	if (!info_ptr)
+	{
+		png_destroy_write_struct(&png_ptr, NULL);
+		throw Exception(Text("png_create_info_struct() failed in SoftwareDevice::WritePNG()"));
+	}
+
+	ArrayList<png_bytep> rowPointers(size.y);
+
+	// for proper error handling
+	if (setjmp(png_jmpbuf(png_ptr)))
+	{
+		png_destroy_write_struct(&png_ptr, &info_ptr);
+		throw Exception(Text("An error occured in SoftwareDevice::WritePNG()"));
+	}
+
+	png_set_write_fn(png_ptr, &out, png_screenshot_write_data, png_screenshot_flush);
+
+	png_set_IHDR(png_ptr, info_ptr, size.x, size.y, 8, PNG_COLOR_TYPE_RGB_ALPHA,
+		PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+	png_write_info(png_ptr, info_ptr);
+
+	// The framebuffer is already in the R8G8B8A8 format libpng expects
+	for (UInt32 y = 0; y < size.y; ++y)
+		rowPointers[y] = (png_bytep)&colorBuffer[y * size.x];
+
+	png_write_image(png_ptr, &rowPointers[0]);
+	png_write_end(png_ptr, info_ptr);
+	png_destroy_write_struct(&png_ptr, &info_ptr);
+}
+
+MAKO_END_NAMESPACE
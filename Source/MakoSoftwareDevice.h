@@ -0,0 +1,185 @@
+#pragma once
+#include "MakoCommon.h"
+#include "MakoGenericGraphicsDevice.h"
+#include "MakoArrayList.h"
+#include "MakoVec2d.h"
+#include "MakoColor.h"
+
+MAKO_BEGIN_NAMESPACE
+
+// Forward declarations
+class Material;
+class CgDevice;
+class SoftwareCgDevice;
+class SoftwareCgShader;
+class SoftwareTexture;
+
+//! Counters gathered by the SoftwareDevice. They are reset in BeginScene(),
+//! so after EndScene() they describe the last frame.
+struct SoftwareRenderStats
+{
+	//! Number of primitive ranges drawn, one per sub material of every
+	//! DrawMeshData() call, and one per DrawMeshDataPrimitives() call
+	UInt32 drawCalls;
+	//! Number of Material::Bind() calls made by DrawMeshData()
+	UInt32 materialBinds;
+	//! Number of triangles handed to the rasterizer
+	UInt32 trianglesSubmitted;
+	//! Number of triangles that survived clipping and culling
+	UInt32 trianglesRasterized;
+	//! Number of pixels that passed the depth test
+	UInt32 pixelsWritten;
+
+	MAKO_INLINE SoftwareRenderStats()
+		: drawCalls(0), materialBinds(0), trianglesSubmitted(0),
+		  trianglesRasterized(0), pixelsWritten(0) {}
+};
+
+//! A GraphicsDevice that rasterizes into an offscreen framebuffer in
+//! system memory. It needs no window and no GPU, which makes it useful
+//! for running the engine on headless machines: profiling scene traversal,
+//! material binding and draw submission, and golden-image tests with
+//! TakeScreenshot().
+//!
+//! Triangle lists, strips and fans are rasterized with perspective-correct
+//! texture coordinates and a z-buffer. Point and line primitives are
+//! ignored. Materials are shaded as described in SoftwareCgShader.
+class SoftwareDevice : public GenericGraphicsDevice
+{
+private:
+	//! A vertex after it has been transformed into clip space
+	struct ClipVertex
+	{
+		Float32 pos[4];
+		Float32 tcoords[2][2];
+	};
+
+	Size2d size;
+	ArrayList<Color> colorBuffer;
+	ArrayList<Float32> depthBuffer;
+
+	Color backgroundColor;
+	ArrayList<bool> deviceOptions;
+
+	TEXTURE_FILTER_MODE filterMode;
+	TEXTURE_ADDRESS_MODE addressModes[2];
+
+	Material* defaultmtl;
+	SoftwareCgDevice* cgdev;
+	String vendornfo;
+
+	SoftwareRenderStats stats;
+
+	//! PROJECTION * VIEW * WORLD of the current draw call
+	Matrix4f worldViewProj;
+
+	//! Area in texture space, in texture coordinates, that each pixel of the
+	//! triangle that is rasterized covers, for both texture coordinate sets.
+	//! 0 if mip mapping is off.
+	Float32 texelDensity[2];
+public:
+	//! \param[in] vsync Whether the device should report v-sync as enabled.
+	//! Nothing is presented, so it only affects how the application steps time.
+	//! \param[in] size The size of the framebuffer, in pixels.
+	SoftwareDevice(bool vsync, const Size2d& size);
+	~SoftwareDevice();
+
+	MAKO_INLINE GRAPHICS_DEVICE_TYPE GetType() const
+	{ return GDT_SOFTWARE; }
+
+	void BeginScene();
+	void EndScene();
+	void Reset();
+
+	CgDevice* GetCgDevice() const;
+
+	Material* GetDefaultMaterial();
+	void SetDefaultMaterial(Material* mtl);
+
+	MAKO_INLINE void SetBackgroundColor(const Color& color)
+	{ backgroundColor = color; }
+
+	MAKO_INLINE void SetOption(GRAPHICS_DEVICE_OPTION option, bool b)
+	{ deviceOptions[option] = b; }
+
+	MAKO_INLINE bool GetOption(GRAPHICS_DEVICE_OPTION option) const
+	{ return deviceOptions[option]; }
+
+	MAKO_INLINE void SetTextureFilteringMode(TEXTURE_FILTER_MODE mode)
+	{ filterMode = mode; }
+
+	MAKO_INLINE TEXTURE_FILTER_MODE GetTextureFilteringMode()
+	{ return filterMode; }
+
+	MAKO_INLINE void SetTexAddressUMode(TEXTURE_ADDRESS_MODE mode)
+	{ addressModes[0] = mode; }
+
+	MAKO_INLINE void SetTexAddressVMode(TEXTURE_ADDRESS_MODE mode)
+	{ addressModes[1] = mode; }
+
+	MAKO_INLINE TEXTURE_ADDRESS_MODE GetTexAddressUMode()
+	{ return addressModes[0]; }
+
+	MAKO_INLINE TEXTURE_ADDRESS_MODE GetTexAddressVMode()
+	{ return addressModes[1]; }
+
+	MAKO_INLINE const String& GetGPUVendorInfo() const
+	{ return vendornfo; }
+
+	String GetName() const;
+
+	//! Supports IMGT_BMP, IMGT_TGA and IMGT_PNG.
+	void TakeScreenshot(const String& filePath, IMAGE_TYPE imageType = IMGT_PNG);
+
+	void DrawMeshData(MeshData* mb);
+	void DrawIndexedMeshData(IndexedMeshData* mb);
+	void DrawMeshDataPrimitives(MeshData* mb, UInt32 firstPrim, UInt32 numPrims);
+
+	void Draw2dTexture(const Position2d& pos,
+		Texture* tex, const Rotation2d& rot = Rot2d(0.f));
+
+	void Draw2dQuads(Texture* tex, const Quad2d* quads, UInt32 numQuads);
+
+	//! Get the framebuffer's size
+	MAKO_INLINE const Size2d& GetFramebufferSize() const
+	{ return size; }
+
+	//! Get the framebuffer's pixels, row by row, in the CF_R8G8B8A8 format.
+	MAKO_INLINE const Color* GetFramebuffer() const
+	{ return &colorBuffer[0]; }
+
+	//! Get the counters of the last (or current) frame
+	MAKO_INLINE const SoftwareRenderStats& GetStats() const
+	{ return stats; }
+private:
+	VertexHardwareBuffer* CreateVertexHardwareBuffer(MeshData* parent);
+	IndexHardwareBuffer* CreateIndexHardwareBuffer(IndexedMeshData* parent);
+	TextureHardwareBuffer* CreateTextureHardwareBuffer(Texture* parent);
+
+	//! Binds every sub material of mb, and draws it's range of primitives
+	void DrawSubMaterials(MeshData* mb);
+
+	void TransformVertex(const Byte* vertex, VERTEX_TYPE vt, ClipVertex& out) const;
+
+	//! Clips against the near plane, then rasterizes the result
+	void DrawTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2,
+		const SoftwareCgShader* shader);
+
+	void RasterizeTriangle(const ClipVertex* v, const SoftwareCgShader* shader);
+	void RasterizeWireframe(const ClipVertex* v, UInt32 numVerts, const SoftwareCgShader* shader);
+
+	Color Shade(Float32 u0, Float32 v0, Float32 u1, Float32 v1,
+		const SoftwareCgShader* shader) const;
+
+	//! Picks the mip level of tex for texture coordinate set coordSet, from
+	//! the texel density of the triangle that is rasterized
+	UInt32 SelectMipLevel(const SoftwareTexture* tex, UInt32 coordSet) const;
+
+	Color Sample(const SoftwareTexture* tex, UInt32 level, Float32 u, Float32 v) const;
+
+	void WriteBMP(const String& filePath) const;
+	void WriteTGA(const String& filePath) const;
+	void WritePNG(const String& filePath) const;
+};
+
+MAKO_END_NAMESPACE
@@ -0,0 +1,51 @@
+#pragma once
+#include "MakoCommon.h"
+#include "MakoIndexedMeshData.h"
+#include "MakoArrayList.h"
+
+MAKO_BEGIN_NAMESPACE
+
+//! The SoftwareDevice's "hardware" index buffer. The indices are widened
+//! to 32 bits when copied, so the rasterizer never has to check the
+//! index type.
+class SoftwareIndexBuffer : public IndexHardwareBuffer
+{
+private:
+	IndexedMeshData* imb;
+	ArrayList<UInt32> indices;
+public:
+	MAKO_INLINE SoftwareIndexBuffer(IndexedMeshData* imb)
+		: imb(imb)
+	{ Update(); }
+
+	MAKO_INLINE ~SoftwareIndexBuffer() {}
+
+	MAKO_INLINE IndexedMeshData* GetParent()
+	{ return imb; }
+
+	MAKO_INLINE const UInt32* GetIndices() const
+	{ return &indices[0]; }
+
+	MAKO_INLINE UInt32 GetNumIndices() const
+	{ return indices.size(); }
+
+	MAKO_INLINE void Update()
+	{
+		indices.resize(imb->GetNumVertexBufferIndices());
+		if (indices.empty())
+			return ;
+
+		if (imb->GetVertexBufferIndexType() == VBIT_16)
+		{
+			const UInt16* in = static_cast<const UInt16*>(imb->GetVertexBufferIndices());
+			for (UInt32 i = 0; i < indices.size(); ++i)
+				indices[i] = in[i];
+		}
+		else
+		{
+			memcpy(&indices[0], imb->GetVertexBufferIndices(), indices.size() * sizeof(UInt32));
+		}
+	}
+};
+
+MAKO_END_NAMESPACE
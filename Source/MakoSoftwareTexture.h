@@ -0,0 +1,82 @@
+#pragma once
+#include "MakoCommon.h"
+#include "MakoTexture.h"
+#include "MakoColor.h"
+#include "MakoArrayList.h"
+#include "MakoException.h"
+#include "MakoBlockCompression.h"
+
+MAKO_BEGIN_NAMESPACE
+
+//! The SoftwareDevice's "hardware" texture: a copy of its parent's
+//! pixels in system memory, stored as Colors. Every mip level of the
+//! parent is copied, one after another. Block compressed levels are
+//! decompressed, and CF_A8 ones are expanded to white.
+class SoftwareTexture : public TextureHardwareBuffer
+{
+private:
+	Texture* parent;
+	ArrayList<Size2d> sizes;
+	//! Index of the first texel of each mip level in texels
+	ArrayList<UInt32> offsets;
+	ArrayList<Color> texels;
+public:
+	MAKO_INLINE SoftwareTexture(Texture* texture)
+		: parent(texture)
+	{ Update(); }
+
+	MAKO_INLINE ~SoftwareTexture() {}
+
+	MAKO_INLINE Texture* GetParent()
+	{ return parent; }
+
+	MAKO_INLINE UInt32 GetNumMipLevels() const
+	{ return sizes.size(); }
+
+	MAKO_INLINE const Size2d& GetSize(UInt32 level = 0) const
+	{ return sizes[level]; }
+
+	MAKO_INLINE const Color& GetTexel(UInt x, UInt y, UInt32 level = 0) const
+	{ return texels[offsets[level] + y * sizes[level].x + x]; }
+
+	MAKO_INLINE void Update()
+	{
+		const COLOR_FORMAT format = parent->GetColorFormat();
+		if (format != CF_R8G8B8A8 && format != CF_A8 && !IsBlockCompressed(format))
+			throw Exception(Text("Failed to identify color format in SoftwareTexture::Update()."));
+
+		const UInt32 levels = parent->GetNumMipLevels();
+		sizes.resize(levels);
+		offsets.resize(levels);
+
+		UInt32 numTexels = 0;
+		for (UInt32 i = 0; i < levels; ++i)
+		{
+			sizes[i]   = parent->GetMipLevelSize(i);
+			offsets[i] = numTexels;
+			numTexels += sizes[i].x * sizes[i].y;
+		}
+
+		texels.resize(numTexels);
+		for (UInt32 i = 0; i < levels; ++i)
+		{
+			if (!(sizes[i].x * sizes[i].y))
+				continue;
+
+			UInt8* out = reinterpret_cast<UInt8*>(&texels[offsets[i]]);
+			const UInt8* in = static_cast<const UInt8*>(parent->GetMipLevelData(i));
+			if (format == CF_R8G8B8A8)
+				memcpy(out, in, sizes[i].x * sizes[i].y * sizeof(Color));
+			else if (format == CF_A8)
+			{
+				Color* texel = &texels[offsets[i]];
+				for (UInt32 j = 0; j < sizes[i].x * sizes[i].y; ++j)
+					texel[j] = Color(255, 255, 255, in[j]);
+			}
+			else
+				DecompressImage(in, sizes[i], format, out);
+		}
+	}
+};
+
+MAKO_END_NAMESPACE
@@ -0,0 +1,37 @@
+#pragma once
+#include "MakoCommon.h"
+#include "MakoMeshData.h"
+#include "MakoArrayList.h"
+
+MAKO_BEGIN_NAMESPACE
+
+//! The SoftwareDevice's "hardware" vertex buffer. It is a copy of its
+//! parent's vertices in system memory, so like any other hardware buffer,
+//! changes made to the parent are only seen after calling Update().
+class SoftwareVertexBuffer : public VertexHardwareBuffer
+{
+private:
+	MeshData* mb;
+	ArrayList<Byte> vertices;
+public:
+	MAKO_INLINE SoftwareVertexBuffer(MeshData* mb)
+		: mb(mb)
+	{ Update(); }
+
+	MAKO_INLINE ~SoftwareVertexBuffer() {}
+
+	MAKO_INLINE MeshData* GetParent()
+	{ return mb; }
+
+	MAKO_INLINE const Byte* GetVertices() const
+	{ return &vertices[0]; }
+
+	MAKO_INLINE void Update()
+	{
+		vertices.resize(mb->GetNumVertices() * mb->GetVertexType());
+		if (!vertices.empty())
+			memcpy(&vertices[0], mb->GetVertices(), vertices.size());
+	}
+};
+
+MAKO_END_NAMESPACE
@@ -0,0 +1,64 @@
+#pragma once
+#include "MakoCommon.h"
+#include "MakoVec3d.h"
+#include "MakoMatrix4.h"
+
+MAKO_BEGIN_NAMESPACE
+
+//! A bounding sphere. A sphere with a negative radius contains nothing, and
+//! is called empty. Default constructed spheres are empty.
+template <typename T>
+class Sphere3d
+{
+public:
+	/////////////////////////////////////////////////////
+	// Fields
+
+	//! The center of the sphere
+	Vec3d<T> center;
+	//! The radius of the sphere
+	T radius;
+
+	/////////////////////////////////////////////////////
+	// Constructor(s)/Deconstructor
+
+	//! Constructs an empty sphere
+	MAKO_INLINE Sphere3d()
+		: radius((T)-1) {}
+
+	MAKO_INLINE Sphere3d(const Vec3d<T>& center, T radius)
+		: center(center), radius(radius) {}
+
+	/////////////////////////////////////////////////////
+	// Methods
+
+	//! Check if this sphere contains nothing
+	MAKO_INLINE bool IsEmpty() const
+	{ return radius < (T)0; }
+
+	//! Get the sphere that contains this sphere after it was transformed by mat.
+	//! The radius is scaled by the largest scale of mat. Empty spheres stay empty.
+	Sphere3d<T> GetTransformed(const Matrix4<T>& mat) const
+	{
+		if (IsEmpty())
+			return *this;
+
+		Vec3d<T> c;
+		mat.TransformVect(c, center);
+
+		// The lengths of the first three rows are the scales along the axes
+		T maxScaleSq = (T)0;
+		for (UInt32 i = 0; i < 3; ++i)
+		{
+			const T s = mat[i*4+0]*mat[i*4+0] + mat[i*4+1]*mat[i*4+1] + mat[i*4+2]*mat[i*4+2];
+			if (s > maxScaleSq)
+				maxScaleSq = s;
+		}
+		return Sphere3d<T>(c, radius * (T)sqrt(maxScaleSq));
+	}
+};
+
+//! Typedef for a Float32 bounding sphere
+typedef Sphere3d<Float32> Sphere3df;
+
+MAKO_END_NAMESPACE
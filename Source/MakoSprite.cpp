@@ -2,19 +2,37 @@
 #include "MakoApplication.h"
 #include "MakoGraphicsDevice.h"
 #include "MakoTexture.h"
+#include "MakoSpriteBatch.h"
 
 MAKO_BEGIN_NAMESPACE
 
 Sprite::Sprite(Texture* t,
 			   const Position2d& pos,
 			   const Rotation2d& rot)
-: Scene2dNode(pos, rot)
-{ tex = t; tex->Hold(); }
+: Scene2dNode(pos, rot), uv0(0.f, 0.f), uv1(1.f, 1.f),
+  color(255, 255, 255, 255), layer(0)
+{
+	tex = t;
+	tex->Hold();
+	SetSize(tex->GetSize());
+}
 
 Sprite::~Sprite()
 { tex->Drop(); }
 
 void Sprite::Draw()
-{ APP()->GetGraphicsDevice()->Draw2dTexture(GetPosition(), tex, GetRotation()); }
+{
+	SpriteBatch batch;
+	Draw(&batch);
+	batch.Flush(APP()->GetGraphicsDevice());
+}
+
+void Sprite::Draw(SpriteBatch* batch)
+{
+	batch->Add(tex,
+		Vec2df(static_cast<Float32>(GetPosition().x), static_cast<Float32>(GetPosition().y)),
+		Vec2df(static_cast<Float32>(GetSize().x), static_cast<Float32>(GetSize().y)),
+		GetRotation(), uv0, uv1, color, layer);
+}
 
 MAKO_END_NAMESPACE
@@ -2,16 +2,24 @@
 
 #include "MakoCommon.h"
 #include "MakoScene2dNode.h"
+#include "MakoColor.h"
 
 MAKO_BEGIN_NAMESPACE
 
 class Texture;
 
+//! A texture drawn in a Scene2d, rotated around it's centre. A Sprite can
+//! show a rectangle of it's texture (e.g. one frame of an animation sheet),
+//! be tinted, and be put on a layer. It's size (see Scene2dNode::SetSize())
+//! is the size of it's texture by default. In a Scene2d, it's drawn by the
+//! scene's SpriteBatch.
 class Sprite : public Scene2dNode
 {
 private:
 	Texture* tex;
-	Float32 rot;
+	TCoord uv0, uv1;
+	Color color;
+	Int32 layer;
 public:
 	MAKO_API Sprite(Texture* t, const Position2d& pos,
 		const Rotation2d& rot = 0.f);
@@ -19,8 +27,40 @@ public:
 	MAKO_INLINE Texture* GetTexture() const
 	{ return tex; }
 
+	//! Set the rectangle of the texture that is drawn, in texture
+	//! coordinates. It's all of it by default.
+	MAKO_INLINE void SetTexCoords(const TCoord& upLeft, const TCoord& downRight)
+	{ uv0 = upLeft; uv1 = downRight; }
+
+	MAKO_INLINE const TCoord& GetTexCoordsUpLeft() const
+	{ return uv0; }
+
+	MAKO_INLINE const TCoord& GetTexCoordsDownRight() const
+	{ return uv1; }
+
+	//! Set the color the texture is multiplied with, white by default
+	MAKO_INLINE void SetColor(const Color& color)
+	{ this->color = color; }
+
+	MAKO_INLINE const Color& GetColor() const
+	{ return color; }
+
+	//! Set the layer of the sprite. Sprites of lower layers are drawn below
+	//! those of higher ones, and sprites of the same layer in their draw
+	//! order (see Scene2dNode::SetDrawOrder()). It's 0 by default.
+	MAKO_INLINE void SetLayer(Int32 layer)
+	{ this->layer = layer; }
+
+	MAKO_INLINE Int32 GetLayer() const
+	{ return layer; }
+
 	MAKO_API virtual ~Sprite();
+
+	//! Draws the sprite right away, with a draw call of it's own
 	MAKO_API virtual void Draw();
+
+	//! Queues the sprite in batch
+	MAKO_API virtual void Draw(SpriteBatch* batch);
 };
 
 MAKO_END_NAMESPACE
\ No newline at end of file
@@ -0,0 +1,116 @@
+#include "MakoSpriteBatch.h"
+#include "MakoSIMD.h"
+#include "MakoMath.h"
+#include <algorithm>
+#include <cmath>
+
+MAKO_BEGIN_NAMESPACE
+
+void SpriteBatch::Flush(GraphicsDevice* gd)
+{
+	numDrawCalls = 0;
+	if (entries.empty())
+		return;
+
+	const UInt32 n = entries.size();
+	order.resize(n);
+	for (UInt32 i = 0; i < n; ++i)
+		order[i] = i;
+	std::sort(order.begin(), order.end(), EntryOrder(&entries[0]));
+
+	// The corners are the centre of a sprite plus or minus the rotated half
+	// sizes: a = hw cos, b = hh sin, c = hw sin and d = hh cos. They're
+	// stored as arrays of every sprite, padded to a multiple of 4, followed
+	// by the x and y of the 4 corners.
+	const UInt32 padded = (n + 3) & ~3;
+	corners.assign(padded * 14, 0.f);
+	Float32* cx = &corners[0];
+	Float32* cy = cx + padded;
+	Float32* a  = cy + padded;
+	Float32* b  = a  + padded;
+	Float32* c  = b  + padded;
+	Float32* d  = c  + padded;
+	Float32* px = d  + padded;
+	Float32* py = px + padded * 4;
+
+	for (UInt32 i = 0; i < n; ++i)
+	{
+		const Entry& e = entries[order[i]];
+		const Float32 hw = e.size.x * .5f, hh = e.size.y * .5f;
+		const Float32 cosr = e.rot != 0.f ? cosf(e.rot) : 1.f;
+		const Float32 sinr = e.rot != 0.f ? sinf(e.rot) : 0.f;
+		cx[i] = e.pos.x + hw;
+		cy[i] = e.pos.y + hh;
+		a[i]  = hw * cosr;
+		b[i]  = hh * sinr;
+		c[i]  = hw * sinr;
+		d[i]  = hh * cosr;
+	}
+
+	// Corners in the order of Quad2d: up-left, up-right, down-right, down-left
+#ifdef MAKO_SSE_AVAILABLE
+	if (GetSIMDLevel() != SL_SCALAR)
+	{
+		for (UInt32 i = 0; i < padded; i += 4)
+		{
+			const __m128 vcx = _mm_loadu_ps(cx + i), vcy = _mm_loadu_ps(cy + i);
+			const __m128 va = _mm_loadu_ps(a + i), vb = _mm_loadu_ps(b + i);
+			const __m128 vc = _mm_loadu_ps(c + i), vd = _mm_loadu_ps(d + i);
+			const __m128 apb = _mm_add_ps(va, vb), amb = _mm_sub_ps(va, vb);
+			const __m128 cpd = _mm_add_ps(vc, vd), cmd = _mm_sub_ps(vc, vd);
+
+			_mm_storeu_ps(px + i,              _mm_sub_ps(vcx, amb));
+			_mm_storeu_ps(py + i,              _mm_sub_ps(vcy, cpd));
+			_mm_storeu_ps(px + padded + i,     _mm_add_ps(vcx, apb));
+			_mm_storeu_ps(py + padded + i,     _mm_add_ps(vcy, cmd));
+			_mm_storeu_ps(px + padded * 2 + i, _mm_add_ps(vcx, amb));
+			_mm_storeu_ps(py + padded * 2 + i, _mm_add_ps(vcy, cpd));
+			_mm_storeu_ps(px + padded * 3 + i, _mm_sub_ps(vcx, apb));
+			_mm_storeu_ps(py + padded * 3 + i, _mm_sub_ps(vcy, cmd));
+		}
+	}
+	else
+#endif
+	{
+		for (UInt32 i = 0; i < n; ++i)
+		{
+			px[i]              = cx[i] - a[i] + b[i];
+			py[i]              = cy[i] - c[i] - d[i];
+			px[padded + i]     = cx[i] + a[i] + b[i];
+			py[padded + i]     = cy[i] + c[i] - d[i];
+			px[padded * 2 + i] = cx[i] + a[i] - b[i];
+			py[padded * 2 + i] = cy[i] + c[i] + d[i];
+			px[padded * 3 + i] = cx[i] - a[i] - b[i];
+			py[padded * 3 + i] = cy[i] - c[i] + d[i];
+		}
+	}
+
+	quads.resize(n);
+	for (UInt32 i = 0; i < n; ++i)
+	{
+		const Entry& e = entries[order[i]];
+		Quad2d& q = quads[i];
+		for (UInt32 j = 0; j < 4; ++j)
+			q.pos[j] = Vec2df(px[padded * j + i], py[padded * j + i]);
+		q.uv0   = e.uv0;
+		q.uv1   = e.uv1;
+		q.color = e.color;
+	}
+
+	// Every run of neighbouring sprites with the same texture is one draw
+	// call, even if the run spans layers
+	UInt32 first = 0;
+	for (UInt32 i = 1; i <= n; ++i)
+	{
+		if (i < n && entries[order[i]].tex == entries[order[first]].tex)
+			continue;
+
+		gd->Draw2dQuads(entries[order[first]].tex, &quads[first], i - first);
+		++numDrawCalls;
+		first = i;
+	}
+
+	entries.clear();
+}
+
+MAKO_END_NAMESPACE
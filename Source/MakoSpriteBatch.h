@@ -0,0 +1,94 @@
+#pragma once
+#include "MakoCommon.h"
+#include "MakoVec2d.h"
+#include "MakoColor.h"
+#include "MakoArrayList.h"
+#include "MakoGraphicsDevice.h"
+
+MAKO_BEGIN_NAMESPACE
+
+// Forward declaration
+class Texture;
+
+//! Gathers 2d sprites and draws them with few draw calls. Sprites are queued
+//! with Add() and drawn by Flush(), sorted by their layer. The sprites of a
+//! layer are drawn in the order they were added, so overlapping sprites
+//! stack the same way every run. Every run of neighbouring sprites with the
+//! same texture is one GraphicsDevice::Draw2dQuads() call, so adding the
+//! sprites of a texture after another makes fewer draw calls.
+//! The corners of the rotated sprites are calculated with SSE, four sprites
+//! at a time. Scene2d::DrawAll() draws every Sprite with one.
+class SpriteBatch
+{
+private:
+	struct Entry
+	{
+		Texture* tex;
+		Int32 layer;
+		Vec2df pos, size;
+		Rotation2d rot;
+		TCoord uv0, uv1;
+		Color color;
+	};
+
+	//! Orders indices of entries by layer and then the order the entries were
+	//! added in
+	struct EntryOrder
+	{
+		const Entry* entries;
+		MAKO_INLINE EntryOrder(const Entry* entries) : entries(entries) {}
+		MAKO_INLINE bool operator()(UInt32 a, UInt32 b) const
+		{
+			if (entries[a].layer != entries[b].layer)
+				return entries[a].layer < entries[b].layer;
+			return a < b;
+		}
+	};
+
+	ArrayList<Entry> entries;
+	//! The memory of Flush(), kept so it's reused every frame
+	ArrayList<UInt32> order;
+	ArrayList<Float32> corners;
+	ArrayList<Quad2d> quads;
+	UInt32 numDrawCalls;
+public:
+	MAKO_INLINE SpriteBatch()
+		: numDrawCalls(0) {}
+
+	//! Queues a sprite. Its texture has to exist until Flush() is called.
+	//! \param[in] tex The texture of the sprite
+	//! \param[in] pos The screen position of the up-left corner, before it's rotated
+	//! \param[in] size The size of the sprite on the screen
+	//! \param[in] rot The rotation around the centre of the sprite
+	//! \param[in] uv0 The texture coordinates of the up-left corner
+	//! \param[in] uv1 The texture coordinates of the down-right corner
+	//! \param[in] color The texels are multiplied with it
+	//! \param[in] layer Sprites of lower layers are drawn below those of higher ones
+	MAKO_INLINE void Add(Texture* tex, const Vec2df& pos, const Vec2df& size, Rotation2d rot,
+		const TCoord& uv0, const TCoord& uv1, const Color& color, Int32 layer = 0)
+	{
+		Entry e;
+		e.tex   = tex;
+		e.layer = layer;
+		e.pos   = pos;
+		e.size  = size;
+		e.rot   = rot;
+		e.uv0   = uv0;
+		e.uv1   = uv1;
+		e.color = color;
+		entries.push_back(e);
+	}
+
+	//! Draws every queued sprite and empties the queue
+	MAKO_API void Flush(GraphicsDevice* gd);
+
+	//! Get the number of sprites that are queued
+	MAKO_INLINE UInt32 GetNumQueued() const
+	{ return entries.size(); }
+
+	//! Get the number of draw calls the last Flush() made
+	MAKO_INLINE UInt32 GetNumDrawCalls() const
+	{ return numDrawCalls; }
+};
+
+MAKO_END_NAMESPACE
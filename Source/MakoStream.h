@@ -2,6 +2,7 @@
 #include "MakoCommon.h"
 #include "MakoReferenceCounted.h"
 #include "MakoString.h"
+#include "MakoException.h"
 
 MAKO_BEGIN_NAMESPACE
 
@@ -42,16 +43,38 @@ public:
 	virtual void ReadTo(void* buffer, UInt32 cBytes) = 0;
 
 	//! Skip a number of bytes that you would have otherwise 
-	//! read. The skip method of InputStream creates a byte 
-	//! array and then ReadTo's into it cBytes. It is highly
-	//! encouraged that subclasses provide a more efficient 
-	//! implementation of this virtual method.
+	//! read. The skip method of InputStream ReadTo's the bytes
+	//! into a small buffer on the stack, a chunk at a time. It
+	//! is highly encouraged that subclasses provide a more
+	//! efficient implementation of this virtual method.
 	virtual void Skip(UInt32 cBytes)
 	{
-		UInt8* mem = new UInt8[cBytes];
-		ReadTo(mem, cBytes);
+		UInt8 mem[256];
+		while (cBytes)
+		{
+			const UInt32 chunk = cBytes < sizeof(mem) ? cBytes : sizeof(mem);
+			ReadTo(mem, chunk);
+			cBytes -= chunk;
+		}
 	}
 
+	//! Check if Seek() can be called. Streams with a fixed size,
+	//! such as file and memory streams, usually can.
+	virtual bool IsSeekable() const
+	{ return false; }
+
+	//! Get the position of the next byte to be read, in bytes from
+	//! the beginning of the stream.
+	virtual UInt32 Tell() const
+	{ return 0; }
+
+	//! Move the position of the next byte to be read. Only
+	//! streams for which IsSeekable() is true implement this.
+	//! \param[in] byte The new position, in bytes from the
+	//! beginning of the stream.
+	virtual void Seek(UInt32 byte)
+	{ throw Exception(Text("The stream is not seekable")); }
+
 	//! Read a Int8
 	MAKO_INLINE Int8  Read8BitInt()
 	{ Int8 n; ReadTo(&n, sizeof(Int8)); return n; }
@@ -82,7 +105,7 @@ public:
 
 	//! Read a Float64
 	MAKO_INLINE Float64 Read64BitFloat()
-	{ Float64 n; ReadTo(&n, sizeof(Float32)); return n; }
+	{ Float64 n; ReadTo(&n, sizeof(Float64)); return n; }
 
 	//! Shorter way of reading data
 	//! \param[out] thing The thing to be read
@@ -115,6 +138,12 @@ public:
 	//! has a default implementation of returning zero.
 	virtual UInt32 GetSize() const
 	{ return 0; }
+
+	//! Get the path of the file the stream reads, so files it refers to can
+	//! be looked for next to it.
+	//! \return The path, or an empty string if the stream doesn't read a file.
+	virtual String GetFilePath() const
+	{ return String(); }
 };
 
 //! This class is used for writing data. Any data passed to any
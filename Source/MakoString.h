@@ -39,38 +39,126 @@ enum TRIM_STYLE
 
 typedef UInt16 StringChar;
 
+// Forward declaration
+template <typename T>
+class BasicString;
+
+//! Refers to characters of a string without owning or copying them, so
+//! functions that only read a string can take one whether the caller has a
+//! BasicString, a part of one, or a string literal. It's only valid while
+//! the characters it refers to are, and they aren't necessarily followed
+//! by a null character.
+template <typename T>
+class BasicStringView
+{
+	const T* data;
+	UInt32 length;
+public:
+	MAKO_INLINE BasicStringView() : data(nullptr), length(0) {}
+
+	MAKO_INLINE BasicStringView(const T* data)
+		: data(data), length(data ? GetAnyStrDataLen(data) : 0) {}
+
+	MAKO_INLINE BasicStringView(const T* data, UInt32 length)
+		: data(data), length(length) {}
+
+	MAKO_INLINE BasicStringView(const BasicString<T>& string)
+		: data(string.GetData()), length(string.GetLength()) {}
+
+	//! Get the length of the view
+	MAKO_INLINE UInt32 GetLength() const
+	{ return length; }
+
+	//! Get the characters. They're not necessarily followed by a null
+	//! character.
+	MAKO_INLINE const T* GetData() const
+	{ return data; }
+
+	MAKO_INLINE bool IsEmpty() const
+	{ return length == 0; }
+
+	//! Get a view of a part of the characters
+	//! \param index The index of the first character of the part
+	//! \param n The number of characters of the part
+	MAKO_INLINE BasicStringView<T> GetSubView(UInt32 index, UInt32 n) const
+	{ return BasicStringView<T>(data + index, n); }
+
+	//! Get a character
+	MAKO_INLINE const T& operator [] (UInt32 i) const
+	{ return data[i]; }
+
+	//! Check whether the characters are identical to the other's
+	MAKO_INLINE bool operator == (const BasicStringView<T>& rhs) const
+	{ return length == rhs.length && (length == 0 || memcmp(data, rhs.data, sizeof(T) * length) == 0); }
+
+	//! Check whether the characters are identical to the other's
+	MAKO_INLINE bool operator == (const T* rhs) const
+	{ return *this == BasicStringView<T>(rhs); }
+
+	MAKO_INLINE bool operator != (const BasicStringView<T>& rhs) const
+	{ return !(*this == rhs); }
+};
+
+typedef BasicStringView<wchar_t> WStringView;
+typedef BasicStringView<char> ASCIIStringView;
+typedef BasicStringView<StringChar> StringView;
+
 //! This class represents a string.
+//!
+//! Strings of up to INLINE_CAPACITY characters are stored in the string
+//! itself, so copying, concatenating and converting short strings (file
+//! extensions, numbers, names) doesn't allocate. Longer ones are stored on
+//! the heap, in a buffer that grows by half it's size when it's full, so
+//! appending to a string over and over allocates rarely.
 template <typename T>
 class BasicString
 {
 	friend class DirectoryPath;
 	friend class FilePath;
-
+public:
+	enum
+	{
+		//! The number of characters stored in the string itself
+		INLINE_CAPACITY = 15
+	};
+private:
 	UInt32 length;
+	//! The number of characters data can hold, not counting the null
+	//! character. It's 0 while data isn't owned by the string.
+	UInt32 capacity;
 	mutable T* data;
+	T inlineData[INLINE_CAPACITY + 1];
+
 	mutable char* ascstr;
 	mutable wchar_t* aswstr;
+	mutable UInt32 ascstrCapacity;
+	mutable UInt32 aswstrCapacity;
 	// Has string changed since last ToASCII()
 	mutable bool changed;
 	// Has string changed since last ToWStringData()
 	mutable bool changed2;
 
+	//! Whether data is owned by someone else
 	bool fromdata;
 
-	BasicString(T* str, UInt32 len, bool fromdata = false) : length(len), data(str), ascstr(nullptr),
-		aswstr(nullptr), changed(false), changed2(false), fromdata(fromdata) {}
+	BasicString(T* str, UInt32 len, bool fromdata = false) : length(len), capacity(fromdata ? 0 : len),
+		data(str), ascstr(nullptr), aswstr(nullptr), ascstrCapacity(0), aswstrCapacity(0), changed(false),
+		changed2(false), fromdata(fromdata) {}
 public:
 	friend BasicString<StringChar> ToString(const char* cstr);
 	friend BasicString<StringChar> ToString(const wchar_t* wstr);
 	//////////////////////////////////////////////////////////////////////////////
 	// Constructors/Deconstructor
 
+	//! Make a string that refers to data without copying it. data must
+	//! outlive the string, and must not be modified through it.
 	static MAKO_INLINE const BasicString<T> FromData(const T* data)
 	{ return BasicString<T>(const_cast<T*>(data), GetAnyStrDataLen(data), true); }
 
 	static MAKO_INLINE const BasicString<T> FromData(const T* data, UInt32 length)
 	{ return BasicString<T>(const_cast<T*>(data), length, true); }
 
+	//! Make a string that takes over data, which was allocated with new [].
 	static MAKO_INLINE const BasicString<T> FromAllocData(const T* data)
 	{ return BasicString<T>(const_cast<T*>(data), GetAnyStrDataLen(data), false); }
 
@@ -78,63 +166,51 @@ public:
 	{ return BasicString<T>(const_cast<T*>(data), length, false); }
 
 	static MAKO_INLINE BasicString<T> From32BitInt(Int32 n)
-	{
-		UInt32 length;
-		T* data = ToStringData(static_cast<Int32>(n), &length);
-		return BasicString<T>(data, length, false);
-	}
+	{ BasicString<T> s; s.Append32BitInt(n); return s; }
 
 	static MAKO_INLINE BasicString<T> From32BitUInt(UInt32 n)
-	{
-		UInt32 length;
-		T* data = ToStringData(static_cast<UInt32>(n), &length);
-		return BasicString<T>(data, length, false);
-	}
+	{ BasicString<T> s; s.Append32BitUInt(n); return s; }
 
 	static MAKO_INLINE BasicString<T> From32BitFloat(Float32 n)
-	{
-		UInt32 length;
-		T* data = ToStringData(static_cast<Float32>(n), &length);
-		return BasicString<T>(data, length, false);
-	}
+	{ BasicString<T> s; s.Append32BitFloat(n); return s; }
 
 	static MAKO_INLINE BasicString<T> From64BitFloat(Float64 n)
-	{
-		UInt32 length;
-		T* data = ToStringData(static_cast<Float64>(n), &length);
-		return BasicString<T>(data, length, false);
-	}
+	{ BasicString<T> s; s.Append64BitFloat(n); return s; }
 
-	BasicString(const BasicString<T>& string) : ascstr(nullptr),
-		aswstr(nullptr), changed(false), changed2(false), fromdata(false)
-	{
-		if (string.GetLength() == 0)
-		{
-			data = nullptr;
-			length = 0;
-			return ;
-		}
-		length = string.GetLength();
-		data = new T[length + 1];
-		memcpy(data, string.GetData(), (length + 1) * sizeof(T));
-	}
+	BasicString(const BasicString<T>& string) : length(0), capacity(0), data(nullptr),
+		ascstr(nullptr), aswstr(nullptr), ascstrCapacity(0), aswstrCapacity(0), changed(false),
+		changed2(false), fromdata(false)
+	{ Append(string.GetData(), string.GetLength()); }
 
-	MAKO_INLINE BasicString(const T* string, UInt32 len = 0xFFFFFFFF)
-		: ascstr(nullptr), aswstr(nullptr), changed(false), changed2(false), fromdata(false)
+	MAKO_INLINE BasicString(const T* string, UInt32 len = 0xFFFFFFFF) : length(0), capacity(0),
+		data(nullptr), ascstr(nullptr), aswstr(nullptr), ascstrCapacity(0), aswstrCapacity(0),
+		changed(false), changed2(false), fromdata(false)
 	{
-		length = len != 0xFFFFFFFF ? len : GetAnyStrDataLen(string);
-		data = new T[length + 1];
-		memcpy(data, string, length * sizeof(T));
-		data[length] = (T)'\0';
+		const UInt32 n = len != 0xFFFFFFFF ? len : GetAnyStrDataLen(string);
+		Reserve(n);
+		Append(string, n);
 	}
 
-	MAKO_INLINE BasicString() : length(0), data(nullptr), ascstr(nullptr),
-		aswstr(nullptr), changed(false), changed2(false), fromdata(false) {}
+	MAKO_INLINE BasicString(const BasicStringView<T>& view) : length(0), capacity(0), data(nullptr),
+		ascstr(nullptr), aswstr(nullptr), ascstrCapacity(0), aswstrCapacity(0), changed(false),
+		changed2(false), fromdata(false)
+	{ Append(view.GetData(), view.GetLength()); }
+
+	MAKO_INLINE BasicString() : length(0), capacity(0), data(nullptr), ascstr(nullptr),
+		aswstr(nullptr), ascstrCapacity(0), aswstrCapacity(0), changed(false), changed2(false),
+		fromdata(false) {}
+
+#ifdef MAKO_HAS_RVALUE_REFERENCES
+	//! Takes over the contents of the other string instead of copying them
+	MAKO_INLINE BasicString(BasicString<T>&& string) : length(0), capacity(0), data(nullptr),
+		ascstr(nullptr), aswstr(nullptr), ascstrCapacity(0), aswstrCapacity(0), changed(false),
+		changed2(false), fromdata(false)
+	{ Swap(string); }
+#endif
 
 	MAKO_INLINE ~BasicString()
 	{
-		if (!fromdata)
-			delete [] data;
+		ReleaseData();
 
 		delete [] ascstr;
 		delete [] aswstr;
@@ -144,79 +220,41 @@ public:
 	//////////////////////////////////////////////////////////////////////////////
 	// Member functions
 
-	static BasicString<T> Concatenate(const T* lhs, const T* rhs)
-	{
-		UInt32 lhslen = GetAnyStrDataLen(lhs), rhslen = GetAnyStrDataLen(rhs);
-		UInt32 combinedLength = lhslen + rhslen;
-		T* newData = new T[combinedLength + 1];
-		memcpy(newData, lhs, sizeof(T) * lhslen);
-		memcpy(newData + lhslen, rhs, sizeof(T) * rhslen);
-		newData[combinedLength] = (T)'\0';
-
-		return BasicString(newData, combinedLength, false);
-	}
-
-	static BasicString<T> Concatenate(const T* lhs, const BasicString<T>& rhs)
-	{
-		UInt32 lhslen = GetAnyStrDataLen(lhs);
-		UInt32 combinedLength = rhs.GetLength() + lhslen;
-		T* newData = new T[combinedLength + 1];
-		memcpy(newData, lhs, sizeof(T) * lhslen);
-		memcpy(newData + lhslen, rhs.GetData(), sizeof(T) * rhs.GetLength());
-		newData[combinedLength] = (T)'\0';
-
-		return BasicString(newData, combinedLength, false);
-	}
-
-	static BasicString<T> Concatenate(const BasicString<T>& lhs, const T* rhs)
+	static BasicString<T> Concatenate(const BasicStringView<T>& lhs, const BasicStringView<T>& rhs)
 	{
-		UInt32 rhslen = GetAnyStrDataLen(rhs);
-		UInt32 combinedLength = lhs.GetLength() + rhslen;
-		T* newData = new T[combinedLength + 1];
-		memcpy(newData, lhs.GetData(), sizeof(T) * lhs.GetLength());
-		memcpy(newData + lhs.length, rhs, sizeof(T) * rhslen);
-		newData[combinedLength] = (T)'\0';
-
-		return BasicString(newData, combinedLength, false);
+		BasicString<T> r;
+		r.Reserve(lhs.GetLength() + rhs.GetLength());
+		r.Append(lhs.GetData(), lhs.GetLength());
+		r.Append(rhs.GetData(), rhs.GetLength());
+		return r;
 	}
 
-	static BasicString<T> Concatenate(const BasicString<T>& lhs, const BasicString<T>& rhs)
-	{
-		UInt32 combinedLength = lhs.GetLength() + rhs.GetLength();
-		T* newData = new T[combinedLength + 1];
-		memcpy(newData, lhs.GetData(), sizeof(T) * lhs.GetLength());
-		memcpy(newData + lhs.length, rhs.GetData(), sizeof(T) * rhs.GetLength());
-		newData[combinedLength] = (T)'\0';
+	static MAKO_INLINE BasicString<T> Concatenate(const T* lhs, const T* rhs)
+	{ return Concatenate(BasicStringView<T>(lhs), BasicStringView<T>(rhs)); }
 
-		return BasicString(newData, combinedLength, false);
-	}
+	static MAKO_INLINE BasicString<T> Concatenate(const T* lhs, const BasicString<T>& rhs)
+	{ return Concatenate(BasicStringView<T>(lhs), BasicStringView<T>(rhs)); }
 
-	static BasicString<T> Concatenate(const BasicString<T>& lhs, const T& rhs)
-	{
-		UInt32 combinedLength = lhs.GetLength() + 1;
-		T* newData = new T[combinedLength + 1];
-		memcpy(newData, lhs.GetData(), sizeof(T) * lhs.GetLength());
-		newData[combinedLength - 1] = rhs;
-		newData[combinedLength] = (T)'\0';
+	static MAKO_INLINE BasicString<T> Concatenate(const BasicString<T>& lhs, const T* rhs)
+	{ return Concatenate(BasicStringView<T>(lhs), BasicStringView<T>(rhs)); }
 
-		return BasicString(newData, combinedLength, false);
-	}
+	static MAKO_INLINE BasicString<T> Concatenate(const BasicString<T>& lhs, const BasicString<T>& rhs)
+	{ return Concatenate(BasicStringView<T>(lhs), BasicStringView<T>(rhs)); }
 
-	static BasicString<T> Concatenate(const T& lhs, const BasicString<T>& rhs)
-	{
-		UInt32 combinedLength = rhs.GetLength() + 1;
-		T* newData = new T[combinedLength + 1];
-		newData[0] = lhs;
-		memcpy(newData + 1, rhs.GetData(), sizeof(T) * rhs.GetLength());
-		newData[combinedLength] = (T)'\0';
+	static MAKO_INLINE BasicString<T> Concatenate(const BasicString<T>& lhs, const T& rhs)
+	{ return Concatenate(BasicStringView<T>(lhs), BasicStringView<T>(&rhs, 1)); }
 
-		return BasicString(newData, combinedLength, false);
-	}
+	static MAKO_INLINE BasicString<T> Concatenate(const T& lhs, const BasicString<T>& rhs)
+	{ return Concatenate(BasicStringView<T>(&lhs, 1), BasicStringView<T>(rhs)); }
 
 	//! Get the length of the BasicString, not including the last null character
 	MAKO_INLINE UInt32 GetLength() const
 	{ return length; }
 
+	//! Get the number of characters the string can hold without allocating
+	MAKO_INLINE UInt32 GetCapacity() const
+	{ return capacity; }
+
 	//! Get the BasicString in bytes.
 	MAKO_INLINE const T* GetData() const
 	{ return data; }
@@ -224,6 +262,46 @@ public:
 	MAKO_INLINE bool IsEmpty() const
 	{ return data == nullptr || length == 0 || *data == '\0'; }
 
+	//! Make the string able to hold n characters without allocating again,
+	//! so a string can be built by appending to it without reallocating.
+	void Reserve(UInt32 n)
+	{
+		if (n > capacity || fromdata)
+			Reallocate(n > length ? n : length);
+	}
+
+	//! Exchange the contents of this string with the other's, without
+	//! copying them if they're stored on the heap. Use it to hand a string
+	//! that was built over to another one, when rvalue references can't be.
+	void Swap(BasicString<T>& other)
+	{
+		if (&other == this)
+			return ;
+
+		const bool inlined = data == inlineData, otherInlined = other.data == other.inlineData;
+		T inlineTemp[INLINE_CAPACITY + 1];
+		memcpy(inlineTemp, inlineData, sizeof(inlineData));
+		memcpy(inlineData, other.inlineData, sizeof(inlineData));
+		memcpy(other.inlineData, inlineTemp, sizeof(inlineData));
+
+		SwapValues(length, other.length);
+		SwapValues(capacity, other.capacity);
+		SwapValues(data, other.data);
+		SwapValues(ascstr, other.ascstr);
+		SwapValues(aswstr, other.aswstr);
+		SwapValues(ascstrCapacity, other.ascstrCapacity);
+		SwapValues(aswstrCapacity, other.aswstrCapacity);
+		SwapValues(changed, other.changed);
+		SwapValues(changed2, other.changed2);
+		SwapValues(fromdata, other.fromdata);
+
+		// Inline data moved to the other string's inline data
+		if (inlined)
+			other.data = other.inlineData;
+		if (otherInlined)
+			data = inlineData;
+	}
+
 	//! Finds the position of a character in this string from the beginning.
 	//! \return The position of the character, or the length of the string
 	//! if the character was not found in the string.
@@ -237,7 +315,7 @@ public:
 	}
 
 	//! Finds the position of a character in this string, searching from the end.
-	//! \return The position of the character, or zero the character was not 
+	//! \return The position of the character, or zero the character was not
 	//! found in the string.
 	UInt FindFromEnd(const T& character) const
 	{
@@ -250,11 +328,13 @@ public:
 
 	void LowerCase()
 	{
+		Reserve(length);
 		for (UInt i = 0; i < length; ++i)
 		{
 			if (IsCharUpper(data[i]))
 				data[i] += 0x20;
 		}
+		Changed();
 	}
 
 
@@ -263,14 +343,9 @@ public:
 	//! \param n (Default = 1) The number of characters past index to erase
 	void Erase(UInt32 index, UInt32 n = 1)
 	{
-		T* newData = new T[(GetLength() + 1) - n];
-		memcpy(newData, data, sizeof(T) * index);
-		memcpy(newData + index, data + (index + n), sizeof(T) * (length - (index + n)));
-		memcpy(newData + index, data + (index + n), sizeof(T) * ((length - (index + n)) + 1));
-
-		delete [] data;
-		data = newData;
-		length = GetLength() - n;
+		Reserve(length);
+		memmove(data + index, data + (index + n), sizeof(T) * ((length - (index + n)) + 1));
+		length -= n;
 		Changed();
 	}
 
@@ -310,10 +385,17 @@ public:
 		return *this;
 	}
 
+	//! Empties the string. It keeps it's capacity, so it can be refilled
+	//! without allocating.
 	void Clear()
 	{
-		delete [] data;
-		data = nullptr;
+		if (fromdata)
+		{
+			data = nullptr;
+			fromdata = false;
+		}
+		else if (data)
+			data[0] = static_cast<T>('\0');
 		length = 0;
 		Changed();
 	}
@@ -351,6 +433,10 @@ public:
 	MAKO_INLINE BasicString<T>& operator += (const T& rhs)
 	{ Append(rhs); return *this; }
 
+	//! Append's to this string's contents
+	MAKO_INLINE BasicString<T>& operator += (const BasicStringView<T>& rhs)
+	{ Append(rhs); return *this; }
+
 	//! Creates a new string that is the Concatenation of this string
 	//! and the other string.
 	MAKO_INLINE BasicString<T> operator + (const BasicString<T>& rhs) const
@@ -378,127 +464,136 @@ public:
 	MAKO_INLINE BasicString<T>& operator = (const T& rhs)
 	{ AssignTo(rhs); return *this; }
 
+#ifdef MAKO_HAS_RVALUE_REFERENCES
+	//! Takes over the contents of the other string instead of copying them
+	MAKO_INLINE BasicString<T>& operator = (BasicString<T>&& rhs)
+	{ Swap(rhs); return *this; }
+#endif
+
 	//! Check whether this string's contents are identical to the other's
-	bool operator == (const BasicString<T>& rhs) const
-	{
-		for (UInt i = 0; i < rhs.GetLength(); ++i)
-			if (data[i] != rhs[i]) return false;
-		return true;
-	}
+	MAKO_INLINE bool operator == (const BasicString<T>& rhs) const
+	{ return BasicStringView<T>(*this) == BasicStringView<T>(rhs); }
 
 	//! Check whether this string's contents are identical to the other's
-	bool operator == (const T* rhs) const
-	{
-		for (UInt i = 0, len = GetAnyStrDataLen(rhs); i < len; ++i)
-			if (data[i] != rhs[i]) return false;
-		return true;
-	}
+	MAKO_INLINE bool operator == (const T* rhs) const
+	{ return BasicStringView<T>(*this) == BasicStringView<T>(rhs); }
 
 	//! Check if this string is identical to a single character.
 	bool operator == (const T& rhs) const
-	{ return *data == rhs && GetLength() == 1; }
+	{ return GetLength() == 1 && *data == rhs; }
 
 
 	//////////////////////////////////////////////////////////////////////////////
 	// Append
 	MAKO_INLINE void Append32BitUInt(UInt32 n)
-	{ UInt32 len; T* d = ToStringData(n, &len); Append(d, len); delete [] d; Changed(); }
+	{ char buff[32]; AppendConverted(buff, _snprintf(buff, 32, "%u", n)); }
 
 	MAKO_INLINE void Append32BitInt(Int32 n)
-	{ UInt32 len; T* d = ToStringData(n, &len); Append(d, len); delete [] d; Changed(); }
+	{ char buff[32]; AppendConverted(buff, _snprintf(buff, 32, "%i", n)); }
 
 	MAKO_INLINE void Append32BitFloat(Float32 n)
-	{ UInt32 len; T* d = ToStringData(n, &len); Append(d, len); delete [] d; Changed(); }
+	{ char buff[32]; AppendConverted(buff, _snprintf(buff, 32, "%f", n)); }
 
 	MAKO_INLINE void Append64BitFloat(Float64 n)
-	{ UInt32 len; T* d = ToStringData(n, &len); Append(d, len); delete [] d; Changed(); }
+	{ char buff[32]; AppendConverted(buff, _snprintf(buff, 32, "%f", n)); }
 
 	//! Append's the string's contents
-	void Append(const BasicString<T>& rhs)
-	{
-		UInt32 combinedLength = GetLength() + rhs.length;
-		T* newData = new T[combinedLength + 1];
-		memcpy(newData, data, sizeof(T) * length);
-		memcpy(newData + length, rhs.data, sizeof(T) * rhs.length);
-		newData[combinedLength] = (T)'\0';
+	MAKO_INLINE void Append(const BasicString<T>& rhs)
+	{ Append(rhs.GetData(), rhs.GetLength()); }
 
-		delete [] data;
-		data = newData;
-
-		length = combinedLength;
-
-		Changed();
-	}
+	//! Append's the viewed characters
+	MAKO_INLINE void Append(const BasicStringView<T>& rhs)
+	{ Append(rhs.GetData(), rhs.GetLength()); }
 
 	//! Append's a char
 	void Append(const T& character)
 	{
-		UInt32 combinedLength = GetLength() + 1;
-		T* newData = new T[combinedLength + 1];
-		memcpy(newData, data, sizeof(T) * length);
-		(*(newData + length)) = character;
-		newData[combinedLength] = (T)'\0';
-
-		delete [] data;
-		data = newData;
-
-		length = combinedLength;
-
+		Grow(length + 1);
+		data[length] = character;
+		data[++length] = static_cast<T>('\0');
 		Changed();
 	}
 
 	//! Append's the string's contents
 	void Append(const T* rhs, UInt32 strlen = 0xFFFFFFFF)
 	{
-		UInt32 rhslen = strlen != 0xFFFFFFFF ? strlen : GetAnyStrDataLen(rhs);
-		UInt32 combinedLength = GetLength() + rhslen;
-		T* newData = new T[combinedLength + 1];
-		memcpy(newData, data, sizeof(T) * GetLength());
-		memcpy(newData + GetLength(), rhs, sizeof(T) * rhslen);
-		newData[combinedLength] = (T)'\0';
+		const UInt32 rhslen = strlen != 0xFFFFFFFF ? strlen : GetAnyStrDataLen(rhs);
+		if (rhslen == 0)
+			return ;
 
-		delete [] data;
-		data = newData;
+		if (data && rhs >= data && rhs <= data + length && length + rhslen > capacity)
+		{
+			// rhs is a part of this string, which is about to be reallocated
+			BasicString<T> copy(rhs, rhslen);
+			Append(copy.GetData(), rhslen);
+			return ;
+		}
 
-		length = combinedLength;
+		Grow(length + rhslen);
+		memcpy(data + length, rhs, sizeof(T) * rhslen);
+		length += rhslen;
+		data[length] = static_cast<T>('\0');
+		Changed();
+	}
 
+	//! Append's characters of another type, converting every one of them,
+	//! e.g. ASCII text to a String.
+	template <typename C>
+	void AppendConverted(const C* rhs, UInt32 strlen)
+	{
+		Grow(length + strlen);
+		for (UInt32 i = 0; i < strlen; ++i)
+			data[length + i] = static_cast<T>(rhs[i]);
+		length += strlen;
+		if (data)
+			data[length] = static_cast<T>('\0');
 		Changed();
 	}
 
 	//////////////////////////////////////////////////////////////////////////////
 	// AssignTo
 	MAKO_INLINE void AssignToU32BitInt(UInt32 n)
-	{ delete [] data; data = ToStringData(n, &length); Changed(); }
+	{ Clear(); Append32BitUInt(n); }
 
 	MAKO_INLINE void AssignTo32BitInt(Int32 n)
-	{ delete [] data; data = ToStringData(n, &length); Changed(); }
+	{ Clear(); Append32BitInt(n); }
 
 	MAKO_INLINE void AssignTo32BitFloat(Float32 n)
-	{ delete [] data; data = ToStringData(n, &length); Changed(); }
+	{ Clear(); Append32BitFloat(n); }
 
 	MAKO_INLINE void AssignTo64BitFloat(Float64 n)
-	{ delete [] data; data = ToStringData(n, &length); Changed(); }
+	{ Clear(); Append64BitFloat(n); }
 
 	//! Copy the string's contents to be this string's contents
-	void AssignTo(const BasicString<T>& string)
-	{
-		if (string.IsEmpty())
-			return;
+	MAKO_INLINE void AssignTo(const BasicString<T>& string)
+	{ AssignTo(string.GetData(), string.GetLength()); }
 
-		delete [] data;
-		length = string.GetLength();
-		data = new T[length + 1];
-		memcpy(data, string.GetData(), (length + 1) * sizeof(T));
-		Changed();
-	}
+	//! Copy the viewed characters to be this string's contents
+	MAKO_INLINE void AssignTo(const BasicStringView<T>& view)
+	{ AssignTo(view.GetData(), view.GetLength()); }
 
 	//! Copy the string's contents to be this string's contents
 	void AssignTo(const T* string, UInt32 len = 0xFFFFFFFF)
 	{
-		delete [] data;
-		length = len != 0xFFFFFFFF ? len : GetAnyStrDataLen(string);
-		data = new T[length + 1];
-		memcpy(data, string, length * sizeof(T));
+		const UInt32 n = len != 0xFFFFFFFF ? len : GetAnyStrDataLen(string);
+		if (n == 0)
+		{
+			Clear();
+			return ;
+		}
+		if (string == data && n == length)
+			return ;
+
+		// Reallocate without copying the old contents. Borrowed data isn't
+		// freed by it, and string can't be a part of the old contents when
+		// it's longer than they can be.
+		if (n > capacity || fromdata)
+		{
+			length = 0;
+			Reallocate(n);
+		}
+		memmove(data, string, sizeof(T) * n);
+		length = n;
 		data[length] = static_cast<T>('\0');
 		Changed();
 	}
@@ -506,12 +601,8 @@ public:
 	//! Set this string to contain a single string char
 	void AssignTo(const T& character)
 	{
-		delete [] data;
-		length = 1;
-		data = new T[2];
-		data[0] = character;
-		data[1] = static_cast<T>('\0');
-		Changed();
+		Clear();
+		Append(character);
 	}
 
 	//////////////////////////////////////////////////////////////////////////////
@@ -522,7 +613,7 @@ public:
 	{
 		if (sizeof(T) != sizeof(char))
 		{
-			char* cstr = ToASCII();
+			const char* cstr = ToASCII();
 			Float64 r = atof(cstr);
 			return r;
 		}
@@ -537,7 +628,7 @@ public:
 	{
 		if (sizeof(T) != sizeof(char))
 		{
-			char* cstr = ToASCII();
+			const char* cstr = ToASCII();
 			Float32 r = static_cast<Float32>(atof(cstr));
 			return r;
 		}
@@ -565,7 +656,7 @@ public:
 	{
 		if (sizeof(T) != sizeof(char))
 		{
-			char* cstr = ToASCII();
+			const char* cstr = ToASCII();
 			Int32 r = static_cast<Int32>(atoi(cstr));
 			return r;
 		}
@@ -573,61 +664,40 @@ public:
 		{
 			return static_cast<Int32>(atoi((char*)data));
 		}
-		return nullptr;
 	}
 
-	//! Get BasicString as a C string (char*)
+	//! Get BasicString as a C string (char*). The converted copy is kept
+	//! until the string changes, and its buffer is reused after that.
 	//! \return A C string.
 	const char* ToASCII() const
 	{
-		if (sizeof(T) != sizeof(char))
-		{
-			if (!ascstr || (changed && aswstr))
-			{
-				ascstr = new char[length + 1];
-				for (UInt i = 0; i < length; ++i)
-					ascstr[i] = (char)data[i];
-				ascstr[length] = '\0';
-				return ascstr;
-			}
-			else if (ascstr && !changed)
-			{
-				return ascstr;
-			}
-		}
-		else
+		if (sizeof(T) == sizeof(char))
+			return data ? (char*)data : "";
+
+		if (!ascstr || changed)
 		{
-			return (char*)data;
+			ConvertTo(ascstr, ascstrCapacity);
+			changed = false;
 		}
-		return nullptr;
+		return ascstr;
 	}
 
-	//! Get BasicString as a c wide string (wchar_t*)
+	//! Get BasicString as a c wide string (wchar_t*). The converted copy is
+	//! kept until the string changes, and its buffer is reused after that.
 	//! \return A wide string.
 	const wchar_t* ToWStringData() const
 	{
 		if (!data)
 			return L"";
-		if (sizeof(T) != sizeof(wchar_t))
-		{
-			if (!aswstr || (changed2 && aswstr))
-			{
-				aswstr = new wchar_t[length + 1];
-				for (UInt i = 0; i < length; ++i)
-					aswstr[i] = (char)data[i];
-				aswstr[length] = '\0';
-				changed2 = false;
-				return aswstr;
-			}
-			else if (aswstr && !changed2)
-			{
-				return aswstr;
-			}
-		}
-		else
-		{
+		if (sizeof(T) == sizeof(wchar_t))
 			return (wchar_t*)data;
+
+		if (!aswstr || changed2)
+		{
+			ConvertTo(aswstr, aswstrCapacity);
+			changed2 = false;
 		}
+		return aswstr;
 	}
 private:
 
@@ -635,68 +705,56 @@ private:
 	MAKO_INLINE void Changed()
 	{ changed = changed2 = true; }
 
-	static T* ToStringData(Float32 f, UInt32* strlen = 0)
-	{
-		char buff[32];
-		UInt32 len = _snprintf(buff, 32, "%f", f);
-
-		T* newData = new T[len + 1];
-		for (UInt i = 0; i < len; ++i)
-			newData[i] = buff[i];
-		newData[len] = '\0';
+	template <typename V>
+	static MAKO_INLINE void SwapValues(V& a, V& b)
+	{ V t = a; a = b; b = t; }
 
-		if (strlen)
-			*strlen = len;
-
-		return newData;
+	//! Frees data if it's owned and on the heap
+	MAKO_INLINE void ReleaseData()
+	{
+		if (!fromdata && data != inlineData)
+			delete [] data;
 	}
 
-	static T* ToStringData(Float64 f, UInt32* strlen = 0)
+	//! Makes data hold n characters and the null character, keeping it's
+	//! contents. Up to INLINE_CAPACITY characters are held in inlineData.
+	void Reallocate(UInt32 n)
 	{
-		char buff[32];
-		UInt32 len = _snprintf(buff, 32, "%f", f);
-
-		T* newData = new T[len + 1];
-		for (UInt i = 0; i < len; ++i)
-			newData[i] = buff[i];
-		newData[len] = '\0';
-
-		if (strlen)
-			*strlen = len;
-
-		return newData;
+		T* newData = n <= INLINE_CAPACITY ? inlineData : new T[n + 1];
+		if (newData != data)
+		{
+			if (data)
+				memcpy(newData, data, sizeof(T) * length);
+			newData[length] = static_cast<T>('\0');
+			ReleaseData();
+			data = newData;
+		}
+		capacity = n <= INLINE_CAPACITY ? static_cast<UInt32>(INLINE_CAPACITY) : n;
+		fromdata = false;
 	}
 
-	static T* ToStringData(Int32 num, UInt32* strlen = 0)
+	//! Makes data hold at least n characters, growing it's buffer by at
+	//! least half so appending repeatedly reallocates rarely.
+	MAKO_INLINE void Grow(UInt32 n)
 	{
-		char buff[32];
-		UInt32 len = _snprintf(buff, 32, "%i", num);
-
-		T* newData = new T[len + 1];
-		for (UInt i = 0; i < len; ++i)
-			newData[i] = buff[i];
-		newData[len] = '\0';
-
-		if (strlen)
-			*strlen = len;
-
-		return newData;
+		if (n > capacity || fromdata)
+			Reallocate(n > capacity + capacity / 2 ? n : capacity + capacity / 2);
 	}
 
-	static T* ToStringData(UInt32 num, UInt32* strlen = 0)
+	//! Copies the string into a buffer of another character type, which is
+	//! only reallocated when it's too small
+	template <typename C>
+	void ConvertTo(C*& dest, UInt32& destCapacity) const
 	{
-		char buff[32];
-		UInt32 len = _snprintf(buff, 32, "%u", num);
-
-		T* newData = new T[len + 1];
-		for (UInt i = 0; i < len; ++i)
-			newData[i] = buff[i];
-		newData[len] = '\0';
-
-		if (strlen)
-			*strlen = len;
-
-		return newData;
+		if (!dest || destCapacity < length)
+		{
+			delete [] dest;
+			dest = new C[length + 1];
+			destCapacity = length;
+		}
+		for (UInt i = 0; i < length; ++i)
+			dest[i] = static_cast<C>(data[i]);
+		dest[length] = static_cast<C>('\0');
 	}
 
 	//! This function trims a string from the right
@@ -734,20 +792,6 @@ private:
 		}
 		Erase(0, pos + 1);
 	}
-
-	static T* ToStringData(const char* cstr, UInt32* strlen = 0)
-	{
-		UInt32 len = GetAnyStrDataLen(cstr);
-		T* newData = new T[len + 1];
-		for (UInt i = 0; i < len; ++i)
-			newData[i] = (T)cstr[i];
-		newData[len] = (T)'\0';
-
-
-		if (strlen)
-			*strlen = len;
-		return newData;
-	}
 };
 
 
@@ -773,20 +817,9 @@ typedef BasicString<StringChar> String;
 //! \return x converted to a string
 MAKO_INLINE String ToString(const char* cstr)
 {
-	if (sizeof(StringChar) != sizeof(char))
-	{
-		UInt32 len = GetAnyStrDataLen(cstr);
-		StringChar* newData = new StringChar[len + 1];
-		for (UInt i = 0; i < len; ++i)
-			newData[i] = cstr[i];
-		newData[len] = (StringChar)'\0';
-
-		return String(newData, len);
-	}
-	else
-	{
-		return String((StringChar*)cstr);
-	}
+	String s;
+	s.AppendConverted(cstr, GetAnyStrDataLen(cstr));
+	return s;
 }
 
 //! Convert to a String
@@ -794,20 +827,9 @@ MAKO_INLINE String ToString(const char* cstr)
 //! \return x converted to a string
 MAKO_INLINE String ToString(const wchar_t* wstr)
 {
-	if (sizeof(StringChar) != sizeof(wchar_t))
-	{
-		UInt32 len = GetAnyStrDataLen(wstr);
-		StringChar* newData = new StringChar[len + 1];
-		for (UInt i = 0; i < len; ++i)
-			newData[i] = wstr[i];
-		newData[len] = (StringChar)'\0';
-
-		return String(newData, len);
-	}
-	else
-	{
-		return String((StringChar*)wstr);
-	}
+	String s;
+	s.AppendConverted(wstr, GetAnyStrDataLen(wstr));
+	return s;
 }
 
 MAKO_END_NAMESPACE
@@ -826,4 +848,4 @@ bool operator == (const T* lhs, const Mako::BasicString<T>& rhs)
 
 template <typename T>
 bool operator == (const T& lhs, const Mako::BasicString<T>& rhs)
-{ return lhs == rhs[0] && rhs.GetLength() == 1; }
\ No newline at end of file
+{ return lhs == rhs[0] && rhs.GetLength() == 1; }
@@ -0,0 +1,87 @@
+#pragma once
+#include "MakoCommon.h"
+#include "MakoString.h"
+
+MAKO_BEGIN_NAMESPACE
+
+//! Builds a string out of parts without making a temporary string for every
+//! part, like a chain of operator + does. Give it the length the string will
+//! likely have, and the parts are appended to one buffer without it being
+//! reallocated:
+//!
+//! StringBuilder b(64);
+//! b.Append(Text("Loaded [")).Append(path).Append(StringChar(']'));
+//! console->Log(LL_LOW, b.GetString());
+//!
+//! Clear() keeps the buffer, so a builder can be reused for many strings.
+template <typename T>
+class BasicStringBuilder
+{
+	BasicString<T> str;
+public:
+	//! \param[in] capacity The number of characters to reserve
+	MAKO_INLINE BasicStringBuilder(UInt32 capacity = 0)
+	{ str.Reserve(capacity); }
+
+	MAKO_INLINE ~BasicStringBuilder() {}
+
+	//! Make the builder able to hold n characters without reallocating
+	MAKO_INLINE void Reserve(UInt32 n)
+	{ str.Reserve(n); }
+
+	MAKO_INLINE BasicStringBuilder<T>& Append(const BasicStringView<T>& s)
+	{ str.Append(s); return *this; }
+
+	MAKO_INLINE BasicStringBuilder<T>& Append(const BasicString<T>& s)
+	{ str.Append(s); return *this; }
+
+	MAKO_INLINE BasicStringBuilder<T>& Append(const T* s)
+	{ str.Append(s); return *this; }
+
+	MAKO_INLINE BasicStringBuilder<T>& Append(const T& character)
+	{ str.Append(character); return *this; }
+
+	//! Append ASCII text, converting it's characters
+	MAKO_INLINE BasicStringBuilder<T>& AppendASCII(const char* s)
+	{ str.AppendConverted(s, GetAnyStrDataLen(s)); return *this; }
+
+	MAKO_INLINE BasicStringBuilder<T>& Append32BitUInt(UInt32 n)
+	{ str.Append32BitUInt(n); return *this; }
+
+	MAKO_INLINE BasicStringBuilder<T>& Append32BitInt(Int32 n)
+	{ str.Append32BitInt(n); return *this; }
+
+	MAKO_INLINE BasicStringBuilder<T>& Append32BitFloat(Float32 n)
+	{ str.Append32BitFloat(n); return *this; }
+
+	MAKO_INLINE BasicStringBuilder<T>& Append64BitFloat(Float64 n)
+	{ str.Append64BitFloat(n); return *this; }
+
+	//! Empties the builder, keeping it's buffer
+	MAKO_INLINE void Clear()
+	{ str.Clear(); }
+
+	MAKO_INLINE UInt32 GetLength() const
+	{ return str.GetLength(); }
+
+	MAKO_INLINE UInt32 GetCapacity() const
+	{ return str.GetCapacity(); }
+
+	//! Get the string that was built so far
+	MAKO_INLINE const BasicString<T>& GetString() const
+	{ return str; }
+
+	//! Hand the string that was built over to s without copying it, and
+	//! empty the builder.
+	MAKO_INLINE void MoveTo(BasicString<T>& s)
+	{ str.Swap(s); str.Clear(); }
+
+	MAKO_INLINE operator BasicStringView<T> () const
+	{ return str; }
+};
+
+typedef BasicStringBuilder<wchar_t> WStringBuilder;
+typedef BasicStringBuilder<char> ASCIIStringBuilder;
+typedef BasicStringBuilder<StringChar> StringBuilder;
+
+MAKO_END_NAMESPACE
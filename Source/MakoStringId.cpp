@@ -0,0 +1,92 @@
+#include "MakoStringId.h"
+#include "MakoMap.h"
+#include "MakoThread.h"
+#include "MakoAllocator.h"
+
+MAKO_BEGIN_NAMESPACE
+
+//! The strings that were interned, by their id
+struct StringTable
+{
+	typedef Map<StringId, String, std::less<StringId>,
+		PoolAllocator<std::pair<const StringId, String>, MC_STRING> > StringMap;
+
+	Mutex lock;
+	StringMap strings;
+	String empty;
+};
+
+//! Get the table, which is created when it's first used, so static objects
+//! of other files can intern strings. It's never deleted, since strings may
+//! be interned until the program exits.
+static StringTable& GetStringTable()
+{
+	static StringTable* table = new StringTable;
+	return *table;
+}
+
+//! Creates the table before main(), so threads never create it at once
+static StringTable& stringTableInit = GetStringTable();
+
+//! Check if an interned string has the same characters as string data
+template <typename T>
+static bool IsSameString(const String& interned, const T* data, UInt32 length)
+{
+	if (interned.GetLength() != length)
+		return false;
+	for (UInt32 i = 0; i < length; ++i)
+	{
+		if (interned[i] != static_cast<StringChar>(data[i]))
+			return false;
+	}
+	return true;
+}
+
+template <typename T>
+static StringId InternStringData(const T* data, UInt32 length)
+{
+	StringId id = HashStringData(data, length);
+
+	// A string that collides with one interned before takes the next id that
+	// is free, or that it was given when it was interned. Strings are never
+	// removed, so probing from it's hash always finds it again.
+	StringTable& table = GetStringTable();
+	ScopedLock<Mutex> l(table.lock);
+	for (;;)
+	{
+		StringTable::StringMap::iterator it = table.strings.find(id);
+		if (it == table.strings.end())
+		{
+			String& s = table.strings[id];
+			s.AppendConverted(data, length);
+			return id;
+		}
+
+		if (IsSameString((*it).second, data, length))
+			return id;
+		id = MakeStringId(id + 1);
+	}
+}
+
+StringId InternString(const StringView& s)
+{ return InternStringData(s.GetData(), s.GetLength()); }
+
+StringId InternString(const ASCIIStringView& s)
+{ return InternStringData(s.GetData(), s.GetLength()); }
+
+const String& FindInternedString(StringId id)
+{
+	StringTable& table = GetStringTable();
+	ScopedLock<Mutex> l(table.lock);
+	StringTable::StringMap::const_iterator it = table.strings.find(id);
+	return it != table.strings.end() ? (*it).second : table.empty;
+}
+
+UInt32 GetNumInternedStrings()
+{
+	StringTable& table = GetStringTable();
+	ScopedLock<Mutex> l(table.lock);
+	return table.strings.size();
+}
+
+MAKO_END_NAMESPACE
@@ -0,0 +1,98 @@
+#pragma once
+#include "MakoCommon.h"
+#include "MakoString.h"
+
+MAKO_BEGIN_NAMESPACE
+
+//! Identifies a string by the 64-bit FNV-1a hash of it's characters, so
+//! names can be compared, ordered and used as Map keys as an integer instead
+//! of character by character. InternString() gets the id of a string and
+//! remembers the string, so it can be looked up again with
+//! FindInternedString() when debugging.
+//!
+//! Two different strings never get the same id from InternString(): if a
+//! string hashes to the id of another string that was interned before, it
+//! gets the next free id instead. HashString() and HashLiteral() only give
+//! the hash, so they equal the interned id unless that happened, which is
+//! unlikely with 64 bits, but possible. Compare them with interned ids only
+//! where a rare mismatch is harmless.
+//!
+//! Characters are hashed as the StringChar they convert to, so ASCII text
+//! has the same id as a String of the same characters, and HashLiteral("diffTex") is the hash of
+//! Text("diffTex").
+typedef UInt64 StringId;
+
+//! No string has this id
+const StringId NULL_STRING_ID = 0;
+
+const UInt64 STRING_ID_OFFSET_BASIS = (static_cast<UInt64>(0xCBF29CE4u) << 32) | 0x84222325u;
+const UInt64 STRING_ID_PRIME = (static_cast<UInt64>(0x00000100u) << 32) | 0x000001B3u;
+
+//! Hash a character into the hash of the characters before it. The whole
+//! character is hashed at once, so a wide character doesn't hash like the
+//! narrow characters of it's bytes.
+MAKO_INLINE UInt64 HashStringChar(UInt64 hash, UInt32 c)
+{ return (hash ^ c) * STRING_ID_PRIME; }
+
+//! Turn a hash into a StringId, which is never NULL_STRING_ID
+MAKO_INLINE StringId MakeStringId(UInt64 hash)
+{ return hash != NULL_STRING_ID ? hash : 1; }
+
+//! Get the hash of string data without interning it
+template <typename T>
+StringId HashStringData(const T* data, UInt32 length)
+{
+	UInt64 hash = STRING_ID_OFFSET_BASIS;
+	for (UInt32 i = 0; i < length; ++i)
+		hash = HashStringChar(hash, static_cast<StringChar>(data[i]));
+	return MakeStringId(hash);
+}
+
+//! Get the hash of a string without interning it
+MAKO_INLINE StringId HashString(const StringView& s)
+{ return HashStringData(s.GetData(), s.GetLength()); }
+
+//! Get the hash of ASCII text without interning it
+MAKO_INLINE StringId HashString(const ASCIIStringView& s)
+{ return HashStringData(s.GetData(), s.GetLength()); }
+
+//! Hashes the first I characters of a string literal of N characters, one
+//! template instance per character, so an optimizing compiler folds the hash
+//! of a literal into a constant.
+template <UInt32 N, UInt32 I>
+struct LiteralHasher
+{
+	static MAKO_INLINE UInt64 Hash(const char (&s)[N])
+	{ return HashStringChar(LiteralHasher<N, I - 1>::Hash(s), static_cast<StringChar>(s[I - 1])); }
+};
+
+template <UInt32 N>
+struct LiteralHasher<N, 0>
+{
+	static MAKO_INLINE UInt64 Hash(const char (&s)[N])
+	{ return STRING_ID_OFFSET_BASIS; }
+};
+
+//! Get the hash of a string literal, which is computed at compile time:
+//! <tt>if (id == HashLiteral("color"))</tt>
+//! The literal isn't interned.
+template <UInt32 N>
+MAKO_INLINE StringId HashLiteral(const char (&s)[N])
+{ return MakeStringId(LiteralHasher<N, N - 1>::Hash(s)); }
+
+//! Get the id of a string, and remember the string. It may be called by any
+//! thread.
+MAKO_API StringId InternString(const StringView& s);
+
+//! Get the id of ASCII text, and remember it, like InternString()
+MAKO_API StringId InternString(const ASCIIStringView& s);
+
+//! Get a string that was interned, for debugging.
+//! \return The string, or an empty string if no string with the id was
+//! interned.
+MAKO_API const String& FindInternedString(StringId id);
+
+//! Get the number of strings that were interned
+MAKO_API UInt32 GetNumInternedStrings();
+
+MAKO_END_NAMESPACE
@@ -2,23 +2,31 @@
 #include "MakoGraphicsDevice.h"
 #include "MakoException.h"
 #include "MakoMath.h"
+#include "MakoImageResampler.h"
 
 MAKO_BEGIN_NAMESPACE
 
+MAKO_DEFINE_OBJECT_POOL(Texture)
+
 Texture::Texture(GraphicsDevice* gd, const TextureCreationParams& params)
 : gd(gd), size(params.size), format(params.format), 
   bitsPerPixel(GetColorStride(format)), bytesPerPixel(bitsPerPixel / 8)
 {
+	SetMipLevels(params.numMipLevels ? params.numMipLevels : 1);
+
 	if (params.copyFromData)
 	{
-		data = new Byte[bytesPerPixel * size.x * size.y];
-		memcpy(data, params.data, bytesPerPixel * size.x * size.y);
+		data = new Byte[GetDataSize()];
+		memcpy(data, params.data, GetDataSize());
 	}
 	else
 	{
 		data = params.data;
 	}
 
+	if (params.generateMipMaps && data && GetNumMipLevels() == 1 && format == CF_R8G8B8A8)
+		GenerateMipMaps(params.mipFilter);
+
 	hardwareTex = gd->CreateTextureHardwareBuffer(this);
 }
 
@@ -29,6 +37,54 @@ Texture::~Texture()
 	delete [] data;
 }
 
+void Texture::SetMipLevels(UInt32 numLevels)
+{
+	mipLevels.resize(numLevels);
+
+	Size2d levelSize = size;
+	UInt32 offset = 0;
+	for (UInt32 i = 0; i < numLevels; ++i)
+	{
+		mipLevels[i].size   = levelSize;
+		mipLevels[i].offset = offset;
+
+		offset += GetImageDataSize(format, levelSize);
+		levelSize = GetNextMipLevelSize(levelSize);
+	}
+}
+
+void Texture::GenerateMipMaps(MIP_FILTER filter)
+{
+	if (format != CF_R8G8B8A8)
+		throw Exception(Text("Failed to identify color format in Texture::GenerateMipMaps()."));
+
+	const UInt32 topSize = GetImageDataSize(format, size);
+	SetMipLevels(GetMipChainLength(size));
+
+	Byte* newData = new Byte[GetDataSize()];
+	memcpy(newData, data, topSize);
+	delete [] static_cast<Byte*>(data);
+	data = newData;
+
+	for (UInt32 i = 1; i < mipLevels.size(); ++i)
+		ResampleImageRGBA8(static_cast<const UInt8*>(GetMipLevelData(i - 1)), mipLevels[i - 1].size,
+			static_cast<UInt8*>(GetMipLevelData(i)), mipLevels[i].size,
+			filter == MF_KAISER ? RF_KAISER : RF_BOX);
+}
+
+void Texture::RemoveMipMaps()
+{
+	if (mipLevels.size() == 1)
+		return;
+
+	SetMipLevels(1);
+
+	Byte* newData = new Byte[GetDataSize()];
+	memcpy(newData, data, GetDataSize());
+	delete [] static_cast<Byte*>(data);
+	data = newData;
+}
+
 void Texture::ResizePixelsNearestNeighbor(const Size2d& newSize, void* out) const
 {
 	for (UInt x = 0; x < newSize.x; ++x)
@@ -58,6 +114,9 @@ void Texture::ResizePixelsNearestNeighbor(const Size2d& newSize, void* out) cons
 
 Texture* Texture::CreateStretched(const Size2d& newSize, RESIZE_ALGORITHM alg) const
 {
+	if (format != CF_R8G8B8A8)
+		throw Exception(Text("Failed to identify color format in Texture::CreateStretched()."));
+
 	Byte* newData = new Byte[GetBytesPerPixel() * newSize.x * newSize.y];
 
 	TextureCreationParams tp;
@@ -65,15 +124,19 @@ Texture* Texture::CreateStretched(const Size2d& newSize, RESIZE_ALGORITHM alg) c
 	tp.data = newData;
 	tp.format = format;
 	tp.size = newSize;
+	tp.generateMipMaps = GetNumMipLevels() > 1;
 
 	switch (alg)
 	{
 	case RA_BILINEAR:
-		throw Exception(Text("RA_BILINEAR NOT SUPPORTED!"));
+		ResampleImageRGBA8(static_cast<const UInt8*>(data), size, newData, newSize, RF_TENT);
 		break;
 	case RA_NEAREST_NEIGHBOR:
 		ResizePixelsNearestNeighbor(newSize, newData);
 		break;
+	case RA_BICUBIC:
+		ResampleImageRGBA8(static_cast<const UInt8*>(data), size, newData, newSize, RF_CATMULL_ROM);
+		break;
 	}
 	return gd->CreateTexture(tp);
 }
@@ -1,9 +1,10 @@
 #pragma once
 #include "MakoCommon.h"
 #include "MakoString.h"
-#include "MakoReferenceCounted.h"
+#include "MakoObjectPool.h"
 #include "MakoHardwareBuffer.h"
 #include "MakoVec2d.h"
+#include "MakoArrayList.h"
 
 MAKO_BEGIN_NAMESPACE
 
@@ -30,18 +31,56 @@ enum COLOR_FORMAT
 	//! red, green, blue and alpha. This is the most widely used color 
 	//! format of the Mako Engine.
 	CF_R8G8B8A8,
-	
+
+	//! 8 bits per pixel, alpha only. It's drawn as white with that alpha,
+	//! tinted by the color it's drawn with. Glyph atlases use it.
+	CF_A8,
+
+	//! Block compressed formats, also known as DXT or S3TC. The image is
+	//! stored in blocks of 4x4 pixels, row by row; images whose size isn't a
+	//! multiple of 4 are padded. They can't be read or written pixel by pixel,
+	//! see MakoBlockCompression.h.
+
+	//! 4 bits per pixel: two RGB565 colors and 2 bit indices between them.
+	//! Alpha is 0 or 255. Known as DXT1.
+	CF_BC1,
+	//! 8 bits per pixel: a BC1 block for the colors, preceded by a BC4 block
+	//! for alpha. Known as DXT5.
+	CF_BC3,
+	//! 4 bits per pixel: one channel, red, with two 8 bit endpoints and 3
+	//! bit indices between them. Known as ATI1.
+	CF_BC4,
+	//! 8 bits per pixel: two BC4 blocks, for red and green. Known as ATI2,
+	//! and used for normal maps.
+	CF_BC5,
+
 	CF_ENUM_LENGTH
 };
 
 //! Texture resizing algorithms
 enum RESIZE_ALGORITHM
 {
+	//! Interpolates between the 4 nearest texels. When shrinking, it averages
+	//! all of the texels under a pixel with a triangle filter instead.
 	RA_BILINEAR,
 	RA_NEAREST_NEIGHBOR,
+	//! Like RA_BILINEAR, but with a Catmull-Rom spline over 4x4 texels,
+	//! which is sharper.
+	RA_BICUBIC,
 	RA_ENUM_LENGTH
 };
 
+//! Filters a Texture can generate it's mip levels with
+enum MIP_FILTER
+{
+	//! Averages 2x2 texels of the level above
+	MF_BOX,
+	//! A Kaiser windowed sinc filter, which keeps the levels sharper than
+	//! MF_BOX, but takes longer.
+	MF_KAISER,
+	MF_ENUM_LENGTH
+};
+
 //! This function gets the stride for a particular color format, in the 
 //! number of bits.
 //! \return The stride for the color format, in the number of bits.
@@ -51,19 +90,47 @@ MAKO_INLINE UInt32 GetColorStride(COLOR_FORMAT format)
 	{
 	case CF_R8G8B8A8:
 		return 32;
+	case CF_A8:
+		return 8;
+	case CF_BC1:
+	case CF_BC4:
+		return 4;
+	case CF_BC3:
+	case CF_BC5:
+		return 8;
 	}
 	return 0xFFFFFFFF;
 }
 
+//! Check if a color format stores blocks of 4x4 pixels
+MAKO_INLINE bool IsBlockCompressed(COLOR_FORMAT format)
+{ return format == CF_BC1 || format == CF_BC3 || format == CF_BC4 || format == CF_BC5; }
+
+//! Get the number of bytes a 4x4 block of a block compressed format takes
+MAKO_INLINE UInt32 GetBlockSize(COLOR_FORMAT format)
+{ return GetColorStride(format) * 16 / 8; }
+
+//! Get the number of bytes an image of a color format takes
+MAKO_INLINE UInt32 GetImageDataSize(COLOR_FORMAT format, const Size2d& size)
+{
+	if (IsBlockCompressed(format))
+		return ((size.x + 3) / 4) * ((size.y + 3) / 4) * GetBlockSize(format);
+	return size.x * size.y * (GetColorStride(format) / 8);
+}
+
 struct TextureCreationParams
 {
-	MAKO_INLINE TextureCreationParams() : data(nullptr), copyFromData(false) {}
+	MAKO_INLINE TextureCreationParams()
+		: data(nullptr), copyFromData(false), numMipLevels(1), generateMipMaps(false),
+		  mipFilter(MF_BOX) {}
 	MAKO_INLINE ~TextureCreationParams() {}
 
 	//! Image data for a texture is stored row by row in memory. Therefore,
 	//! to access a single pixel, the offset is calculated by:
 	//! u8pvar += ((y * colorStride) * width) + (x * colorStride)
 	//! It must be in the standard format of the Mako engine (A8R8G8B8 format).
+	//! If numMipLevels is more than 1, the smaller levels follow the image,
+	//! one after another.
 	void* data;
 	
 	//! The dimensions of the texture.
@@ -76,6 +143,22 @@ struct TextureCreationParams
 	//! merely holding the pointer to data and deleting it's contents on 
 	//! deconstruction.
 	bool copyFromData;
+
+	//! The number of mip levels in data, each half the size of the one above
+	//! it (see GetNextMipLevelSize()), rounded down.
+	UInt32 numMipLevels;
+
+	//! If set to true and data has only one level, the Texture generates a
+	//! full chain of mip levels from data when it's created, which takes a
+	//! third more memory and the time to filter it. The texture loaders set
+	//! it, so textures loaded from files have mip maps; textures that are only
+	//! drawn in 2d, at their own size, don't need them. Only CF_R8G8B8A8
+	//! textures can generate them; the levels of other formats have to be
+	//! in data.
+	bool generateMipMaps;
+
+	//! The filter the mip levels are generated with
+	MIP_FILTER mipFilter;
 };
 
 // Forward declaration
@@ -85,9 +168,17 @@ class GraphicsDevice;
 //! This process is akin to applying patterned paper to a plain white box.
 //! In the Mako engine, a Texture is also used to represent a general
 //! purpose image.
-class Texture : public ReferenceCounted
+//! Textures are allocated from the pool GetPool() returns.
+class Texture : public PooledObject<Texture>
 {
 private:
+	struct MipLevel
+	{
+		Size2d size;
+		//! Offset of the level's pixels in data
+		UInt32 offset;
+	};
+
 	GraphicsDevice* gd;
 	TextureHardwareBuffer* hardwareTex;
 
@@ -98,12 +189,54 @@ private:
 	
 	const UInt32 bitsPerPixel, bytesPerPixel;
 
+	//! Every mip level, level 0 included. The levels are stored in data, one
+	//! after another.
+	ArrayList<MipLevel> mipLevels;
+
+	//! Fills mipLevels with numLevels levels, starting at the size of the texture
+	void SetMipLevels(UInt32 numLevels);
+
 	void ResizePixelsNearestNeighbor(const Size2d& newSize, void* out) const;
 public:
 	Texture(GraphicsDevice* gd, const TextureCreationParams& params);
 	~Texture();
 
+	//! Get the pool every Texture is allocated from
+	MAKO_API static ObjectPool& GetPool();
+
+	//! Creates a copy of the texture with another size. RA_BILINEAR and
+	//! RA_BICUBIC filter gamma-correct, with the kernels mip levels are
+	//! generated with. The copy has mip levels if this texture has them.
 	MAKO_API Texture* CreateStretched(const Size2d& newSize, RESIZE_ALGORITHM alg = RA_NEAREST_NEIGHBOR) const;
+
+	//! Generates a full chain of mip levels from the image data, replacing
+	//! the current one. Each level is filtered gamma-correct from the one
+	//! above it, in parallel if the Application has a JobSystem. Call it
+	//! again after the image data was changed, before updating the
+	//! TextureHardwareBuffer. Throws for block compressed textures.
+	MAKO_API void GenerateMipMaps(MIP_FILTER filter = MF_BOX);
+
+	//! Removes every mip level but the image data itself
+	MAKO_API void RemoveMipMaps();
+
+	//! Get the number of mip levels, which is 1 if there are no mip maps
+	MAKO_INLINE UInt32 GetNumMipLevels() const
+	{ return mipLevels.size(); }
+
+	//! Get the size of a mip level. Level 0 is the size of the texture.
+	MAKO_INLINE const Size2d& GetMipLevelSize(UInt32 level) const
+	{ return mipLevels[level].size; }
+
+	//! Get the pixels of a mip level. Level 0 is the image data.
+	MAKO_INLINE const void* GetMipLevelData(UInt32 level) const
+	{ return static_cast<const UInt8*>(data) + mipLevels[level].offset; }
+
+	MAKO_INLINE void* GetMipLevelData(UInt32 level)
+	{ return static_cast<UInt8*>(data) + mipLevels[level].offset; }
+
+	//! Get the number of bytes of the pixels of every mip level together
+	MAKO_INLINE UInt32 GetDataSize() const
+	{ return mipLevels.back().offset + GetImageDataSize(format, mipLevels.back().size); }
 	
 	MAKO_INLINE const Size2d& GetSize() const
 	{ return size; }
@@ -124,10 +257,10 @@ public:
 	{ return data; }
 
 	MAKO_INLINE const void* GetImageDataEnd() const
-	{ return (UInt8*)data + (GetSize().x * GetSize().y * GetBytesPerPixel()); }
+	{ return (UInt8*)data + GetImageDataSize(format, size); }
 
 	MAKO_INLINE void* GetImageDataEnd()
-	{ return (UInt8*)data + (GetSize().x * GetSize().y * GetBytesPerPixel()); }
+	{ return (UInt8*)data + GetImageDataSize(format, size); }
 
 	MAKO_INLINE UInt32 GetBitsPerPixel() const
 	{ return bitsPerPixel; }
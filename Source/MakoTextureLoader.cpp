@@ -0,0 +1,16 @@
+#include "MakoTextureLoader.h"
+#include "MakoTexture.h"
+#include "MakoApplication.h"
+#include "MakoGraphicsDevice.h"
+
+MAKO_BEGIN_NAMESPACE
+
+Texture* TextureLoader::Load(InputStream* stream)
+{
+	TextureCreationParams params;
+	if (!Decode(stream, params))
+		return nullptr;
+	return APP()->GD()->CreateTexture(params);
+}
+
+MAKO_END_NAMESPACE
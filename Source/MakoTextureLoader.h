@@ -7,6 +7,7 @@ MAKO_BEGIN_NAMESPACE
 // Forward declarations
 class Texture;
 class InputStream;
+struct TextureCreationParams;
 
 //! This class can load Textures (images) from data
 class TextureLoader : public Loader
@@ -14,7 +15,18 @@ class TextureLoader : public Loader
 public:
 	//! Load a texture from a file
 	//! \param[in] filePath The file path of the texture
-	virtual Texture* Load(InputStream* stream) = 0;
+	//! \return The texture, or nullptr if the data isn't of this loader's type.
+	MAKO_API Texture* Load(InputStream* stream);
+
+	//! Decode a texture without creating it, so the texture can be created
+	//! later on the thread that renders. Decode() doesn't use the
+	//! GraphicsDevice, and may be called by several threads at once.
+	//! \param[out] params Receives the pixels. data is allocated with new [],
+	//! and is owned by whoever creates the texture from params.
+	//! generateMipMaps is set, so a texture without mip levels in the file
+	//! gets them when it's created.
+	//! \return false if the data isn't of this loader's type.
+	virtual bool Decode(InputStream* stream, TextureCreationParams& params) = 0;
 	
 	virtual ~TextureLoader() {}
 };
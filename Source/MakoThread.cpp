@@ -0,0 +1,190 @@
+#include "MakoThread.h"
+#include "MakoException.h"
+#include "MakoOS.h"
+#if MAKO_PLATFORM != MAKO_PLATFORM_WIN32
+#include <pthread.h>
+#include <semaphore.h>
+#include <sched.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+MAKO_BEGIN_NAMESPACE
+
+#if MAKO_PLATFORM == MAKO_PLATFORM_WIN32
+
+////////////////////////////////////////////////////////////////////////////////////////
+// Thread
+
+unsigned long __stdcall Thread::Start(void* thread)
+{
+	Thread* t = static_cast<Thread*>(thread);
+	t->function(t->arg);
+	return 0;
+}
+
+Thread::Thread(Function function, void* arg)
+: function(function), arg(arg), handle(nullptr), joined(false)
+{
+	handle = CreateThread(nullptr, 0, Start, this, 0, nullptr);
+	if (!handle)
+		throw Exception(Text("CreateThread() failed in Thread::Thread()"));
+}
+
+void Thread::Join()
+{
+	if (joined)
+		return;
+	WaitForSingleObject(handle, INFINITE);
+	CloseHandle(handle);
+	joined = true;
+}
+
+UInt32 Thread::GetNumHardwareThreads()
+{
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors;
+}
+
+void Thread::YieldCPU()
+{ SwitchToThread(); }
+
+////////////////////////////////////////////////////////////////////////////////////////
+// Mutex
+
+Mutex::Mutex()
+: handle(new CRITICAL_SECTION)
+{ InitializeCriticalSection(static_cast<CRITICAL_SECTION*>(handle)); }
+
+Mutex::~Mutex()
+{
+	DeleteCriticalSection(static_cast<CRITICAL_SECTION*>(handle));
+	delete static_cast<CRITICAL_SECTION*>(handle);
+}
+
+void Mutex::Lock()
+{ EnterCriticalSection(static_cast<CRITICAL_SECTION*>(handle)); }
+
+void Mutex::Unlock()
+{ LeaveCriticalSection(static_cast<CRITICAL_SECTION*>(handle)); }
+
+////////////////////////////////////////////////////////////////////////////////////////
+// Semaphore
+
+Semaphore::Semaphore(UInt32 initialCount)
+: handle(nullptr)
+{
+	handle = CreateSemaphoreW(nullptr, initialCount, 0x7FFFFFFF, nullptr);
+	if (!handle)
+		throw Exception(Text("CreateSemaphore() failed in Semaphore::Semaphore()"));
+}
+
+Semaphore::~Semaphore()
+{ CloseHandle(handle); }
+
+void Semaphore::Post(UInt32 count)
+{ ReleaseSemaphore(handle, count, nullptr); }
+
+void Semaphore::Wait()
+{ WaitForSingleObject(handle, INFINITE); }
+
+#else
+
+////////////////////////////////////////////////////////////////////////////////////////
+// Thread
+
+void* Thread::Start(void* thread)
+{
+	Thread* t = static_cast<Thread*>(thread);
+	t->function(t->arg);
+	return nullptr;
+}
+
+Thread::Thread(Function function, void* arg)
+: function(function), arg(arg), handle(new pthread_t), joined(false)
+{
+	if (pthread_create(static_cast<pthread_t*>(handle), nullptr, Start, this))
+	{
+		delete static_cast<pthread_t*>(handle);
+		throw Exception(Text("pthread_create() failed in Thread::Thread()"));
+	}
+}
+
+void Thread::Join()
+{
+	if (joined)
+		return;
+	pthread_join(*static_cast<pthread_t*>(handle), nullptr);
+	delete static_cast<pthread_t*>(handle);
+	joined = true;
+}
+
+UInt32 Thread::GetNumHardwareThreads()
+{
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n > 0 ? (UInt32)n : 1;
+}
+
+void Thread::YieldCPU()
+{ sched_yield(); }
+
+////////////////////////////////////////////////////////////////////////////////////////
+// Mutex
+
+Mutex::Mutex()
+: handle(new pthread_mutex_t)
+{ pthread_mutex_init(static_cast<pthread_mutex_t*>(handle), nullptr); }
+
+Mutex::~Mutex()
+{
+	pthread_mutex_destroy(static_cast<pthread_mutex_t*>(handle));
+	delete static_cast<pthread_mutex_t*>(handle);
+}
+
+void Mutex::Lock()
+{ pthread_mutex_lock(static_cast<pthread_mutex_t*>(handle)); }
+
+void Mutex::Unlock()
+{ pthread_mutex_unlock(static_cast<pthread_mutex_t*>(handle)); }
+
+////////////////////////////////////////////////////////////////////////////////////////
+// Semaphore
+
+Semaphore::Semaphore(UInt32 initialCount)
+: handle(new sem_t)
+{
+	if (sem_init(static_cast<sem_t*>(handle), 0, initialCount))
+	{
+		delete static_cast<sem_t*>(handle);
+		throw Exception(Text("sem_init() failed in Semaphore::Semaphore()"));
+	}
+}
+
+Semaphore::~Semaphore()
+{
+	sem_destroy(static_cast<sem_t*>(handle));
+	delete static_cast<sem_t*>(handle);
+}
+
+void Semaphore::Post(UInt32 count)
+{
+	while (count--)
+		sem_post(static_cast<sem_t*>(handle));
+}
+
+void Semaphore::Wait()
+{
+	// Signals interrupt the wait
+	while (sem_wait(static_cast<sem_t*>(handle)) && errno == EINTR) {}
+}
+
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////
+// Both
+
+Thread::~Thread()
+{ Join(); }
+
+MAKO_END_NAMESPACE
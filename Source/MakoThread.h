@@ -0,0 +1,127 @@
+#pragma once
+#include "MakoCommon.h"
+#include "MakoAtomic.h"
+
+MAKO_BEGIN_NAMESPACE
+
+//! A thread of execution. The thread starts running as soon as it's
+//! constructed, and is joined when it's destroyed.
+class Thread
+{
+public:
+	//! The function a thread runs
+	typedef void (*Function)(void* arg);
+private:
+	Function function;
+	void* arg;
+	void* handle;
+	bool joined;
+
+	// Not copyable
+	Thread(const Thread&);
+	Thread& operator = (const Thread&);
+
+#if MAKO_PLATFORM == MAKO_PLATFORM_WIN32
+	static unsigned long __stdcall Start(void* thread);
+#else
+	static void* Start(void* thread);
+#endif
+public:
+	//! Starts a thread that calls function(arg). Throws an Exception if the
+	//! thread can't be created.
+	MAKO_API Thread(Function function, void* arg);
+
+	//! Joins the thread, if it wasn't joined yet
+	MAKO_API ~Thread();
+
+	//! Waits until the thread's function returned
+	MAKO_API void Join();
+
+	//! Get the number of threads the processors can run at the same time
+	MAKO_API static UInt32 GetNumHardwareThreads();
+
+	//! Gives the rest of the calling thread's time slice to other threads
+	MAKO_API static void YieldCPU();
+};
+
+//! A lock that puts threads waiting for it to sleep
+class Mutex
+{
+private:
+	void* handle;
+
+	// Not copyable
+	Mutex(const Mutex&);
+	Mutex& operator = (const Mutex&);
+public:
+	MAKO_API Mutex();
+	MAKO_API ~Mutex();
+
+	MAKO_API void Lock();
+	MAKO_API void Unlock();
+};
+
+//! A lock that spins while it waits. It's cheaper than a Mutex when it's
+//! only held for a few instructions at a time.
+class SpinLock
+{
+private:
+	volatile Int32 locked;
+public:
+	MAKO_INLINE SpinLock()
+	: locked(0) {}
+
+	MAKO_INLINE void Lock()
+	{
+		while (AtomicCompareExchange(&locked, 1, 0) != 0)
+		{
+			do CPUPause(); while (locked);
+		}
+	}
+
+	MAKO_INLINE bool TryLock()
+	{ return AtomicCompareExchange(&locked, 1, 0) == 0; }
+
+	MAKO_INLINE void Unlock()
+	{ AtomicStore(&locked, 0); }
+};
+
+//! Locks a Mutex or SpinLock for as long as it exists
+template <typename L>
+class ScopedLock
+{
+private:
+	L& lock;
+
+	// Not copyable
+	ScopedLock(const ScopedLock&);
+	ScopedLock& operator = (const ScopedLock&);
+public:
+	MAKO_INLINE ScopedLock(L& lock)
+	: lock(lock) { lock.Lock(); }
+
+	MAKO_INLINE ~ScopedLock()
+	{ lock.Unlock(); }
+};
+
+//! A counter that threads can wait on until it's above zero
+class Semaphore
+{
+private:
+	void* handle;
+
+	// Not copyable
+	Semaphore(const Semaphore&);
+	Semaphore& operator = (const Semaphore&);
+public:
+	MAKO_API Semaphore(UInt32 initialCount = 0);
+	MAKO_API ~Semaphore();
+
+	//! Adds count to the counter, waking up to count waiting threads
+	MAKO_API void Post(UInt32 count = 1);
+
+	//! Waits until the counter is above zero, then subtracts one from it
+	MAKO_API void Wait();
+};
+
+MAKO_END_NAMESPACE
@@ -16,7 +16,9 @@ enum VERTEX_TYPE
 	VT_STANDARD = sizeof(Float32) * 5,
 	// Float32's: position(3), tcoords(4) = 7
 	VT_T2 = sizeof(Float32) * 7,
-	VT_ENUM_LENGTH = 2
+	// Float32's: position(3), normal(3), tcoord0(2) = 8
+	VT_NORMAL = sizeof(Float32) * 8,
+	VT_ENUM_LENGTH = 3
 };
 
 class Vertex
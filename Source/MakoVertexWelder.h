@@ -0,0 +1,68 @@
+#pragma once
+#include "MakoCommon.h"
+#include "MakoArrayList.h"
+#include <string.h>
+
+MAKO_BEGIN_NAMESPACE
+
+//! Builds a vertex buffer in which every vertex is unique. Vertices are
+//! compared by their bytes, so V must not have padding, which is true for
+//! StandardVertex and T2Vertex. Add() returns the index of the vertex in the
+//! buffer, which is only appended to if the vertex wasn't added before.
+//! Lookups go through an open addressing hash table, so welding n
+//! vertices takes O(n).
+template <typename V>
+class VertexWelder
+{
+private:
+	ArrayList<V>& vertices;
+	//! Index + 1 of a vertex in vertices, 0 for empty slots
+	ArrayList<UInt32> table;
+	UInt32 mask;
+
+	//! FNV-1a hash of the bytes of v
+	static MAKO_INLINE UInt32 Hash(const V& v)
+	{
+		const UInt8* bytes = reinterpret_cast<const UInt8*>(&v);
+		UInt32 h = 2166136261u;
+		for (UInt32 i = 0; i < sizeof(V); ++i)
+			h = (h ^ bytes[i]) * 16777619u;
+		return h;
+	}
+public:
+	//! \param[in] vertices The vertex buffer to append the unique vertices to.
+	//! \param[in] maxVertices The most vertices that will be added, so the
+	//! table never has to grow.
+	VertexWelder(ArrayList<V>& vertices, UInt32 maxVertices)
+		: vertices(vertices)
+	{
+		// Keep the table at most half full
+		UInt32 size = 16;
+		while (size < maxVertices * 2)
+			size <<= 1;
+		table.assign(size, 0);
+		mask = size - 1;
+		vertices.reserve(vertices.size() + maxVertices);
+	}
+
+	//! Get the index of v in the vertex buffer, appending it if it's new
+	UInt32 Add(const V& v)
+	{
+		UInt32 slot = Hash(v) & mask;
+		for (;;)
+		{
+			const UInt32 entry = table[slot];
+			if (!entry)
+				break;
+			if (memcmp(&vertices[entry - 1], &v, sizeof(V)) == 0)
+				return entry - 1;
+			slot = (slot + 1) & mask;
+		}
+
+		vertices.push_back(v);
+		table[slot] = vertices.size();
+		return vertices.size() - 1;
+	}
+};
+
+MAKO_END_NAMESPACE